@@ -29,24 +29,24 @@
  *
  * To facilitate presenting entries to users, we create "representative" query
  * strings in which constants are replaced with parameter symbols ($n), to
- * make it clearer what a normalized entry can represent.  To save on shared
- * memory, and to avoid having to truncate oversized query strings, we store
- * these strings in a temporary external query-texts file.  Offsets into this
- * file are kept in shared memory.
+ * make it clearer what a normalized entry can represent.  These strings are
+ * kept in full, next to the hashtable itself, in a DSA area that lives inside
+ * our main shared memory chunk.  The space they may take up is bounded by
+ * pg_stat_statements.query_text_memory.
  *
- * Note about locking issues: to create or delete an entry in the shared
- * hashtable, one must hold pgss->lock exclusively.  Modifying any field
- * in an entry except the counters requires the same.  To look up an entry,
- * one must hold the lock shared.  To read or update the counters within
- * an entry, one must hold the lock shared or exclusive (so the entry doesn't
- * disappear!) and also take the entry's mutex spinlock.
- * The shared state variable pgss->extent (the next free spot in the external
- * query-text file) should be accessed only while holding either the
- * pgss->mutex spinlock, or exclusive lock on pgss->lock.  We use the mutex to
- * allow reserving file space while holding only shared lock on pgss->lock.
- * Rewriting the entire external query-text file, eg for garbage collection,
- * requires holding pgss->lock exclusively; this allows individual entries
- * in the file to be read or written while holding only shared lock.
+ * Note about locking issues: the shared hashtable is a dshash table, made up
+ * of independently locked partitions.  To create or delete an entry, one
+ * must hold its partition lock exclusively.  Modifying any field in an entry
+ * except the counters requires the same.  To look up an entry, one must hold
+ * the partition lock shared.  To read or update the counters within an
+ * entry, one must hold the partition lock shared or exclusive (so the entry
+ * doesn't disappear!) and also take the entry's mutex spinlock.  A query
+ * text never changes once its entry has been created, and is freed together
+ * with the entry.
+ *
+ * pgss->lock only keeps entry_dealloc() and entry_reset() from running
+ * concurrently.  They visit the hashtable one partition at a time, so
+ * lookups and counter updates elsewhere in the table are never blocked.
  *
  *
  * Copyright (c) 2008-2021, PostgreSQL Global Development Group
@@ -59,13 +59,13 @@
 #include "postgres.h"
 
 #include <math.h>
-#include <sys/stat.h>
 #include <unistd.h>
 
 #include "catalog/pg_authid.h"
 #include "common/hashfn.h"
 #include "executor/instrument.h"
 #include "funcapi.h"
+#include "lib/dshash.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "optimizer/planner.h"
@@ -74,12 +74,14 @@
 #include "parser/scanner.h"
 #include "parser/scansup.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/spin.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/dsa.h"
 #include "utils/memutils.h"
 #include "utils/timestamp.h"
 
@@ -88,18 +90,11 @@ PG_MODULE_MAGIC;
 /* Location of permanent stats file (valid when database is shut down) */
 #define PGSS_DUMP_FILE	PGSTAT_STAT_PERMANENT_DIRECTORY "/pg_stat_statements.stat"
 
-/*
- * Location of external query text file.  We don't keep it in the core
- * system's stats_temp_directory.  The core system can safely use that GUC
- * setting, because the statistics collector temp file paths are set only once
- * as part of changing the GUC, but pg_stat_statements has no way of avoiding
- * race conditions.  Besides, we only expect modest, infrequent I/O for query
- * strings, so placing the file on a faster filesystem is not compelling.
- */
-#define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
+/* External query text file used by older versions, removed at startup */
+#define PGSS_OLD_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
 
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20201218;
+static const uint32 PGSS_FILE_HEADER = 0x20210318;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -108,12 +103,15 @@ static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
 #define USAGE_EXEC(duration)	(1.0)
 #define USAGE_INIT				(1.0)	/* including initial planning */
 #define ASSUMED_MEDIAN_INIT		(10.0)	/* initial assumed median usage */
-#define ASSUMED_LENGTH_INIT		1024	/* initial assumed mean query length */
 #define USAGE_DECREASE_FACTOR	(0.99)	/* decreased every entry_dealloc */
 #define STICKY_DECREASE_FACTOR	(0.50)	/* factor for sticky entries */
 #define USAGE_DEALLOC_PERCENT	5	/* free this % of entries at once */
 #define IS_STICKY(c)	((c.calls[PGSS_PLAN] + c.calls[PGSS_EXEC]) == 0)
 
+#define PGSS_ENTRY_OVERHEAD		64	/* dshash item header and bucket, roughly */
+#define PGSS_AREA_SLACK			(4 * 1024 * 1024)	/* DSA's own bookkeeping */
+#define PGSS_TEXT_BUDGET		((uint64) pgss_query_text_memory * 1024)
+
 #define JUMBLE_SIZE				1024	/* query serialization buffer size */
 
 /*
@@ -149,8 +147,8 @@ typedef enum pgssStoreKind
  *
  * Right now, this structure contains no padding.  If you add any, make sure
  * to teach pgss_store() to zero the padding bytes.  Otherwise, things will
- * break, because pgss_hash is created using HASH_BLOBS, and thus tag_hash
- * is used to hash this.
+ * break, because pgss_hash is created with dshash_memhash and dshash_memcmp,
+ * which hash and compare the raw bytes of the key.
  */
 typedef struct pgssHashKey
 {
@@ -206,15 +204,14 @@ typedef struct pgssGlobalStats
 /*
  * Statistics per statement
  *
- * Note: in event of a failure in garbage collection of the query text file,
- * we reset query_offset to zero and query_len to -1.  This will be seen as
- * an invalid state by qtext_fetch().
+ * The query text is kept in pgss_area.  If there was no room for it when the
+ * entry was made, query_text is InvalidDsaPointer and query_len is -1.
  */
 typedef struct pgssEntry
 {
 	pgssHashKey key;			/* hash key of entry - MUST BE FIRST */
 	Counters	counters;		/* the statistics for this query */
-	Size		query_offset;	/* query text offset in external file */
+	dsa_pointer query_text;		/* query text in pgss_area, or invalid */
 	int			query_len;		/* # of valid bytes in query string, or -1 */
 	int			encoding;		/* query text encoding */
 	slock_t		mutex;			/* protects the counters only */
@@ -225,16 +222,19 @@ typedef struct pgssEntry
  */
 typedef struct pgssSharedState
 {
-	LWLock	   *lock;			/* protects hashtable search/modification */
-	double		cur_median_usage;	/* current median usage in hashtable */
-	Size		mean_query_len; /* current mean entry text length */
+	LWLock	   *lock;			/* serializes entry_dealloc/entry_reset */
+	dshash_table_handle hash_handle;	/* the hashtable in pgss_area */
+	pg_atomic_uint32 num_entries;	/* # of entries in the hashtable */
+	pg_atomic_uint64 text_bytes;	/* space taken by query texts */
 	slock_t		mutex;			/* protects following fields only: */
-	Size		extent;			/* current extent of query file */
-	int			n_writers;		/* number of active writers to query file */
-	int			gc_count;		/* query file garbage collection cycle count */
+	double		cur_median_usage;	/* current median usage in hashtable */
 	pgssGlobalStats stats;		/* global statistics for pgss */
 } pgssSharedState;
 
+/* The DSA area holding the hashtable and query texts follows the state */
+#define PGSS_AREA_PLACE(s) \
+	((char *) (s) + MAXALIGN(sizeof(pgssSharedState)))
+
 /*
  * Struct for tracking locations/lengths of constants during normalization
  */
@@ -289,7 +289,17 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 
 /* Links to shared memory state */
 static pgssSharedState *pgss = NULL;
-static HTAB *pgss_hash = NULL;
+static dsa_area *pgss_area = NULL;
+static dshash_table *pgss_hash = NULL;
+
+/* Parameters of the hashtable; tranche_id is filled in at runtime */
+static dshash_parameters pgss_hash_params = {
+	sizeof(pgssHashKey),
+	sizeof(pgssEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	0
+};
 
 /*---- GUC variables ----*/
 
@@ -309,6 +319,7 @@ static const struct config_enum_entry track_options[] =
 };
 
 static int	pgss_max;			/* max # statements to track */
+static int	pgss_query_text_memory; /* memory for query texts, in kB */
 static int	pgss_track;			/* tracking level */
 static bool pgss_track_utility; /* whether to track utility commands */
 static bool pgss_track_planning;	/* whether to track planning duration */
@@ -319,14 +330,6 @@ static bool pgss_save;			/* whether to save stats across shutdown */
 	(pgss_track == PGSS_TRACK_ALL || \
 	(pgss_track == PGSS_TRACK_TOP && (level) == 0))
 
-#define record_gc_qtexts() \
-	do { \
-		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss; \
-		SpinLockAcquire(&s->mutex); \
-		s->gc_count++; \
-		SpinLockRelease(&s->mutex); \
-	} while(0)
-
 /*---- Function declarations ----*/
 
 void		_PG_init(void);
@@ -369,16 +372,14 @@ static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 										pgssVersion api_version,
 										bool showtext);
 static Size pgss_memsize(void);
-static pgssEntry *entry_alloc(pgssHashKey *key, Size query_offset, int query_len,
-							  int encoding, bool sticky);
+static Size pgss_area_size(void);
+static void pgss_attach(void);
+static pgssEntry *entry_alloc(pgssHashKey *key, const char *query,
+							  int query_len, int encoding, bool sticky);
 static void entry_dealloc(void);
-static bool qtext_store(const char *query, int query_len,
-						Size *query_offset, int *gc_count);
-static char *qtext_load_file(Size *buffer_size);
-static char *qtext_fetch(Size query_offset, int query_len,
-						 char *buffer, Size buffer_size);
-static bool need_gc_qtexts(void);
-static void gc_qtexts(void);
+static void entry_remove(dshash_seq_status *hash_seq, pgssEntry *entry);
+static dsa_pointer qtext_store(const char *query, int query_len);
+static void qtext_free(dsa_pointer query_text, int query_len);
 static void entry_reset(Oid userid, Oid dbid, uint64 queryid);
 static void AppendJumble(pgssJumbleState *jstate,
 						 const unsigned char *item, Size size);
@@ -427,6 +428,19 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_stat_statements.query_text_memory",
+							"Sets the amount of shared memory used for query texts by pg_stat_statements.",
+							NULL,
+							&pgss_query_text_memory,
+							10240,
+							64,
+							MAX_KILOBYTES,
+							PGC_POSTMASTER,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomEnumVariable("pg_stat_statements.track",
 							 "Selects which statements are tracked by pg_stat_statements.",
 							 NULL,
@@ -523,16 +537,12 @@ _PG_fini(void)
 /*
  * shmem_startup hook: allocate or attach to shared memory,
  * then load any pre-existing statistics from file.
- * Also create and load the query-texts file, which is expected to exist
- * (even if empty) while the module is enabled.
  */
 static void
 pgss_shmem_startup(void)
 {
 	bool		found;
-	HASHCTL		info;
 	FILE	   *file = NULL;
-	FILE	   *qfile = NULL;
 	uint32		header;
 	int32		num;
 	int32		pgver;
@@ -545,37 +555,50 @@ pgss_shmem_startup(void)
 
 	/* reset in case this is a restart within the postmaster */
 	pgss = NULL;
+	pgss_area = NULL;
 	pgss_hash = NULL;
 
 	/*
-	 * Create or attach to the shared memory state, including hash table
+	 * Create or attach to the shared memory state, including the area that
+	 * holds the hash table
 	 */
 	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
 
 	pgss = ShmemInitStruct("pg_stat_statements",
-						   sizeof(pgssSharedState),
+						   pgss_memsize(),
 						   &found);
 
 	if (!found)
 	{
+		MemoryContext oldcontext;
+
 		/* First time through ... */
 		pgss->lock = &(GetNamedLWLockTranche("pg_stat_statements"))->lock;
-		pgss->cur_median_usage = ASSUMED_MEDIAN_INIT;
-		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
+		pg_atomic_init_u32(&pgss->num_entries, 0);
+		pg_atomic_init_u64(&pgss->text_bytes, 0);
 		SpinLockInit(&pgss->mutex);
-		pgss->extent = 0;
-		pgss->n_writers = 0;
-		pgss->gc_count = 0;
+		pgss->cur_median_usage = ASSUMED_MEDIAN_INIT;
 		pgss->stats.dealloc = 0;
 		pgss->stats.stats_reset = GetCurrentTimestamp();
-	}
 
-	info.keysize = sizeof(pgssHashKey);
-	info.entrysize = sizeof(pgssEntry);
-	pgss_hash = ShmemInitHash("pg_stat_statements hash",
-							  pgss_max, pgss_max,
-							  &info,
-							  HASH_ELEM | HASH_BLOBS);
+		/*
+		 * Create the area and the hash table in it.  The area must never
+		 * grow beyond the space reserved for it, so that we don't create DSM
+		 * segments behind the postmaster's back.  We stay attached, and
+		 * backends forked from here inherit that; we never detach, so there
+		 * is no need to pin the area.  Our backend-local state has to
+		 * survive the deletion of PostmasterContext in child processes.
+		 */
+		oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		pgss_area = dsa_create_in_place(PGSS_AREA_PLACE(pgss),
+										pgss_area_size(),
+										pgss->lock->tranche, NULL);
+		dsa_set_size_limit(pgss_area, pgss_area_size());
+		pgss_hash_params.tranche_id = pgss->lock->tranche;
+		pgss_hash = dshash_create(pgss_area, &pgss_hash_params, NULL);
+		pgss->hash_handle = dshash_get_hash_table_handle(pgss_hash);
+		MemoryContextSwitchTo(oldcontext);
+	}
 
 	LWLockRelease(AddinShmemInitLock);
 
@@ -593,17 +616,12 @@ pgss_shmem_startup(void)
 		return;
 
 	/*
-	 * Note: we don't bother with locks here, because there should be no other
-	 * processes running when this code is reached.
+	 * Note: we don't bother with pgss->lock here, because there should be no
+	 * other processes running when this code is reached.
 	 */
 
-	/* Unlink query text file possibly left over from crash */
-	unlink(PGSS_TEXT_FILE);
-
-	/* Allocate new query text temp file */
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
-		goto write_error;
+	/* Unlink query text file possibly left behind by an older version */
+	unlink(PGSS_OLD_TEXT_FILE);
 
 	/*
 	 * If we were told not to load old statistics, we're done.  (Note we do
@@ -611,10 +629,7 @@ pgss_shmem_startup(void)
 	 * questionable but it's the historical behavior.)
 	 */
 	if (!pgss_save)
-	{
-		FreeFile(qfile);
 		return;
-	}
 
 	/*
 	 * Attempt to load old statistics from the dump file.
@@ -625,7 +640,6 @@ pgss_shmem_startup(void)
 		if (errno != ENOENT)
 			goto read_error;
 		/* No existing persisted stats file, so we're done */
-		FreeFile(qfile);
 		return;
 	}
 
@@ -645,7 +659,6 @@ pgss_shmem_startup(void)
 	{
 		pgssEntry	temp;
 		pgssEntry  *entry;
-		Size		query_offset;
 
 		if (fread(&temp, sizeof(pgssEntry), 1, file) != 1)
 			goto read_error;
@@ -654,36 +667,36 @@ pgss_shmem_startup(void)
 		if (!PG_VALID_BE_ENCODING(temp.encoding))
 			goto data_error;
 
-		/* Resize buffer as needed */
-		if (temp.query_len >= buffer_size)
+		/* Entries that had no room for their text were written without it */
+		if (temp.query_len >= 0)
 		{
-			buffer_size = Max(buffer_size * 2, temp.query_len + 1);
-			buffer = repalloc(buffer, buffer_size);
-		}
+			/* Resize buffer as needed */
+			if (temp.query_len >= buffer_size)
+			{
+				buffer_size = Max(buffer_size * 2, temp.query_len + 1);
+				buffer = repalloc(buffer, buffer_size);
+			}
 
-		if (fread(buffer, 1, temp.query_len + 1, file) != temp.query_len + 1)
-			goto read_error;
+			if (fread(buffer, 1, temp.query_len + 1, file) != temp.query_len + 1)
+				goto read_error;
 
-		/* Should have a trailing null, but let's make sure */
-		buffer[temp.query_len] = '\0';
+			/* Should have a trailing null, but let's make sure */
+			buffer[temp.query_len] = '\0';
+		}
 
 		/* Skip loading "sticky" entries */
 		if (IS_STICKY(temp.counters))
 			continue;
 
-		/* Store the query text */
-		query_offset = pgss->extent;
-		if (fwrite(buffer, 1, temp.query_len + 1, qfile) != temp.query_len + 1)
-			goto write_error;
-		pgss->extent += temp.query_len + 1;
-
 		/* make the hashtable entry (discards old entries if too many) */
-		entry = entry_alloc(&temp.key, query_offset, temp.query_len,
+		entry = entry_alloc(&temp.key, buffer, temp.query_len,
 							temp.encoding,
 							false);
 
 		/* copy in the actual stats */
 		entry->counters = temp.counters;
+
+		dshash_release_lock(pgss_hash, entry);
 	}
 
 	/* Read global statistics for pg_stat_statements */
@@ -692,20 +705,11 @@ pgss_shmem_startup(void)
 
 	pfree(buffer);
 	FreeFile(file);
-	FreeFile(qfile);
 
 	/*
 	 * Remove the persisted stats file so it's not included in
 	 * backups/replication standbys, etc.  A new file will be written on next
 	 * shutdown.
-	 *
-	 * Note: it's okay if the PGSS_TEXT_FILE is included in a basebackup,
-	 * because we remove that file on startup; it acts inversely to
-	 * PGSS_DUMP_FILE, in that it is only supposed to be around when the
-	 * server is running, whereas PGSS_DUMP_FILE is only supposed to be around
-	 * when the server is not running.  Leaving the file creates no danger of
-	 * a newly restored database having a spurious record of execution costs,
-	 * which is what we're really concerned about here.
 	 */
 	unlink(PGSS_DUMP_FILE);
 
@@ -722,41 +726,26 @@ data_error:
 			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 			 errmsg("ignoring invalid data in file \"%s\"",
 					PGSS_DUMP_FILE)));
-	goto fail;
-write_error:
-	ereport(LOG,
-			(errcode_for_file_access(),
-			 errmsg("could not write file \"%s\": %m",
-					PGSS_TEXT_FILE)));
 fail:
 	if (buffer)
 		pfree(buffer);
 	if (file)
 		FreeFile(file);
-	if (qfile)
-		FreeFile(qfile);
 	/* If possible, throw away the bogus file; ignore any error */
 	unlink(PGSS_DUMP_FILE);
-
-	/*
-	 * Don't unlink PGSS_TEXT_FILE here; it should always be around while the
-	 * server is running with pg_stat_statements enabled
-	 */
 }
 
 /*
  * shmem_shutdown hook: Dump statistics into file.
  *
- * Note: we don't bother with acquiring lock, because there should be no
- * other processes running when this is called.
+ * Note: we don't bother with pgss->lock, because there should be no other
+ * processes running when this is called.
  */
 static void
 pgss_shmem_shutdown(int code, Datum arg)
 {
 	FILE	   *file;
-	char	   *qbuffer = NULL;
-	Size		qbuffer_size = 0;
-	HASH_SEQ_STATUS hash_seq;
+	dshash_seq_status hash_seq;
 	int32		num_entries;
 	pgssEntry  *entry;
 
@@ -765,13 +754,15 @@ pgss_shmem_shutdown(int code, Datum arg)
 		return;
 
 	/* Safety check ... shouldn't get here unless shmem is set up. */
-	if (!pgss || !pgss_hash)
+	if (!pgss)
 		return;
 
 	/* Don't dump if told not to. */
 	if (!pgss_save)
 		return;
 
+	pgss_attach();
+
 	file = AllocateFile(PGSS_DUMP_FILE ".tmp", PG_BINARY_W);
 	if (file == NULL)
 		goto error;
@@ -780,33 +771,27 @@ pgss_shmem_shutdown(int code, Datum arg)
 		goto error;
 	if (fwrite(&PGSS_PG_MAJOR_VERSION, sizeof(uint32), 1, file) != 1)
 		goto error;
-	num_entries = hash_get_num_entries(pgss_hash);
+	num_entries = pg_atomic_read_u32(&pgss->num_entries);
 	if (fwrite(&num_entries, sizeof(int32), 1, file) != 1)
 		goto error;
 
-	qbuffer = qtext_load_file(&qbuffer_size);
-	if (qbuffer == NULL)
-		goto error;
-
 	/*
 	 * When serializing to disk, we store query texts immediately after their
-	 * entry data.  Any orphaned query texts are thereby excluded.
+	 * entry data.  Entries without a text are written with a query_len of -1
+	 * and nothing after them.
 	 */
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	dshash_seq_init(&hash_seq, pgss_hash, false);
+	while ((entry = dshash_seq_next(&hash_seq)) != NULL)
 	{
 		int			len = entry->query_len;
-		char	   *qstr = qtext_fetch(entry->query_offset, len,
-									   qbuffer, qbuffer_size);
-
-		if (qstr == NULL)
-			continue;			/* Ignore any entries with bogus texts */
 
 		if (fwrite(entry, sizeof(pgssEntry), 1, file) != 1 ||
-			fwrite(qstr, 1, len + 1, file) != len + 1)
+			(len >= 0 &&
+			 fwrite(dsa_get_address(pgss_area, entry->query_text),
+					1, len + 1, file) != len + 1))
 		{
-			/* note: we assume hash_seq_term won't change errno */
-			hash_seq_term(&hash_seq);
+			/* note: we assume dshash_seq_term won't change errno */
+			dshash_seq_term(&hash_seq);
 			goto error;
 		}
 	}
@@ -815,9 +800,6 @@ pgss_shmem_shutdown(int code, Datum arg)
 	if (fwrite(&pgss->stats, sizeof(pgssGlobalStats), 1, file) != 1)
 		goto error;
 
-	free(qbuffer);
-	qbuffer = NULL;
-
 	if (FreeFile(file))
 	{
 		file = NULL;
@@ -829,9 +811,6 @@ pgss_shmem_shutdown(int code, Datum arg)
 	 */
 	(void) durable_rename(PGSS_DUMP_FILE ".tmp", PGSS_DUMP_FILE, LOG);
 
-	/* Unlink query-texts file; it's not needed while shutdown */
-	unlink(PGSS_TEXT_FILE);
-
 	return;
 
 error:
@@ -839,12 +818,31 @@ error:
 			(errcode_for_file_access(),
 			 errmsg("could not write file \"%s\": %m",
 					PGSS_DUMP_FILE ".tmp")));
-	if (qbuffer)
-		free(qbuffer);
 	if (file)
 		FreeFile(file);
 	unlink(PGSS_DUMP_FILE ".tmp");
-	unlink(PGSS_TEXT_FILE);
+}
+
+/*
+ * Attach to the area and the hash table in it, unless this process is
+ * attached already.  Processes forked from the postmaster inherit its
+ * attachment, so this does real work only in EXEC_BACKEND builds.  The area
+ * is never destroyed, so there's no need to detach at process exit.
+ */
+static void
+pgss_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (pgss_hash)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	pgss_area = dsa_attach_in_place(PGSS_AREA_PLACE(pgss), NULL);
+	pgss_hash_params.tranche_id = pgss->lock->tranche;
+	pgss_hash = dshash_attach(pgss_area, &pgss_hash_params,
+							  pgss->hash_handle, NULL);
+	MemoryContextSwitchTo(oldcontext);
 }
 
 /*
@@ -862,7 +860,7 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query)
 	Assert(query->queryId == UINT64CONST(0));
 
 	/* Safety check... */
-	if (!pgss || !pgss_hash || !pgss_enabled(exec_nested_level))
+	if (!pgss || !pgss_enabled(exec_nested_level))
 		return;
 
 	/*
@@ -1277,9 +1275,11 @@ pgss_store(const char *query, uint64 queryId,
 	Assert(query != NULL);
 
 	/* Safety check... */
-	if (!pgss || !pgss_hash)
+	if (!pgss)
 		return;
 
+	pgss_attach();
+
 	/*
 	 * Confine our attention to the relevant part of the string, if the query
 	 * is a portion of a multi-statement source string.
@@ -1333,72 +1333,26 @@ pgss_store(const char *query, uint64 queryId,
 	key.dbid = MyDatabaseId;
 	key.queryid = queryId;
 
-	/* Lookup the hash table entry with shared lock. */
-	LWLockAcquire(pgss->lock, LW_SHARED);
-
-	entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_FIND, NULL);
+	/* Lookup the hash table entry, locking its partition in shared mode. */
+	entry = (pgssEntry *) dshash_find(pgss_hash, &key, false);
 
 	/* Create new entry, if not present */
 	if (!entry)
 	{
-		Size		query_offset;
-		int			gc_count;
-		bool		stored;
-		bool		do_gc;
-
 		/*
-		 * Create a new, normalized query string if caller asked.  We don't
-		 * need to hold the lock while doing this work.  (Note: in any case,
-		 * it's possible that someone else creates a duplicate hashtable entry
-		 * in the interval where we don't hold the lock below.  That case is
-		 * handled by entry_alloc.)
+		 * Create a new, normalized query string if caller asked.  No lock is
+		 * held while doing this work.  (Note: in any case, it's possible that
+		 * someone else creates a duplicate hashtable entry meanwhile.  That
+		 * case is handled by entry_alloc.)
 		 */
 		if (jstate)
-		{
-			LWLockRelease(pgss->lock);
 			norm_query = generate_normalized_query(jstate, query,
 												   query_location,
 												   &query_len);
-			LWLockAcquire(pgss->lock, LW_SHARED);
-		}
-
-		/* Append new query text to file with only shared lock held */
-		stored = qtext_store(norm_query ? norm_query : query, query_len,
-							 &query_offset, &gc_count);
-
-		/*
-		 * Determine whether we need to garbage collect external query texts
-		 * while the shared lock is still held.  This micro-optimization
-		 * avoids taking the time to decide this while holding exclusive lock.
-		 */
-		do_gc = need_gc_qtexts();
-
-		/* Need exclusive lock to make a new hashtable entry - promote */
-		LWLockRelease(pgss->lock);
-		LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 
-		/*
-		 * A garbage collection may have occurred while we weren't holding the
-		 * lock.  In the unlikely event that this happens, the query text we
-		 * stored above will have been garbage collected, so write it again.
-		 * This should be infrequent enough that doing it while holding
-		 * exclusive lock isn't a performance problem.
-		 */
-		if (!stored || pgss->gc_count != gc_count)
-			stored = qtext_store(norm_query ? norm_query : query, query_len,
-								 &query_offset, NULL);
-
-		/* If we failed to write to the text file, give up */
-		if (!stored)
-			goto done;
-
-		/* OK to create a new hashtable entry */
-		entry = entry_alloc(&key, query_offset, query_len, encoding,
-							jstate != NULL);
-
-		/* If needed, perform garbage collection while exclusive lock held */
-		if (do_gc)
-			gc_qtexts();
+		/* OK to create a new hashtable entry; it comes back locked */
+		entry = entry_alloc(&key, norm_query ? norm_query : query, query_len,
+							encoding, jstate != NULL);
 	}
 
 	/* Increment the counts, except when jstate is not NULL */
@@ -1467,8 +1421,7 @@ pgss_store(const char *query, uint64 queryId,
 		SpinLockRelease(&e->mutex);
 	}
 
-done:
-	LWLockRelease(pgss->lock);
+	dshash_release_lock(pgss_hash, entry);
 
 	/* We postpone this clean-up until we're out of the lock */
 	if (norm_query)
@@ -1579,18 +1532,14 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	MemoryContext oldcontext;
 	Oid			userid = GetUserId();
 	bool		is_allowed_role = false;
-	char	   *qbuffer = NULL;
-	Size		qbuffer_size = 0;
-	Size		extent = 0;
-	int			gc_count = 0;
-	HASH_SEQ_STATUS hash_seq;
+	dshash_seq_status hash_seq;
 	pgssEntry  *entry;
 
 	/* Superusers or members of pg_read_all_stats members are allowed */
 	is_allowed_role = is_member_of_role(GetUserId(), DEFAULT_ROLE_READ_ALL_STATS);
 
 	/* hash table must exist already */
-	if (!pgss || !pgss_hash)
+	if (!pgss)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
@@ -1653,73 +1602,15 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 
 	MemoryContextSwitchTo(oldcontext);
 
-	/*
-	 * We'd like to load the query text file (if needed) while not holding any
-	 * lock on pgss->lock.  In the worst case we'll have to do this again
-	 * after we have the lock, but it's unlikely enough to make this a win
-	 * despite occasional duplicated work.  We need to reload if anybody
-	 * writes to the file (either a retail qtext_store(), or a garbage
-	 * collection) between this point and where we've gotten shared lock.  If
-	 * a qtext_store is actually in progress when we look, we might as well
-	 * skip the speculative load entirely.
-	 */
-	if (showtext)
-	{
-		int			n_writers;
-
-		/* Take the mutex so we can examine variables */
-		{
-			volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
-
-			SpinLockAcquire(&s->mutex);
-			extent = s->extent;
-			n_writers = s->n_writers;
-			gc_count = s->gc_count;
-			SpinLockRelease(&s->mutex);
-		}
-
-		/* No point in loading file now if there are active writers */
-		if (n_writers == 0)
-			qbuffer = qtext_load_file(&qbuffer_size);
-	}
+	pgss_attach();
 
 	/*
-	 * Get shared lock, load or reload the query text file if we must, and
-	 * iterate over the hashtable entries.
-	 *
-	 * With a large hash table, we might be holding the lock rather longer
-	 * than one could wish.  However, this only blocks creation of new hash
-	 * table entries, and the larger the hash table the less likely that is to
-	 * be needed.  So we can hope this is okay.  Perhaps someday we'll decide
-	 * we need to partition the hash table to limit the time spent holding any
-	 * one lock.
+	 * Iterate over the hashtable entries.  Partitions are locked one at a
+	 * time, and only in shared mode, so this blocks creation and eviction of
+	 * entries in one partition at a time, and never blocks counter updates.
 	 */
-	LWLockAcquire(pgss->lock, LW_SHARED);
-
-	if (showtext)
-	{
-		/*
-		 * Here it is safe to examine extent and gc_count without taking the
-		 * mutex.  Note that although other processes might change
-		 * pgss->extent just after we look at it, the strings they then write
-		 * into the file cannot yet be referenced in the hashtable, so we
-		 * don't care whether we see them or not.
-		 *
-		 * If qtext_load_file fails, we just press on; we'll return NULL for
-		 * every query text.
-		 */
-		if (qbuffer == NULL ||
-			pgss->extent != extent ||
-			pgss->gc_count != gc_count)
-		{
-			if (qbuffer)
-				free(qbuffer);
-			qbuffer = qtext_load_file(&qbuffer_size);
-		}
-	}
-
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	dshash_seq_init(&hash_seq, pgss_hash, false);
+	while ((entry = dshash_seq_next(&hash_seq)) != NULL)
 	{
 		Datum		values[PG_STAT_STATEMENTS_COLS];
 		bool		nulls[PG_STAT_STATEMENTS_COLS];
@@ -1741,13 +1632,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 
 			if (showtext)
 			{
-				char	   *qstr = qtext_fetch(entry->query_offset,
-											   entry->query_len,
-											   qbuffer,
-											   qbuffer_size);
-
-				if (qstr)
+				if (entry->query_len >= 0)
 				{
+					char	   *qstr = dsa_get_address(pgss_area,
+													   entry->query_text);
 					char	   *enc;
 
 					enc = pg_any_to_server(qstr,
@@ -1761,7 +1649,7 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 				}
 				else
 				{
-					/* Just return a null if we fail to find the text */
+					/* Just return a null if there was no room for the text */
 					nulls[i++] = true;
 				}
 			}
@@ -1876,11 +1764,6 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	}
 
 	/* clean up and return the tuplestore */
-	LWLockRelease(pgss->lock);
-
-	if (qbuffer)
-		free(qbuffer);
-
 	tuplestore_donestoring(tupstore);
 }
 
@@ -1898,7 +1781,7 @@ pg_stat_statements_info(PG_FUNCTION_ARGS)
 	Datum		values[PG_STAT_STATEMENTS_INFO_COLS];
 	bool		nulls[PG_STAT_STATEMENTS_INFO_COLS];
 
-	if (!pgss || !pgss_hash)
+	if (!pgss)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
@@ -1934,16 +1817,39 @@ pgss_memsize(void)
 	Size		size;
 
 	size = MAXALIGN(sizeof(pgssSharedState));
-	size = add_size(size, hash_estimate_size(pgss_max, sizeof(pgssEntry)));
+	size = add_size(size, pgss_area_size());
 
 	return size;
 }
 
 /*
- * Allocate a new hashtable entry.
- * caller must hold an exclusive lock on pgss->lock
+ * Size of the DSA area holding the hashtable and the query texts.
  *
- * "query" need not be null-terminated; we rely on query_len instead
+ * DSA rounds requests up to size classes and keeps a partially used
+ * superblock around for each class, so we're generous: entries get twice
+ * their nominal size, which also covers the hashtable's bucket array and
+ * concurrent insertions briefly overshooting pg_stat_statements.max, and
+ * texts get half again as much as pg_stat_statements.query_text_memory.
+ */
+static Size
+pgss_area_size(void)
+{
+	Size		size;
+
+	size = mul_size(pgss_max, 2 * (sizeof(pgssEntry) + PGSS_ENTRY_OVERHEAD));
+	size = add_size(size, mul_size(pgss_query_text_memory, 1024 + 512));
+	size = add_size(size, PGSS_AREA_SLACK);
+
+	return size;
+}
+
+/*
+ * Allocate a new hashtable entry, and return it with its partition locked
+ * exclusively; the caller must release it with dshash_release_lock().  The
+ * caller must not hold any partition lock.
+ *
+ * "query" need not be null-terminated; we rely on query_len instead.  A
+ * negative query_len means that the entry has no text.
  *
  * If "sticky" is true, make the new entry artificially sticky so that it will
  * probably still be there when the query finishes execution.  We do this by
@@ -1951,24 +1857,38 @@ pgss_memsize(void)
  * speaking, query strings are normalized on a best effort basis, though it
  * would be difficult to demonstrate this even under artificial conditions.)
  *
- * Note: despite needing exclusive lock, it's not an error for the target
- * entry to already exist.  This is because pgss_store releases and
- * reacquires lock after failing to find a match; so someone else could
- * have made the entry while we waited to get exclusive lock.
+ * Note: it's not an error for the target entry to already exist.  pgss_store
+ * holds no lock between failing to find a match and getting here, so someone
+ * else could have made the entry meanwhile.
  */
 static pgssEntry *
-entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
+entry_alloc(pgssHashKey *key, const char *query, int query_len, int encoding,
 			bool sticky)
 {
 	pgssEntry  *entry;
+	dsa_pointer query_text = InvalidDsaPointer;
+	double		usage = USAGE_INIT;
 	bool		found;
 
 	/* Make space if needed */
-	while (hash_get_num_entries(pgss_hash) >= pgss_max)
+	if (pg_atomic_read_u32(&pgss->num_entries) >= pgss_max)
 		entry_dealloc();
 
+	/* Store the query text before locking anything */
+	if (query_len >= 0)
+		query_text = qtext_store(query, query_len);
+
+	if (sticky)
+	{
+		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+
+		SpinLockAcquire(&s->mutex);
+		usage = s->cur_median_usage;
+		SpinLockRelease(&s->mutex);
+	}
+
 	/* Find or create an entry with desired hash code */
-	entry = (pgssEntry *) hash_search(pgss_hash, key, HASH_ENTER, &found);
+	entry = (pgssEntry *) dshash_find_or_insert(pgss_hash, key, &found);
 
 	if (!found)
 	{
@@ -1977,27 +1897,33 @@ entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
 		/* reset the statistics */
 		memset(&entry->counters, 0, sizeof(Counters));
 		/* set the appropriate initial usage count */
-		entry->counters.usage = sticky ? pgss->cur_median_usage : USAGE_INIT;
-		/* re-initialize the mutex each time ... we assume no one using it */
+		entry->counters.usage = usage;
+		/* the entry is new, so no one else can be using the mutex */
 		SpinLockInit(&entry->mutex);
 		/* ... and don't forget the query text metadata */
-		Assert(query_len >= 0);
-		entry->query_offset = query_offset;
-		entry->query_len = query_len;
+		entry->query_text = query_text;
+		entry->query_len = DsaPointerIsValid(query_text) ? query_len : -1;
 		entry->encoding = encoding;
+
+		pg_atomic_fetch_add_u32(&pgss->num_entries, 1);
+	}
+	else if (DsaPointerIsValid(query_text))
+	{
+		/* Somebody beat us to it, so we don't need our copy of the text */
+		qtext_free(query_text, query_len);
 	}
 
 	return entry;
 }
 
 /*
- * qsort comparator for sorting into increasing usage order
+ * qsort comparator for sorting usage values into increasing order
  */
 static int
-entry_cmp(const void *lhs, const void *rhs)
+usage_cmp(const void *lhs, const void *rhs)
 {
-	double		l_usage = (*(pgssEntry *const *) lhs)->counters.usage;
-	double		r_usage = (*(pgssEntry *const *) rhs)->counters.usage;
+	double		l_usage = *(const double *) lhs;
+	double		r_usage = *(const double *) rhs;
 
 	if (l_usage < r_usage)
 		return -1;
@@ -2010,512 +1936,170 @@ entry_cmp(const void *lhs, const void *rhs)
 /*
  * Deallocate least-used entries.
  *
- * Caller must hold an exclusive lock on pgss->lock.
+ * The caller must not hold any partition lock.  Only one process evicts
+ * entries at a time; anyone arriving meanwhile just waits for it to finish,
+ * since room has been made for them too.
+ *
+ * We make two passes over the hashtable, each locking one partition at a
+ * time.  The first applies the decay factor to the usage values and collects
+ * them; they're sorted in local memory, without holding any lock, to find
+ * the usage below which the USAGE_DEALLOC_PERCENT least-used entries fall.
+ * The second pass removes entries at or below that usage.  An entry used in
+ * between might survive, and one created in between might be zapped
+ * instead; neither matters much.
  */
 static void
 entry_dealloc(void)
 {
-	HASH_SEQ_STATUS hash_seq;
-	pgssEntry **entries;
+	dshash_seq_status hash_seq;
 	pgssEntry  *entry;
+	double	   *usages;
+	int			maxentries;
+	int			nentries = 0;
 	int			nvictims;
-	int			i;
-	Size		tottextlen;
-	int			nvalidtexts;
-
-	/*
-	 * Sort entries by usage and deallocate USAGE_DEALLOC_PERCENT of them.
-	 * While we're scanning the table, apply the decay factor to the usage
-	 * values, and update the mean query length.
-	 *
-	 * Note that the mean query length is almost immediately obsolete, since
-	 * we compute it before not after discarding the least-used entries.
-	 * Hopefully, that doesn't affect the mean too much; it doesn't seem worth
-	 * making two passes to get a more current result.  Likewise, the new
-	 * cur_median_usage includes the entries we're about to zap.
-	 */
 
-	entries = palloc(hash_get_num_entries(pgss_hash) * sizeof(pgssEntry *));
+	if (!LWLockAcquireOrWait(pgss->lock, LW_EXCLUSIVE))
+		return;
 
-	i = 0;
-	tottextlen = 0;
-	nvalidtexts = 0;
+	/* Entries created during the scan are not counted for the median */
+	maxentries = pg_atomic_read_u32(&pgss->num_entries);
+	usages = palloc(Max(maxentries, 1) * sizeof(double));
 
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	dshash_seq_init(&hash_seq, pgss_hash, false);
+	while ((entry = dshash_seq_next(&hash_seq)) != NULL)
 	{
-		entries[i++] = entry;
+		volatile pgssEntry *e = (volatile pgssEntry *) entry;
+		double		usage;
+
+		SpinLockAcquire(&e->mutex);
 		/* "Sticky" entries get a different usage decay rate. */
-		if (IS_STICKY(entry->counters))
-			entry->counters.usage *= STICKY_DECREASE_FACTOR;
+		if (IS_STICKY(e->counters))
+			e->counters.usage *= STICKY_DECREASE_FACTOR;
 		else
-			entry->counters.usage *= USAGE_DECREASE_FACTOR;
-		/* In the mean length computation, ignore dropped texts. */
-		if (entry->query_len >= 0)
-		{
-			tottextlen += entry->query_len + 1;
-			nvalidtexts++;
-		}
-	}
-
-	/* Sort into increasing order by usage */
-	qsort(entries, i, sizeof(pgssEntry *), entry_cmp);
-
-	/* Record the (approximate) median usage */
-	if (i > 0)
-		pgss->cur_median_usage = entries[i / 2]->counters.usage;
-	/* Record the mean query length */
-	if (nvalidtexts > 0)
-		pgss->mean_query_len = tottextlen / nvalidtexts;
-	else
-		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
-
-	/* Now zap an appropriate fraction of lowest-usage entries */
-	nvictims = Max(10, i * USAGE_DEALLOC_PERCENT / 100);
-	nvictims = Min(nvictims, i);
-
-	for (i = 0; i < nvictims; i++)
-	{
-		hash_search(pgss_hash, &entries[i]->key, HASH_REMOVE, NULL);
-	}
-
-	pfree(entries);
-
-	/* Increment the number of times entries are deallocated */
-	{
-		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+			e->counters.usage *= USAGE_DECREASE_FACTOR;
+		usage = e->counters.usage;
+		SpinLockRelease(&e->mutex);
 
-		SpinLockAcquire(&s->mutex);
-		s->stats.dealloc += 1;
-		SpinLockRelease(&s->mutex);
+		if (nentries < maxentries)
+			usages[nentries++] = usage;
 	}
-}
 
-/*
- * Given a query string (not necessarily null-terminated), allocate a new
- * entry in the external query text file and store the string there.
- *
- * If successful, returns true, and stores the new entry's offset in the file
- * into *query_offset.  Also, if gc_count isn't NULL, *gc_count is set to the
- * number of garbage collections that have occurred so far.
- *
- * On failure, returns false.
- *
- * At least a shared lock on pgss->lock must be held by the caller, so as
- * to prevent a concurrent garbage collection.  Share-lock-holding callers
- * should pass a gc_count pointer to obtain the number of garbage collections,
- * so that they can recheck the count after obtaining exclusive lock to
- * detect whether a garbage collection occurred (and removed this entry).
- */
-static bool
-qtext_store(const char *query, int query_len,
-			Size *query_offset, int *gc_count)
-{
-	Size		off;
-	int			fd;
+	/* Sort into increasing order by usage */
+	qsort(usages, nentries, sizeof(double), usage_cmp);
 
 	/*
-	 * We use a spinlock to protect extent/n_writers/gc_count, so that
-	 * multiple processes may execute this function concurrently.
+	 * Record the (approximate) median usage.  Like the cutoff below, it
+	 * includes the entries we're about to zap.
 	 */
+	if (nentries > 0)
 	{
 		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
 
 		SpinLockAcquire(&s->mutex);
-		off = s->extent;
-		s->extent += query_len + 1;
-		s->n_writers++;
-		if (gc_count)
-			*gc_count = s->gc_count;
+		s->cur_median_usage = usages[nentries / 2];
 		SpinLockRelease(&s->mutex);
 	}
 
-	*query_offset = off;
-
-	/* Now write the data into the successfully-reserved part of the file */
-	fd = OpenTransientFile(PGSS_TEXT_FILE, O_RDWR | O_CREAT | PG_BINARY);
-	if (fd < 0)
-		goto error;
-
-	if (pg_pwrite(fd, query, query_len, off) != query_len)
-		goto error;
-	if (pg_pwrite(fd, "\0", 1, off + query_len) != 1)
-		goto error;
-
-	CloseTransientFile(fd);
+	/* Now zap an appropriate fraction of lowest-usage entries */
+	nvictims = Max(10, nentries * USAGE_DEALLOC_PERCENT / 100);
+	nvictims = Min(nvictims, nentries);
 
-	/* Mark our write complete */
+	if (nvictims > 0)
 	{
-		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+		double		cutoff = usages[nvictims - 1];
 
-		SpinLockAcquire(&s->mutex);
-		s->n_writers--;
-		SpinLockRelease(&s->mutex);
+		/*
+		 * With the partition locked exclusively, nobody else can be looking
+		 * at the counters, so we needn't take the entry spinlocks.
+		 */
+		dshash_seq_init(&hash_seq, pgss_hash, true);
+		while (nvictims > 0 && (entry = dshash_seq_next(&hash_seq)) != NULL)
+		{
+			if (entry->counters.usage <= cutoff)
+			{
+				entry_remove(&hash_seq, entry);
+				nvictims--;
+			}
+		}
+		dshash_seq_term(&hash_seq);
 	}
 
-	return true;
+	pfree(usages);
 
-error:
-	ereport(LOG,
-			(errcode_for_file_access(),
-			 errmsg("could not write file \"%s\": %m",
-					PGSS_TEXT_FILE)));
-
-	if (fd >= 0)
-		CloseTransientFile(fd);
-
-	/* Mark our write complete */
+	/* Increment the number of times entries are deallocated */
 	{
 		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
 
 		SpinLockAcquire(&s->mutex);
-		s->n_writers--;
+		s->stats.dealloc += 1;
 		SpinLockRelease(&s->mutex);
 	}
 
-	return false;
-}
-
-/*
- * Read the external query text file into a malloc'd buffer.
- *
- * Returns NULL (without throwing an error) if unable to read, eg
- * file not there or insufficient memory.
- *
- * On success, the buffer size is also returned into *buffer_size.
- *
- * This can be called without any lock on pgss->lock, but in that case
- * the caller is responsible for verifying that the result is sane.
- */
-static char *
-qtext_load_file(Size *buffer_size)
-{
-	char	   *buf;
-	int			fd;
-	struct stat stat;
-
-	fd = OpenTransientFile(PGSS_TEXT_FILE, O_RDONLY | PG_BINARY);
-	if (fd < 0)
-	{
-		if (errno != ENOENT)
-			ereport(LOG,
-					(errcode_for_file_access(),
-					 errmsg("could not read file \"%s\": %m",
-							PGSS_TEXT_FILE)));
-		return NULL;
-	}
-
-	/* Get file length */
-	if (fstat(fd, &stat))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not stat file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		CloseTransientFile(fd);
-		return NULL;
-	}
-
-	/* Allocate buffer; beware that off_t might be wider than size_t */
-	if (stat.st_size <= MaxAllocHugeSize)
-		buf = (char *) malloc(stat.st_size);
-	else
-		buf = NULL;
-	if (buf == NULL)
-	{
-		ereport(LOG,
-				(errcode(ERRCODE_OUT_OF_MEMORY),
-				 errmsg("out of memory"),
-				 errdetail("Could not allocate enough memory to read file \"%s\".",
-						   PGSS_TEXT_FILE)));
-		CloseTransientFile(fd);
-		return NULL;
-	}
-
-	/*
-	 * OK, slurp in the file.  If we get a short read and errno doesn't get
-	 * set, the reason is probably that garbage collection truncated the file
-	 * since we did the fstat(), so we don't log a complaint --- but we don't
-	 * return the data, either, since it's most likely corrupt due to
-	 * concurrent writes from garbage collection.
-	 */
-	errno = 0;
-	if (read(fd, buf, stat.st_size) != stat.st_size)
-	{
-		if (errno)
-			ereport(LOG,
-					(errcode_for_file_access(),
-					 errmsg("could not read file \"%s\": %m",
-							PGSS_TEXT_FILE)));
-		free(buf);
-		CloseTransientFile(fd);
-		return NULL;
-	}
-
-	if (CloseTransientFile(fd) != 0)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not close file \"%s\": %m", PGSS_TEXT_FILE)));
-
-	*buffer_size = stat.st_size;
-	return buf;
+	LWLockRelease(pgss->lock);
 }
 
 /*
- * Locate a query text in the file image previously read by qtext_load_file().
- *
- * We validate the given offset/length, and return NULL if bogus.  Otherwise,
- * the result points to a null-terminated string within the buffer.
+ * Remove the entry just returned by an exclusive sequential scan of the
+ * hashtable, along with its query text.
  */
-static char *
-qtext_fetch(Size query_offset, int query_len,
-			char *buffer, Size buffer_size)
+static void
+entry_remove(dshash_seq_status *hash_seq, pgssEntry *entry)
 {
-	/* File read failed? */
-	if (buffer == NULL)
-		return NULL;
-	/* Bogus offset/length? */
-	if (query_len < 0 ||
-		query_offset + query_len >= buffer_size)
-		return NULL;
-	/* As a further sanity check, make sure there's a trailing null */
-	if (buffer[query_offset + query_len] != '\0')
-		return NULL;
-	/* Looks OK */
-	return buffer + query_offset;
+	if (DsaPointerIsValid(entry->query_text))
+		qtext_free(entry->query_text, entry->query_len);
+	dshash_delete_current(hash_seq);
+	pg_atomic_fetch_sub_u32(&pgss->num_entries, 1);
 }
 
 /*
- * Do we need to garbage-collect the external query text file?
+ * Given a query string (not necessarily null-terminated), store a
+ * null-terminated copy of it in pgss_area.
  *
- * Caller should hold at least a shared lock on pgss->lock.
+ * If the texts already stored leave no room for this one within
+ * pg_stat_statements.query_text_memory, we evict some entries and try once
+ * more.  Returns InvalidDsaPointer if there's still no room, in which case
+ * the entry is kept without a text.
  */
-static bool
-need_gc_qtexts(void)
+static dsa_pointer
+qtext_store(const char *query, int query_len)
 {
-	Size		extent;
+	Size		len = query_len + 1;
+	dsa_pointer query_text;
+	char	   *buf;
 
-	/* Read shared extent pointer */
+	if (pg_atomic_add_fetch_u64(&pgss->text_bytes, len) > PGSS_TEXT_BUDGET)
 	{
-		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
-
-		SpinLockAcquire(&s->mutex);
-		extent = s->extent;
-		SpinLockRelease(&s->mutex);
+		pg_atomic_sub_fetch_u64(&pgss->text_bytes, len);
+		entry_dealloc();
+		if (pg_atomic_add_fetch_u64(&pgss->text_bytes, len) > PGSS_TEXT_BUDGET)
+		{
+			pg_atomic_sub_fetch_u64(&pgss->text_bytes, len);
+			return InvalidDsaPointer;
+		}
 	}
 
-	/* Don't proceed if file does not exceed 512 bytes per possible entry */
-	if (extent < 512 * pgss_max)
-		return false;
+	query_text = dsa_allocate_extended(pgss_area, len, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(query_text))
+	{
+		pg_atomic_sub_fetch_u64(&pgss->text_bytes, len);
+		return InvalidDsaPointer;
+	}
 
-	/*
-	 * Don't proceed if file is less than about 50% bloat.  Nothing can or
-	 * should be done in the event of unusually large query texts accounting
-	 * for file's large size.  We go to the trouble of maintaining the mean
-	 * query length in order to prevent garbage collection from thrashing
-	 * uselessly.
-	 */
-	if (extent < pgss->mean_query_len * pgss_max * 2)
-		return false;
+	buf = dsa_get_address(pgss_area, query_text);
+	memcpy(buf, query, query_len);
+	buf[query_len] = '\0';
 
-	return true;
+	return query_text;
 }
 
 /*
- * Garbage-collect orphaned query texts in external file.
- *
- * This won't be called often in the typical case, since it's likely that
- * there won't be too much churn, and besides, a similar compaction process
- * occurs when serializing to disk at shutdown or as part of resetting.
- * Despite this, it seems prudent to plan for the edge case where the file
- * becomes unreasonably large, with no other method of compaction likely to
- * occur in the foreseeable future.
- *
- * The caller must hold an exclusive lock on pgss->lock.
- *
- * At the first sign of trouble we unlink the query text file to get a clean
- * slate (although existing statistics are retained), rather than risk
- * thrashing by allowing the same problem case to recur indefinitely.
+ * Free a query text stored by qtext_store().
  */
 static void
-gc_qtexts(void)
+qtext_free(dsa_pointer query_text, int query_len)
 {
-	char	   *qbuffer;
-	Size		qbuffer_size;
-	FILE	   *qfile = NULL;
-	HASH_SEQ_STATUS hash_seq;
-	pgssEntry  *entry;
-	Size		extent;
-	int			nentries;
-
-	/*
-	 * When called from pgss_store, some other session might have proceeded
-	 * with garbage collection in the no-lock-held interim of lock strength
-	 * escalation.  Check once more that this is actually necessary.
-	 */
-	if (!need_gc_qtexts())
-		return;
-
-	/*
-	 * Load the old texts file.  If we fail (out of memory, for instance),
-	 * invalidate query texts.  Hopefully this is rare.  It might seem better
-	 * to leave things alone on an OOM failure, but the problem is that the
-	 * file is only going to get bigger; hoping for a future non-OOM result is
-	 * risky and can easily lead to complete denial of service.
-	 */
-	qbuffer = qtext_load_file(&qbuffer_size);
-	if (qbuffer == NULL)
-		goto gc_fail;
-
-	/*
-	 * We overwrite the query texts file in place, so as to reduce the risk of
-	 * an out-of-disk-space failure.  Since the file is guaranteed not to get
-	 * larger, this should always work on traditional filesystems; though we
-	 * could still lose on copy-on-write filesystems.
-	 */
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		goto gc_fail;
-	}
-
-	extent = 0;
-	nentries = 0;
-
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
-	{
-		int			query_len = entry->query_len;
-		char	   *qry = qtext_fetch(entry->query_offset,
-									  query_len,
-									  qbuffer,
-									  qbuffer_size);
-
-		if (qry == NULL)
-		{
-			/* Trouble ... drop the text */
-			entry->query_offset = 0;
-			entry->query_len = -1;
-			/* entry will not be counted in mean query length computation */
-			continue;
-		}
-
-		if (fwrite(qry, 1, query_len + 1, qfile) != query_len + 1)
-		{
-			ereport(LOG,
-					(errcode_for_file_access(),
-					 errmsg("could not write file \"%s\": %m",
-							PGSS_TEXT_FILE)));
-			hash_seq_term(&hash_seq);
-			goto gc_fail;
-		}
-
-		entry->query_offset = extent;
-		extent += query_len + 1;
-		nentries++;
-	}
-
-	/*
-	 * Truncate away any now-unused space.  If this fails for some odd reason,
-	 * we log it, but there's no need to fail.
-	 */
-	if (ftruncate(fileno(qfile), extent) != 0)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not truncate file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-
-	if (FreeFile(qfile))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		qfile = NULL;
-		goto gc_fail;
-	}
-
-	elog(DEBUG1, "pgss gc of queries file shrunk size from %zu to %zu",
-		 pgss->extent, extent);
-
-	/* Reset the shared extent pointer */
-	pgss->extent = extent;
-
-	/*
-	 * Also update the mean query length, to be sure that need_gc_qtexts()
-	 * won't still think we have a problem.
-	 */
-	if (nentries > 0)
-		pgss->mean_query_len = extent / nentries;
-	else
-		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
-
-	free(qbuffer);
-
-	/*
-	 * OK, count a garbage collection cycle.  (Note: even though we have
-	 * exclusive lock on pgss->lock, we must take pgss->mutex for this, since
-	 * other processes may examine gc_count while holding only the mutex.
-	 * Also, we have to advance the count *after* we've rewritten the file,
-	 * else other processes might not realize they read a stale file.)
-	 */
-	record_gc_qtexts();
-
-	return;
-
-gc_fail:
-	/* clean up resources */
-	if (qfile)
-		FreeFile(qfile);
-	if (qbuffer)
-		free(qbuffer);
-
-	/*
-	 * Since the contents of the external file are now uncertain, mark all
-	 * hashtable entries as having invalid texts.
-	 */
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
-	{
-		entry->query_offset = 0;
-		entry->query_len = -1;
-	}
-
-	/*
-	 * Destroy the query text file and create a new, empty one
-	 */
-	(void) unlink(PGSS_TEXT_FILE);
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not recreate file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-	else
-		FreeFile(qfile);
-
-	/* Reset the shared extent pointer */
-	pgss->extent = 0;
-
-	/* Reset mean_query_len to match the new state */
-	pgss->mean_query_len = ASSUMED_LENGTH_INIT;
-
-	/*
-	 * Bump the GC count even though we failed.
-	 *
-	 * This is needed to make concurrent readers of file without any lock on
-	 * pgss->lock notice existence of new version of file.  Once readers
-	 * subsequently observe a change in GC count with pgss->lock held, that
-	 * forces a safe reopen of file.  Writers also require that we bump here,
-	 * of course.  (As required by locking protocol, readers and writers don't
-	 * trust earlier file contents until gc_count is found unchanged after
-	 * pgss->lock acquired in shared or exclusive mode respectively.)
-	 */
-	record_gc_qtexts();
+	dsa_free(pgss_area, query_text);
+	pg_atomic_sub_fetch_u64(&pgss->text_bytes, query_len + 1);
 }
 
 /*
@@ -2524,20 +2108,22 @@ gc_fail:
 static void
 entry_reset(Oid userid, Oid dbid, uint64 queryid)
 {
-	HASH_SEQ_STATUS hash_seq;
+	dshash_seq_status hash_seq;
 	pgssEntry  *entry;
-	FILE	   *qfile;
-	long		num_entries;
-	long		num_remove = 0;
+	uint32		num_entries;
+	uint32		num_remove = 0;
 	pgssHashKey key;
 
-	if (!pgss || !pgss_hash)
+	if (!pgss)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
 
+	pgss_attach();
+
+	/* Keep entry_dealloc() from removing entries meanwhile */
 	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
-	num_entries = hash_get_num_entries(pgss_hash);
+	num_entries = pg_atomic_read_u32(&pgss->num_entries);
 
 	if (userid != 0 && dbid != 0 && queryid != UINT64CONST(0))
 	{
@@ -2547,45 +2133,45 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 		key.queryid = queryid;
 
 		/* Remove the key if exists */
-		entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_REMOVE, NULL);
+		entry = (pgssEntry *) dshash_find(pgss_hash, &key, true);
 		if (entry)				/* found */
+		{
+			if (DsaPointerIsValid(entry->query_text))
+				qtext_free(entry->query_text, entry->query_len);
+			dshash_delete_entry(pgss_hash, entry);
+			pg_atomic_fetch_sub_u32(&pgss->num_entries, 1);
 			num_remove++;
+		}
 	}
-	else if (userid != 0 || dbid != 0 || queryid != UINT64CONST(0))
+	else
 	{
-		/* Remove entries corresponding to valid parameters. */
-		hash_seq_init(&hash_seq, pgss_hash);
-		while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		/*
+		 * Remove entries corresponding to valid parameters, or all entries
+		 * if none are valid.
+		 */
+		dshash_seq_init(&hash_seq, pgss_hash, true);
+		while ((entry = dshash_seq_next(&hash_seq)) != NULL)
 		{
 			if ((!userid || entry->key.userid == userid) &&
 				(!dbid || entry->key.dbid == dbid) &&
 				(!queryid || entry->key.queryid == queryid))
 			{
-				hash_search(pgss_hash, &entry->key, HASH_REMOVE, NULL);
+				entry_remove(&hash_seq, entry);
 				num_remove++;
 			}
 		}
 	}
-	else
-	{
-		/* Remove all entries. */
-		hash_seq_init(&hash_seq, pgss_hash);
-		while ((entry = hash_seq_search(&hash_seq)) != NULL)
-		{
-			hash_search(pgss_hash, &entry->key, HASH_REMOVE, NULL);
-			num_remove++;
-		}
-	}
-
-	/* All entries are removed? */
-	if (num_entries != num_remove)
-		goto release_lock;
 
 	/*
-	 * Reset global statistics for pg_stat_statements since all entries are
-	 * removed.
+	 * All entries are removed?  Entries created meanwhile may have been
+	 * removed too, so this can exceed the count we started with.
 	 */
+	if (num_remove >= num_entries)
 	{
+		/*
+		 * Reset global statistics for pg_stat_statements since all entries
+		 * are removed.
+		 */
 		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
 		TimestampTz stats_reset = GetCurrentTimestamp();
 
@@ -2595,35 +2181,6 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 		SpinLockRelease(&s->mutex);
 	}
 
-	/*
-	 * Write new empty query file, perhaps even creating a new one to recover
-	 * if the file was missing.
-	 */
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not create file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		goto done;
-	}
-
-	/* If ftruncate fails, log it, but it's not a fatal problem */
-	if (ftruncate(fileno(qfile), 0) != 0)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not truncate file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-
-	FreeFile(qfile);
-
-done:
-	pgss->extent = 0;
-	/* This counts as a query text garbage collection for our purposes */
-	record_gc_qtexts();
-
-release_lock:
 	LWLockRelease(pgss->lock);
 }
 
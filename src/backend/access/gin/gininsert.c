@@ -15,17 +15,133 @@
 #include "postgres.h"
 
 #include "access/gin_private.h"
+#include "access/gin_tuple.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/indexfsm.h"
 #include "storage/predicate.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/datum.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
+
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000005)
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.  Note that there is a separate tuplesort TOC
+ * entry, private to tuplesort.c but allocated by this module on its behalf.
+ */
+typedef struct GinShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to create state
+	 * corresponding to that used by the leader.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			scantuplesortstates;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can use
+	 * results built by the workers (and before leader can write the data into
+	 * the index).
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects all fields before heapdesc.
+	 *
+	 * These fields contain status information of interest to GIN index builds
+	 * that must work just the same when an index is built in parallel.
+	 */
+	slock_t		mutex;
+
+	/*
+	 * Mutable state that is maintained by workers, and reported back to
+	 * leader at end of the scans.
+	 *
+	 * nparticipantsdone is number of worker processes finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of tuples that made it into the index.
+	 *
+	 * brokenhotchain indicates if any worker detected a broken HOT chain
+	 * during build.
+	 */
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} GinShared;
+
+/*
+ * Return pointer to a GinShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromGinShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(GinShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipanttuplesorts is the exact number of worker processes
+	 * successfully launched, plus one leader process if it participates as a
+	 * worker.
+	 */
+	int			nparticipanttuplesorts;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 *
+	 * ginshared is the shared state for entire build.  sharedsort is the
+	 * shared, tuplesort-managed state passed to each process tuplesort.
+	 * snapshot is the snapshot used by the scan iff an MVCC snapshot is
+	 * required.
+	 */
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} GinLeader;
 
 typedef struct
 {
@@ -35,8 +151,36 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+
+	/*
+	 * Parallel builds only: leader is the leader's parallel state (NULL in
+	 * workers), sortstate the tuplesort the accumulated entries are spooled
+	 * into, and accumMaxMem the memory limit for the accumulator.
+	 */
+	GinLeader  *leader;
+	Tuplesortstate *sortstate;
+	Size		accumMaxMem;
 } GinBuildState;
 
+static void _gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+								Relation index, bool isconcurrent,
+								int request);
+static void _gin_end_parallel(GinLeader *ginleader);
+static Size _gin_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static double _gin_parallel_heapscan(GinBuildState *buildstate,
+									 bool *brokenhotchain);
+static void _gin_parallel_merge(GinBuildState *buildstate);
+static void _gin_leader_participate_as_worker(GinBuildState *buildstate,
+											  Relation heap, Relation index);
+static void _gin_parallel_scan_and_sort(Relation heap, Relation index,
+										GinShared *ginshared,
+										Sharedsort *sharedsort,
+										int sortmem, bool progress);
+static GinTuple *_gin_build_tuple(GinState *ginstate, OffsetNumber attrnum,
+								  GinNullCategory category, Datum key,
+								  ItemPointerData *items, uint32 nitems,
+								  Size *len);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -316,6 +460,65 @@ ginBuildCallback(Relation index, ItemPointer tid, Datum *values,
 	MemoryContextSwitchTo(oldCtx);
 }
 
+/*
+ * Dump the contents of the build state's accumulator into its tuplesort, in
+ * the form of GinTuples.  Used by the participants of a parallel build.
+ */
+static void
+ginFlushBuildState(GinBuildState *buildstate)
+{
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		GinTuple   *tup;
+		Size		tuplen;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		tup = _gin_build_tuple(&buildstate->ginstate, attnum, category, key,
+							   list, nlist, &tuplen);
+		tuplesort_putgintuple(buildstate->sortstate, tup, tuplen);
+		pfree(tup);
+	}
+
+	MemoryContextReset(buildstate->tmpCtx);
+	ginInitBA(&buildstate->accum);
+}
+
+/*
+ * Per-tuple callback for table_index_build_scan in parallel builds.  This is
+ * just like ginBuildCallback, except that a full accumulator is spooled into
+ * the participant's tuplesort rather than inserted into the index.
+ */
+static void
+ginBuildCallbackParallel(Relation index, ItemPointer tid, Datum *values,
+						 bool *isnull, bool tupleIsAlive, void *state)
+{
+	GinBuildState *buildstate = (GinBuildState *) state;
+	MemoryContext oldCtx;
+	int			i;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	for (i = 0; i < buildstate->ginstate.origTupdesc->natts; i++)
+		ginHeapTupleBulkInsert(buildstate, (OffsetNumber) (i + 1),
+							   values[i], isnull[i], tid);
+
+	/* If we've maxed out our available memory, dump everything to the sort */
+	if (buildstate->accum.allocatedMemory >= buildstate->accumMaxMem)
+		ginFlushBuildState(buildstate);
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
 IndexBuildResult *
 ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 {
@@ -338,6 +541,9 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	initGinState(&buildstate.ginstate, index);
 	buildstate.indtuples = 0;
 	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.leader = NULL;
+	buildstate.sortstate = NULL;
+	buildstate.accumMaxMem = (Size) maintenance_work_mem * 1024L;
 
 	/* initialize the meta page */
 	MetaBuffer = GinNewBuffer(index);
@@ -378,26 +584,63 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	buildstate.accum.ginstate = &buildstate.ginstate;
 	ginInitBA(&buildstate.accum);
 
-	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
-	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   ginBuildCallback, (void *) &buildstate,
-									   NULL);
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_gin_begin_parallel(&buildstate, heap, index,
+							indexInfo->ii_Concurrent,
+							indexInfo->ii_ParallelWorkers);
 
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	if (!buildstate.leader)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   ginBuildCallback,
+										   (void *) &buildstate, NULL);
+
+		/* dump remaining entries to the index */
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		ginBeginBAScan(&buildstate.accum);
+		while ((list = ginGetBAEntry(&buildstate.accum,
+									 &attnum, &key, &category, &nlist)) != NULL)
+		{
+			/* there could be many entries, so be willing to abort here */
+			CHECK_FOR_INTERRUPTS();
+			ginEntryInsert(&buildstate.ginstate, attnum, key, category,
+						   list, nlist, &buildstate.buildStats);
+		}
+		MemoryContextSwitchTo(oldCtx);
+	}
+	else
+	{
+		SortCoordinate coordinate;
+
+		/*
+		 * Set up the leader's tuplesort, which merges the runs sorted by the
+		 * participants.  As with nbtree, the leader receives the same share
+		 * of maintenance_work_mem as a serial build would, since the workers
+		 * are about to go away by the time it starts using it.
+		 */
+		coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+		coordinate->isWorker = false;
+		coordinate->nParticipants =
+			buildstate.leader->nparticipanttuplesorts;
+		coordinate->sharedsort = buildstate.leader->sharedsort;
+
+		buildstate.sortstate = tuplesort_begin_index_gin(heap, index,
+														 maintenance_work_mem,
+														 coordinate, false);
+
+		/* Wait for the participants to finish scanning, then merge */
+		reltuples = _gin_parallel_heapscan(&buildstate,
+										   &indexInfo->ii_BrokenHotChain);
+		_gin_parallel_merge(&buildstate);
+
+		tuplesort_end(buildstate.sortstate);
+		_gin_end_parallel(buildstate.leader);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -430,6 +673,635 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	return result;
 }
 
+/*
+ * Form a GinTuple holding the given key and list of TIDs, returning its
+ * length in *len.  The result is palloc'd in the current memory context.
+ */
+static GinTuple *
+_gin_build_tuple(GinState *ginstate, OffsetNumber attrnum,
+				 GinNullCategory category, Datum key,
+				 ItemPointerData *items, uint32 nitems, Size *len)
+{
+	Form_pg_attribute attr = TupleDescAttr(ginstate->origTupdesc,
+										   attrnum - 1);
+	GinTuple   *tuple;
+	Size		keylen;
+	Size		tuplen;
+
+	/* figure out how much space the key takes up */
+	if (category != GIN_CAT_NORM_KEY)
+		keylen = 0;
+	else if (attr->attbyval)
+		keylen = sizeof(Datum);
+	else
+		keylen = datumGetSize(key, false, attr->attlen);
+
+	tuplen = SHORTALIGN(GinTupleKeyOffset + keylen) +
+		sizeof(ItemPointerData) * nitems;
+
+	tuple = palloc0(tuplen);
+
+	tuple->tuplen = tuplen;
+	tuple->attrnum = attrnum;
+	tuple->typlen = attr->attlen;
+	tuple->typbyval = attr->attbyval;
+	tuple->category = category;
+	tuple->keylen = keylen;
+	tuple->nitems = nitems;
+
+	if (category == GIN_CAT_NORM_KEY)
+	{
+		if (attr->attbyval)
+			memcpy((char *) tuple + GinTupleKeyOffset, &key, sizeof(Datum));
+		else
+			memcpy((char *) tuple + GinTupleKeyOffset,
+				   DatumGetPointer(key), keylen);
+	}
+
+	memcpy(GinTupleGetItems(tuple), items, sizeof(ItemPointerData) * nitems);
+
+	*len = tuplen;
+
+	return tuple;
+}
+
+/*
+ * qsort comparator for ItemPointerData items
+ */
+static int
+qsortCompareItemPointers(const void *a, const void *b)
+{
+	return ginCompareItemPointers((ItemPointer) a, (ItemPointer) b);
+}
+
+/*
+ * Insert the first nitems TIDs of a key being merged by the leader into the
+ * index, and remove them from the buffer.
+ */
+static void
+_gin_flush_items(GinBuildState *buildstate, OffsetNumber attnum,
+				 Datum key, GinNullCategory category,
+				 ItemPointerData *items, uint32 *nbuffered, uint32 nitems)
+{
+	/* there could be many entries, so be willing to abort here */
+	CHECK_FOR_INTERRUPTS();
+
+	ginEntryInsert(&buildstate->ginstate, attnum, key, category,
+				   items, nitems, &buildstate->buildStats);
+
+	*nbuffered -= nitems;
+	memmove(items, items + nitems, sizeof(ItemPointerData) * *nbuffered);
+}
+
+/*
+ * Within leader, read the GinTuples produced by all participants in sorted
+ * order, and insert the combined TID list of every key into the index.
+ *
+ * Tuples for the same key arrive ordered by their first TID, so TIDs less
+ * than the first TID of the tuple just read can no longer change position.
+ * That lets us insert a prefix of a very long list early, to bound the
+ * amount of memory used for merging.
+ */
+static void
+_gin_parallel_merge(GinBuildState *buildstate)
+{
+	GinState   *ginstate = &buildstate->ginstate;
+	MemoryContext oldCtx;
+	GinTuple   *tup;
+	Size		tuplen;
+	OffsetNumber attnum = InvalidOffsetNumber;
+	GinNullCategory category = GIN_CAT_NORM_KEY;
+	Datum		key = (Datum) 0;
+	ItemPointerData *items;
+	uint32		nitems = 0;
+	uint32		maxitems = 1024;
+	bool		sorted = true;
+	Size		maxbuffered = (Size) work_mem * 1024L / sizeof(ItemPointerData);
+
+	tuplesort_performsort(buildstate->sortstate);
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	items = palloc(sizeof(ItemPointerData) * maxitems);
+
+	while ((tup = tuplesort_getgintuple(buildstate->sortstate,
+										&tuplen, true)) != NULL)
+	{
+		Datum		tupkey = GinTupleGetKey(tup);
+		ItemPointer tupitems = GinTupleGetItems(tup);
+
+		/* a new key?  if so, write out the one we have been merging */
+		if (nitems > 0 &&
+			(tup->attrnum != attnum ||
+			 ginCompareEntries(ginstate, attnum, key, category,
+							   tupkey, tup->category) != 0))
+		{
+			if (!sorted)
+				qsort(items, nitems, sizeof(ItemPointerData),
+					  qsortCompareItemPointers);
+			_gin_flush_items(buildstate, attnum, key, category,
+							 items, &nitems, nitems);
+
+			MemoryContextReset(buildstate->tmpCtx);
+			maxitems = 1024;
+			items = palloc(sizeof(ItemPointerData) * maxitems);
+			sorted = true;
+		}
+
+		if (nitems == 0)
+		{
+			attnum = tup->attrnum;
+			category = tup->category;
+			if (category == GIN_CAT_NORM_KEY)
+				key = datumCopy(tupkey, tup->typbyval, tup->typlen);
+			else
+				key = (Datum) 0;
+		}
+		else if (nitems >= maxbuffered)
+		{
+			uint32		nfinal;
+
+			/* insert the TIDs that precede everything still to come */
+			if (!sorted)
+				qsort(items, nitems, sizeof(ItemPointerData),
+					  qsortCompareItemPointers);
+			sorted = true;
+
+			for (nfinal = 0; nfinal < nitems; nfinal++)
+			{
+				if (ginCompareItemPointers(&items[nfinal], tupitems) >= 0)
+					break;
+			}
+			if (nfinal > 0)
+				_gin_flush_items(buildstate, attnum, key, category,
+								 items, &nitems, nfinal);
+		}
+
+		if (nitems + tup->nitems > maxitems)
+		{
+			while (nitems + tup->nitems > maxitems)
+				maxitems *= 2;
+			items = repalloc_huge(items, sizeof(ItemPointerData) * maxitems);
+		}
+
+		if (nitems > 0 &&
+			ginCompareItemPointers(&items[nitems - 1], tupitems) >= 0)
+			sorted = false;
+
+		memcpy(items + nitems, tupitems, sizeof(ItemPointerData) * tup->nitems);
+		nitems += tup->nitems;
+	}
+
+	/* write out the last key */
+	if (nitems > 0)
+	{
+		if (!sorted)
+			qsort(items, nitems, sizeof(ItemPointerData),
+				  qsortCompareItemPointers);
+		_gin_flush_items(buildstate, attnum, key, category,
+						 items, &nitems, nitems);
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(buildstate->tmpCtx);
+}
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized (with the exception of the
+ * leader and sortstate fields).
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GinLeader, which caller must use to shut down parallel
+ * mode by passing it to _gin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gin_begin_parallel(GinBuildState *buildstate, Relation heap, Relation index,
+					bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		estginshared;
+	Size		estsort;
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+	GinLeader  *ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gin index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request);
+
+	/* the leader always participates as a worker */
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace, and
+	 * PARALLEL_KEY_TUPLESORT tuplesort workspace
+	 */
+	estginshared = _gin_parallel_estimate_shared(heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 *
+	 * If there are no extensions loaded that care, we could skip this.  We
+	 * have no way of knowing whether anyone's looking at pgWalUsage or
+	 * pgBufferUsage, so do it unconditionally.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	/* Initialize immutable state */
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->scantuplesortstates = scantuplesortstates;
+	ConditionVariableInit(&ginshared->workersdonecv);
+	SpinLockInit(&ginshared->mutex);
+	/* Initialize mutable state */
+	ginshared->nparticipantsdone = 0;
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	ginshared->brokenhotchain = false;
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromGinShared(ginshared),
+								  snapshot);
+
+	/*
+	 * Store shared tuplesort-private state, for which we reserved space.
+	 * Then, initialize opaque state using tuplesort routine.
+	 */
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+								pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	ginleader->ginshared = ginshared;
+	ginleader->sharedsort = sharedsort;
+	ginleader->snapshot = snapshot;
+	ginleader->walusage = walusage;
+	ginleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gin_end_parallel(ginleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->leader = ginleader;
+
+	/* Join heap scan ourselves */
+	_gin_leader_participate_as_worker(buildstate, heap, index);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < ginleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&ginleader->bufferusage[i], &ginleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * gin index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_gin_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(GinShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, wait for end of heap scan.
+ *
+ * When called, parallel heap scan started by _gin_begin_parallel() will
+ * already be underway within worker processes (the leader participates as a
+ * worker, so we should end up here just as workers are finishing).
+ *
+ * Fills in fields needed for ambuild statistics, and lets caller set
+ * field indicating that some worker encountered a broken HOT chain.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gin_parallel_heapscan(GinBuildState *buildstate, bool *brokenhotchain)
+{
+	GinShared  *ginshared = buildstate->leader->ginshared;
+	int			nparticipanttuplesorts;
+	double		reltuples;
+
+	nparticipanttuplesorts = buildstate->leader->nparticipanttuplesorts;
+	for (;;)
+	{
+		SpinLockAcquire(&ginshared->mutex);
+		if (ginshared->nparticipantsdone == nparticipanttuplesorts)
+		{
+			buildstate->indtuples = ginshared->indtuples;
+			*brokenhotchain = ginshared->brokenhotchain;
+			reltuples = ginshared->reltuples;
+			SpinLockRelease(&ginshared->mutex);
+			break;
+		}
+		SpinLockRelease(&ginshared->mutex);
+
+		ConditionVariableSleep(&ginshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * Within leader, participate as a parallel worker.
+ */
+static void
+_gin_leader_participate_as_worker(GinBuildState *buildstate, Relation heap,
+								  Relation index)
+{
+	GinLeader  *ginleader = buildstate->leader;
+	int			sortmem;
+
+	/*
+	 * Might as well use reliable figure when doling out maintenance_work_mem
+	 * (when requested number of workers were not launched, this will be
+	 * somewhat higher than it is for other workers).
+	 */
+	sortmem = maintenance_work_mem / ginleader->nparticipanttuplesorts;
+
+	/* Perform work common to all participants */
+	_gin_parallel_scan_and_sort(heap, index, ginleader->ginshared,
+								ginleader->sharedsort, sortmem, true);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			sortmem;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gin shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Look up shared state private to tuplesort.c */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Perform this worker's share of the scan and sort */
+	sortmem = maintenance_work_mem / ginshared->scantuplesortstates;
+	_gin_parallel_scan_and_sort(heapRel, indexRel, ginshared, sharedsort,
+								sortmem, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a worker's portion of a parallel build.
+ *
+ * The participant scans its share of the table, accumulating entries in
+ * memory like a serial build does.  Whenever the accumulator fills up, and
+ * at the end of the scan, its contents are spooled as GinTuples into this
+ * participant's partial tuplesort.  Half of sortmem (expressed in KBs) goes
+ * to the accumulator, and the other half to the tuplesort.
+ *
+ * When this returns, workers are done, and need only release resources.
+ */
+static void
+_gin_parallel_scan_and_sort(Relation heap, Relation index,
+							GinShared *ginshared, Sharedsort *sharedsort,
+							int sortmem, bool progress)
+{
+	SortCoordinate coordinate;
+	GinBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+	MemoryContext oldCtx;
+
+	/* Initialize local tuplesort coordination state */
+	coordinate = palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	/* Set up build state, like ginbuild() does */
+	initGinState(&buildstate.ginstate, index);
+	buildstate.indtuples = 0;
+	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "Gin build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	buildstate.funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context for user-defined function",
+											   ALLOCSET_DEFAULT_SIZES);
+	buildstate.accum.ginstate = &buildstate.ginstate;
+	ginInitBA(&buildstate.accum);
+	buildstate.leader = NULL;
+	buildstate.accumMaxMem = (Size) (sortmem / 2) * 1024L;
+
+	/* Begin "partial" tuplesort */
+	buildstate.sortstate = tuplesort_begin_index_gin(heap, index,
+													 sortmem / 2,
+													 coordinate, false);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGinShared(ginshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   ginBuildCallbackParallel,
+									   (void *) &buildstate, scan);
+
+	/* spool remaining entries */
+	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+	ginFlushBuildState(&buildstate);
+	MemoryContextSwitchTo(oldCtx);
+
+	/* Execute this worker's part of the sort */
+	tuplesort_performsort(buildstate.sortstate);
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->nparticipantsdone++;
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		ginshared->brokenhotchain = true;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&ginshared->workersdonecv);
+
+	/* We can end tuplesorts immediately */
+	tuplesort_end(buildstate.sortstate);
+
+	MemoryContextDelete(buildstate.funcCtx);
+	MemoryContextDelete(buildstate.tmpCtx);
+}
+
 /*
  *	ginbuildempty() -- build an empty gin index in the initialization fork
  */
@@ -1026,11 +1026,11 @@ gistproperty(Oid index_oid, int attno,
 XLogRecPtr
 gistGetFakeLSN(Relation rel)
 {
-	if (rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+	if (RelationUsesLocalBuffers(rel))
 	{
 		/*
-		 * Temporary relations are only accessible in our session, so a simple
-		 * backend-local counter will do.
+		 * Temporary relations, global or not, have only our session's data in
+		 * them, so a simple backend-local counter will do.
 		 */
 		static XLogRecPtr counter = FirstNormalUnloggedLSN;
 
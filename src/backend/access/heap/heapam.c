@@ -65,6 +65,7 @@
 #include "storage/spin.h"
 #include "storage/standby.h"
 #include "utils/datum.h"
+#include "utils/guc.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/relcache.h"
@@ -258,11 +259,24 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	 * behaviors, independently of the size of the table; also there is a GUC
 	 * variable that can disable synchronized scanning.)
 	 *
+	 * Temporary tables get the bulk-read strategy too, judged against the
+	 * size of the local buffer pool, but synchronized scanning makes no sense
+	 * for them since nobody else can be scanning the same table.  The pool
+	 * may be smaller than temp_buffers until it's enlarged at the next
+	 * transaction end, or not be set up yet at all.
+	 *
 	 * Note that table_block_parallelscan_initialize has a very similar test;
 	 * if you change this, consider changing that one, too.
 	 */
-	if (!RelationUsesLocalBuffers(scan->rs_base.rs_rd) &&
-		scan->rs_nblocks > NBuffers / 4)
+	if (RelationUsesLocalBuffers(scan->rs_base.rs_rd))
+	{
+		int			nlocbuffers = NLocBuffer > 0 ? NLocBuffer : num_temp_buffers;
+
+		allow_strat = scan->rs_nblocks > nlocbuffers / 4 &&
+			(scan->rs_base.rs_flags & SO_ALLOW_STRAT) != 0;
+		allow_sync = false;
+	}
+	else if (scan->rs_nblocks > NBuffers / 4)
 	{
 		allow_strat = (scan->rs_base.rs_flags & SO_ALLOW_STRAT) != 0;
 		allow_sync = (scan->rs_base.rs_flags & SO_ALLOW_SYNC) != 0;
@@ -1987,6 +2001,9 @@ GetBulkInsertState(void)
 	bistate = (BulkInsertState) palloc(sizeof(BulkInsertStateData));
 	bistate->strategy = GetAccessStrategy(BAS_BULKWRITE);
 	bistate->current_buf = InvalidBuffer;
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->already_extended_by = 0;
 	return bistate;
 }
 
@@ -2011,6 +2028,14 @@ ReleaseBulkInsertStatePin(BulkInsertState bistate)
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
 	bistate->current_buf = InvalidBuffer;
+
+	/*
+	 * The reserved blocks belong to the relation we were inserting into,
+	 * which the caller is presumably switching away from.
+	 */
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->already_extended_by = 0;
 }
 
 
@@ -2063,7 +2088,7 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 	 */
 	buffer = RelationGetBufferForTuple(relation, heaptup->t_len,
 									   InvalidBuffer, options, bistate,
-									   &vmbuffer, NULL);
+									   &vmbuffer, NULL, 1);
 
 
 	/*
@@ -2327,6 +2352,38 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 		return tup;
 }
 
+/*
+ * Helper for heap_multi_insert() that computes the number of entire pages
+ * that inserting the remaining heaptuples requires.  Used to determine how
+ * much the relation needs to be extended by.
+ *
+ * This walks all the tuples, so heap_multi_insert() calls it only once and
+ * then counts down the pages it has filled.
+ */
+static int
+heap_multi_insert_pages(HeapTuple *heaptuples, int done, int ntuples,
+						Size saveFreeSpace)
+{
+	size_t		page_avail = BLCKSZ - SizeOfPageHeaderData - saveFreeSpace;
+	int			npages = 1;
+
+	for (int i = done; i < ntuples; i++)
+	{
+		size_t		tup_sz = sizeof(ItemIdData) + MAXALIGN(heaptuples[i]->t_len);
+
+		if (page_avail < tup_sz)
+		{
+			npages++;
+			page_avail = BLCKSZ - SizeOfPageHeaderData - saveFreeSpace;
+		}
+
+		/* a tuple too big for the fillfactor gets a page to itself */
+		page_avail = (page_avail > tup_sz) ? page_avail - tup_sz : 0;
+	}
+
+	return npages;
+}
+
 /*
  *	heap_multi_insert	- insert multiple tuple into a heap
  *
@@ -2346,6 +2403,8 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	HeapTuple  *heaptuples;
 	int			i;
 	int			ndone;
+	int			npages;
+	int			npages_used = 0;
 	PGAlignedBlock scratch;
 	Page		page;
 	Buffer		vmbuffer = InvalidBuffer;
@@ -2399,6 +2458,9 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	 */
 	CheckForSerializableConflictIn(relation, NULL, InvalidBlockNumber);
 
+	/* Number of pages needed for all the tuples, at least one */
+	npages = heap_multi_insert_pages(heaptuples, 0, ntuples, saveFreeSpace);
+
 	ndone = 0;
 	while (ndone < ntuples)
 	{
@@ -2416,10 +2478,15 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 		 *
 		 * Also pin visibility map page if COPY FREEZE inserts tuples into an
 		 * empty page. See all_frozen_set below.
+		 *
+		 * The estimate of pages still to fill can drop to zero or below if
+		 * earlier tuples went to pages that already had some space in use;
+		 * RelationGetBufferForTuple treats that as one page.
 		 */
 		buffer = RelationGetBufferForTuple(relation, heaptuples[ndone]->t_len,
 										   InvalidBuffer, options, bistate,
-										   &vmbuffer, NULL);
+										   &vmbuffer, NULL,
+										   npages - npages_used);
 		page = BufferGetPage(buffer);
 
 		starting_with_empty_page = PageGetMaxOffsetNumber(page) == 0;
@@ -2622,6 +2689,7 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 
 		UnlockReleaseBuffer(buffer);
 		ndone += nthispage;
+		npages_used++;
 
 		/*
 		 * NB: Only release vmbuffer after inserting all tuples - it's fairly
@@ -3828,7 +3896,7 @@ l2:
 			/* Assume there's no chance to put heaptup on same page. */
 			newbuf = RelationGetBufferForTuple(relation, heaptup->t_len,
 											   buffer, 0, NULL,
-											   &vmbuffer_new, &vmbuffer);
+											   &vmbuffer_new, &vmbuffer, 1);
 		}
 		else
 		{
@@ -3846,7 +3914,7 @@ l2:
 				LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
 				newbuf = RelationGetBufferForTuple(relation, heaptup->t_len,
 												   buffer, 0, NULL,
-												   &vmbuffer_new, &vmbuffer);
+												   &vmbuffer_new, &vmbuffer, 1);
 			}
 			else
 			{
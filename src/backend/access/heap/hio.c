@@ -186,87 +186,141 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
 }
 
 /*
- * Extend a relation by multiple blocks to avoid future contention on the
- * relation extension lock.  Our goal is to pre-extend the relation by an
- * amount which ramps up as the degree of contention ramps up, but limiting
- * the result to some sane overall value.
+ * Upper limit on the number of blocks to extend a relation by at once.  It's
+ * just an arbitrary cap to prevent pathological results.
  */
-static void
-RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+#define MAX_BLOCKS_TO_EXTEND_BY		512
+
+/*
+ * Extend a relation by one or more blocks, and return the number of the first
+ * new block.  The caller must hold the relation extension lock if needLock;
+ * we release it as soon as the new blocks have been reserved.
+ *
+ * num_pages is the number of blocks the caller expects to fill.  Beyond that,
+ * we pre-extend by an amount which ramps up as contention on the extension
+ * lock ramps up, and, for bulk inserts, as the amount this BulkInsertState
+ * has extended by so far grows.  That avoids both future contention on the
+ * extension lock and a large number of small extensions.
+ *
+ * The new blocks are only reserved in the file, and are left uninitialized
+ * and not in shared buffers; whoever uses one will read and PageInit it.
+ * Blocks that we don't expect to use ourselves are entered into the FSM, so
+ * that concurrently inserting backends can find them.  If a BulkInsertState
+ * is given, blocks we do expect to use are remembered in it.
+ */
+static BlockNumber
+RelationAddBlocks(Relation relation, BulkInsertState bistate, int num_pages,
+				  bool use_fsm, bool needLock)
 {
-	BlockNumber blockNum,
-				firstBlock = InvalidBlockNumber;
-	int			extraBlocks;
-	int			lockWaiters;
+	BlockNumber firstBlock;
+	int			extend_by;
+	int			keep_pages;
 
-	/* Use the length of the lock wait queue to judge how much to extend. */
-	lockWaiters = RelationExtensionLockWaiterCount(relation);
-	if (lockWaiters <= 0)
-		return;
+	extend_by = Max(num_pages, 1);
 
 	/*
-	 * It might seem like multiplying the number of lock waiters by as much as
-	 * 20 is too aggressive, but benchmarking revealed that smaller numbers
-	 * were insufficient.  512 is just an arbitrary cap to prevent
-	 * pathological results.
+	 * Use the length of the lock wait queue to judge how much extra to
+	 * extend.  It might seem like multiplying the number of lock waiters by
+	 * as much as 20 is too aggressive, but benchmarking revealed that smaller
+	 * numbers were insufficient.  This only makes sense if we're using the
+	 * FSM, since the waiters couldn't find the extra blocks otherwise.
 	 */
-	extraBlocks = Min(512, lockWaiters * 20);
-
-	do
+	if (needLock && use_fsm)
 	{
-		Buffer		buffer;
-		Page		page;
-		Size		freespace;
+		int			lockWaiters = RelationExtensionLockWaiterCount(relation);
 
-		/*
-		 * Extend by one page.  This should generally match the main-line
-		 * extension code in RelationGetBufferForTuple, except that we hold
-		 * the relation extension lock throughout, and we don't immediately
-		 * initialize the page (see below).
-		 */
-		buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
-		page = BufferGetPage(buffer);
+		if (lockWaiters > 0)
+			extend_by += lockWaiters * 20;
+	}
+
+	/*
+	 * If we've extended the relation before with this BulkInsertState, we'll
+	 * very likely do so again, so extend by at least as much as we have
+	 * already.  That grows the extension size geometrically during large
+	 * bulk loads.
+	 */
+	if (bistate && bistate->already_extended_by > 0)
+		extend_by = Max(extend_by, bistate->already_extended_by);
 
-		if (!PageIsNew(page))
-			elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
-				 BufferGetBlockNumber(buffer),
-				 RelationGetRelationName(relation));
+	extend_by = Min(extend_by, MAX_BLOCKS_TO_EXTEND_BY);
+
+	/*
+	 * Decide how many of the new blocks we'll use ourselves.  Without a
+	 * BulkInsertState that's just the one we're about to return.  Without the
+	 * FSM, nobody else could find the extra blocks, so keep all of them.
+	 */
+	if (bistate == NULL)
+		keep_pages = 1;
+	else if (!use_fsm)
+		keep_pages = extend_by;
+	else
+		keep_pages = Min(Max(num_pages, 1), extend_by);
+
+	/*
+	 * Reserve the blocks.  This is the only step that needs the extension
+	 * lock, and it's cheap since the storage manager can usually just
+	 * allocate the space rather than write out zeroes.
+	 */
+	RelationOpenSmgr(relation);
+	firstBlock = smgrnblocks(relation->rd_smgr, MAIN_FORKNUM);
+	smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock, extend_by,
+				   false);
+
+	/*
+	 * Release the file-extension lock; it's now OK for someone else to extend
+	 * the relation some more.
+	 */
+	if (needLock)
+		UnlockRelationForExtension(relation, ExclusiveLock);
+
+	if (bistate)
+	{
+		if (keep_pages > 1)
+		{
+			bistate->next_free = firstBlock + 1;
+			bistate->last_free = firstBlock + keep_pages - 1;
+		}
+		else
+		{
+			bistate->next_free = InvalidBlockNumber;
+			bistate->last_free = InvalidBlockNumber;
+		}
+		bistate->already_extended_by += extend_by;
+	}
+
+	if (use_fsm && keep_pages < extend_by)
+	{
+		BlockNumber blockNum;
+		Size		freespace = BLCKSZ - SizeOfPageHeaderData;
 
 		/*
-		 * Add the page to the FSM without initializing. If we were to
-		 * initialize here, the page would potentially get flushed out to disk
-		 * before we add any useful content. There's no guarantee that that'd
-		 * happen before a potential crash, so we need to deal with
+		 * Add the pages to the FSM without initializing them.  If we were to
+		 * initialize them here, they would potentially get flushed out to
+		 * disk before we add any useful content.  There's no guarantee that
+		 * that'd happen before a potential crash, so we need to deal with
 		 * uninitialized pages anyway, thus avoid the potential for
 		 * unnecessary writes.
+		 *
+		 * Updating the bottom level of the FSM immediately has a good chance
+		 * of making the pages visible to other concurrently inserting
+		 * backends.
 		 */
-
-		/* we'll need this info below */
-		blockNum = BufferGetBlockNumber(buffer);
-		freespace = BufferGetPageSize(buffer) - SizeOfPageHeaderData;
-
-		UnlockReleaseBuffer(buffer);
-
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
+		for (blockNum = firstBlock + keep_pages;
+			 blockNum < firstBlock + extend_by;
+			 blockNum++)
+			RecordPageWithFreeSpace(relation, blockNum, freespace);
 
 		/*
-		 * Immediately update the bottom level of the FSM.  This has a good
-		 * chance of making this page visible to other concurrently inserting
-		 * backends, and we want that to happen without delay.
+		 * Updating the upper levels of the free space map is too expensive to
+		 * do for every block, but it's worth doing once at the end to make
+		 * sure that subsequent insertion activity sees all of those nifty
+		 * free pages we just inserted.
 		 */
-		RecordPageWithFreeSpace(relation, blockNum, freespace);
+		FreeSpaceMapVacuumRange(relation, firstBlock + keep_pages,
+								firstBlock + extend_by);
 	}
-	while (--extraBlocks > 0);
 
-	/*
-	 * Updating the upper levels of the free space map is too expensive to do
-	 * for every block, but it's worth doing once at the end to make sure that
-	 * subsequent insertion activity sees all of those nifty free pages we
-	 * just inserted.
-	 */
-	FreeSpaceMapVacuumRange(relation, firstBlock, blockNum + 1);
+	return firstBlock;
 }
 
 /*
@@ -317,6 +371,10 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
  *	BULKWRITE buffer selection strategy object to the buffer manager.
  *	Passing NULL for bistate selects the default behavior.
  *
+ *	num_pages is the number of pages the caller expects to fill, counting the
+ *	one returned.  If we have to extend the relation, we extend it by at least
+ *	that much at once.
+ *
  *	We always try to avoid filling existing pages further than the fillfactor.
  *	This is OK since this routine is not consulted when updating a tuple and
  *	keeping it on the same page, which is the scenario fillfactor is meant
@@ -329,7 +387,8 @@ Buffer
 RelationGetBufferForTuple(Relation relation, Size len,
 						  Buffer otherBuffer, int options,
 						  BulkInsertState bistate,
-						  Buffer *vmbuffer, Buffer *vmbuffer_other)
+						  Buffer *vmbuffer, Buffer *vmbuffer_other,
+						  int num_pages)
 {
 	bool		use_fsm = !(options & HEAP_INSERT_SKIP_FSM);
 	Buffer		buffer = InvalidBuffer;
@@ -516,8 +575,13 @@ loop:
 			MarkBufferDirty(buffer);
 		}
 
+		/*
+		 * A tuple that can't fit together with the fillfactor reserve goes
+		 * onto an empty page by itself.
+		 */
 		pageFreeSpace = PageGetHeapFreeSpace(page);
-		if (len + saveFreeSpace <= pageFreeSpace)
+		if (len + saveFreeSpace <= pageFreeSpace ||
+			(len <= pageFreeSpace && PageGetMaxOffsetNumber(page) == 0))
 		{
 			/* use this page as future insert target, too */
 			RelationSetTargetBlock(relation, targetBlock);
@@ -553,21 +617,40 @@ loop:
 													len + saveFreeSpace);
 	}
 
+	/*
+	 * If we reserved more blocks than we needed the last time we extended the
+	 * relation with this BulkInsertState, use the next of those before
+	 * extending again.
+	 */
+	if (bistate && bistate->next_free != InvalidBlockNumber)
+	{
+		targetBlock = bistate->next_free;
+		if (bistate->next_free >= bistate->last_free)
+		{
+			bistate->next_free = InvalidBlockNumber;
+			bistate->last_free = InvalidBlockNumber;
+		}
+		else
+			bistate->next_free++;
+
+		goto loop;
+	}
+
 	/*
 	 * Have to extend the relation.
 	 *
 	 * We have to use a lock to ensure no one else is extending the rel at the
-	 * same time, else we will both try to initialize the same new page.  We
-	 * can skip locking for new or temp relations, however, since no one else
+	 * same time, else we will both try to use the same new block.  We can
+	 * skip locking for new or temp relations, however, since no one else
 	 * could be accessing them.
 	 */
 	needLock = !RELATION_IS_LOCAL(relation);
 
 	/*
-	 * If we need the lock but are not able to acquire it immediately, we'll
-	 * consider extending the relation by multiple blocks at a time to manage
-	 * contention on the relation extension lock.  However, this only makes
-	 * sense if we're using the FSM; otherwise, there's no point.
+	 * If we need the lock but are not able to acquire it immediately, some
+	 * other waiter may have extended the relation for us by the time we get
+	 * it.  However, this only makes sense if we're using the FSM; otherwise,
+	 * there's no point.
 	 */
 	if (needLock)
 	{
@@ -593,108 +676,18 @@ loop:
 				UnlockRelationForExtension(relation, ExclusiveLock);
 				goto loop;
 			}
-
-			/* Time to bulk-extend. */
-			RelationAddExtraBlocks(relation, bistate);
 		}
 	}
 
 	/*
-	 * In addition to whatever extension we performed above, we always add at
-	 * least one block to satisfy our own request.
-	 *
-	 * XXX This does an lseek - rather expensive - but at the moment it is the
-	 * only way to accurately determine how many blocks are in a relation.  Is
-	 * it worth keeping an accurate file length in shared memory someplace,
-	 * rather than relying on the kernel to do it for us?
-	 */
-	buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
-
-	/*
-	 * We need to initialize the empty new page.  Double-check that it really
-	 * is empty (this should never happen, but if it does we don't want to
-	 * risk wiping out valid data).
-	 */
-	page = BufferGetPage(buffer);
-
-	if (!PageIsNew(page))
-		elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
-			 BufferGetBlockNumber(buffer),
-			 RelationGetRelationName(relation));
-
-	PageInit(page, BufferGetPageSize(buffer), 0);
-	MarkBufferDirty(buffer);
-
-	/*
-	 * The page is empty, pin vmbuffer to set all_frozen bit.
-	 */
-	if (options & HEAP_INSERT_FROZEN)
-	{
-		Assert(PageGetMaxOffsetNumber(BufferGetPage(buffer)) == 0);
-		visibilitymap_pin(relation, BufferGetBlockNumber(buffer), vmbuffer);
-	}
-
-	/*
-	 * Release the file-extension lock; it's now OK for someone else to extend
-	 * the relation some more.
+	 * Reserve at least one new block for our own request, and possibly more;
+	 * this releases the extension lock.  The new block isn't in shared
+	 * buffers yet, so read it like any other target block.  Someone else
+	 * could conceivably have found it as the last block of the relation and
+	 * used it already, in which case the loop will just look elsewhere.
 	 */
-	if (needLock)
-		UnlockRelationForExtension(relation, ExclusiveLock);
+	targetBlock = RelationAddBlocks(relation, bistate, num_pages, use_fsm,
+									needLock);
 
-	/*
-	 * Lock the other buffer. It's guaranteed to be of a lower page number
-	 * than the new page. To conform with the deadlock prevent rules, we ought
-	 * to lock otherBuffer first, but that would give other backends a chance
-	 * to put tuples on our page. To reduce the likelihood of that, attempt to
-	 * lock the other buffer conditionally, that's very likely to work.
-	 * Otherwise we need to lock buffers in the correct order, and retry if
-	 * the space has been used in the mean time.
-	 *
-	 * Alternatively, we could acquire the lock on otherBuffer before
-	 * extending the relation, but that'd require holding the lock while
-	 * performing IO, which seems worse than an unlikely retry.
-	 */
-	if (otherBuffer != InvalidBuffer)
-	{
-		Assert(otherBuffer != buffer);
-
-		if (unlikely(!ConditionalLockBuffer(otherBuffer)))
-		{
-			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
-			LockBuffer(otherBuffer, BUFFER_LOCK_EXCLUSIVE);
-			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
-
-			/*
-			 * Because the buffer was unlocked for a while, it's possible,
-			 * although unlikely, that the page was filled. If so, just retry
-			 * from start.
-			 */
-			if (len > PageGetHeapFreeSpace(page))
-			{
-				LockBuffer(otherBuffer, BUFFER_LOCK_UNLOCK);
-				UnlockReleaseBuffer(buffer);
-
-				goto loop;
-			}
-		}
-	}
-
-	if (len > PageGetHeapFreeSpace(page))
-	{
-		/* We should not get here given the test at the top */
-		elog(PANIC, "tuple is too big: size %zu", len);
-	}
-
-	/*
-	 * Remember the new page as our target for future insertions.
-	 *
-	 * XXX should we enter the new page into the free space map immediately,
-	 * or just keep it for this backend's exclusive use in the short run
-	 * (until VACUUM sees it)?	Seems to depend on whether you expect the
-	 * current backend to make more insertions or not, which is probably a
-	 * good bet most of the time.  So for now, don't add it to FSM yet.
-	 */
-	RelationSetTargetBlock(relation, BufferGetBlockNumber(buffer));
-
-	return buffer;
+	goto loop;
 }
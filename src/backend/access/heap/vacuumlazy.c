@@ -37,6 +37,16 @@
  * parallel mode we update the index statistics after exiting from the
  * parallel mode.
  *
+ * When the table is large enough, the two heap passes are performed in
+ * parallel too, using the same parallel context.  For the first pass, the
+ * leader and the workers claim ranges of blocks from a shared counter, and
+ * record the dead tuples they find directly in the dead tuple array in the
+ * DSM segment.  Room for the dead tuples of a range is reserved before the
+ * range is claimed, so a scan round ends, rather than overflows, when the
+ * array is full; the leader then sorts the array, performs a cycle of index
+ * and heap vacuuming, and launches workers again to continue the scan.  For
+ * the second pass, the dead tuple array is divided among the participants.
+ *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -75,6 +85,7 @@
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/spin.h"
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -131,6 +142,14 @@
  */
 #define PREFETCH_SIZE			((BlockNumber) 32)
 
+/*
+ * Number of blocks a participant of a parallel heap scan claims at a time,
+ * and number of dead tuples a participant of parallel heap vacuuming claims
+ * at a time.
+ */
+#define PARALLEL_VACUUM_CHUNK_BLOCKS	((BlockNumber) 64)
+#define PARALLEL_VACUUM_CHUNK_TUPLES	1024
+
 /*
  * DSM keys for parallel vacuum.  Unlike other parallel execution code, since
  * we don't need to worry about DSM keys conflicting with plan_node_id we can
@@ -181,6 +200,35 @@ typedef struct LVDeadTuples
 #define MAXDEADTUPLES(max_size) \
 		(((max_size) - offsetof(LVDeadTuples, itemptrs)) / sizeof(ItemPointerData))
 
+/* Kinds of work that parallel vacuum workers are launched for */
+typedef enum LVParallelWork
+{
+	PARALLEL_VACUUM_INDEXES,	/* index vacuum or index cleanup */
+	PARALLEL_VACUUM_SCAN_HEAP,	/* first heap pass */
+	PARALLEL_VACUUM_VACUUM_HEAP /* second heap pass */
+} LVParallelWork;
+
+/*
+ * Heap scan statistics of the workers of a parallel heap scan.  Each worker
+ * adds its counts here when it is done, and the leader adds the totals to its
+ * own LVRelStats at the end of each scan round.
+ */
+typedef struct LVSharedScanStats
+{
+	BlockNumber scanned_pages;
+	BlockNumber pinskipped_pages;
+	BlockNumber frozenskipped_pages;
+	BlockNumber tupcount_pages;
+	BlockNumber empty_pages;
+	BlockNumber nonempty_pages;
+	double		num_tuples;
+	double		live_tuples;
+	double		tuples_deleted;
+	double		new_dead_tuples;
+	double		nunused;
+	TransactionId latestRemovedXid;
+} LVSharedScanStats;
+
 /*
  * Shared information among parallel workers.  So this is allocated in the DSM
  * segment.
@@ -239,6 +287,48 @@ typedef struct LVShared
 	 */
 	pg_atomic_uint32 active_nworkers;
 
+	/* What the workers launched next are to do */
+	LVParallelWork work;
+
+	/*
+	 * Fields for the parallel heap scan and heap vacuuming.  The vacuum
+	 * parameters and cutoff points are set by the leader before the heap
+	 * scan, and the workers use them in place of the leader's static
+	 * variables.
+	 */
+	VacuumParams params;
+	bool		aggressive;
+	bool		force_check_last_page;
+	TransactionId oldest_xmin;
+	TransactionId freeze_limit;
+	MultiXactId multixact_cutoff;
+	BlockNumber rel_pages;
+	BlockNumber chunk_blocks;	/* # of blocks claimed at a time */
+	TransactionId latest_removed_xid;	/* for heap vacuuming */
+
+	/*
+	 * Block allocation state of the parallel heap scan.  A participant claims
+	 * chunk_blocks blocks at a time, but only after reserving room in the
+	 * dead tuple array for the dead tuples of all of them, so the array can't
+	 * overflow.  Once there's no room left, the participants stop and the
+	 * leader vacuums indexes and heap before continuing the scan from
+	 * next_block.  These fields, the dead tuple array's num_tuples and the
+	 * statistics below are protected by mutex.
+	 */
+	slock_t		mutex;
+	BlockNumber next_block;
+	int			reserved_tuples;
+	LVSharedScanStats scan_stats;
+	int			vacuumed_pages; /* # of pages processed by heap vacuuming */
+
+	/*
+	 * Number of blocks processed by the parallel heap scan, which the leader
+	 * reports as progress, and the next dead tuple to be handed out by the
+	 * parallel heap vacuuming.
+	 */
+	pg_atomic_uint32 nblocks_scanned;
+	pg_atomic_uint32 next_tupindex;
+
 	/*
 	 * Variables to control parallel vacuum.  We have a bitmap to indicate
 	 * which index has stats in shared memory.  The set bit in the map
@@ -288,6 +378,15 @@ typedef struct LVParallelState
 	int			nindexes_parallel_bulkdel;
 	int			nindexes_parallel_cleanup;
 	int			nindexes_parallel_condcleanup;
+
+	/*
+	 * The number of workers to use for the heap scan and heap vacuuming, or
+	 * zero if the leader performs those alone.
+	 */
+	int			nworkers_heap;
+
+	/* Have workers been launched using this parallel context before? */
+	bool		workers_launched;
 } LVParallelState;
 
 typedef struct LVRelStats
@@ -303,10 +402,15 @@ typedef struct LVRelStats
 	BlockNumber pinskipped_pages;	/* # of pages we skipped due to a pin */
 	BlockNumber frozenskipped_pages;	/* # of frozen pages we skipped */
 	BlockNumber tupcount_pages; /* pages whose tuples we counted */
+	BlockNumber empty_pages;	/* # of empty pages we found */
+	BlockNumber vacuumed_pages; /* # of pages vacuumed during the scan */
 	double		old_live_tuples;	/* previous value of pg_class.reltuples */
 	double		new_rel_tuples; /* new estimated total # of tuples */
 	double		new_live_tuples;	/* new estimated total # of live tuples */
 	double		new_dead_tuples;	/* new estimated total # of dead tuples */
+	double		num_tuples;		/* total # of nonremovable tuples */
+	double		live_tuples;	/* live tuples (reltuples estimate) */
+	double		nunused;		/* # existing unused line pointers */
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
@@ -344,7 +448,26 @@ static BufferAccessStrategy vac_strategy;
 static void lazy_scan_heap(Relation onerel, VacuumParams *params,
 						   LVRelStats *vacrelstats, Relation *Irel, int nindexes,
 						   bool aggressive);
-static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
+static void lazy_scan_page(Relation onerel, VacuumParams *params,
+						   LVRelStats *vacrelstats, LVDeadTuples *dead_tuples,
+						   int nindexes, BlockNumber blkno, bool aggressive,
+						   bool all_visible_according_to_vm, bool force_check,
+						   GlobalVisState *vistest, xl_heap_freeze_tuple *frozen,
+						   Buffer *vmbuffer,
+						   BlockNumber *next_fsm_block_to_vacuum);
+static void lazy_parallel_scan_heap(Relation onerel, VacuumParams *params,
+									LVRelStats *vacrelstats, Relation *Irel,
+									IndexBulkDeleteResult **indstats,
+									int nindexes, LVParallelState *lps,
+									bool aggressive, GlobalVisState *vistest,
+									BlockNumber *next_fsm_block_to_vacuum);
+static void parallel_scan_heap(Relation onerel, LVShared *lvshared,
+							   LVDeadTuples *dead_tuples, int nindexes,
+							   LVRelStats *vacrelstats, GlobalVisState *vistest);
+static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+							 LVParallelState *lps);
+static void parallel_vacuum_heap(Relation onerel, LVShared *lvshared,
+								 LVRelStats *vacrelstats);
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup,
 									LVRelStats *vacrelstats);
 static void lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
@@ -389,6 +512,9 @@ static void lazy_cleanup_all_indexes(Relation *Irel, IndexBulkDeleteResult **sta
 static long compute_max_dead_tuples(BlockNumber relblocks, bool hasindex);
 static int	compute_parallel_vacuum_workers(Relation *Irel, int nindexes, int nrequested,
 											bool *can_parallel_vacuum);
+static int	compute_parallel_heap_workers(BlockNumber nblocks, int nrequested);
+static int	parallel_vacuum_launch_workers(LVParallelState *lps, int nworkers);
+static void parallel_vacuum_wait_workers(LVParallelState *lps);
 static void prepare_index_statistics(LVShared *lvshared, bool *can_parallel_vacuum,
 									 int nindexes);
 static void update_index_statistics(Relation *Irel, IndexBulkDeleteResult **stats,
@@ -734,17 +860,18 @@ vacuum_log_cleanup_info(Relation rel, LVRelStats *vacrelstats)
  *		dead-tuple TIDs, invoke vacuuming of indexes and call lazy_vacuum_heap
  *		to reclaim dead line pointers.
  *
- *		If the table has at least two indexes, we execute both index vacuum
- *		and index cleanup with parallel workers unless parallel vacuum is
- *		disabled.  In a parallel vacuum, we enter parallel mode and then
- *		create both the parallel context and the DSM segment before starting
- *		heap scan so that we can record dead tuples to the DSM segment.  All
- *		parallel workers are launched at beginning of index vacuuming and
- *		index cleanup and they exit once done with all indexes.  At the end of
- *		this function we exit from parallel mode.  Index bulk-deletion results
- *		are stored in the DSM segment and we update index statistics for all
- *		the indexes after exiting from parallel mode since writes are not
- *		allowed during parallel mode.
+ *		If the table has indexes, we execute both index vacuum and index
+ *		cleanup with parallel workers unless parallel vacuum is disabled, and
+ *		if the table is large enough we also scan and vacuum the heap with
+ *		parallel workers (see lazy_parallel_scan_heap).  In a parallel vacuum,
+ *		we enter parallel mode and then create both the parallel context and
+ *		the DSM segment before starting heap scan so that we can record dead
+ *		tuples to the DSM segment.  Parallel workers are launched at the
+ *		beginning of each parallel phase and they exit once done with it.  At
+ *		the end of this function we exit from parallel mode.  Index
+ *		bulk-deletion results are stored in the DSM segment and we update index
+ *		statistics for all the indexes after exiting from parallel mode since
+ *		writes are not allowed during parallel mode.
  *
  *		If there are no indexes then we can reclaim line pointers on the fly;
  *		dead line pointers need only be retained until all index pointers that
@@ -758,19 +885,8 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	LVDeadTuples *dead_tuples;
 	BlockNumber nblocks,
 				blkno;
-	HeapTupleData tuple;
-	TransactionId relfrozenxid = onerel->rd_rel->relfrozenxid;
-	TransactionId relminmxid = onerel->rd_rel->relminmxid;
-	BlockNumber empty_pages,
-				vacuumed_pages,
-				next_fsm_block_to_vacuum;
-	double		num_tuples,		/* total number of nonremovable tuples */
-				live_tuples,	/* live tuples (reltuples estimate) */
-				tups_vacuumed,	/* tuples cleaned up by current vacuum */
-				nkeep,			/* dead-but-not-removable tuples */
-				nunused;		/* # existing unused line pointers */
+	BlockNumber next_fsm_block_to_vacuum;
 	IndexBulkDeleteResult **indstats;
-	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 	BlockNumber next_unskippable_block;
@@ -798,9 +914,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 						vacrelstats->relnamespace,
 						vacrelstats->relname)));
 
-	empty_pages = vacuumed_pages = 0;
 	next_fsm_block_to_vacuum = (BlockNumber) 0;
-	num_tuples = live_tuples = tups_vacuumed = nkeep = nunused = 0;
 
 	indstats = (IndexBulkDeleteResult **)
 		palloc0(nindexes * sizeof(IndexBulkDeleteResult *));
@@ -809,17 +923,26 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	vacrelstats->rel_pages = nblocks;
 	vacrelstats->scanned_pages = 0;
 	vacrelstats->tupcount_pages = 0;
+	vacrelstats->empty_pages = 0;
+	vacrelstats->vacuumed_pages = 0;
 	vacrelstats->nonempty_pages = 0;
+	vacrelstats->num_tuples = 0;
+	vacrelstats->live_tuples = 0;
+	vacrelstats->tuples_deleted = 0;
+	vacrelstats->new_dead_tuples = 0;
+	vacrelstats->nunused = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
 	vistest = GlobalVisTestFor(onerel);
 
 	/*
 	 * Initialize state for a parallel vacuum.  As of now, only one worker can
-	 * be used for an index, so we invoke parallelism only if there are at
-	 * least two indexes on a table.
+	 * be used for an index, so index vacuuming is parallelized only if there
+	 * are at least two indexes on a table; the heap scan can use workers even
+	 * if there is just one.  Without indexes (or with index cleanup disabled)
+	 * there is no second heap pass, and we keep to the one-pass strategy.
 	 */
-	if (params->nworkers >= 0 && vacrelstats->useindex && nindexes > 1)
+	if (params->nworkers >= 0 && vacrelstats->useindex && nindexes > 0)
 	{
 		/*
 		 * Since parallel workers cannot access data in temporary tables, we
@@ -858,6 +981,16 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	initprog_val[2] = dead_tuples->max_tuples;
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
+	/* Scan the heap with parallel workers, if we can */
+	if (ParallelVacuumIsActive(lps) && lps->nworkers_heap > 0)
+	{
+		lazy_parallel_scan_heap(onerel, params, vacrelstats, Irel, indstats,
+								nindexes, lps, aggressive, vistest,
+								&next_fsm_block_to_vacuum);
+		blkno = nblocks;
+		goto scan_done;
+	}
+
 	/*
 	 * Except when aggressive is set, we want to skip pages that are
 	 * all-visible according to the visibility map, but only when we can skip
@@ -933,20 +1066,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 
 	for (blkno = 0; blkno < nblocks; blkno++)
 	{
-		Buffer		buf;
-		Page		page;
-		OffsetNumber offnum,
-					maxoff;
-		bool		tupgone,
-					hastup;
-		int			prev_dead_count;
-		int			nfrozen;
-		Size		freespace;
 		bool		all_visible_according_to_vm = false;
-		bool		all_visible;
-		bool		all_frozen = true;	/* provided all_visible is also true */
-		bool		has_dead_tuples;
-		TransactionId visibility_cutoff_xid = InvalidTransactionId;
 
 		/* see note above about forcing scanning of last page */
 #define FORCE_CHECK_PAGE() \
@@ -1056,7 +1176,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 									vacrelstats, lps, nindexes);
 
 			/* Remove tuples from heap */
-			lazy_vacuum_heap(onerel, vacrelstats);
+			lazy_vacuum_heap(onerel, vacrelstats, lps);
 
 			/*
 			 * Forget the now-vacuumed tuples, and press on, but be careful
@@ -1077,704 +1197,1021 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
 		}
 
-		/*
-		 * Pin the visibility map page in case we need to mark the page
-		 * all-visible.  In most cases this will be very cheap, because we'll
-		 * already have the correct page pinned anyway.  However, it's
-		 * possible that (a) next_unskippable_block is covered by a different
-		 * VM page than the current block or (b) we released our pin and did a
-		 * cycle of index vacuuming.
-		 *
-		 */
-		visibilitymap_pin(onerel, blkno, &vmbuffer);
+		lazy_scan_page(onerel, params, vacrelstats, dead_tuples, nindexes,
+					   blkno, aggressive, all_visible_according_to_vm,
+					   FORCE_CHECK_PAGE(), vistest, frozen, &vmbuffer,
+					   &next_fsm_block_to_vacuum);
+	}
 
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vac_strategy);
+scan_done:
 
-		/* We need buffer cleanup lock so that we can prune HOT chains. */
-		if (!ConditionalLockBufferForCleanup(buf))
-		{
-			/*
-			 * If we're not performing an aggressive scan to guard against XID
-			 * wraparound, and we don't want to forcibly check the page, then
-			 * it's OK to skip vacuuming pages we get a lock conflict on. They
-			 * will be dealt with in some future vacuum.
-			 */
-			if (!aggressive && !FORCE_CHECK_PAGE())
-			{
-				ReleaseBuffer(buf);
-				vacrelstats->pinskipped_pages++;
-				continue;
-			}
+	/* report that everything is scanned and vacuumed */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
 
-			/*
-			 * Read the page with share lock to see if any xids on it need to
-			 * be frozen.  If not we just skip the page, after updating our
-			 * scan statistics.  If there are some, we wait for cleanup lock.
-			 *
-			 * We could defer the lock request further by remembering the page
-			 * and coming back to it later, or we could even register
-			 * ourselves for multiple buffers and then service whichever one
-			 * is received first.  For now, this seems good enough.
-			 *
-			 * If we get here with aggressive false, then we're just forcibly
-			 * checking the page, and so we don't want to insist on getting
-			 * the lock; we only need to know if the page contains tuples, so
-			 * that we can update nonempty_pages correctly.  It's convenient
-			 * to use lazy_check_needs_freeze() for both situations, though.
-			 */
-			LockBuffer(buf, BUFFER_LOCK_SHARE);
-			if (!lazy_check_needs_freeze(buf, &hastup, vacrelstats))
-			{
-				UnlockReleaseBuffer(buf);
-				vacrelstats->scanned_pages++;
-				vacrelstats->pinskipped_pages++;
-				if (hastup)
-					vacrelstats->nonempty_pages = blkno + 1;
-				continue;
-			}
-			if (!aggressive)
-			{
-				/*
-				 * Here, we must not advance scanned_pages; that would amount
-				 * to claiming that the page contains no freezable tuples.
-				 */
-				UnlockReleaseBuffer(buf);
-				vacrelstats->pinskipped_pages++;
-				if (hastup)
-					vacrelstats->nonempty_pages = blkno + 1;
-				continue;
-			}
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-			LockBufferForCleanup(buf);
-			/* drop through to normal processing */
-		}
+	/* Clear the block number information */
+	vacrelstats->blkno = InvalidBlockNumber;
 
-		vacrelstats->scanned_pages++;
-		vacrelstats->tupcount_pages++;
+	pfree(frozen);
 
-		page = BufferGetPage(buf);
+	/* now we can compute the new value for pg_class.reltuples */
+	vacrelstats->new_live_tuples = vac_estimate_reltuples(onerel,
+														  nblocks,
+														  vacrelstats->tupcount_pages,
+														  vacrelstats->live_tuples);
 
-		if (PageIsNew(page))
-		{
-			/*
-			 * All-zeroes pages can be left over if either a backend extends
-			 * the relation by a single page, but crashes before the newly
-			 * initialized page has been written out, or when bulk-extending
-			 * the relation (which creates a number of empty pages at the tail
-			 * end of the relation, but enters them into the FSM).
-			 *
-			 * Note we do not enter the page into the visibilitymap. That has
-			 * the downside that we repeatedly visit this page in subsequent
-			 * vacuums, but otherwise we'll never not discover the space on a
-			 * promoted standby. The harm of repeated checking ought to
-			 * normally not be too bad - the space usually should be used at
-			 * some point, otherwise there wouldn't be any regular vacuums.
-			 *
-			 * Make sure these pages are in the FSM, to ensure they can be
-			 * reused. Do that by testing if there's any space recorded for
-			 * the page. If not, enter it. We do so after releasing the lock
-			 * on the heap page, the FSM is approximate, after all.
-			 */
-			UnlockReleaseBuffer(buf);
+	/*
+	 * Also compute the total number of surviving heap entries.  In the
+	 * (unlikely) scenario that new_live_tuples is -1, take it as zero.
+	 */
+	vacrelstats->new_rel_tuples =
+		Max(vacrelstats->new_live_tuples, 0) + vacrelstats->new_dead_tuples;
 
-			empty_pages++;
+	/*
+	 * Release any remaining pin on visibility map page.
+	 */
+	if (BufferIsValid(vmbuffer))
+	{
+		ReleaseBuffer(vmbuffer);
+		vmbuffer = InvalidBuffer;
+	}
 
-			if (GetRecordedFreeSpace(onerel, blkno) == 0)
-			{
-				Size		freespace;
+	/* If any tuples need to be deleted, perform final vacuum cycle */
+	/* XXX put a threshold on min number of tuples here? */
+	if (dead_tuples->num_tuples > 0)
+	{
+		/* Work on all the indexes, and then the heap */
+		lazy_vacuum_all_indexes(onerel, Irel, indstats, vacrelstats,
+								lps, nindexes);
 
-				freespace = BufferGetPageSize(buf) - SizeOfPageHeaderData;
-				RecordPageWithFreeSpace(onerel, blkno, freespace);
-			}
-			continue;
-		}
+		/* Remove tuples from heap */
+		lazy_vacuum_heap(onerel, vacrelstats, lps);
+	}
 
-		if (PageIsEmpty(page))
-		{
-			empty_pages++;
-			freespace = PageGetHeapFreeSpace(page);
+	/*
+	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
+	 * not there were indexes.
+	 */
+	if (blkno > next_fsm_block_to_vacuum)
+		FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, blkno);
 
-			/*
-			 * Empty pages are always all-visible and all-frozen (note that
-			 * the same is currently not true for new pages, see above).
-			 */
-			if (!PageIsAllVisible(page))
-			{
-				START_CRIT_SECTION();
+	/* report all blocks vacuumed */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
 
-				/* mark buffer dirty before writing a WAL record */
-				MarkBufferDirty(buf);
+	/* Do post-vacuum cleanup */
+	if (vacrelstats->useindex)
+		lazy_cleanup_all_indexes(Irel, indstats, vacrelstats, lps, nindexes);
 
-				/*
-				 * It's possible that another backend has extended the heap,
-				 * initialized the page, and then failed to WAL-log the page
-				 * due to an ERROR.  Since heap extension is not WAL-logged,
-				 * recovery might try to replay our record setting the page
-				 * all-visible and find that the page isn't initialized, which
-				 * will cause a PANIC.  To prevent that, check whether the
-				 * page has been previously WAL-logged, and if not, do that
-				 * now.
-				 */
-				if (RelationNeedsWAL(onerel) &&
-					PageGetLSN(page) == InvalidXLogRecPtr)
-					log_newpage_buffer(buf, true);
-
-				PageSetAllVisible(page);
-				visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-								  vmbuffer, InvalidTransactionId,
-								  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
-				END_CRIT_SECTION();
-			}
+	/*
+	 * End parallel mode before updating index statistics as we cannot write
+	 * during parallel mode.
+	 */
+	if (ParallelVacuumIsActive(lps))
+		end_parallel_vacuum(indstats, lps, nindexes);
 
-			UnlockReleaseBuffer(buf);
-			RecordPageWithFreeSpace(onerel, blkno, freespace);
-			continue;
-		}
+	/* Update index statistics */
+	if (vacrelstats->useindex)
+		update_index_statistics(Irel, indstats, nindexes);
 
-		/*
-		 * Prune all HOT-update chains in this page.
-		 *
-		 * We count tuples removed by the pruning step as removed by VACUUM
-		 * (existing LP_DEAD line pointers don't count).
-		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, vistest,
-										 InvalidTransactionId, 0, false,
-										 &vacrelstats->latestRemovedXid,
-										 &vacrelstats->offnum);
+	/* If no indexes, make log report that lazy_vacuum_heap would've made */
+	if (vacrelstats->vacuumed_pages)
+		ereport(elevel,
+				(errmsg("\"%s\": removed %.0f row versions in %u pages",
+						vacrelstats->relname,
+						vacrelstats->tuples_deleted,
+						vacrelstats->vacuumed_pages)));
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 _("%.0f dead row versions cannot be removed yet, oldest xmin: %u\n"),
+					 vacrelstats->new_dead_tuples, OldestXmin);
+	appendStringInfo(&buf, _("There were %.0f unused item identifiers.\n"),
+					 vacrelstats->nunused);
+	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
+									"Skipped %u pages due to buffer pins, ",
+									vacrelstats->pinskipped_pages),
+					 vacrelstats->pinskipped_pages);
+	appendStringInfo(&buf, ngettext("%u frozen page.\n",
+									"%u frozen pages.\n",
+									vacrelstats->frozenskipped_pages),
+					 vacrelstats->frozenskipped_pages);
+	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
+									"%u pages are entirely empty.\n",
+									vacrelstats->empty_pages),
+					 vacrelstats->empty_pages);
+	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
+
+	ereport(elevel,
+			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions in %u out of %u pages",
+					vacrelstats->relname,
+					vacrelstats->tuples_deleted, vacrelstats->num_tuples,
+					vacrelstats->scanned_pages, nblocks),
+			 errdetail_internal("%s", buf.data)));
+	pfree(buf.data);
+}
+
+/*
+ *	lazy_scan_page() -- prune and scan one heap page
+ *
+ *		This does the work of lazy_scan_heap for a single block that the
+ *		caller decided not to skip.  Statistics are accumulated into
+ *		vacrelstats, and dead tuples are recorded in dead_tuples, which is
+ *		either vacrelstats->dead_tuples or, in a parallel heap scan, an array
+ *		private to the participant.
+ *
+ *		force_check tells whether we must check the page for tuples even if
+ *		we can't get a cleanup lock on it (see lazy_scan_heap).  vmbuffer is
+ *		the caller's visibility map buffer, which we may switch to the page
+ *		covering blkno.  next_fsm_block_to_vacuum is only used for the
+ *		one-pass strategy, where we vacuum the FSM incrementally.
+ */
+static void
+lazy_scan_page(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
+			   LVDeadTuples *dead_tuples, int nindexes, BlockNumber blkno,
+			   bool aggressive, bool all_visible_according_to_vm,
+			   bool force_check, GlobalVisState *vistest,
+			   xl_heap_freeze_tuple *frozen, Buffer *vmbuffer,
+			   BlockNumber *next_fsm_block_to_vacuum)
+{
+	TransactionId relfrozenxid = onerel->rd_rel->relfrozenxid;
+	TransactionId relminmxid = onerel->rd_rel->relminmxid;
+	HeapTupleData tuple;
+	Buffer		buf;
+	Page		page;
+	OffsetNumber offnum,
+				maxoff;
+	bool		tupgone,
+				hastup;
+	int			prev_dead_count;
+	int			nfrozen;
+	Size		freespace;
+	bool		all_visible;
+	bool		all_frozen = true;	/* provided all_visible is also true */
+	bool		has_dead_tuples;
+	TransactionId visibility_cutoff_xid = InvalidTransactionId;
+	int			i;
 
+	/*
+	 * Pin the visibility map page in case we need to mark the page
+	 * all-visible.  In most cases this will be very cheap, because we'll
+	 * already have the correct page pinned anyway.  However, it's possible
+	 * that (a) next_unskippable_block is covered by a different VM page than
+	 * the current block or (b) we released our pin and did a cycle of index
+	 * vacuuming.
+	 *
+	 */
+	visibilitymap_pin(onerel, blkno, vmbuffer);
+
+	buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
+							 RBM_NORMAL, vac_strategy);
+
+	/* We need buffer cleanup lock so that we can prune HOT chains. */
+	if (!ConditionalLockBufferForCleanup(buf))
+	{
 		/*
-		 * Now scan the page to collect vacuumable items and check for tuples
-		 * requiring freezing.
+		 * If we're not performing an aggressive scan to guard against XID
+		 * wraparound, and we don't want to forcibly check the page, then it's
+		 * OK to skip vacuuming pages we get a lock conflict on. They will be
+		 * dealt with in some future vacuum.
 		 */
-		all_visible = true;
-		has_dead_tuples = false;
-		nfrozen = 0;
-		hastup = false;
-		prev_dead_count = dead_tuples->num_tuples;
-		maxoff = PageGetMaxOffsetNumber(page);
+		if (!aggressive && !force_check)
+		{
+			ReleaseBuffer(buf);
+			vacrelstats->pinskipped_pages++;
+			return;
+		}
 
 		/*
-		 * Note: If you change anything in the loop below, also look at
-		 * heap_page_is_all_visible to see if that needs to be changed.
+		 * Read the page with share lock to see if any xids on it need to be
+		 * frozen.  If not we just skip the page, after updating our scan
+		 * statistics.  If there are some, we wait for cleanup lock.
+		 *
+		 * We could defer the lock request further by remembering the page and
+		 * coming back to it later, or we could even register ourselves for
+		 * multiple buffers and then service whichever one is received first.
+		 * For now, this seems good enough.
+		 *
+		 * If we get here with aggressive false, then we're just forcibly
+		 * checking the page, and so we don't want to insist on getting the
+		 * lock; we only need to know if the page contains tuples, so that we
+		 * can update nonempty_pages correctly.  It's convenient to use
+		 * lazy_check_needs_freeze() for both situations, though.
 		 */
-		for (offnum = FirstOffsetNumber;
-			 offnum <= maxoff;
-			 offnum = OffsetNumberNext(offnum))
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		if (!lazy_check_needs_freeze(buf, &hastup, vacrelstats))
+		{
+			UnlockReleaseBuffer(buf);
+			vacrelstats->scanned_pages++;
+			vacrelstats->pinskipped_pages++;
+			if (hastup)
+				vacrelstats->nonempty_pages = blkno + 1;
+			return;
+		}
+		if (!aggressive)
 		{
-			ItemId		itemid;
-
 			/*
-			 * Set the offset number so that we can display it along with any
-			 * error that occurred while processing this tuple.
+			 * Here, we must not advance scanned_pages; that would amount to
+			 * claiming that the page contains no freezable tuples.
 			 */
-			vacrelstats->offnum = offnum;
-			itemid = PageGetItemId(page, offnum);
+			UnlockReleaseBuffer(buf);
+			vacrelstats->pinskipped_pages++;
+			if (hastup)
+				vacrelstats->nonempty_pages = blkno + 1;
+			return;
+		}
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBufferForCleanup(buf);
+		/* drop through to normal processing */
+	}
 
-			/* Unused items require no processing, but we count 'em */
-			if (!ItemIdIsUsed(itemid))
-			{
-				nunused += 1;
-				continue;
-			}
+	vacrelstats->scanned_pages++;
+	vacrelstats->tupcount_pages++;
 
-			/* Redirect items mustn't be touched */
-			if (ItemIdIsRedirected(itemid))
-			{
-				hastup = true;	/* this page won't be truncatable */
-				continue;
-			}
+	page = BufferGetPage(buf);
+
+	if (PageIsNew(page))
+	{
+		/*
+		 * All-zeroes pages can be left over if either a backend extends the
+		 * relation by a single page, but crashes before the newly initialized
+		 * page has been written out, or when bulk-extending the relation
+		 * (which creates a number of empty pages at the tail end of the
+		 * relation, but enters them into the FSM).
+		 *
+		 * Note we do not enter the page into the visibilitymap. That has the
+		 * downside that we repeatedly visit this page in subsequent vacuums,
+		 * but otherwise we'll never not discover the space on a promoted
+		 * standby. The harm of repeated checking ought to normally not be too
+		 * bad - the space usually should be used at some point, otherwise
+		 * there wouldn't be any regular vacuums.
+		 *
+		 * Make sure these pages are in the FSM, to ensure they can be reused.
+		 * Do that by testing if there's any space recorded for the page. If
+		 * not, enter it. We do so after releasing the lock on the heap page,
+		 * the FSM is approximate, after all.
+		 */
+		UnlockReleaseBuffer(buf);
 
-			ItemPointerSet(&(tuple.t_self), blkno, offnum);
+		vacrelstats->empty_pages++;
 
-			/*
-			 * LP_DEAD line pointers are to be vacuumed normally; but we don't
-			 * count them in tups_vacuumed, else we'd be double-counting (at
-			 * least in the common case where heap_page_prune() just freed up
-			 * a non-HOT tuple).  Note also that the final tups_vacuumed value
-			 * might be very low for tables where opportunistic page pruning
-			 * happens to occur very frequently (via heap_page_prune_opt()
-			 * calls that free up non-HOT tuples).
-			 */
-			if (ItemIdIsDead(itemid))
-			{
-				lazy_record_dead_tuple(dead_tuples, &(tuple.t_self));
-				all_visible = false;
-				continue;
-			}
+		if (GetRecordedFreeSpace(onerel, blkno) == 0)
+		{
+			freespace = BufferGetPageSize(buf) - SizeOfPageHeaderData;
+			RecordPageWithFreeSpace(onerel, blkno, freespace);
+		}
+		return;
+	}
 
-			Assert(ItemIdIsNormal(itemid));
+	if (PageIsEmpty(page))
+	{
+		vacrelstats->empty_pages++;
+		freespace = PageGetHeapFreeSpace(page);
 
-			tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
-			tuple.t_len = ItemIdGetLength(itemid);
-			tuple.t_tableOid = RelationGetRelid(onerel);
+		/*
+		 * Empty pages are always all-visible and all-frozen (note that the
+		 * same is currently not true for new pages, see above).
+		 */
+		if (!PageIsAllVisible(page))
+		{
+			START_CRIT_SECTION();
 
-			tupgone = false;
+			/* mark buffer dirty before writing a WAL record */
+			MarkBufferDirty(buf);
 
 			/*
-			 * The criteria for counting a tuple as live in this block need to
-			 * match what analyze.c's acquire_sample_rows() does, otherwise
-			 * VACUUM and ANALYZE may produce wildly different reltuples
-			 * values, e.g. when there are many recently-dead tuples.
-			 *
-			 * The logic here is a bit simpler than acquire_sample_rows(), as
-			 * VACUUM can't run inside a transaction block, which makes some
-			 * cases impossible (e.g. in-progress insert from the same
-			 * transaction).
+			 * It's possible that another backend has extended the heap,
+			 * initialized the page, and then failed to WAL-log the page due
+			 * to an ERROR.  Since heap extension is not WAL-logged, recovery
+			 * might try to replay our record setting the page all-visible and
+			 * find that the page isn't initialized, which will cause a PANIC.
+			 * To prevent that, check whether the page has been previously
+			 * WAL-logged, and if not, do that now.
 			 */
-			switch (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf))
-			{
-				case HEAPTUPLE_DEAD:
+			if (RelationNeedsWAL(onerel) &&
+				PageGetLSN(page) == InvalidXLogRecPtr)
+				log_newpage_buffer(buf, true);
 
-					/*
-					 * Ordinarily, DEAD tuples would have been removed by
-					 * heap_page_prune(), but it's possible that the tuple
-					 * state changed since heap_page_prune() looked.  In
-					 * particular an INSERT_IN_PROGRESS tuple could have
-					 * changed to DEAD if the inserter aborted.  So this
-					 * cannot be considered an error condition.
-					 *
-					 * If the tuple is HOT-updated then it must only be
-					 * removed by a prune operation; so we keep it just as if
-					 * it were RECENTLY_DEAD.  Also, if it's a heap-only
-					 * tuple, we choose to keep it, because it'll be a lot
-					 * cheaper to get rid of it in the next pruning pass than
-					 * to treat it like an indexed tuple. Finally, if index
-					 * cleanup is disabled, the second heap pass will not
-					 * execute, and the tuple will not get removed, so we must
-					 * treat it like any other dead tuple that we choose to
-					 * keep.
-					 *
-					 * If this were to happen for a tuple that actually needed
-					 * to be deleted, we'd be in trouble, because it'd
-					 * possibly leave a tuple below the relation's xmin
-					 * horizon alive.  heap_prepare_freeze_tuple() is prepared
-					 * to detect that case and abort the transaction,
-					 * preventing corruption.
-					 */
-					if (HeapTupleIsHotUpdated(&tuple) ||
-						HeapTupleIsHeapOnly(&tuple) ||
-						params->index_cleanup == VACOPT_TERNARY_DISABLED)
-						nkeep += 1;
-					else
-						tupgone = true; /* we can delete the tuple */
-					all_visible = false;
-					break;
-				case HEAPTUPLE_LIVE:
+			PageSetAllVisible(page);
+			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+							  *vmbuffer, InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+			END_CRIT_SECTION();
+		}
 
-					/*
-					 * Count it as live.  Not only is this natural, but it's
-					 * also what acquire_sample_rows() does.
-					 */
-					live_tuples += 1;
-
-					/*
-					 * Is the tuple definitely visible to all transactions?
-					 *
-					 * NB: Like with per-tuple hint bits, we can't set the
-					 * PD_ALL_VISIBLE flag if the inserter committed
-					 * asynchronously. See SetHintBits for more info. Check
-					 * that the tuple is hinted xmin-committed because of
-					 * that.
-					 */
-					if (all_visible)
-					{
-						TransactionId xmin;
-
-						if (!HeapTupleHeaderXminCommitted(tuple.t_data))
-						{
-							all_visible = false;
-							break;
-						}
-
-						/*
-						 * The inserter definitely committed. But is it old
-						 * enough that everyone sees it as committed?
-						 */
-						xmin = HeapTupleHeaderGetXmin(tuple.t_data);
-						if (!TransactionIdPrecedes(xmin, OldestXmin))
-						{
-							all_visible = false;
-							break;
-						}
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(onerel, blkno, freespace);
+		return;
+	}
 
-						/* Track newest xmin on page. */
-						if (TransactionIdFollows(xmin, visibility_cutoff_xid))
-							visibility_cutoff_xid = xmin;
-					}
-					break;
-				case HEAPTUPLE_RECENTLY_DEAD:
+	/*
+	 * Prune all HOT-update chains in this page.
+	 *
+	 * We count tuples removed by the pruning step as removed by VACUUM
+	 * (existing LP_DEAD line pointers don't count).
+	 */
+	vacrelstats->tuples_deleted += heap_page_prune(onerel, buf, vistest,
+												   InvalidTransactionId, 0, false,
+												   &vacrelstats->latestRemovedXid,
+												   &vacrelstats->offnum);
 
-					/*
-					 * If tuple is recently deleted then we must not remove it
-					 * from relation.
-					 */
-					nkeep += 1;
-					all_visible = false;
-					break;
-				case HEAPTUPLE_INSERT_IN_PROGRESS:
+	/*
+	 * Now scan the page to collect vacuumable items and check for tuples
+	 * requiring freezing.
+	 */
+	all_visible = true;
+	has_dead_tuples = false;
+	nfrozen = 0;
+	hastup = false;
+	prev_dead_count = dead_tuples->num_tuples;
+	maxoff = PageGetMaxOffsetNumber(page);
 
-					/*
-					 * This is an expected case during concurrent vacuum.
-					 *
-					 * We do not count these rows as live, because we expect
-					 * the inserting transaction to update the counters at
-					 * commit, and we assume that will happen only after we
-					 * report our results.  This assumption is a bit shaky,
-					 * but it is what acquire_sample_rows() does, so be
-					 * consistent.
-					 */
-					all_visible = false;
-					break;
-				case HEAPTUPLE_DELETE_IN_PROGRESS:
-					/* This is an expected case during concurrent vacuum */
-					all_visible = false;
+	/*
+	 * Note: If you change anything in the loop below, also look at
+	 * heap_page_is_all_visible to see if that needs to be changed.
+	 */
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid;
 
-					/*
-					 * Count such rows as live.  As above, we assume the
-					 * deleting transaction will commit and update the
-					 * counters after we report.
-					 */
-					live_tuples += 1;
-					break;
-				default:
-					elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
-					break;
-			}
+		/*
+		 * Set the offset number so that we can display it along with any
+		 * error that occurred while processing this tuple.
+		 */
+		vacrelstats->offnum = offnum;
+		itemid = PageGetItemId(page, offnum);
 
-			if (tupgone)
-			{
-				lazy_record_dead_tuple(dead_tuples, &(tuple.t_self));
-				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
-													   &vacrelstats->latestRemovedXid);
-				tups_vacuumed += 1;
-				has_dead_tuples = true;
-			}
-			else
-			{
-				bool		tuple_totally_frozen;
+		/* Unused items require no processing, but we count 'em */
+		if (!ItemIdIsUsed(itemid))
+		{
+			vacrelstats->nunused += 1;
+			continue;
+		}
 
-				num_tuples += 1;
-				hastup = true;
+		/* Redirect items mustn't be touched */
+		if (ItemIdIsRedirected(itemid))
+		{
+			hastup = true;		/* this page won't be truncatable */
+			continue;
+		}
 
-				/*
-				 * Each non-removable tuple must be checked to see if it needs
-				 * freezing.  Note we already have exclusive buffer lock.
-				 */
-				if (heap_prepare_freeze_tuple(tuple.t_data,
-											  relfrozenxid, relminmxid,
-											  FreezeLimit, MultiXactCutoff,
-											  &frozen[nfrozen],
-											  &tuple_totally_frozen))
-					frozen[nfrozen++].offset = offnum;
-
-				if (!tuple_totally_frozen)
-					all_frozen = false;
-			}
-		}						/* scan along page */
+		ItemPointerSet(&(tuple.t_self), blkno, offnum);
 
 		/*
-		 * Clear the offset information once we have processed all the tuples
-		 * on the page.
+		 * LP_DEAD line pointers are to be vacuumed normally; but we don't
+		 * count them in tuples_deleted, else we'd be double-counting (at
+		 * least in the common case where heap_page_prune() just freed up a
+		 * non-HOT tuple).  Note also that the final tuples_deleted value
+		 * might be very low for tables where opportunistic page pruning
+		 * happens to occur very frequently (via heap_page_prune_opt() calls
+		 * that free up non-HOT tuples).
 		 */
-		vacrelstats->offnum = InvalidOffsetNumber;
+		if (ItemIdIsDead(itemid))
+		{
+			lazy_record_dead_tuple(dead_tuples, &(tuple.t_self));
+			all_visible = false;
+			continue;
+		}
+
+		Assert(ItemIdIsNormal(itemid));
+
+		tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+		tuple.t_len = ItemIdGetLength(itemid);
+		tuple.t_tableOid = RelationGetRelid(onerel);
+
+		tupgone = false;
 
 		/*
-		 * If we froze any tuples, mark the buffer dirty, and write a WAL
-		 * record recording the changes.  We must log the changes to be
-		 * crash-safe against future truncation of CLOG.
+		 * The criteria for counting a tuple as live in this block need to
+		 * match what analyze.c's acquire_sample_rows() does, otherwise VACUUM
+		 * and ANALYZE may produce wildly different reltuples values, e.g.
+		 * when there are many recently-dead tuples.
+		 *
+		 * The logic here is a bit simpler than acquire_sample_rows(), as
+		 * VACUUM can't run inside a transaction block, which makes some cases
+		 * impossible (e.g. in-progress insert from the same transaction).
 		 */
-		if (nfrozen > 0)
+		switch (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf))
 		{
-			START_CRIT_SECTION();
+			case HEAPTUPLE_DEAD:
 
-			MarkBufferDirty(buf);
+				/*
+				 * Ordinarily, DEAD tuples would have been removed by
+				 * heap_page_prune(), but it's possible that the tuple state
+				 * changed since heap_page_prune() looked.  In particular an
+				 * INSERT_IN_PROGRESS tuple could have changed to DEAD if the
+				 * inserter aborted.  So this cannot be considered an error
+				 * condition.
+				 *
+				 * If the tuple is HOT-updated then it must only be removed by
+				 * a prune operation; so we keep it just as if it were
+				 * RECENTLY_DEAD.  Also, if it's a heap-only tuple, we choose
+				 * to keep it, because it'll be a lot cheaper to get rid of it
+				 * in the next pruning pass than to treat it like an indexed
+				 * tuple. Finally, if index cleanup is disabled, the second
+				 * heap pass will not execute, and the tuple will not get
+				 * removed, so we must treat it like any other dead tuple that
+				 * we choose to keep.
+				 *
+				 * If this were to happen for a tuple that actually needed to
+				 * be deleted, we'd be in trouble, because it'd possibly leave
+				 * a tuple below the relation's xmin horizon alive.
+				 * heap_prepare_freeze_tuple() is prepared to detect that case
+				 * and abort the transaction, preventing corruption.
+				 */
+				if (HeapTupleIsHotUpdated(&tuple) ||
+					HeapTupleIsHeapOnly(&tuple) ||
+					params->index_cleanup == VACOPT_TERNARY_DISABLED)
+					vacrelstats->new_dead_tuples += 1;
+				else
+					tupgone = true; /* we can delete the tuple */
+				all_visible = false;
+				break;
+			case HEAPTUPLE_LIVE:
 
-			/* execute collected freezes */
-			for (i = 0; i < nfrozen; i++)
-			{
-				ItemId		itemid;
-				HeapTupleHeader htup;
+				/*
+				 * Count it as live.  Not only is this natural, but it's also
+				 * what acquire_sample_rows() does.
+				 */
+				vacrelstats->live_tuples += 1;
 
-				itemid = PageGetItemId(page, frozen[i].offset);
-				htup = (HeapTupleHeader) PageGetItem(page, itemid);
+				/*
+				 * Is the tuple definitely visible to all transactions?
+				 *
+				 * NB: Like with per-tuple hint bits, we can't set the
+				 * PD_ALL_VISIBLE flag if the inserter committed
+				 * asynchronously. See SetHintBits for more info. Check that
+				 * the tuple is hinted xmin-committed because of that.
+				 */
+				if (all_visible)
+				{
+					TransactionId xmin;
 
-				heap_execute_freeze_tuple(htup, &frozen[i]);
-			}
+					if (!HeapTupleHeaderXminCommitted(tuple.t_data))
+					{
+						all_visible = false;
+						break;
+					}
 
-			/* Now WAL-log freezing if necessary */
-			if (RelationNeedsWAL(onerel))
-			{
-				XLogRecPtr	recptr;
+					/*
+					 * The inserter definitely committed. But is it old enough
+					 * that everyone sees it as committed?
+					 */
+					xmin = HeapTupleHeaderGetXmin(tuple.t_data);
+					if (!TransactionIdPrecedes(xmin, OldestXmin))
+					{
+						all_visible = false;
+						break;
+					}
 
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
-										 frozen, nfrozen);
-				PageSetLSN(page, recptr);
-			}
+					/* Track newest xmin on page. */
+					if (TransactionIdFollows(xmin, visibility_cutoff_xid))
+						visibility_cutoff_xid = xmin;
+				}
+				break;
+			case HEAPTUPLE_RECENTLY_DEAD:
 
-			END_CRIT_SECTION();
-		}
+				/*
+				 * If tuple is recently deleted then we must not remove it
+				 * from relation.
+				 */
+				vacrelstats->new_dead_tuples += 1;
+				all_visible = false;
+				break;
+			case HEAPTUPLE_INSERT_IN_PROGRESS:
 
-		/*
-		 * If there are no indexes we can vacuum the page right now instead of
-		 * doing a second scan. Also we don't do that but forget dead tuples
-		 * when index cleanup is disabled.
-		 */
-		if (!vacrelstats->useindex && dead_tuples->num_tuples > 0)
-		{
-			if (nindexes == 0)
-			{
-				/* Remove tuples from heap if the table has no index */
-				lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
-				vacuumed_pages++;
-				has_dead_tuples = false;
-			}
-			else
-			{
 				/*
-				 * Here, we have indexes but index cleanup is disabled.
-				 * Instead of vacuuming the dead tuples on the heap, we just
-				 * forget them.
+				 * This is an expected case during concurrent vacuum.
 				 *
-				 * Note that vacrelstats->dead_tuples could have tuples which
-				 * became dead after HOT-pruning but are not marked dead yet.
-				 * We do not process them because it's a very rare condition,
-				 * and the next vacuum will process them anyway.
+				 * We do not count these rows as live, because we expect the
+				 * inserting transaction to update the counters at commit,
+				 * and we assume that will happen only after we report our
+				 * results.  This assumption is a bit shaky, but it is what
+				 * acquire_sample_rows() does, so be consistent.
 				 */
-				Assert(params->index_cleanup == VACOPT_TERNARY_DISABLED);
-			}
+				all_visible = false;
+				break;
+			case HEAPTUPLE_DELETE_IN_PROGRESS:
+				/* This is an expected case during concurrent vacuum */
+				all_visible = false;
 
-			/*
-			 * Forget the now-vacuumed tuples, and press on, but be careful
-			 * not to reset latestRemovedXid since we want that value to be
-			 * valid.
-			 */
-			dead_tuples->num_tuples = 0;
+				/*
+				 * Count such rows as live.  As above, we assume the deleting
+				 * transaction will commit and update the counters after we
+				 * report.
+				 */
+				vacrelstats->live_tuples += 1;
+				break;
+			default:
+				elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
+				break;
+		}
+
+		if (tupgone)
+		{
+			lazy_record_dead_tuple(dead_tuples, &(tuple.t_self));
+			HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
+												   &vacrelstats->latestRemovedXid);
+			vacrelstats->tuples_deleted += 1;
+			has_dead_tuples = true;
+		}
+		else
+		{
+			bool		tuple_totally_frozen;
+
+			vacrelstats->num_tuples += 1;
+			hastup = true;
 
 			/*
-			 * Periodically do incremental FSM vacuuming to make newly-freed
-			 * space visible on upper FSM pages.  Note: although we've cleaned
-			 * the current block, we haven't yet updated its FSM entry (that
-			 * happens further down), so passing end == blkno is correct.
+			 * Each non-removable tuple must be checked to see if it needs
+			 * freezing.  Note we already have exclusive buffer lock.
 			 */
-			if (blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
-			{
-				FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum,
-										blkno);
-				next_fsm_block_to_vacuum = blkno;
-			}
+			if (heap_prepare_freeze_tuple(tuple.t_data,
+										  relfrozenxid, relminmxid,
+										  FreezeLimit, MultiXactCutoff,
+										  &frozen[nfrozen],
+										  &tuple_totally_frozen))
+				frozen[nfrozen++].offset = offnum;
+
+			if (!tuple_totally_frozen)
+				all_frozen = false;
 		}
+	}							/* scan along page */
 
-		freespace = PageGetHeapFreeSpace(page);
+	/*
+	 * Clear the offset information once we have processed all the tuples on
+	 * the page.
+	 */
+	vacrelstats->offnum = InvalidOffsetNumber;
 
-		/* mark page all-visible, if appropriate */
-		if (all_visible && !all_visible_according_to_vm)
+	/*
+	 * If we froze any tuples, mark the buffer dirty, and write a WAL record
+	 * recording the changes.  We must log the changes to be crash-safe
+	 * against future truncation of CLOG.
+	 */
+	if (nfrozen > 0)
+	{
+		START_CRIT_SECTION();
+
+		MarkBufferDirty(buf);
+
+		/* execute collected freezes */
+		for (i = 0; i < nfrozen; i++)
+		{
+			ItemId		itemid;
+			HeapTupleHeader htup;
+
+			itemid = PageGetItemId(page, frozen[i].offset);
+			htup = (HeapTupleHeader) PageGetItem(page, itemid);
+
+			heap_execute_freeze_tuple(htup, &frozen[i]);
+		}
+
+		/* Now WAL-log freezing if necessary */
+		if (RelationNeedsWAL(onerel))
 		{
-			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+			XLogRecPtr	recptr;
 
-			if (all_frozen)
-				flags |= VISIBILITYMAP_ALL_FROZEN;
+			recptr = log_heap_freeze(onerel, buf, FreezeLimit,
+									 frozen, nfrozen);
+			PageSetLSN(page, recptr);
+		}
+
+		END_CRIT_SECTION();
+	}
+
+	/*
+	 * If there are no indexes we can vacuum the page right now instead of
+	 * doing a second scan. Also we don't do that but forget dead tuples when
+	 * index cleanup is disabled.
+	 */
+	if (!vacrelstats->useindex && dead_tuples->num_tuples > 0)
+	{
+		Assert(dead_tuples == vacrelstats->dead_tuples);
 
+		if (nindexes == 0)
+		{
+			/* Remove tuples from heap if the table has no index */
+			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, vmbuffer);
+			vacrelstats->vacuumed_pages++;
+			has_dead_tuples = false;
+		}
+		else
+		{
 			/*
-			 * It should never be the case that the visibility map page is set
-			 * while the page-level bit is clear, but the reverse is allowed
-			 * (if checksums are not enabled).  Regardless, set both bits so
-			 * that we get back in sync.
+			 * Here, we have indexes but index cleanup is disabled.  Instead
+			 * of vacuuming the dead tuples on the heap, we just forget them.
 			 *
-			 * NB: If the heap page is all-visible but the VM bit is not set,
-			 * we don't need to dirty the heap page.  However, if checksums
-			 * are enabled, we do need to make sure that the heap page is
-			 * dirtied before passing it to visibilitymap_set(), because it
-			 * may be logged.  Given that this situation should only happen in
-			 * rare cases after a crash, it is not worth optimizing.
+			 * Note that vacrelstats->dead_tuples could have tuples which
+			 * became dead after HOT-pruning but are not marked dead yet.  We
+			 * do not process them because it's a very rare condition, and
+			 * the next vacuum will process them anyway.
 			 */
-			PageSetAllVisible(page);
-			MarkBufferDirty(buf);
-			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, visibility_cutoff_xid, flags);
+			Assert(params->index_cleanup == VACOPT_TERNARY_DISABLED);
 		}
 
 		/*
-		 * As of PostgreSQL 9.2, the visibility map bit should never be set if
-		 * the page-level bit is clear.  However, it's possible that the bit
-		 * got cleared after we checked it and before we took the buffer
-		 * content lock, so we must recheck before jumping to the conclusion
-		 * that something bad has happened.
+		 * Forget the now-vacuumed tuples, and press on, but be careful not to
+		 * reset latestRemovedXid since we want that value to be valid.
 		 */
-		else if (all_visible_according_to_vm && !PageIsAllVisible(page)
-				 && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
-		{
-			elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
-				 vacrelstats->relname, blkno);
-			visibilitymap_clear(onerel, blkno, vmbuffer,
-								VISIBILITYMAP_VALID_BITS);
-		}
+		dead_tuples->num_tuples = 0;
 
 		/*
-		 * It's possible for the value returned by
-		 * GetOldestNonRemovableTransactionId() to move backwards, so it's not
-		 * wrong for us to see tuples that appear to not be visible to
-		 * everyone yet, while PD_ALL_VISIBLE is already set. The real safe
-		 * xmin value never moves backwards, but
-		 * GetOldestNonRemovableTransactionId() is conservative and sometimes
-		 * returns a value that's unnecessarily small, so if we see that
-		 * contradiction it just means that the tuples that we think are not
-		 * visible to everyone yet actually are, and the PD_ALL_VISIBLE flag
-		 * is correct.
-		 *
-		 * There should never be dead tuples on a page with PD_ALL_VISIBLE
-		 * set, however.
+		 * Periodically do incremental FSM vacuuming to make newly-freed space
+		 * visible on upper FSM pages.  Note: although we've cleaned the
+		 * current block, we haven't yet updated its FSM entry (that happens
+		 * further down), so passing end == blkno is correct.
 		 */
-		else if (PageIsAllVisible(page) && has_dead_tuples)
+		if (blkno - *next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
 		{
-			elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
-				 vacrelstats->relname, blkno);
-			PageClearAllVisible(page);
-			MarkBufferDirty(buf);
-			visibilitymap_clear(onerel, blkno, vmbuffer,
-								VISIBILITYMAP_VALID_BITS);
+			FreeSpaceMapVacuumRange(onerel, *next_fsm_block_to_vacuum,
+									blkno);
+			*next_fsm_block_to_vacuum = blkno;
 		}
+	}
+
+	freespace = PageGetHeapFreeSpace(page);
+
+	/* mark page all-visible, if appropriate */
+	if (all_visible && !all_visible_according_to_vm)
+	{
+		uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+		if (all_frozen)
+			flags |= VISIBILITYMAP_ALL_FROZEN;
 
 		/*
-		 * If the all-visible page is all-frozen but not marked as such yet,
-		 * mark it as all-frozen.  Note that all_frozen is only valid if
-		 * all_visible is true, so we must check both.
+		 * It should never be the case that the visibility map page is set
+		 * while the page-level bit is clear, but the reverse is allowed (if
+		 * checksums are not enabled).  Regardless, set both bits so that we
+		 * get back in sync.
+		 *
+		 * NB: If the heap page is all-visible but the VM bit is not set, we
+		 * don't need to dirty the heap page.  However, if checksums are
+		 * enabled, we do need to make sure that the heap page is dirtied
+		 * before passing it to visibilitymap_set(), because it may be logged.
+		 * Given that this situation should only happen in rare cases after a
+		 * crash, it is not worth optimizing.
 		 */
-		else if (all_visible_according_to_vm && all_visible && all_frozen &&
-				 !VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
-		{
-			/*
-			 * We can pass InvalidTransactionId as the cutoff XID here,
-			 * because setting the all-frozen bit doesn't cause recovery
-			 * conflicts.
-			 */
-			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, InvalidTransactionId,
-							  VISIBILITYMAP_ALL_FROZEN);
-		}
+		PageSetAllVisible(page);
+		MarkBufferDirty(buf);
+		visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+						  *vmbuffer, visibility_cutoff_xid, flags);
+	}
 
-		UnlockReleaseBuffer(buf);
+	/*
+	 * As of PostgreSQL 9.2, the visibility map bit should never be set if the
+	 * page-level bit is clear.  However, it's possible that the bit got
+	 * cleared after we checked it and before we took the buffer content lock,
+	 * so we must recheck before jumping to the conclusion that something bad
+	 * has happened.
+	 */
+	else if (all_visible_according_to_vm && !PageIsAllVisible(page)
+			 && VM_ALL_VISIBLE(onerel, blkno, vmbuffer))
+	{
+		elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
+			 vacrelstats->relname, blkno);
+		visibilitymap_clear(onerel, blkno, *vmbuffer,
+							VISIBILITYMAP_VALID_BITS);
+	}
 
-		/* Remember the location of the last page with nonremovable tuples */
-		if (hastup)
-			vacrelstats->nonempty_pages = blkno + 1;
+	/*
+	 * It's possible for the value returned by
+	 * GetOldestNonRemovableTransactionId() to move backwards, so it's not
+	 * wrong for us to see tuples that appear to not be visible to everyone
+	 * yet, while PD_ALL_VISIBLE is already set. The real safe xmin value
+	 * never moves backwards, but GetOldestNonRemovableTransactionId() is
+	 * conservative and sometimes returns a value that's unnecessarily small,
+	 * so if we see that contradiction it just means that the tuples that we
+	 * think are not visible to everyone yet actually are, and the
+	 * PD_ALL_VISIBLE flag is correct.
+	 *
+	 * There should never be dead tuples on a page with PD_ALL_VISIBLE set,
+	 * however.
+	 */
+	else if (PageIsAllVisible(page) && has_dead_tuples)
+	{
+		elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
+			 vacrelstats->relname, blkno);
+		PageClearAllVisible(page);
+		MarkBufferDirty(buf);
+		visibilitymap_clear(onerel, blkno, *vmbuffer,
+							VISIBILITYMAP_VALID_BITS);
+	}
 
+	/*
+	 * If the all-visible page is all-frozen but not marked as such yet, mark
+	 * it as all-frozen.  Note that all_frozen is only valid if all_visible is
+	 * true, so we must check both.
+	 */
+	else if (all_visible_according_to_vm && all_visible && all_frozen &&
+			 !VM_ALL_FROZEN(onerel, blkno, vmbuffer))
+	{
 		/*
-		 * If we remembered any tuples for deletion, then the page will be
-		 * visited again by lazy_vacuum_heap, which will compute and record
-		 * its post-compaction free space.  If not, then we're done with this
-		 * page, so remember its free space as-is.  (This path will always be
-		 * taken if there are no indexes.)
+		 * We can pass InvalidTransactionId as the cutoff XID here, because
+		 * setting the all-frozen bit doesn't cause recovery conflicts.
 		 */
-		if (dead_tuples->num_tuples == prev_dead_count)
-			RecordPageWithFreeSpace(onerel, blkno, freespace);
+		visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+						  *vmbuffer, InvalidTransactionId,
+						  VISIBILITYMAP_ALL_FROZEN);
 	}
 
-	/* report that everything is scanned and vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+	UnlockReleaseBuffer(buf);
+
+	/* Remember the location of the last page with nonremovable tuples */
+	if (hastup)
+		vacrelstats->nonempty_pages = blkno + 1;
+
+	/*
+	 * If we remembered any tuples for deletion, then the page will be visited
+	 * again by lazy_vacuum_heap, which will compute and record its
+	 * post-compaction free space.  If not, then we're done with this page, so
+	 * remember its free space as-is.  (This path will always be taken if
+	 * there are no indexes.)
+	 */
+	if (dead_tuples->num_tuples == prev_dead_count)
+		RecordPageWithFreeSpace(onerel, blkno, freespace);
+}
+
+/*
+ *	lazy_parallel_scan_heap() -- scan the heap with parallel workers
+ *
+ *		This replaces the main loop of lazy_scan_heap when the heap is scanned
+ *		in parallel.  The scan proceeds in rounds: we launch workers, join the
+ *		scan ourselves (see parallel_scan_heap), and once the participants
+ *		have stopped because the heap has been scanned completely or the dead
+ *		tuple array has no room left, we collect the workers' statistics and
+ *		sort the dead tuples, which were recorded in no particular order.  In
+ *		the latter case, we perform a cycle of index and heap vacuuming and
+ *		start another round.  The dead tuples of the last round are left for
+ *		the caller's final vacuum cycle.
+ *
+ *		Unlike the serial scan, we skip every block that the visibility map
+ *		allows us to skip: the participants read different parts of the heap
+ *		anyway, so keeping the reads sequential for the benefit of OS
+ *		readahead is not a concern.
+ */
+static void
+lazy_parallel_scan_heap(Relation onerel, VacuumParams *params,
+						LVRelStats *vacrelstats, Relation *Irel,
+						IndexBulkDeleteResult **indstats, int nindexes,
+						LVParallelState *lps, bool aggressive,
+						GlobalVisState *vistest,
+						BlockNumber *next_fsm_block_to_vacuum)
+{
+	LVShared   *lvshared = lps->lvshared;
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+	BlockNumber nblocks = vacrelstats->rel_pages;
+	BlockNumber chunk_blocks;
+
+	Assert(!IsParallelWorker());
+	Assert(lps->nworkers_heap > 0);
+
+	/*
+	 * Use smaller ranges of blocks if the dead tuple array can't accommodate
+	 * a full range for each participant.  compute_max_dead_tuples makes sure
+	 * there's room for at least one block.
+	 */
+	chunk_blocks = dead_tuples->max_tuples /
+		(MaxHeapTuplesPerPage * (lps->nworkers_heap + 1));
+	chunk_blocks = Min(chunk_blocks, PARALLEL_VACUUM_CHUNK_BLOCKS);
+	chunk_blocks = Max(chunk_blocks, 1);
+
+	/* Pass the workers the state they need to scan the heap as we would */
+	lvshared->params = *params;
+	lvshared->aggressive = aggressive;
+	lvshared->force_check_last_page = should_attempt_truncation(params,
+																vacrelstats);
+	lvshared->oldest_xmin = OldestXmin;
+	lvshared->freeze_limit = FreezeLimit;
+	lvshared->multixact_cutoff = MultiXactCutoff;
+	lvshared->rel_pages = nblocks;
+	lvshared->chunk_blocks = chunk_blocks;
+	lvshared->next_block = 0;
+	lvshared->reserved_tuples = 0;
+	pg_atomic_write_u32(&(lvshared->nblocks_scanned), 0);
+
+	for (;;)
+	{
+		LVSharedScanStats *scan_stats = &(lvshared->scan_stats);
+		int			nworkers;
+
+		/* Tell parallel workers to scan the heap */
+		lvshared->work = PARALLEL_VACUUM_SCAN_HEAP;
+		MemSet(scan_stats, 0, sizeof(LVSharedScanStats));
+
+		nworkers = parallel_vacuum_launch_workers(lps, lps->nworkers_heap);
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for heap scan (planned: %d)",
+								 "launched %d parallel vacuum workers for heap scan (planned: %d)",
+								 lps->pcxt->nworkers_launched),
+						lps->pcxt->nworkers_launched, nworkers)));
+
+		/*
+		 * Join as a parallel worker.  The leader process alone scans the heap
+		 * in the case where no workers are launched.
+		 */
+		parallel_scan_heap(onerel, lvshared, dead_tuples, nindexes,
+						   vacrelstats, vistest);
+
+		parallel_vacuum_wait_workers(lps);
+
+		/* Accumulate the statistics of the workers */
+		vacrelstats->scanned_pages += scan_stats->scanned_pages;
+		vacrelstats->pinskipped_pages += scan_stats->pinskipped_pages;
+		vacrelstats->frozenskipped_pages += scan_stats->frozenskipped_pages;
+		vacrelstats->tupcount_pages += scan_stats->tupcount_pages;
+		vacrelstats->empty_pages += scan_stats->empty_pages;
+		vacrelstats->nonempty_pages = Max(vacrelstats->nonempty_pages,
+										  scan_stats->nonempty_pages);
+		vacrelstats->num_tuples += scan_stats->num_tuples;
+		vacrelstats->live_tuples += scan_stats->live_tuples;
+		vacrelstats->tuples_deleted += scan_stats->tuples_deleted;
+		vacrelstats->new_dead_tuples += scan_stats->new_dead_tuples;
+		vacrelstats->nunused += scan_stats->nunused;
+		if (TransactionIdFollows(scan_stats->latestRemovedXid,
+								 vacrelstats->latestRemovedXid))
+			vacrelstats->latestRemovedXid = scan_stats->latestRemovedXid;
+
+		/* Index and heap vacuuming need the dead tuples in TID order */
+		qsort((void *) dead_tuples->itemptrs, dead_tuples->num_tuples,
+			  sizeof(ItemPointerData), vac_cmp_itemptr);
+
+		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+									 dead_tuples->num_tuples);
+
+		if (lvshared->next_block >= nblocks)
+			break;
+
+		/*
+		 * The participants ran out of space for dead-tuple TIDs.  Do a cycle
+		 * of vacuuming before scanning the rest of the heap.
+		 */
+		if (dead_tuples->num_tuples > 0)
+		{
+			/* Work on all the indexes, then the heap */
+			lazy_vacuum_all_indexes(onerel, Irel, indstats,
+									vacrelstats, lps, nindexes);
 
-	/* Clear the block number information */
-	vacrelstats->blkno = InvalidBlockNumber;
+			/* Remove tuples from heap */
+			lazy_vacuum_heap(onerel, vacrelstats, lps);
 
-	pfree(frozen);
+			/*
+			 * Forget the now-vacuumed tuples, and press on, but be careful
+			 * not to reset latestRemovedXid since we want that value to be
+			 * valid.
+			 */
+			dead_tuples->num_tuples = 0;
 
-	/* save stats for use later */
-	vacrelstats->tuples_deleted = tups_vacuumed;
-	vacrelstats->new_dead_tuples = nkeep;
+			/*
+			 * Vacuum the Free Space Map to make newly-freed space visible on
+			 * upper-level FSM pages.  All blocks before next_block have been
+			 * processed.
+			 */
+			FreeSpaceMapVacuumRange(onerel, *next_fsm_block_to_vacuum,
+									lvshared->next_block);
+			*next_fsm_block_to_vacuum = lvshared->next_block;
 
-	/* now we can compute the new value for pg_class.reltuples */
-	vacrelstats->new_live_tuples = vac_estimate_reltuples(onerel,
-														  nblocks,
-														  vacrelstats->tupcount_pages,
-														  live_tuples);
+			/* Report that we are once again scanning the heap */
+			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+		}
+	}
+}
 
-	/*
-	 * Also compute the total number of surviving heap entries.  In the
-	 * (unlikely) scenario that new_live_tuples is -1, take it as zero.
-	 */
-	vacrelstats->new_rel_tuples =
-		Max(vacrelstats->new_live_tuples, 0) + vacrelstats->new_dead_tuples;
+/*
+ * Heap scan routine used by the leader process and parallel vacuum worker
+ * processes during a parallel heap scan.
+ *
+ * We claim ranges of blocks until the heap has been scanned completely or the
+ * shared dead tuple array has no room for the dead tuples of another range.
+ * The dead tuples of each block are collected in a private array and then
+ * copied to the part of the shared array that we reserve for them.  The
+ * statistics are accumulated into vacrelstats.
+ */
+static void
+parallel_scan_heap(Relation onerel, LVShared *lvshared,
+				   LVDeadTuples *dead_tuples, int nindexes,
+				   LVRelStats *vacrelstats, GlobalVisState *vistest)
+{
+	VacuumParams *params = &(lvshared->params);
+	BlockNumber nblocks = lvshared->rel_pages;
+	LVDeadTuples *page_dead_tuples;
+	xl_heap_freeze_tuple *frozen;
+	Buffer		vmbuffer = InvalidBuffer;
+	uint8		skipflags;
 
-	/*
-	 * Release any remaining pin on visibility map page.
-	 */
-	if (BufferIsValid(vmbuffer))
-	{
-		ReleaseBuffer(vmbuffer);
-		vmbuffer = InvalidBuffer;
-	}
+	/* Blocks are skippable as in lazy_scan_heap */
+	if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) != 0)
+		skipflags = 0;
+	else if (lvshared->aggressive)
+		skipflags = VISIBILITYMAP_ALL_FROZEN;
+	else
+		skipflags = VISIBILITYMAP_ALL_VISIBLE;
 
-	/* If any tuples need to be deleted, perform final vacuum cycle */
-	/* XXX put a threshold on min number of tuples here? */
-	if (dead_tuples->num_tuples > 0)
+	page_dead_tuples = (LVDeadTuples *) palloc(SizeOfDeadTuples(MaxHeapTuplesPerPage));
+	page_dead_tuples->max_tuples = MaxHeapTuplesPerPage;
+	page_dead_tuples->num_tuples = 0;
+	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+
+	for (;;)
 	{
-		/* Work on all the indexes, and then the heap */
-		lazy_vacuum_all_indexes(onerel, Irel, indstats, vacrelstats,
-								lps, nindexes);
+		BlockNumber startblock;
+		BlockNumber endblock;
+		BlockNumber blkno;
+		int			reserve;
+
+		/* Claim the next range of blocks, if there's room for its tuples */
+		SpinLockAcquire(&(lvshared->mutex));
+		startblock = lvshared->next_block;
+		if (nblocks - startblock > lvshared->chunk_blocks)
+			endblock = startblock + lvshared->chunk_blocks;
+		else
+			endblock = nblocks;
+		reserve = (endblock - startblock) * MaxHeapTuplesPerPage;
+		if (startblock >= nblocks ||
+			dead_tuples->num_tuples + lvshared->reserved_tuples + reserve >
+			dead_tuples->max_tuples)
+		{
+			SpinLockRelease(&(lvshared->mutex));
+			break;
+		}
+		lvshared->next_block = endblock;
+		lvshared->reserved_tuples += reserve;
+		SpinLockRelease(&(lvshared->mutex));
 
-		/* Remove tuples from heap */
-		lazy_vacuum_heap(onerel, vacrelstats);
-	}
+		for (blkno = startblock; blkno < endblock; blkno++)
+		{
+			bool		force_check;
+			uint8		vmstatus;
+			int			ndead;
+			int			offset;
+			uint32		nscanned;
 
-	/*
-	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
-	 * not there were indexes.
-	 */
-	if (blkno > next_fsm_block_to_vacuum)
-		FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, blkno);
+			update_vacuum_error_info(vacrelstats, NULL,
+									 VACUUM_ERRCB_PHASE_SCAN_HEAP,
+									 blkno, InvalidOffsetNumber);
 
-	/* report all blocks vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
+			/* see lazy_scan_heap about forcing scanning of last page */
+			force_check = (blkno == nblocks - 1 &&
+						   lvshared->force_check_last_page);
 
-	/* Do post-vacuum cleanup */
-	if (vacrelstats->useindex)
-		lazy_cleanup_all_indexes(Irel, indstats, vacrelstats, lps, nindexes);
+			vmstatus = visibilitymap_get_status(onerel, blkno, &vmbuffer);
+			if ((vmstatus & skipflags) != 0 && !force_check)
+			{
+				if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) != 0)
+					vacrelstats->frozenskipped_pages++;
+			}
+			else
+			{
+				vacuum_delay_point();
 
-	/*
-	 * End parallel mode before updating index statistics as we cannot write
-	 * during parallel mode.
-	 */
-	if (ParallelVacuumIsActive(lps))
-		end_parallel_vacuum(indstats, lps, nindexes);
+				lazy_scan_page(onerel, params, vacrelstats, page_dead_tuples,
+							   nindexes, blkno, lvshared->aggressive,
+							   (vmstatus & VISIBILITYMAP_ALL_VISIBLE) != 0,
+							   force_check, vistest, frozen, &vmbuffer,
+							   NULL);
+			}
 
-	/* Update index statistics */
-	if (vacrelstats->useindex)
-		update_index_statistics(Irel, indstats, nindexes);
+			/* Publish the dead tuples, giving back the block's reservation */
+			ndead = page_dead_tuples->num_tuples;
+			SpinLockAcquire(&(lvshared->mutex));
+			offset = dead_tuples->num_tuples;
+			dead_tuples->num_tuples += ndead;
+			lvshared->reserved_tuples -= MaxHeapTuplesPerPage;
+			SpinLockRelease(&(lvshared->mutex));
+
+			if (ndead > 0)
+				memcpy(&(dead_tuples->itemptrs[offset]),
+					   page_dead_tuples->itemptrs,
+					   sizeof(ItemPointerData) * ndead);
+			page_dead_tuples->num_tuples = 0;
+
+			/* The leader reports the progress of all participants */
+			nscanned = pg_atomic_add_fetch_u32(&(lvshared->nblocks_scanned), 1);
+			if (!IsParallelWorker())
+			{
+				const int	prog_index[] = {
+					PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+					PROGRESS_VACUUM_NUM_DEAD_TUPLES
+				};
+				int64		prog_val[2];
+
+				prog_val[0] = nscanned;
+				prog_val[1] = offset + ndead;
+				pgstat_progress_update_multi_param(2, prog_index, prog_val);
+			}
+		}
+	}
 
-	/* If no indexes, make log report that lazy_vacuum_heap would've made */
-	if (vacuumed_pages)
-		ereport(elevel,
-				(errmsg("\"%s\": removed %.0f row versions in %u pages",
-						vacrelstats->relname,
-						tups_vacuumed, vacuumed_pages)));
+	/* Clear the block number information */
+	vacrelstats->blkno = InvalidBlockNumber;
 
-	initStringInfo(&buf);
-	appendStringInfo(&buf,
-					 _("%.0f dead row versions cannot be removed yet, oldest xmin: %u\n"),
-					 nkeep, OldestXmin);
-	appendStringInfo(&buf, _("There were %.0f unused item identifiers.\n"),
-					 nunused);
-	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
-									"Skipped %u pages due to buffer pins, ",
-									vacrelstats->pinskipped_pages),
-					 vacrelstats->pinskipped_pages);
-	appendStringInfo(&buf, ngettext("%u frozen page.\n",
-									"%u frozen pages.\n",
-									vacrelstats->frozenskipped_pages),
-					 vacrelstats->frozenskipped_pages);
-	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
-									"%u pages are entirely empty.\n",
-									empty_pages),
-					 empty_pages);
-	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
 
-	ereport(elevel,
-			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions in %u out of %u pages",
-					vacrelstats->relname,
-					tups_vacuumed, num_tuples,
-					vacrelstats->scanned_pages, nblocks),
-			 errdetail_internal("%s", buf.data)));
-	pfree(buf.data);
+	pfree(page_dead_tuples);
+	pfree(frozen);
 }
 
 /*
@@ -1842,7 +2279,8 @@ lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
  * process index entry removal in batches as large as possible.
  */
 static void
-lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
+lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+				 LVParallelState *lps)
 {
 	int			tupindex;
 	int			npages;
@@ -1861,7 +2299,43 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	pg_rusage_init(&ru0);
 	npages = 0;
 
-	tupindex = 0;
+	/* Vacuum the heap with parallel workers if we scanned it with them */
+	if (ParallelVacuumIsActive(lps) && lps->nworkers_heap > 0)
+	{
+		LVShared   *lvshared = lps->lvshared;
+		int			nworkers;
+
+		/* Tell parallel workers to vacuum the heap */
+		lvshared->work = PARALLEL_VACUUM_VACUUM_HEAP;
+		lvshared->latest_removed_xid = vacrelstats->latestRemovedXid;
+		lvshared->vacuumed_pages = 0;
+		pg_atomic_write_u32(&(lvshared->next_tupindex), 0);
+
+		/* Don't bother with workers for a few pages worth of tuples */
+		nworkers = Min(lps->nworkers_heap,
+					   vacrelstats->dead_tuples->num_tuples / PARALLEL_VACUUM_CHUNK_TUPLES);
+		if (nworkers > 0)
+		{
+			nworkers = parallel_vacuum_launch_workers(lps, nworkers);
+			ereport(elevel,
+					(errmsg(ngettext("launched %d parallel vacuum worker for heap vacuuming (planned: %d)",
+									 "launched %d parallel vacuum workers for heap vacuuming (planned: %d)",
+									 lps->pcxt->nworkers_launched),
+							lps->pcxt->nworkers_launched, nworkers)));
+		}
+
+		/* Join as a parallel worker */
+		parallel_vacuum_heap(onerel, lvshared, vacrelstats);
+
+		if (nworkers > 0)
+			parallel_vacuum_wait_workers(lps);
+
+		tupindex = vacrelstats->dead_tuples->num_tuples;
+		npages = lvshared->vacuumed_pages;
+	}
+	else
+		tupindex = 0;
+
 	while (tupindex < vacrelstats->dead_tuples->num_tuples)
 	{
 		BlockNumber tblk;
@@ -1912,6 +2386,88 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	restore_vacuum_error_info(vacrelstats, &saved_err_info);
 }
 
+/*
+ * Heap vacuuming routine used by the leader process and parallel vacuum
+ * worker processes to vacuum the heap in parallel.
+ *
+ * The dead tuple array is handed out in ranges of PARALLEL_VACUUM_CHUNK_TUPLES
+ * tuples.  We vacuum each block whose first dead tuple falls into one of the
+ * ranges we claim, so every block is processed by exactly one participant.
+ * Unlike lazy_vacuum_heap, which keeps retrying until it gets a cleanup lock
+ * on a block or runs out of its tuples, we skip a block on the first lock
+ * conflict.
+ */
+static void
+parallel_vacuum_heap(Relation onerel, LVShared *lvshared,
+					 LVRelStats *vacrelstats)
+{
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+	Buffer		vmbuffer = InvalidBuffer;
+	int			npages = 0;
+
+	for (;;)
+	{
+		int			tupindex;
+		int			endindex;
+
+		tupindex = pg_atomic_fetch_add_u32(&(lvshared->next_tupindex),
+										   PARALLEL_VACUUM_CHUNK_TUPLES);
+		if (tupindex >= dead_tuples->num_tuples)
+			break;
+		endindex = Min(tupindex + PARALLEL_VACUUM_CHUNK_TUPLES,
+					   dead_tuples->num_tuples);
+
+		/* Skip the tuples of a block whose first tuple precedes our range */
+		while (tupindex > 0 && tupindex < endindex &&
+			   ItemPointerGetBlockNumber(&dead_tuples->itemptrs[tupindex]) ==
+			   ItemPointerGetBlockNumber(&dead_tuples->itemptrs[tupindex - 1]))
+			tupindex++;
+
+		while (tupindex < endindex)
+		{
+			BlockNumber tblk;
+			Buffer		buf;
+			Page		page;
+			Size		freespace;
+
+			vacuum_delay_point();
+
+			tblk = ItemPointerGetBlockNumber(&dead_tuples->itemptrs[tupindex]);
+			vacrelstats->blkno = tblk;
+			buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
+									 vac_strategy);
+			if (!ConditionalLockBufferForCleanup(buf))
+			{
+				ReleaseBuffer(buf);
+				while (tupindex < dead_tuples->num_tuples &&
+					   ItemPointerGetBlockNumber(&dead_tuples->itemptrs[tupindex]) == tblk)
+					tupindex++;
+				continue;
+			}
+			tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex,
+										vacrelstats, &vmbuffer);
+
+			/* Now that we've compacted the page, record its available space */
+			page = BufferGetPage(buf);
+			freespace = PageGetHeapFreeSpace(page);
+
+			UnlockReleaseBuffer(buf);
+			RecordPageWithFreeSpace(onerel, tblk, freespace);
+			npages++;
+		}
+	}
+
+	/* Clear the block number information */
+	vacrelstats->blkno = InvalidBlockNumber;
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+
+	SpinLockAcquire(&(lvshared->mutex));
+	lvshared->vacuumed_pages += npages;
+	SpinLockRelease(&(lvshared->mutex));
+}
+
 /*
  *	lazy_vacuum_page() -- free dead tuples on a page
  *					 and repair its fragmentation.
@@ -2122,48 +2678,16 @@ lazy_parallel_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
 	 */
 	nworkers = Min(nworkers, lps->pcxt->nworkers);
 
+	/* Tell parallel workers to process indexes */
+	lps->lvshared->work = PARALLEL_VACUUM_INDEXES;
+
+	/* Reset the parallel index processing counter */
+	pg_atomic_write_u32(&(lps->lvshared->idx), 0);
+
 	/* Setup the shared cost-based vacuum delay and launch workers */
 	if (nworkers > 0)
 	{
-		if (vacrelstats->num_index_scans > 0)
-		{
-			/* Reset the parallel index processing counter */
-			pg_atomic_write_u32(&(lps->lvshared->idx), 0);
-
-			/* Reinitialize the parallel context to relaunch parallel workers */
-			ReinitializeParallelDSM(lps->pcxt);
-		}
-
-		/*
-		 * Set up shared cost balance and the number of active workers for
-		 * vacuum delay.  We need to do this before launching workers as
-		 * otherwise, they might not see the updated values for these
-		 * parameters.
-		 */
-		pg_atomic_write_u32(&(lps->lvshared->cost_balance), VacuumCostBalance);
-		pg_atomic_write_u32(&(lps->lvshared->active_nworkers), 0);
-
-		/*
-		 * The number of workers can vary between bulkdelete and cleanup
-		 * phase.
-		 */
-		ReinitializeParallelWorkers(lps->pcxt, nworkers);
-
-		LaunchParallelWorkers(lps->pcxt);
-
-		if (lps->pcxt->nworkers_launched > 0)
-		{
-			/*
-			 * Reset the local cost values for leader backend as we have
-			 * already accumulated the remaining balance of heap.
-			 */
-			VacuumCostBalance = 0;
-			VacuumCostBalanceLocal = 0;
-
-			/* Enable shared cost balance for leader backend */
-			VacuumSharedCostBalance = &(lps->lvshared->cost_balance);
-			VacuumActiveNWorkers = &(lps->lvshared->active_nworkers);
-		}
+		nworkers = parallel_vacuum_launch_workers(lps, nworkers);
 
 		if (lps->lvshared->for_cleanup)
 			ereport(elevel,
@@ -2189,21 +2713,77 @@ lazy_parallel_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
 	parallel_vacuum_index(Irel, stats, lps->lvshared,
 						  vacrelstats->dead_tuples, nindexes, vacrelstats);
 
+	/* Wait for the workers and accumulate their buffer and WAL usage */
+	if (nworkers > 0)
+		parallel_vacuum_wait_workers(lps);
+}
+
+/*
+ * Launch nworkers parallel vacuum workers to perform the work set up in
+ * lps->lvshared, returning the number of workers planned.  The caller is
+ * expected to participate, and to call parallel_vacuum_wait_workers once it
+ * is done.
+ */
+static int
+parallel_vacuum_launch_workers(LVParallelState *lps, int nworkers)
+{
+	Assert(!IsParallelWorker());
+	Assert(nworkers > 0);
+
+	/* Reinitialize the parallel context to relaunch parallel workers */
+	if (lps->workers_launched)
+		ReinitializeParallelDSM(lps->pcxt);
+	lps->workers_launched = true;
+
 	/*
-	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
-	 * to finish, or we might get incomplete data.)
+	 * Set up shared cost balance and the number of active workers for vacuum
+	 * delay.  We need to do this before launching workers as otherwise, they
+	 * might not see the updated values for these parameters.
 	 */
-	if (nworkers > 0)
-	{
-		int			i;
+	pg_atomic_write_u32(&(lps->lvshared->cost_balance), VacuumCostBalance);
+	pg_atomic_write_u32(&(lps->lvshared->active_nworkers), 0);
+
+	/* The number of workers can vary between the phases */
+	nworkers = Min(nworkers, lps->pcxt->nworkers);
+	ReinitializeParallelWorkers(lps->pcxt, nworkers);
+
+	LaunchParallelWorkers(lps->pcxt);
 
-		/* Wait for all vacuum workers to finish */
-		WaitForParallelWorkersToFinish(lps->pcxt);
+	if (lps->pcxt->nworkers_launched > 0)
+	{
+		/*
+		 * Reset the local cost values for leader backend as we have already
+		 * accumulated the remaining balance of heap.
+		 */
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
 
-		for (i = 0; i < lps->pcxt->nworkers_launched; i++)
-			InstrAccumParallelQuery(&lps->buffer_usage[i], &lps->wal_usage[i]);
+		/* Enable shared cost balance for leader backend */
+		VacuumSharedCostBalance = &(lps->lvshared->cost_balance);
+		VacuumActiveNWorkers = &(lps->lvshared->active_nworkers);
 	}
 
+	return nworkers;
+}
+
+/*
+ * Wait for the workers launched by parallel_vacuum_launch_workers to finish,
+ * and accumulate their buffer and WAL usage.
+ */
+static void
+parallel_vacuum_wait_workers(LVParallelState *lps)
+{
+	int			i;
+
+	/*
+	 * Accumulate buffer and WAL usage.  (This must wait for the workers to
+	 * finish, or we might get incomplete data.)
+	 */
+	WaitForParallelWorkersToFinish(lps->pcxt);
+
+	for (i = 0; i < lps->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&lps->buffer_usage[i], &lps->wal_usage[i]);
+
 	/*
 	 * Carry the shared balance value to heap scan and disable shared costing
 	 */
@@ -3173,6 +3753,52 @@ compute_parallel_vacuum_workers(Relation *Irel, int nindexes, int nrequested,
 	return parallel_workers;
 }
 
+/*
+ * Compute the number of parallel worker processes to use for the heap scan
+ * and heap vacuuming.  As for a parallel sequential scan, the heap must be at
+ * least min_parallel_table_scan_size, and we add another worker each time it
+ * triples in size.  If the user requested a number of workers, we use that
+ * for heaps of at least min_parallel_table_scan_size instead.
+ */
+static int
+compute_parallel_heap_workers(BlockNumber nblocks, int nrequested)
+{
+	int			parallel_workers;
+
+	/*
+	 * We don't allow performing parallel operation in standalone backend or
+	 * when parallelism is disabled.
+	 */
+	if (!IsUnderPostmaster || max_parallel_maintenance_workers == 0)
+		return 0;
+
+	/* Invoking workers for a small heap can hurt performance */
+	if (nblocks < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	if (nrequested > 0)
+		parallel_workers = nrequested;
+	else
+	{
+		int			heap_parallel_threshold;
+
+		parallel_workers = 1;
+		heap_parallel_threshold = Max(min_parallel_table_scan_size, 1);
+		while (nblocks >= (BlockNumber) heap_parallel_threshold * 3)
+		{
+			parallel_workers++;
+			heap_parallel_threshold *= 3;
+			if (heap_parallel_threshold > INT_MAX / 3)
+				break;			/* avoid overflow */
+		}
+	}
+
+	/* Cap by max_parallel_maintenance_workers */
+	parallel_workers = Min(parallel_workers, max_parallel_maintenance_workers);
+
+	return parallel_workers;
+}
+
 /*
  * Initialize variables for shared index statistics, set NULL bitmap and the
  * size of stats for each index.
@@ -3249,6 +3875,7 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	Size		est_deadtuples;
 	int			nindexes_mwm = 0;
 	int			parallel_workers = 0;
+	int			nworkers_heap;
 	int			querylen;
 	int			i;
 
@@ -3266,9 +3893,10 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	parallel_workers = compute_parallel_vacuum_workers(Irel, nindexes,
 													   nrequested,
 													   can_parallel_vacuum);
+	nworkers_heap = compute_parallel_heap_workers(nblocks, nrequested);
 
 	/* Can't perform vacuum in parallel */
-	if (parallel_workers <= 0)
+	if (parallel_workers <= 0 && nworkers_heap <= 0)
 	{
 		pfree(can_parallel_vacuum);
 		return lps;
@@ -3278,9 +3906,10 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 
 	EnterParallelMode();
 	pcxt = CreateParallelContext("postgres", "parallel_vacuum_main",
-								 parallel_workers);
+								 Max(parallel_workers, nworkers_heap));
 	Assert(pcxt->nworkers > 0);
 	lps->pcxt = pcxt;
+	lps->nworkers_heap = nworkers_heap;
 
 	/* Estimate size for shared information -- PARALLEL_VACUUM_KEY_SHARED */
 	est_shared = MAXALIGN(add_size(SizeOfLVShared, BITMAPLEN(nindexes)));
@@ -3358,12 +3987,15 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	shared->relid = relid;
 	shared->elevel = elevel;
 	shared->maintenance_work_mem_worker =
-		(nindexes_mwm > 0) ?
+		(nindexes_mwm > 0 && parallel_workers > 0) ?
 		maintenance_work_mem / Min(parallel_workers, nindexes_mwm) :
 		maintenance_work_mem;
 
 	pg_atomic_init_u32(&(shared->cost_balance), 0);
 	pg_atomic_init_u32(&(shared->active_nworkers), 0);
+	SpinLockInit(&(shared->mutex));
+	pg_atomic_init_u32(&(shared->nblocks_scanned), 0);
+	pg_atomic_init_u32(&(shared->next_tupindex), 0);
 	pg_atomic_init_u32(&(shared->idx), 0);
 	shared->offset = MAXALIGN(add_size(SizeOfLVShared, BITMAPLEN(nindexes)));
 	prepare_index_statistics(shared, can_parallel_vacuum, nindexes);
@@ -3517,8 +4149,8 @@ skip_parallel_vacuum_index(Relation indrel, LVShared *lvshared)
 /*
  * Perform work within a launched parallel process.
  *
- * Since parallel vacuum workers perform only index vacuum or index cleanup,
- * we don't need to report progress information.
+ * Parallel vacuum workers don't report progress information.  The leader
+ * reports the progress of the heap scan on behalf of all participants.
  */
 void
 parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
@@ -3539,7 +4171,11 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 										   false);
 	elevel = lvshared->elevel;
 
-	if (lvshared->for_cleanup)
+	if (lvshared->work == PARALLEL_VACUUM_SCAN_HEAP)
+		elog(DEBUG1, "starting parallel vacuum worker for heap scan");
+	else if (lvshared->work == PARALLEL_VACUUM_VACUUM_HEAP)
+		elog(DEBUG1, "starting parallel vacuum worker for heap vacuuming");
+	else if (lvshared->for_cleanup)
 		elog(DEBUG1, "starting parallel vacuum worker for cleanup");
 	else
 		elog(DEBUG1, "starting parallel vacuum worker for bulk delete");
@@ -3584,14 +4220,25 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	if (lvshared->maintenance_work_mem_worker > 0)
 		maintenance_work_mem = lvshared->maintenance_work_mem_worker;
 
+	/* Use the leader's cutoff points and a ring buffer, as the leader does */
+	OldestXmin = lvshared->oldest_xmin;
+	FreezeLimit = lvshared->freeze_limit;
+	MultiXactCutoff = lvshared->multixact_cutoff;
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
 	/*
 	 * Initialize vacrelstats for use as error callback arg by parallel
-	 * worker.
+	 * worker, and for accumulating heap scan statistics.
 	 */
+	MemSet(&vacrelstats, 0, sizeof(LVRelStats));
 	vacrelstats.relnamespace = get_namespace_name(RelationGetNamespace(onerel));
 	vacrelstats.relname = pstrdup(RelationGetRelationName(onerel));
 	vacrelstats.indname = NULL;
 	vacrelstats.phase = VACUUM_ERRCB_PHASE_UNKNOWN; /* Not yet processing */
+	vacrelstats.useindex = true;
+	vacrelstats.rel_pages = lvshared->rel_pages;
+	vacrelstats.dead_tuples = dead_tuples;
+	vacrelstats.latestRemovedXid = InvalidTransactionId;
 
 	/* Setup error traceback support for ereport() */
 	errcallback.callback = vacuum_error_callback;
@@ -3602,9 +4249,47 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
 
-	/* Process indexes to perform vacuum/cleanup */
-	parallel_vacuum_index(indrels, stats, lvshared, dead_tuples, nindexes,
-						  &vacrelstats);
+	if (lvshared->work == PARALLEL_VACUUM_SCAN_HEAP)
+	{
+		LVSharedScanStats *scan_stats = &(lvshared->scan_stats);
+
+		/* Scan the heap, and add our statistics to the shared ones */
+		parallel_scan_heap(onerel, lvshared, dead_tuples, nindexes,
+						   &vacrelstats, GlobalVisTestFor(onerel));
+
+		SpinLockAcquire(&(lvshared->mutex));
+		scan_stats->scanned_pages += vacrelstats.scanned_pages;
+		scan_stats->pinskipped_pages += vacrelstats.pinskipped_pages;
+		scan_stats->frozenskipped_pages += vacrelstats.frozenskipped_pages;
+		scan_stats->tupcount_pages += vacrelstats.tupcount_pages;
+		scan_stats->empty_pages += vacrelstats.empty_pages;
+		scan_stats->nonempty_pages = Max(scan_stats->nonempty_pages,
+										 vacrelstats.nonempty_pages);
+		scan_stats->num_tuples += vacrelstats.num_tuples;
+		scan_stats->live_tuples += vacrelstats.live_tuples;
+		scan_stats->tuples_deleted += vacrelstats.tuples_deleted;
+		scan_stats->new_dead_tuples += vacrelstats.new_dead_tuples;
+		scan_stats->nunused += vacrelstats.nunused;
+		if (TransactionIdFollows(vacrelstats.latestRemovedXid,
+								 scan_stats->latestRemovedXid))
+			scan_stats->latestRemovedXid = vacrelstats.latestRemovedXid;
+		SpinLockRelease(&(lvshared->mutex));
+	}
+	else if (lvshared->work == PARALLEL_VACUUM_VACUUM_HEAP)
+	{
+		/* Vacuum the heap */
+		vacrelstats.latestRemovedXid = lvshared->latest_removed_xid;
+		update_vacuum_error_info(&vacrelstats, NULL,
+								 VACUUM_ERRCB_PHASE_VACUUM_HEAP,
+								 InvalidBlockNumber, InvalidOffsetNumber);
+		parallel_vacuum_heap(onerel, lvshared, &vacrelstats);
+	}
+	else
+	{
+		/* Process indexes to perform vacuum/cleanup */
+		parallel_vacuum_index(indrels, stats, lvshared, dead_tuples, nindexes,
+							  &vacrelstats);
+	}
 
 	/* Report buffer/WAL usage during parallel execution */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
@@ -50,6 +50,7 @@
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xlog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/pg_amproc.h"
 #include "catalog/pg_type.h"
@@ -261,6 +262,10 @@ index_beginscan_internal(Relation indexRelation,
 	RELATION_CHECKS;
 	CHECK_REL_PROCEDURE(ambeginscan);
 
+	/* See table_ensure_storage() */
+	if (unlikely(RelationLacksSessionStorage(indexRelation)))
+		GlobalTempRelationEnsureStorage(indexRelation);
+
 	if (!(indexRelation->rd_indam->ampredlocks))
 		PredicateLockRelation(indexRelation, snapshot);
 
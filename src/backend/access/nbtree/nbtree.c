@@ -111,6 +111,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = true;
 	amroutine->ampredlocks = true;
 	amroutine->amcanparallel = true;
+	amroutine->amcanbuildparallel = true;
 	amroutine->amcaninclude = true;
 	amroutine->amusemaintenanceworkmem = false;
 	amroutine->amparallelvacuumoptions =
@@ -226,7 +227,9 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		if (so->numArrayKeys < 0)
 			return false;
 
-		_bt_start_array_keys(scan, dir);
+		/* also punt if a skip scan finds the index empty */
+		if (!_bt_start_array_keys(scan, dir))
+			return false;
 	}
 
 	/* This loop handles advancing to the next array elements, if any */
@@ -296,7 +299,9 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 		if (so->numArrayKeys < 0)
 			return ntids;
 
-		_bt_start_array_keys(scan, ForwardScanDirection);
+		/* also punt if a skip scan finds the index empty */
+		if (!_bt_start_array_keys(scan, ForwardScanDirection))
+			return ntids;
 	}
 
 	/* This loop handles advancing to the next array elements, if any */
@@ -354,13 +359,24 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so = (BTScanOpaque) palloc(sizeof(BTScanOpaqueData));
 	BTScanPosInvalidate(so->currPos);
 	BTScanPosInvalidate(so->markPos);
+
+	/*
+	 * Leave room for the skip keys that _bt_preprocess_array_keys might add
+	 * in front of the caller's keys
+	 */
 	if (scan->numberOfKeys > 0)
-		so->keyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
+		so->keyData = (ScanKey)
+			palloc((scan->numberOfKeys + IndexRelationGetNumberOfKeyAttributes(rel)) *
+				   sizeof(ScanKeyData));
 	else
 		so->keyData = NULL;
 
 	so->arrayKeyData = NULL;	/* assume no array keys for now */
+	so->numArrayKeyData = 0;
 	so->numArrayKeys = 0;
+	so->numSkipKeys = 0;
+	so->skipFallback = false;
+	so->markSkipFallback = false;
 	so->arrayKeys = NULL;
 	so->arrayContext = NULL;
 
@@ -23,11 +23,20 @@
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 
+/*
+ * A skip scan gives up skipping after this many consecutive prefixes were
+ * found on the same leaf page as the prefix before them
+ */
+#define BT_SKIP_MAX_SAME_PAGE	4
+
 
 static void _bt_drop_lock_and_maybe_pin(IndexScanDesc scan, BTScanPos sp);
 static OffsetNumber _bt_binsrch(Relation rel, BTScanInsert key, Buffer buf);
 static int	_bt_binsrch_posting(BTScanInsert key, Page page,
 								OffsetNumber offnum);
+static inline int32 _bt_compare_prefix(Relation rel, BTScanInsert key,
+									   Page page, OffsetNumber offnum,
+									   int *cmpcol);
 static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 						 OffsetNumber offnum);
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
@@ -45,6 +54,7 @@ static bool _bt_parallel_readpage(IndexScanDesc scan, BlockNumber blkno,
 static Buffer _bt_walk_left(Relation rel, Buffer buf, Snapshot snapshot);
 static bool _bt_endpoint(IndexScanDesc scan, ScanDirection dir);
 static inline void _bt_initialize_more_data(BTScanOpaque so, ScanDirection dir);
+static void _bt_skip_scankeys(IndexScanDesc scan, ScanKey scankeys);
 
 
 /*
@@ -348,6 +358,8 @@ _bt_binsrch(Relation rel,
 	BTPageOpaque opaque;
 	OffsetNumber low,
 				high;
+	int			lowcmpcol,
+				highcmpcol;
 	int32		result,
 				cmpval;
 
@@ -383,23 +395,36 @@ _bt_binsrch(Relation rel,
 	 * 'low' are <= scan key, all slots at or after 'high' are > scan key.
 	 *
 	 * We can fall out when high == low.
+	 *
+	 * lowcmpcol and highcmpcol track how many leading key attributes the
+	 * scan key is known to share with the tuples just below 'low' and at
+	 * 'high'.  Everything in between shares the shorter of the two prefixes,
+	 * so _bt_compare_prefix() needn't compare those attributes again.
 	 */
 	high++;						/* establish the loop invariant for high */
+	lowcmpcol = highcmpcol = 1;
 
 	cmpval = key->nextkey ? 0 : 1;	/* select comparison value */
 
 	while (high > low)
 	{
 		OffsetNumber mid = low + ((high - low) / 2);
+		int			cmpcol = Min(lowcmpcol, highcmpcol);
 
 		/* We have low <= mid < high, so mid points at a real slot */
 
-		result = _bt_compare(rel, key, page, mid);
+		result = _bt_compare_prefix(rel, key, page, mid, &cmpcol);
 
 		if (result >= cmpval)
+		{
 			low = mid + 1;
+			lowcmpcol = cmpcol;
+		}
 		else
+		{
 			high = mid;
+			highcmpcol = cmpcol;
+		}
 	}
 
 	/*
@@ -452,6 +477,8 @@ _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
 	OffsetNumber low,
 				high,
 				stricthigh;
+	int			lowcmpcol,
+				highcmpcol;
 	int32		result,
 				cmpval;
 
@@ -498,22 +525,28 @@ _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
 	if (!insertstate->bounds_valid)
 		high++;					/* establish the loop invariant for high */
 	stricthigh = high;			/* high initially strictly higher */
+	lowcmpcol = highcmpcol = 1; /* see _bt_binsrch() */
 
 	cmpval = 1;					/* !nextkey comparison value */
 
 	while (high > low)
 	{
 		OffsetNumber mid = low + ((high - low) / 2);
+		int			cmpcol = Min(lowcmpcol, highcmpcol);
 
 		/* We have low <= mid < high, so mid points at a real slot */
 
-		result = _bt_compare(rel, key, page, mid);
+		result = _bt_compare_prefix(rel, key, page, mid, &cmpcol);
 
 		if (result >= cmpval)
+		{
 			low = mid + 1;
+			lowcmpcol = cmpcol;
+		}
 		else
 		{
 			high = mid;
+			highcmpcol = cmpcol;
 			if (result != 0)
 				stricthigh = high;
 		}
@@ -645,6 +678,35 @@ _bt_compare(Relation rel,
 			BTScanInsert key,
 			Page page,
 			OffsetNumber offnum)
+{
+	int			cmpcol = 1;
+
+	return _bt_compare_prefix(rel, key, page, offnum, &cmpcol);
+}
+
+/*
+ *	_bt_compare_prefix() -- _bt_compare(), skipping a known-equal key prefix.
+ *
+ * On entry, *cmpcol is the first key attribute that might differ between the
+ * scankey and the tuple at offnum; attributes before it are assumed to be
+ * equal, and aren't compared again.  On exit, *cmpcol is set to the first
+ * attribute that was found to differ (or one past the last attribute compared,
+ * if they were all equal), which is what callers need to know to narrow the
+ * search.
+ *
+ * A binary search can use this to avoid repeatedly comparing a page's common
+ * key prefix.  Once the scankey is known to be equal to both the current low
+ * and high bounds of the search on their first N attributes, every tuple
+ * between them must be equal to the scankey on those attributes too, since
+ * the page is in key order.  Multi-column indexes whose leading columns have
+ * few distinct values (or long, expensive to compare values) benefit most.
+ */
+static inline int32
+_bt_compare_prefix(Relation rel,
+				   BTScanInsert key,
+				   Page page,
+				   OffsetNumber offnum,
+				   int *cmpcol)
 {
 	TupleDesc	itupdesc = RelationGetDescr(rel);
 	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
@@ -664,7 +726,11 @@ _bt_compare(Relation rel,
 	 * --- see NOTE above.
 	 */
 	if (!P_ISLEAF(opaque) && offnum == P_FIRSTDATAKEY(opaque))
+	{
+		/* minus infinity isn't equal to anything */
+		*cmpcol = 1;
 		return 1;
+	}
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
 	ntupatts = BTreeTupleGetNAtts(itup, rel);
@@ -684,8 +750,8 @@ _bt_compare(Relation rel,
 	ncmpkey = Min(ntupatts, key->keysz);
 	Assert(key->heapkeyspace || ncmpkey == key->keysz);
 	Assert(!BTreeTupleIsPosting(itup) || key->allequalimage);
-	scankey = key->scankeys;
-	for (int i = 1; i <= ncmpkey; i++)
+	scankey = key->scankeys + (*cmpcol - 1);
+	for (int i = *cmpcol; i <= ncmpkey; i++)
 	{
 		Datum		datum;
 		bool		isNull;
@@ -729,10 +795,14 @@ _bt_compare(Relation rel,
 
 		/* if the keys are unequal, return the difference */
 		if (result != 0)
+		{
+			*cmpcol = i;
 			return result;
+		}
 
 		scankey++;
 	}
+	*cmpcol = ncmpkey + 1;
 
 	/*
 	 * All non-truncated attributes (other than heap TID) were found to be
@@ -910,6 +980,20 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 		}
 	}
 
+	/*
+	 * A skip scan that has given up skipping resumes right after the last
+	 * prefix it processed, see _bt_skip_next().  This is positioned just
+	 * like _bt_skip_next's own searches.
+	 */
+	if (so->skipFallback)
+	{
+		_bt_skip_scankeys(scan, inskey.scankeys);
+		keysCount = so->numSkipKeys;
+		nextkey = ScanDirectionIsForward(dir);
+		goback = ScanDirectionIsBackward(dir);
+		goto search;
+	}
+
 	/*----------
 	 * Examine the scan keys to discover where we need to start the scan.
 	 *
@@ -1339,6 +1423,7 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 			return false;
 	}
 
+search:
 	/* Initialize remaining insertion scan key fields */
 	_bt_metaversion(rel, &inskey.heapkeyspace, &inskey.allequalimage);
 	inskey.anynullkeys = false; /* unused */
@@ -2461,6 +2546,206 @@ _bt_endpoint(IndexScanDesc scan, ScanDirection dir)
 	return true;
 }
 
+/*
+ * _bt_skip_scankeys() -- Build insertion scankeys from the skip keys
+ *
+ * Fills the first so->numSkipKeys entries of scankeys with the skip keys'
+ * current values, so that a search finds the position of the current prefix.
+ */
+static void
+_bt_skip_scankeys(IndexScanDesc scan, ScanKey scankeys)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	int			i;
+
+	for (i = 0; i < so->numSkipKeys; i++)
+	{
+		BTArrayKeyInfo *skipKey = &so->arrayKeys[i];
+		int			flags;
+
+		flags = rel->rd_indoption[i] << SK_BT_INDOPTION_SHIFT;
+		if (skipKey->cur_null)
+			flags |= SK_ISNULL;
+		ScanKeyEntryInitializeWithInfo(&scankeys[i],
+									   flags,
+									   (AttrNumber) (i + 1),
+									   InvalidStrategy,
+									   InvalidOid,
+									   rel->rd_indcollation[i],
+									   index_getprocinfo(rel, i + 1,
+														 BTORDER_PROC),
+									   skipKey->cur_value);
+	}
+}
+
+/*
+ * _bt_skip_next() -- Find the next distinct prefix for a skip scan
+ *
+ * The skip keys of a skip scan are set to successive distinct values of the
+ * leading index columns that the scan has no quals for.  If first is true,
+ * we find the first prefix in the index in the given scan direction;
+ * otherwise we find the first prefix that follows the skip keys' current
+ * values in the scan direction.  Either way, we descend to the leaf level and
+ * set the skip keys from the first tuple we come to.
+ *
+ * Returns false if there are no more prefixes, in which case the skip keys
+ * are left unchanged.
+ *
+ * Skipping only pays off if the prefixes are far enough apart.  If several
+ * prefixes in a row are found on the same leaf page as the one before, two
+ * descents per prefix cost more than reading the leaf pages in order, so we
+ * give up skipping: we set so->skipFallback and return true with the skip
+ * keys unchanged.  The rest of the scan is then a single primitive scan that
+ * _bt_first starts right after the current prefix, using the remaining quals
+ * as filters.  Not possible if there are also real array keys, since their
+ * primitive scans are nested inside those of the skip keys.
+ */
+bool
+_bt_skip_next(IndexScanDesc scan, ScanDirection dir, bool first)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+	OffsetNumber offnum;
+	IndexTuple	itup;
+	BlockNumber blkno;
+	int			i;
+
+	Assert(so->numSkipKeys > 0);
+
+	/* a scan that finds nothing may loop here for a long time */
+	CHECK_FOR_INTERRUPTS();
+
+	if (first)
+	{
+		buf = _bt_get_endpoint(rel, 0, ScanDirectionIsBackward(dir),
+							   scan->xs_snapshot);
+		if (!BufferIsValid(buf))
+		{
+			/*
+			 * Empty index. Lock the whole relation, as nothing finer to lock
+			 * exists.
+			 */
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+		if (ScanDirectionIsForward(dir))
+			offnum = P_FIRSTDATAKEY(opaque);
+		else
+			offnum = PageGetMaxOffsetNumber(page);
+	}
+	else
+	{
+		BTScanInsertData inskey;
+		BTStack		stack;
+
+		/*
+		 * Build an insertion scankey from the current skip key values.  In a
+		 * forward scan we want the first item > the current prefix.  In a
+		 * backward scan we want the last item < the current prefix, which is
+		 * the one before the first item >= it.
+		 */
+		_bt_skip_scankeys(scan, inskey.scankeys);
+
+		_bt_metaversion(rel, &inskey.heapkeyspace, &inskey.allequalimage);
+		inskey.anynullkeys = false; /* unused */
+		inskey.nextkey = ScanDirectionIsForward(dir);
+		inskey.pivotsearch = false;
+		inskey.scantid = NULL;
+		inskey.keysz = so->numSkipKeys;
+
+		stack = _bt_search(rel, &inskey, &buf, BT_READ, scan->xs_snapshot);
+		_bt_freestack(stack);
+
+		if (!BufferIsValid(buf))
+		{
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+
+		offnum = _bt_binsrch(rel, &inskey, buf);
+		if (ScanDirectionIsBackward(dir))
+			offnum = OffsetNumberPrev(offnum);
+
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	}
+
+	/*
+	 * If we're positioned off the end of the page, move to the neighboring
+	 * page in the scan direction, until we find one with an item on it.  The
+	 * pages we pass through are predicate-locked, since it's their lack of
+	 * items that lets the scan skip over them.
+	 */
+	for (;;)
+	{
+		PredicateLockPage(rel, BufferGetBlockNumber(buf), scan->xs_snapshot);
+
+		if (ScanDirectionIsForward(dir))
+		{
+			if (!P_IGNORE(opaque) && offnum <= PageGetMaxOffsetNumber(page))
+				break;
+			if (P_RIGHTMOST(opaque))
+			{
+				_bt_relbuf(rel, buf);
+				return false;
+			}
+			buf = _bt_relandgetbuf(rel, buf, opaque->btpo_next, BT_READ);
+			page = BufferGetPage(buf);
+			TestForOldSnapshot(scan->xs_snapshot, rel, page);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = P_FIRSTDATAKEY(opaque);
+		}
+		else
+		{
+			if (!P_IGNORE(opaque) && offnum >= P_FIRSTDATAKEY(opaque))
+				break;
+			buf = _bt_walk_left(rel, buf, scan->xs_snapshot);
+			if (!BufferIsValid(buf))
+				return false;
+			page = BufferGetPage(buf);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = PageGetMaxOffsetNumber(page);
+		}
+	}
+
+	/* Give up skipping if the prefixes are too dense, see above */
+	blkno = BufferGetBlockNumber(buf);
+	if (!first && blkno == so->skipPrevBlock)
+		so->skipSamePage++;
+	else
+		so->skipSamePage = 0;
+	so->skipPrevBlock = blkno;
+	if (so->skipSamePage >= BT_SKIP_MAX_SAME_PAGE &&
+		so->numArrayKeys == so->numSkipKeys)
+	{
+		_bt_relbuf(rel, buf);
+		so->skipFallback = true;
+		return true;
+	}
+
+	/* Set the skip keys from the leading attributes of the tuple we found */
+	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	for (i = 0; i < so->numSkipKeys; i++)
+	{
+		Datum		value;
+		bool		isnull;
+
+		value = index_getattr(itup, i + 1, RelationGetDescr(rel), &isnull);
+		_bt_set_skip_key(scan, i, value, isnull);
+	}
+
+	_bt_relbuf(rel, buf);
+
+	return true;
+}
+
 /*
  * _bt_initialize_more_data() -- initialize moreLeft/moreRight appropriately
  * for scan direction
@@ -195,6 +195,18 @@ _bt_freestack(BTStack stack)
  * array keys, it's sufficient to find the extreme element value and replace
  * the whole array with that scalar value.
  *
+ * This is also where we decide whether to use a skip scan.  If the scan has
+ * quals, but none of them are on the first index column, we generate an
+ * equality "skip key" for each leading column before the first column that
+ * has a qual, and put them at the front of so->arrayKeyData.  The skip keys
+ * are treated like array keys whose elements are the distinct values present
+ * in the index, so that the scan consists of one primitive indexscan per
+ * distinct prefix, each of which can use the remaining quals to position
+ * itself and to terminate early.  The values are found on the fly by probing
+ * the index, see _bt_skip_next().  Skip scans aren't used for parallel scans,
+ * since the parallel array key machinery assumes that every participant can
+ * enumerate the array elements independently.
+ *
  * Note: the reason we need so->arrayKeyData, rather than just scribbling
  * on scan->keyData, is that callers are permitted to call btrescan without
  * supplying a new set of scankey data.
@@ -203,13 +215,21 @@ void
 _bt_preprocess_array_keys(IndexScanDesc scan)
 {
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
 	int			numberOfKeys = scan->numberOfKeys;
-	int16	   *indoption = scan->indexRelation->rd_indoption;
+	int16	   *indoption = rel->rd_indoption;
 	int			numArrayKeys;
+	int			numSkipKeys;
 	ScanKey		cur;
 	int			i;
 	MemoryContext oldContext;
 
+	so->numSkipKeys = 0;
+	so->skipFallback = false;
+	so->markSkipFallback = false;
+	so->skipPrevBlock = InvalidBlockNumber;
+	so->skipSamePage = 0;
+
 	/* Quick check to see if there are any array keys */
 	numArrayKeys = 0;
 	for (i = 0; i < numberOfKeys; i++)
@@ -229,8 +249,16 @@ _bt_preprocess_array_keys(IndexScanDesc scan)
 		}
 	}
 
+	/*
+	 * Skip leading columns that have no quals.  The input keys are sorted by
+	 * attribute number, so only the first one needs to be examined.
+	 */
+	numSkipKeys = 0;
+	if (numberOfKeys > 0 && scan->parallel_scan == NULL)
+		numSkipKeys = scan->keyData[0].sk_attno - 1;
+
 	/* Quit if nothing to do. */
-	if (numArrayKeys == 0)
+	if (numArrayKeys == 0 && numSkipKeys == 0)
 	{
 		so->numArrayKeys = 0;
 		so->arrayKeyData = NULL;
@@ -250,18 +278,58 @@ _bt_preprocess_array_keys(IndexScanDesc scan)
 
 	oldContext = MemoryContextSwitchTo(so->arrayContext);
 
-	/* Create modifiable copy of scan->keyData in the workspace context */
-	so->arrayKeyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
-	memcpy(so->arrayKeyData,
+	/*
+	 * Create modifiable copy of scan->keyData in the workspace context, with
+	 * room for the skip keys in front of it
+	 */
+	so->numArrayKeyData = numSkipKeys + numberOfKeys;
+	so->arrayKeyData = (ScanKey) palloc(so->numArrayKeyData * sizeof(ScanKeyData));
+	memcpy(&so->arrayKeyData[numSkipKeys],
 		   scan->keyData,
-		   scan->numberOfKeys * sizeof(ScanKeyData));
+		   numberOfKeys * sizeof(ScanKeyData));
 
 	/* Allocate space for per-array data in the workspace context */
-	so->arrayKeys = (BTArrayKeyInfo *) palloc0(numArrayKeys * sizeof(BTArrayKeyInfo));
+	so->arrayKeys = (BTArrayKeyInfo *)
+		palloc0((numSkipKeys + numArrayKeys) * sizeof(BTArrayKeyInfo));
+
+	/* Set up the skip keys; their values are filled in later */
+	for (i = 0; i < numSkipKeys; i++)
+	{
+		Oid			opcintype = rel->rd_opcintype[i];
+		Oid			eq_op;
+		RegProcedure eq_proc;
+
+		eq_op = get_opfamily_member(rel->rd_opfamily[i],
+									opcintype,
+									opcintype,
+									BTEqualStrategyNumber);
+		if (!OidIsValid(eq_op))
+			elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+				 BTEqualStrategyNumber, opcintype, opcintype,
+				 rel->rd_opfamily[i]);
+		eq_proc = get_opcode(eq_op);
+		if (!RegProcedureIsValid(eq_proc))
+			elog(ERROR, "missing oprcode for operator %u", eq_op);
+
+		ScanKeyEntryInitialize(&so->arrayKeyData[i],
+							   indoption[i] << SK_BT_INDOPTION_SHIFT,
+							   (AttrNumber) (i + 1),
+							   BTEqualStrategyNumber,
+							   opcintype,
+							   rel->rd_indcollation[i],
+							   eq_proc,
+							   (Datum) 0);
+
+		so->arrayKeys[i].scan_key = i;
+		so->arrayKeys[i].skip = true;
+		so->arrayKeys[i].cur_null = true;
+		so->arrayKeys[i].mark_null = true;
+	}
+	so->numSkipKeys = numSkipKeys;
 
 	/* Now process each array key */
-	numArrayKeys = 0;
-	for (i = 0; i < numberOfKeys; i++)
+	numArrayKeys = numSkipKeys;
+	for (i = numSkipKeys; i < so->numArrayKeyData; i++)
 	{
 		ArrayType  *arrayval;
 		int16		elmlen;
@@ -513,14 +581,17 @@ _bt_compare_array_elements(const void *a, const void *b, void *arg)
  *
  * Set up the cur_elem counters and fill in the first sk_argument value for
  * each array scankey.  We can't do this until we know the scan direction.
+ * Skip keys are set to the first prefix present in the index.
+ *
+ * Returns false if there's nothing to scan (the index is empty), else true.
  */
-void
+bool
 _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir)
 {
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
 	int			i;
 
-	for (i = 0; i < so->numArrayKeys; i++)
+	for (i = so->numSkipKeys; i < so->numArrayKeys; i++)
 	{
 		BTArrayKeyInfo *curArrayKey = &so->arrayKeys[i];
 		ScanKey		skey = &so->arrayKeyData[curArrayKey->scan_key];
@@ -532,6 +603,11 @@ _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir)
 			curArrayKey->cur_elem = 0;
 		skey->sk_argument = curArrayKey->elem_values[curArrayKey->cur_elem];
 	}
+
+	if (so->numSkipKeys > 0)
+		return _bt_skip_next(scan, dir, true);
+
+	return true;
 }
 
 /*
@@ -553,7 +629,7 @@ _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir)
 	 * qualifications. This is necessary to ensure correct ordering of output
 	 * when there are multiple array keys.
 	 */
-	for (i = so->numArrayKeys - 1; i >= 0; i--)
+	for (i = so->numArrayKeys - 1; i >= so->numSkipKeys; i--)
 	{
 		BTArrayKeyInfo *curArrayKey = &so->arrayKeys[i];
 		ScanKey		skey = &so->arrayKeyData[curArrayKey->scan_key];
@@ -587,6 +663,15 @@ _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir)
 			break;
 	}
 
+	/*
+	 * If all the real arrays wrapped around, move on to the next distinct
+	 * prefix of the skipped columns.  The skip keys all correspond to index
+	 * columns before those of the real arrays, so this preserves the output
+	 * ordering.
+	 */
+	if (!found && so->numSkipKeys > 0 && !so->skipFallback)
+		found = _bt_skip_next(scan, dir, false);
+
 	/* advance parallel scan */
 	if (scan->parallel_scan != NULL)
 		_bt_parallel_advance_array_keys(scan);
@@ -594,6 +679,51 @@ _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir)
 	return found;
 }
 
+/*
+ * _bt_set_skip_key() -- Set the value of a skip key
+ *
+ * The value is copied into the array context.  A NULL value turns the key
+ * into an IS NULL search condition.
+ */
+void
+_bt_set_skip_key(IndexScanDesc scan, int skipidx, Datum value, bool isnull)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	BTArrayKeyInfo *curArrayKey = &so->arrayKeys[skipidx];
+	ScanKey		skey = &so->arrayKeyData[curArrayKey->scan_key];
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(rel), skipidx);
+	int			attno = skey->sk_attno;
+
+	Assert(curArrayKey->skip);
+
+	if (!curArrayKey->cur_null && !att->attbyval)
+		pfree(DatumGetPointer(curArrayKey->cur_value));
+
+	curArrayKey->cur_null = isnull;
+	if (isnull)
+		curArrayKey->cur_value = (Datum) 0;
+	else
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(so->arrayContext);
+
+		curArrayKey->cur_value = datumCopy(value, att->attbyval, att->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	/*
+	 * Reinitialize the scankey.  _bt_fix_scankey_strategy() will adjust the
+	 * strategy and subtype of an IS NULL key, so undo that here if needed.
+	 */
+	skey->sk_flags = rel->rd_indoption[attno - 1] << SK_BT_INDOPTION_SHIFT;
+	skey->sk_strategy = BTEqualStrategyNumber;
+	skey->sk_subtype = rel->rd_opcintype[attno - 1];
+	skey->sk_collation = rel->rd_indcollation[attno - 1];
+	if (isnull)
+		skey->sk_flags |= SK_ISNULL | SK_SEARCHNULL;
+	skey->sk_argument = curArrayKey->cur_value;
+}
+
 /*
  * _bt_mark_array_keys() -- Handle array keys during btmarkpos
  *
@@ -605,10 +735,33 @@ _bt_mark_array_keys(IndexScanDesc scan)
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
 	int			i;
 
+	so->markSkipFallback = so->skipFallback;
+
 	for (i = 0; i < so->numArrayKeys; i++)
 	{
 		BTArrayKeyInfo *curArrayKey = &so->arrayKeys[i];
 
+		if (curArrayKey->skip)
+		{
+			Form_pg_attribute att = TupleDescAttr(RelationGetDescr(scan->indexRelation), i);
+
+			if (!curArrayKey->mark_null && !att->attbyval)
+				pfree(DatumGetPointer(curArrayKey->mark_value));
+			curArrayKey->mark_null = curArrayKey->cur_null;
+			if (curArrayKey->cur_null)
+				curArrayKey->mark_value = (Datum) 0;
+			else
+			{
+				MemoryContext oldContext = MemoryContextSwitchTo(so->arrayContext);
+
+				curArrayKey->mark_value = datumCopy(curArrayKey->cur_value,
+													att->attbyval,
+													att->attlen);
+				MemoryContextSwitchTo(oldContext);
+			}
+			continue;
+		}
+
 		curArrayKey->mark_elem = curArrayKey->cur_elem;
 	}
 }
@@ -625,8 +778,31 @@ _bt_restore_array_keys(IndexScanDesc scan)
 	bool		changed = false;
 	int			i;
 
+	/*
+	 * Restore each skip key to its value when the mark was set.  We don't
+	 * bother to check whether the value actually changed.
+	 */
+	for (i = 0; i < so->numSkipKeys; i++)
+	{
+		BTArrayKeyInfo *curArrayKey = &so->arrayKeys[i];
+
+		_bt_set_skip_key(scan, i, curArrayKey->mark_value,
+						 curArrayKey->mark_null);
+		changed = true;
+	}
+
+	/*
+	 * If we gave up skipping after the mark was set, go back to skipping,
+	 * since the marked position is inside a single prefix's primitive scan.
+	 */
+	if (so->skipFallback && !so->markSkipFallback)
+	{
+		so->skipFallback = false;
+		so->skipSamePage = 0;
+	}
+
 	/* Restore each array key to its position when the mark was set */
-	for (i = 0; i < so->numArrayKeys; i++)
+	for (i = so->numSkipKeys; i < so->numArrayKeys; i++)
 	{
 		BTArrayKeyInfo *curArrayKey = &so->arrayKeys[i];
 		ScanKey		skey = &so->arrayKeyData[curArrayKey->scan_key];
@@ -659,8 +835,9 @@ _bt_restore_array_keys(IndexScanDesc scan)
  *
  * The given search-type keys (in scan->keyData[] or so->arrayKeyData[])
  * are copied to so->keyData[] with possible transformation.
- * scan->numberOfKeys is the number of input keys, so->numberOfKeys gets
- * the number of output keys (possibly less, never greater).
+ * scan->numberOfKeys (or so->numArrayKeyData) is the number of input keys,
+ * so->numberOfKeys gets the number of output keys (possibly less, never
+ * greater).
  *
  * The output keys are marked with additional sk_flags bits beyond the
  * system-standard bits supplied by the caller.  The DESC and NULLS_FIRST
@@ -766,7 +943,17 @@ _bt_preprocess_keys(IndexScanDesc scan)
 	 * Read so->arrayKeyData if array keys are present, else scan->keyData
 	 */
 	if (so->arrayKeyData != NULL)
+	{
 		inkeys = so->arrayKeyData;
+		numberOfKeys = so->numArrayKeyData;
+
+		/* A skip scan that gave up skipping has no keys on those columns */
+		if (so->skipFallback)
+		{
+			inkeys += so->numSkipKeys;
+			numberOfKeys -= so->numSkipKeys;
+		}
+	}
 	else
 		inkeys = scan->keyData;
 
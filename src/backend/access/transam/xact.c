@@ -30,6 +30,7 @@
 #include "access/xlog.h"
 #include "access/xloginsert.h"
 #include "access/xlogutils.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_enum.h"
@@ -2300,7 +2301,9 @@ CommitTransaction(void)
 	AtEOXact_SPI(true);
 	AtEOXact_Enum();
 	AtEOXact_on_commit_actions(true);
+	AtEOXact_GlobalTemp(true);
 	AtEOXact_Namespace(true, is_parallel_worker);
+	AtEOXact_CatCache();
 	AtEOXact_SMgr();
 	AtEOXact_Files(true);
 	AtEOXact_ComboCid();
@@ -2582,7 +2585,9 @@ PrepareTransaction(void)
 	AtEOXact_SPI(true);
 	AtEOXact_Enum();
 	AtEOXact_on_commit_actions(true);
+	AtEOXact_GlobalTemp(true);
 	AtEOXact_Namespace(true, false);
+	AtEOXact_CatCache();
 	AtEOXact_SMgr();
 	AtEOXact_Files(true);
 	AtEOXact_ComboCid();
@@ -2728,7 +2733,6 @@ AbortTransaction(void)
 	AtAbort_Portals();
 	smgrDoPendingSyncs(false, is_parallel_worker);
 	AtEOXact_LargeObject(false);
-	AtAbort_Notify();
 	AtEOXact_RelationMap(false, is_parallel_worker);
 	AtAbort_Twophase();
 
@@ -2761,6 +2765,12 @@ AbortTransaction(void)
 	 */
 	ProcArrayEndTransaction(MyProc, latestXid);
 
+	/*
+	 * Listeners that we wake up here must see us as no longer running, so
+	 * that they skip any notifications we have already queued.
+	 */
+	AtAbort_Notify();
+
 	/*
 	 * Post-abort cleanup.  See notes in CommitTransaction() concerning
 	 * ordering.  We can skip all of it if the transaction failed before
@@ -2792,7 +2802,9 @@ AbortTransaction(void)
 		AtEOXact_SPI(false);
 		AtEOXact_Enum();
 		AtEOXact_on_commit_actions(false);
+		AtEOXact_GlobalTemp(false);
 		AtEOXact_Namespace(false, is_parallel_worker);
+		AtEOXact_CatCache();
 		AtEOXact_SMgr();
 		AtEOXact_Files(false);
 		AtEOXact_ComboCid();
@@ -4916,6 +4928,8 @@ CommitSubTransaction(void)
 	AtEOSubXact_SPI(true, s->subTransactionId);
 	AtEOSubXact_on_commit_actions(true, s->subTransactionId,
 								  s->parent->subTransactionId);
+	AtEOSubXact_GlobalTemp(true, s->subTransactionId,
+						   s->parent->subTransactionId);
 	AtEOSubXact_Namespace(true, s->subTransactionId,
 						  s->parent->subTransactionId);
 	AtEOSubXact_Files(true, s->subTransactionId,
@@ -5075,6 +5089,8 @@ AbortSubTransaction(void)
 		AtEOSubXact_SPI(false, s->subTransactionId);
 		AtEOSubXact_on_commit_actions(false, s->subTransactionId,
 									  s->parent->subTransactionId);
+		AtEOSubXact_GlobalTemp(false, s->subTransactionId,
+							   s->parent->subTransactionId);
 		AtEOSubXact_Namespace(false, s->subTransactionId,
 							  s->parent->subTransactionId);
 		AtEOSubXact_Files(false, s->subTransactionId,
@@ -0,0 +1,1105 @@
+/*-------------------------------------------------------------------------
+ *
+ * globaltemp.c
+ *	  per-session storage and statistics of global temporary tables
+ *
+ * A global temporary table (relpersistence RELPERSISTENCE_GLOBAL_TEMP) is
+ * created once, and its definition lives in the catalogs like that of any
+ * other table.  Its contents, however, are private to each session: when a
+ * session first scans or inserts into the table or one of its indexes, it
+ * assigns the table, its indexes and its TOAST table relfilenodes of its own
+ * and creates their storage as backend-local files, accessed through local
+ * buffers exactly like the storage of a regular temporary table.  None of
+ * this is recorded in pg_class.  The relation's pg_class.relfilenode is only
+ * a placeholder, and RelationInitPhysicalAddr asks us for this session's
+ * relfilenode instead.  Until then, the relation reads as empty; merely
+ * opening it, as VACUUM, pg_relation_size() or DROP TABLE in another session
+ * do, has no side effects.  See table_ensure_storage().
+ *
+ * What pg_class and pg_statistic normally record about a table's data ---
+ * relpages, reltuples, relallvisible, relfrozenxid, relminmxid, and the
+ * column statistics gathered by ANALYZE --- can only describe one session's
+ * data here, so that is kept in the same backend-local hash table, and the
+ * pg_class fields are overlaid on the relcache entry.  Using a global
+ * temporary table thus neither writes to the catalogs nor sends
+ * invalidation messages.
+ *
+ * Changes to the mapping (new storage, TRUNCATE, REINDEX, DROP) follow
+ * transaction semantics: each entry remembers the state it had before it
+ * was first changed in each open subtransaction, and that state is put back
+ * on abort.  The files themselves are created and removed through the
+ * pending create/delete machinery in storage.c.
+ *
+ * A session having storage for a table holds a session-level lock on the
+ * table's pg_class object, which DDL that cannot cope with other sessions'
+ * data tries to take; see CheckGlobalTempRelationNotInUse.  That is why an
+ * index created by such DDL can be built right away and need not be built
+ * by the other sessions: they have no data.  Since VACUUM in
+ * one session cannot freeze the tuples of another, each backend advertises
+ * the oldest relfrozenxid and relminmxid of its storage in shared memory,
+ * for vac_update_datfrozenxid to take into account.
+ *
+ * The storage is removed at session exit, or earlier by DISCARD TEMP.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/catalog/globaltemp.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/multixact.h"
+#include "access/parallel.h"
+#include "access/relation.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
+#include "catalog/index.h"
+#include "catalog/pg_class.h"
+#include "catalog/storage.h"
+#include "commands/tablecmds.h"
+#include "miscadmin.h"
+#include "storage/ipc.h"
+#include "storage/lock.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+/*
+ * This session's storage of a relation, and what we know about it.  The
+ * last five fields correspond to the pg_class columns of the same names.
+ */
+typedef struct GlobalTempStorage
+{
+	RelFileNode rnode;			/* relNode is InvalidOid if none */
+	TransactionId relfrozenxid;
+	MultiXactId relminmxid;
+	BlockNumber relpages;
+	float4		reltuples;
+	BlockNumber relallvisible;
+} GlobalTempStorage;
+
+/*
+ * The state a relation had before it was first changed in a subtransaction.
+ */
+typedef struct GlobalTempSavedState
+{
+	SubTransactionId subid;
+	GlobalTempStorage storage;
+} GlobalTempSavedState;
+
+/*
+ * Statistics of one column, as the pg_statistic tuple ANALYZE formed.
+ */
+typedef struct GlobalTempStatistic
+{
+	AttrNumber	attnum;
+	bool		inh;
+	HeapTuple	tuple;
+} GlobalTempStatistic;
+
+typedef struct GlobalTempRelation
+{
+	Oid			relid;			/* hash key; must be first */
+	Oid			tableid;		/* table whose storage this came with */
+	bool		locked;			/* holding the session lock? */
+	bool		discarded;		/* storage discarded after losing the lock? */
+	GlobalTempStorage storage;	/* current state */
+	List	   *saved;			/* GlobalTempSavedStates, newest first */
+	List	   *statistics;		/* GlobalTempStatistics */
+} GlobalTempRelation;
+
+/*
+ * Shared memory: the oldest relfrozenxid and relminmxid of each backend's
+ * storage, indexed by BackendId - 1.
+ */
+typedef struct GlobalTempXids
+{
+	Oid			dbid;			/* InvalidOid if the backend has no storage */
+	TransactionId frozenxid;
+	MultiXactId minmulti;
+} GlobalTempXids;
+
+typedef struct GlobalTempShmemData
+{
+	slock_t		mutex;			/* protects xids[] */
+	GlobalTempXids xids[FLEXIBLE_ARRAY_MEMBER];
+} GlobalTempShmemData;
+
+static GlobalTempShmemData *GlobalTempShmem = NULL;
+
+/* This session's relations, keyed by OID; NULL until first needed */
+static HTAB *GlobalTempRelations = NULL;
+static MemoryContext GlobalTempContext = NULL;
+
+/* Has any entry been changed in the current transaction? */
+static bool GlobalTempXactChanged = false;
+
+static GlobalTempRelation *GlobalTempRelationLookup(Oid relid, bool create);
+static void GlobalTempSetLockTag(LOCKTAG *tag, Relation rel);
+static void GlobalTempCreateStorage(Relation rel, Oid tableid);
+static void GlobalTempCreateTableStorage(Relation rel, Oid tableid);
+static void GlobalTempDiscardTable(Oid tableid);
+static void GlobalTempSaveState(GlobalTempRelation *entry);
+static void GlobalTempResetStorage(GlobalTempStorage *storage);
+static void GlobalTempAdvertiseXids(void);
+static void GlobalTempUnlinkStorage(RelFileNode rnode);
+static void AtProcExit_GlobalTemp(int code, Datum arg);
+
+
+/*
+ * GlobalTempShmemSize --- report amount of shared memory space needed
+ */
+Size
+GlobalTempShmemSize(void)
+{
+	return add_size(offsetof(GlobalTempShmemData, xids),
+					mul_size(MaxBackends, sizeof(GlobalTempXids)));
+}
+
+/*
+ * GlobalTempShmemInit --- initialize this module's shared memory
+ */
+void
+GlobalTempShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	GlobalTempShmem = (GlobalTempShmemData *)
+		ShmemInitStruct("Global Temporary Table Data",
+						GlobalTempShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		SpinLockInit(&GlobalTempShmem->mutex);
+		for (i = 0; i < MaxBackends; i++)
+		{
+			GlobalTempShmem->xids[i].dbid = InvalidOid;
+			GlobalTempShmem->xids[i].frozenxid = InvalidTransactionId;
+			GlobalTempShmem->xids[i].minmulti = InvalidMultiXactId;
+		}
+	}
+}
+
+/*
+ * Find the entry of a relation, optionally creating it.  Returns NULL if
+ * there is none and create is false.
+ */
+static GlobalTempRelation *
+GlobalTempRelationLookup(Oid relid, bool create)
+{
+	GlobalTempRelation *entry;
+	bool		found;
+
+	if (GlobalTempRelations == NULL)
+	{
+		HASHCTL		ctl;
+
+		if (!create)
+			return NULL;
+
+		GlobalTempContext = AllocSetContextCreate(TopMemoryContext,
+												  "GlobalTempContext",
+												  ALLOCSET_DEFAULT_SIZES);
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(GlobalTempRelation);
+		ctl.hcxt = GlobalTempContext;
+		GlobalTempRelations = hash_create("Global temporary relations", 64,
+										  &ctl,
+										  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		/* Run after the transaction has been aborted; see ShutdownPostgres */
+		on_shmem_exit(AtProcExit_GlobalTemp, 0);
+	}
+
+	entry = (GlobalTempRelation *) hash_search(GlobalTempRelations, &relid,
+											   create ? HASH_ENTER : HASH_FIND,
+											   &found);
+	if (create && !found)
+	{
+		entry->tableid = InvalidOid;
+		entry->locked = false;
+		entry->discarded = false;
+		GlobalTempResetStorage(&entry->storage);
+		entry->saved = NIL;
+		entry->statistics = NIL;
+	}
+
+	return entry;
+}
+
+/*
+ * Set up the tag of the lock that tells other sessions we're using a table.
+ * For an index or a TOAST table, that's the lock of the table it belongs to.
+ */
+static void
+GlobalTempSetLockTag(LOCKTAG *tag, Relation rel)
+{
+	Oid			relid = RelationGetRelid(rel);
+
+	if (rel->rd_rel->relkind == RELKIND_INDEX)
+		relid = rel->rd_index->indrelid;
+
+	SET_LOCKTAG_OBJECT(*tag, MyDatabaseId, RelationRelationId, relid, 0);
+}
+
+/*
+ * Mark the storage state as "no storage".
+ */
+static void
+GlobalTempResetStorage(GlobalTempStorage *storage)
+{
+	storage->rnode.spcNode = InvalidOid;
+	storage->rnode.dbNode = InvalidOid;
+	storage->rnode.relNode = InvalidOid;
+	storage->relfrozenxid = InvalidTransactionId;
+	storage->relminmxid = InvalidMultiXactId;
+	storage->relpages = 0;
+	storage->reltuples = -1;
+	storage->relallvisible = 0;
+}
+
+/*
+ * Remember the current state of an entry, unless that was already done in
+ * the current subtransaction.
+ */
+static void
+GlobalTempSaveState(GlobalTempRelation *entry)
+{
+	SubTransactionId mySubid = GetCurrentSubTransactionId();
+	GlobalTempSavedState *saved;
+	MemoryContext oldcxt;
+
+	GlobalTempXactChanged = true;
+
+	if (entry->saved != NIL &&
+		((GlobalTempSavedState *) linitial(entry->saved))->subid == mySubid)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(GlobalTempContext);
+	saved = (GlobalTempSavedState *) palloc(sizeof(GlobalTempSavedState));
+	saved->subid = mySubid;
+	saved->storage = entry->storage;
+	entry->saved = lcons(saved, entry->saved);
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * GlobalTempRelationInitPhysicalAddr
+ *		Fill in the relfilenode and the storage-related pg_class fields of a
+ *		relcache entry from this session's state.
+ *
+ * If the session has no storage for the relation yet, rd_node.relNode is set
+ * to InvalidOid (see RelationLacksSessionStorage), and
+ * GlobalTempRelationEnsureStorage will create it.
+ */
+void
+GlobalTempRelationInitPhysicalAddr(Relation rel)
+{
+	GlobalTempRelation *entry;
+	GlobalTempStorage nostorage;
+	GlobalTempStorage *storage;
+
+	entry = GlobalTempRelationLookup(RelationGetRelid(rel), false);
+	if (entry != NULL)
+		storage = &entry->storage;
+	else
+	{
+		GlobalTempResetStorage(&nostorage);
+		storage = &nostorage;
+	}
+
+	rel->rd_node.relNode = storage->rnode.relNode;
+	rel->rd_rel->relpages = (int32) storage->relpages;
+	rel->rd_rel->reltuples = storage->reltuples;
+	rel->rd_rel->relallvisible = (int32) storage->relallvisible;
+	rel->rd_rel->relfrozenxid = storage->relfrozenxid;
+	rel->rd_rel->relminmxid = storage->relminmxid;
+}
+
+/*
+ * GlobalTempRelationEnsureStorage
+ *		Create this session's storage for a relation, if not done yet.
+ *
+ * This is called before a global temporary relation is first scanned or
+ * inserted into.  A table gets storage together with its indexes and its
+ * TOAST table, and an index together with its table.
+ */
+void
+GlobalTempRelationEnsureStorage(Relation rel)
+{
+	GlobalTempRelation *entry;
+	Relation	heapRel;
+
+	/* Quick exit in the common case that we have it already */
+	if (!RelationLacksSessionStorage(rel))
+		return;
+
+	if (rel->rd_rel->relkind == RELKIND_INDEX)
+	{
+		heapRel = table_open(rel->rd_index->indrelid, AccessShareLock);
+		GlobalTempRelationEnsureStorage(heapRel);
+
+		/*
+		 * That normally gave the index storage as well, but not if the table
+		 * had storage already and the index was created without it, as
+		 * index_create does in sessions with no data.  Build it from the
+		 * data we have.
+		 */
+		if (RelationLacksSessionStorage(rel))
+		{
+			entry = GlobalTempRelationLookup(RelationGetRelid(heapRel), false);
+			GlobalTempCreateStorage(rel, entry->tableid);
+			index_build(heapRel, rel, BuildIndexInfo(rel), false, false);
+		}
+
+		table_close(heapRel, NoLock);
+		return;
+	}
+
+	/*
+	 * If we lost our storage of the table to DDL in another session, say so
+	 * once rather than silently present an empty table.
+	 */
+	entry = GlobalTempRelationLookup(RelationGetRelid(rel), false);
+	if (entry != NULL && entry->discarded)
+	{
+		entry->discarded = false;
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("contents of global temporary table \"%s\" have been discarded",
+						RelationGetRelationName(rel)),
+				 errdetail("Another session altered the table while this session was rolling back a transaction.")));
+	}
+
+	GlobalTempCreateTableStorage(rel, RelationGetRelid(rel));
+}
+
+/*
+ * Create empty storage for a table or TOAST table that has none, and for its
+ * indexes and TOAST table.  tableid is the table all of it comes with.
+ */
+static void
+GlobalTempCreateTableStorage(Relation rel, Oid tableid)
+{
+	List	   *indexoidlist;
+	ListCell   *lc;
+
+	GlobalTempCreateStorage(rel, tableid);
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel = index_open(lfirst_oid(lc), AccessShareLock);
+
+		if (RelationLacksSessionStorage(indexRel))
+		{
+			GlobalTempCreateStorage(indexRel, tableid);
+			index_build(rel, indexRel, BuildIndexInfo(indexRel), false, false);
+		}
+		index_close(indexRel, NoLock);
+	}
+	list_free(indexoidlist);
+
+	if (OidIsValid(rel->rd_rel->reltoastrelid))
+	{
+		Relation	toastRel = table_open(rel->rd_rel->reltoastrelid,
+										  AccessShareLock);
+
+		if (RelationLacksSessionStorage(toastRel))
+			GlobalTempCreateTableStorage(toastRel, tableid);
+		table_close(toastRel, NoLock);
+	}
+}
+
+/*
+ * GlobalTempRelationSetNewFilenode
+ *		Give a relation new, empty storage in this session.
+ *
+ * This is what RelationSetNewRelfilenode does for a global temporary
+ * relation; the old storage, if any, is unlinked at commit.  Unlike there,
+ * nothing is written to pg_class.
+ */
+void
+GlobalTempRelationSetNewFilenode(Relation rel)
+{
+	/*
+	 * Make sure that the relation's table, indexes and TOAST table all have
+	 * storage, as they would after a scan, before replacing this part.
+	 */
+	GlobalTempRelationEnsureStorage(rel);
+
+	GlobalTempCreateStorage(rel, InvalidOid);
+}
+
+/*
+ * Give a relation new, empty storage.  tableid is recorded as the table the
+ * storage comes with, unless one is known already.
+ */
+static void
+GlobalTempCreateStorage(Relation rel, Oid tableid)
+{
+	GlobalTempRelation *entry;
+	GlobalTempStorage newstorage;
+	SMgrRelation srel;
+
+	/*
+	 * A parallel worker could not see the leader's storage, and we can't
+	 * create any storage during recovery.
+	 */
+	if (IsParallelWorker())
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
+				 errmsg("cannot access global temporary tables during a parallel operation")));
+	if (RecoveryInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access global temporary tables during recovery")));
+
+	entry = GlobalTempRelationLookup(RelationGetRelid(rel), true);
+	if (!OidIsValid(entry->tableid))
+		entry->tableid = OidIsValid(tableid) ? tableid : entry->relid;
+
+	/* Let DDL in other sessions know that we are using the table */
+	if (!entry->locked && rel->rd_rel->relkind == RELKIND_RELATION)
+	{
+		LOCKTAG		tag;
+
+		GlobalTempSetLockTag(&tag, rel);
+		(void) LockAcquire(&tag, AccessShareLock, true, false);
+		entry->locked = true;
+
+		/*
+		 * If we had to wait for DDL in another session, it may have added
+		 * an index that our caller has to give storage to; make sure the
+		 * relcache knows about it, as LockRelationOid would.
+		 */
+		AcceptInvalidationMessages();
+	}
+
+	GlobalTempSaveState(entry);
+
+	GlobalTempResetStorage(&newstorage);
+	newstorage.rnode = rel->rd_node;
+	newstorage.rnode.relNode =
+		GetNewRelFileNode(rel->rd_rel->reltablespace, NULL,
+						  RELPERSISTENCE_GLOBAL_TEMP);
+
+	/* Schedule unlinking of the old storage at transaction commit */
+	if (OidIsValid(entry->storage.rnode.relNode))
+		RelationDropStorage(rel);
+
+	switch (rel->rd_rel->relkind)
+	{
+		case RELKIND_INDEX:
+			srel = RelationCreateStorage(newstorage.rnode,
+										 RELPERSISTENCE_GLOBAL_TEMP);
+			smgrclose(srel);
+			break;
+
+		case RELKIND_RELATION:
+		case RELKIND_TOASTVALUE:
+			table_relation_set_new_filenode(rel, &newstorage.rnode,
+											RELPERSISTENCE_GLOBAL_TEMP,
+											&newstorage.relfrozenxid,
+											&newstorage.relminmxid);
+			break;
+
+		default:
+			elog(ERROR, "relation \"%s\" does not have storage",
+				 RelationGetRelationName(rel));
+			break;
+	}
+
+	entry->storage = newstorage;
+	GlobalTempAdvertiseXids();
+
+	/* Point the relcache entry to the new storage */
+	RelationCacheResetStorage(RelationGetRelid(rel));
+	RelationAssumeNewRelfilenode(rel);
+}
+
+/*
+ * GlobalTempRelationDropped
+ *		Schedule unlinking of this session's storage of a relation.
+ *
+ * Used when the relation is dropped, and by DISCARD TEMP.
+ */
+void
+GlobalTempRelationDropped(Relation rel)
+{
+	GlobalTempRelation *entry;
+
+	entry = GlobalTempRelationLookup(RelationGetRelid(rel), false);
+	if (entry == NULL || !OidIsValid(entry->storage.rnode.relNode))
+		return;
+
+	GlobalTempSaveState(entry);
+	RelationDropStorage(rel);
+	GlobalTempResetStorage(&entry->storage);
+
+	RelationCacheResetStorage(RelationGetRelid(rel));
+}
+
+/*
+ * GlobalTempRelationGetFilenode
+ *		This session's relfilenode of a relation, or InvalidOid if none.
+ */
+Oid
+GlobalTempRelationGetFilenode(Oid relid)
+{
+	GlobalTempRelation *entry;
+
+	entry = GlobalTempRelationLookup(relid, false);
+	if (entry == NULL)
+		return InvalidOid;
+	return entry->storage.rnode.relNode;
+}
+
+/*
+ * GlobalTempRelationSetStats
+ *		Record the size of this session's storage of a relation, as VACUUM,
+ *		ANALYZE and index builds do in pg_class for other relations.
+ */
+void
+GlobalTempRelationSetStats(Relation rel, BlockNumber relpages,
+						   double reltuples, BlockNumber relallvisible)
+{
+	GlobalTempRelation *entry;
+
+	entry = GlobalTempRelationLookup(RelationGetRelid(rel), false);
+	if (entry == NULL || !OidIsValid(entry->storage.rnode.relNode))
+		return;
+
+	entry->storage.relpages = relpages;
+	entry->storage.reltuples = (float4) reltuples;
+	entry->storage.relallvisible = relallvisible;
+
+	rel->rd_rel->relpages = (int32) relpages;
+	rel->rd_rel->reltuples = (float4) reltuples;
+	rel->rd_rel->relallvisible = (int32) relallvisible;
+}
+
+/*
+ * GlobalTempRelationSetXids
+ *		Advance the relfrozenxid and relminmxid of this session's storage of
+ *		a relation after VACUUM.
+ *
+ * Invalid values mean there's nothing new, as in vac_update_relstats.
+ */
+void
+GlobalTempRelationSetXids(Relation rel, TransactionId frozenxid,
+						  MultiXactId minmulti)
+{
+	GlobalTempRelation *entry;
+	bool		changed = false;
+
+	entry = GlobalTempRelationLookup(RelationGetRelid(rel), false);
+	if (entry == NULL || !OidIsValid(entry->storage.rnode.relNode))
+		return;
+
+	if (TransactionIdIsNormal(frozenxid) &&
+		TransactionIdPrecedes(entry->storage.relfrozenxid, frozenxid))
+	{
+		entry->storage.relfrozenxid = frozenxid;
+		rel->rd_rel->relfrozenxid = frozenxid;
+		changed = true;
+	}
+
+	if (MultiXactIdIsValid(minmulti) &&
+		MultiXactIdPrecedes(entry->storage.relminmxid, minmulti))
+	{
+		entry->storage.relminmxid = minmulti;
+		rel->rd_rel->relminmxid = minmulti;
+		changed = true;
+	}
+
+	if (changed)
+		GlobalTempAdvertiseXids();
+}
+
+/*
+ * GlobalTempRelationSetStatistic
+ *		Store the statistics of a column gathered by ANALYZE, replacing any
+ *		previous ones.  The tuple is copied.
+ */
+void
+GlobalTempRelationSetStatistic(Oid relid, AttrNumber attnum, bool inh,
+							   HeapTuple tuple)
+{
+	GlobalTempRelation *entry;
+	GlobalTempStatistic *stat;
+	MemoryContext oldcxt;
+	ListCell   *lc;
+
+	entry = GlobalTempRelationLookup(relid, false);
+	if (entry == NULL || !OidIsValid(entry->storage.rnode.relNode))
+		return;
+
+	oldcxt = MemoryContextSwitchTo(GlobalTempContext);
+
+	foreach(lc, entry->statistics)
+	{
+		stat = (GlobalTempStatistic *) lfirst(lc);
+
+		if (stat->attnum == attnum && stat->inh == inh)
+		{
+			heap_freetuple(stat->tuple);
+			stat->tuple = heap_copytuple(tuple);
+			MemoryContextSwitchTo(oldcxt);
+			return;
+		}
+	}
+
+	stat = (GlobalTempStatistic *) palloc(sizeof(GlobalTempStatistic));
+	stat->attnum = attnum;
+	stat->inh = inh;
+	stat->tuple = heap_copytuple(tuple);
+	entry->statistics = lappend(entry->statistics, stat);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * GlobalTempRelationGetStatistic
+ *		Look up the statistics of a column in this session.
+ *
+ * Returns false if the relation isn't a global temporary relation that this
+ * session has storage for; the caller should then look in pg_statistic.
+ * Otherwise *tuple is set to a palloc'd copy of the statistics tuple, or to
+ * NULL if ANALYZE hasn't gathered any.
+ */
+bool
+GlobalTempRelationGetStatistic(Oid relid, AttrNumber attnum, bool inh,
+							   HeapTuple *tuple)
+{
+	GlobalTempRelation *entry;
+	ListCell   *lc;
+
+	entry = GlobalTempRelationLookup(relid, false);
+	if (entry == NULL)
+		return false;
+
+	*tuple = NULL;
+	foreach(lc, entry->statistics)
+	{
+		GlobalTempStatistic *stat = (GlobalTempStatistic *) lfirst(lc);
+
+		if (stat->attnum == attnum && stat->inh == inh)
+		{
+			*tuple = heap_copytuple(stat->tuple);
+			break;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * CheckGlobalTempRelationNotInUse
+ *		Make sure that no other session has storage for a global temporary
+ *		table, or for the table an index belongs to.
+ *
+ * Used by DDL that can't take other sessions' data into account.  Like
+ * CheckTableNotInUse, "stmt" is the name of the command for the message.  On
+ * success, sessions that want to start using the table block until our
+ * transaction ends.
+ */
+void
+CheckGlobalTempRelationNotInUse(Relation rel, const char *stmt)
+{
+	LOCKTAG		tag;
+
+	if (!RelationIsGlobalTemp(rel))
+		return;
+
+	GlobalTempSetLockTag(&tag, rel);
+	if (LockAcquire(&tag, AccessExclusiveLock, false, true) == LOCKACQUIRE_NOT_AVAIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_IN_USE),
+		/* translator: first %s is a SQL command, eg ALTER TABLE */
+				 errmsg("cannot %s \"%s\" because it is being used by other sessions",
+						stmt, RelationGetRelationName(rel))));
+}
+
+/*
+ * ResetGlobalTempRelations
+ *		Drop all of this session's storage, for DISCARD TEMP.
+ *
+ * The storage is unlinked at commit, and the session locks released then.
+ */
+void
+ResetGlobalTempRelations(void)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempRelation *entry;
+	List	   *relids = NIL;
+	ListCell   *lc;
+
+	if (GlobalTempRelations == NULL)
+		return;
+
+	hash_seq_init(&status, GlobalTempRelations);
+	while ((entry = (GlobalTempRelation *) hash_seq_search(&status)) != NULL)
+	{
+		if (OidIsValid(entry->storage.rnode.relNode))
+			relids = lappend_oid(relids, entry->relid);
+	}
+
+	foreach(lc, relids)
+	{
+		Oid			relid = lfirst_oid(lc);
+		Relation	rel;
+
+		rel = try_relation_open(relid, AccessShareLock);
+		if (rel == NULL)
+		{
+			/*
+			 * The relation has been dropped by another session; that can
+			 * happen if we lost our session lock.  Nobody can see the storage
+			 * anymore, so just get rid of it.
+			 */
+			entry = GlobalTempRelationLookup(relid, false);
+			GlobalTempSaveState(entry);
+			GlobalTempUnlinkStorage(entry->storage.rnode);
+			GlobalTempResetStorage(&entry->storage);
+			continue;
+		}
+
+		CheckTableNotInUse(rel, "DISCARD TEMP");
+		GlobalTempRelationDropped(rel);
+		relation_close(rel, NoLock);
+	}
+
+	list_free(relids);
+}
+
+/*
+ * GetOldestGlobalTempXids
+ *		Lower *frozenxid and *minmulti to the oldest relfrozenxid and
+ *		relminmxid of any session's storage in the current database.
+ */
+void
+GetOldestGlobalTempXids(TransactionId *frozenxid, MultiXactId *minmulti)
+{
+	int			i;
+
+	SpinLockAcquire(&GlobalTempShmem->mutex);
+	for (i = 0; i < MaxBackends; i++)
+	{
+		GlobalTempXids *xids = &GlobalTempShmem->xids[i];
+
+		if (xids->dbid != MyDatabaseId)
+			continue;
+
+		if (TransactionIdIsNormal(xids->frozenxid) &&
+			TransactionIdPrecedes(xids->frozenxid, *frozenxid))
+			*frozenxid = xids->frozenxid;
+		if (MultiXactIdIsValid(xids->minmulti) &&
+			MultiXactIdPrecedes(xids->minmulti, *minmulti))
+			*minmulti = xids->minmulti;
+	}
+	SpinLockRelease(&GlobalTempShmem->mutex);
+}
+
+/*
+ * Publish the oldest relfrozenxid and relminmxid of our storage, including
+ * storage that is only kept in case the current transaction aborts.
+ */
+static void
+GlobalTempAdvertiseXids(void)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempRelation *entry;
+	TransactionId frozenxid = InvalidTransactionId;
+	MultiXactId minmulti = InvalidMultiXactId;
+	GlobalTempXids *xids;
+
+	if (GlobalTempRelations != NULL)
+	{
+		hash_seq_init(&status, GlobalTempRelations);
+		while ((entry = (GlobalTempRelation *) hash_seq_search(&status)) != NULL)
+		{
+			GlobalTempStorage *storage = &entry->storage;
+			ListCell   *lc = list_head(entry->saved);
+
+			for (;;)
+			{
+				if (TransactionIdIsNormal(storage->relfrozenxid) &&
+					(!TransactionIdIsValid(frozenxid) ||
+					 TransactionIdPrecedes(storage->relfrozenxid, frozenxid)))
+					frozenxid = storage->relfrozenxid;
+				if (MultiXactIdIsValid(storage->relminmxid) &&
+					(!MultiXactIdIsValid(minmulti) ||
+					 MultiXactIdPrecedes(storage->relminmxid, minmulti)))
+					minmulti = storage->relminmxid;
+
+				if (lc == NULL)
+					break;
+				storage = &((GlobalTempSavedState *) lfirst(lc))->storage;
+				lc = lnext(entry->saved, lc);
+			}
+		}
+	}
+
+	xids = &GlobalTempShmem->xids[MyBackendId - 1];
+	SpinLockAcquire(&GlobalTempShmem->mutex);
+	if (TransactionIdIsValid(frozenxid) || MultiXactIdIsValid(minmulti))
+		xids->dbid = MyDatabaseId;
+	else
+		xids->dbid = InvalidOid;
+	xids->frozenxid = frozenxid;
+	xids->minmulti = minmulti;
+	SpinLockRelease(&GlobalTempShmem->mutex);
+}
+
+/*
+ * Unlink the files of a relation right away.
+ */
+static void
+GlobalTempUnlinkStorage(RelFileNode rnode)
+{
+	SMgrRelation srel;
+
+	if (!OidIsValid(rnode.relNode))
+		return;
+
+	srel = smgropen(rnode, MyBackendId);
+	smgrdounlinkall(&srel, 1, false);
+	smgrclose(srel);
+}
+
+/*
+ * AtEOXact_GlobalTemp
+ *		Transaction end processing.
+ *
+ * On abort, put back the state of every relation changed in the transaction;
+ * either way, forget about relations we no longer have storage for.
+ */
+void
+AtEOXact_GlobalTemp(bool isCommit)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempRelation *entry;
+	Oid		   *lost = NULL;
+	int			nlost = 0;
+	int			i;
+
+	if (GlobalTempRelations == NULL)
+		return;
+
+	/*
+	 * Aborting releases session locks as well (see ProcReleaseLocks), so we
+	 * have work to do then even if nothing changed.
+	 */
+	if (isCommit && !GlobalTempXactChanged)
+		return;
+
+	hash_seq_init(&status, GlobalTempRelations);
+	while ((entry = (GlobalTempRelation *) hash_seq_search(&status)) != NULL)
+	{
+		Oid			relid = entry->relid;
+		bool		changed = (entry->saved != NIL);
+
+		if (changed)
+		{
+			if (!isCommit)
+				entry->storage =
+					((GlobalTempSavedState *) llast(entry->saved))->storage;
+			list_free_deep(entry->saved);
+			entry->saved = NIL;
+		}
+
+		if (!OidIsValid(entry->storage.rnode.relNode) && !entry->discarded)
+		{
+			if (entry->locked && isCommit)
+			{
+				LOCKTAG		tag;
+
+				SET_LOCKTAG_OBJECT(tag, MyDatabaseId, RelationRelationId,
+								   relid, 0);
+				LockRelease(&tag, AccessShareLock, true);
+			}
+			list_free_deep(entry->statistics);
+			hash_search(GlobalTempRelations, &relid, HASH_REMOVE, NULL);
+		}
+		else if (entry->locked && !isCommit)
+		{
+			LOCKTAG		tag;
+
+			/*
+			 * Get the session lock back.  We mustn't wait or fail here, but
+			 * we don't need to: the DDL that takes the lock doesn't wait for
+			 * it either, so it can only have got in during the moment we
+			 * didn't hold it.  In that case it went ahead assuming no other
+			 * session had data in the table, so we must give up ours.
+			 */
+			SET_LOCKTAG_OBJECT(tag, MyDatabaseId, RelationRelationId,
+							   relid, 0);
+			if (LockAcquireExtended(&tag, AccessShareLock, true, true,
+									false, NULL) == LOCKACQUIRE_NOT_AVAIL)
+			{
+				entry->locked = false;
+				if (lost == NULL)
+					lost = MemoryContextAlloc(GlobalTempContext,
+											  sizeof(Oid) * hash_get_num_entries(GlobalTempRelations));
+				lost[nlost++] = relid;
+			}
+		}
+
+		if (changed)
+			RelationCacheResetStorage(relid);
+	}
+
+	for (i = 0; i < nlost; i++)
+		GlobalTempDiscardTable(lost[i]);
+	if (lost != NULL)
+		pfree(lost);
+
+	if (GlobalTempXactChanged || nlost > 0)
+		GlobalTempAdvertiseXids();
+	GlobalTempXactChanged = false;
+}
+
+/*
+ * Throw away this session's storage of a table, its indexes and its TOAST
+ * table right away, because we lost the table's session lock.  The table's
+ * entry is kept to report that when the table is next used.
+ */
+static void
+GlobalTempDiscardTable(Oid tableid)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempRelation *entry;
+	List	   *relids = NIL;
+	ListCell   *lc;
+
+	hash_seq_init(&status, GlobalTempRelations);
+	while ((entry = (GlobalTempRelation *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->tableid == tableid)
+			relids = lappend_oid(relids, entry->relid);
+	}
+
+	foreach(lc, relids)
+	{
+		Oid			relid = lfirst_oid(lc);
+
+		entry = GlobalTempRelationLookup(relid, false);
+		GlobalTempUnlinkStorage(entry->storage.rnode);
+		GlobalTempResetStorage(&entry->storage);
+		list_free_deep(entry->statistics);
+		entry->statistics = NIL;
+
+		if (relid == tableid)
+			entry->discarded = true;
+		else
+			hash_search(GlobalTempRelations, &relid, HASH_REMOVE, NULL);
+
+		RelationCacheResetStorage(relid);
+	}
+
+	list_free(relids);
+}
+
+/*
+ * AtEOSubXact_GlobalTemp
+ *		Subtransaction end processing.
+ *
+ * At commit, the states saved in the subtransaction become the parent's,
+ * unless the parent has saved older ones.  At abort, they are put back.
+ */
+void
+AtEOSubXact_GlobalTemp(bool isCommit, SubTransactionId mySubid,
+					   SubTransactionId parentSubid)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempRelation *entry;
+
+	if (GlobalTempRelations == NULL || !GlobalTempXactChanged)
+		return;
+
+	hash_seq_init(&status, GlobalTempRelations);
+	while ((entry = (GlobalTempRelation *) hash_seq_search(&status)) != NULL)
+	{
+		GlobalTempSavedState *saved;
+
+		if (entry->saved == NIL)
+			continue;
+		saved = (GlobalTempSavedState *) linitial(entry->saved);
+		if (saved->subid != mySubid)
+			continue;
+
+		if (isCommit)
+		{
+			if (list_length(entry->saved) > 1 &&
+				((GlobalTempSavedState *) lsecond(entry->saved))->subid == parentSubid)
+			{
+				entry->saved = list_delete_first(entry->saved);
+				pfree(saved);
+			}
+			else
+				saved->subid = parentSubid;
+		}
+		else
+		{
+			entry->storage = saved->storage;
+			entry->saved = list_delete_first(entry->saved);
+			pfree(saved);
+			RelationCacheResetStorage(entry->relid);
+		}
+	}
+
+	if (!isCommit)
+		GlobalTempAdvertiseXids();
+}
+
+/*
+ * Remove all our storage at backend exit.
+ *
+ * This runs after ShutdownPostgres has aborted any open transaction, so
+ * there are no saved states left to consider.
+ */
+static void
+AtProcExit_GlobalTemp(int code, Datum arg)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempRelation *entry;
+	SMgrRelation *srels;
+	int			nrels = 0;
+	int			i;
+
+	srels = palloc(sizeof(SMgrRelation) * hash_get_num_entries(GlobalTempRelations));
+
+	hash_seq_init(&status, GlobalTempRelations);
+	while ((entry = (GlobalTempRelation *) hash_seq_search(&status)) != NULL)
+	{
+		if (OidIsValid(entry->storage.rnode.relNode))
+			srels[nrels++] = smgropen(entry->storage.rnode, MyBackendId);
+	}
+
+	if (nrels > 0)
+		smgrdounlinkall(srels, nrels, false);
+	for (i = 0; i < nrels; i++)
+		smgrclose(srels[i]);
+	pfree(srels);
+
+	SpinLockAcquire(&GlobalTempShmem->mutex);
+	GlobalTempShmem->xids[MyBackendId - 1].dbid = InvalidOid;
+	SpinLockRelease(&GlobalTempShmem->mutex);
+}
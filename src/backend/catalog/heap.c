@@ -42,6 +42,7 @@
 #include "catalog/binary_upgrade.h"
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
+#include "catalog/globaltemp.h"
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/objectaccess.h"
@@ -377,6 +378,14 @@ heap_create(const char *relname,
 		relfilenode = relid;
 	}
 
+	/*
+	 * A global temporary relation's pg_class.relfilenode is only a
+	 * placeholder.  Each session creates storage of its own when it first
+	 * uses the relation; see globaltemp.c.
+	 */
+	if (relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		create_storage = false;
+
 	/*
 	 * Never allow a pg_class entry to explicitly specify the database's
 	 * default tablespace in reltablespace; force it to zero instead. This
@@ -1945,6 +1954,9 @@ heap_drop_with_catalog(Oid relid)
 	 */
 	CheckTableNotInUse(rel, "DROP TABLE");
 
+	/* Nor in other sessions, for a global temporary table */
+	CheckGlobalTempRelationNotInUse(rel, "DROP TABLE");
+
 	/*
 	 * This effectively deletes all rows in the table, and may be done in a
 	 * serializable transaction.  In that case we must record a rw-conflict in
@@ -1989,7 +2001,9 @@ heap_drop_with_catalog(Oid relid)
 	/*
 	 * Schedule unlinking of the relation's physical files at commit.
 	 */
-	if (RELKIND_HAS_STORAGE(rel->rd_rel->relkind))
+	if (RelationIsGlobalTemp(rel))
+		GlobalTempRelationDropped(rel);
+	else if (RELKIND_HAS_STORAGE(rel->rd_rel->relkind))
 		RelationDropStorage(rel);
 
 	/*
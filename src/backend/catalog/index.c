@@ -37,6 +37,7 @@
 #include "catalog/binary_upgrade.h"
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
+#include "catalog/globaltemp.h"
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/objectaccess.h"
@@ -1252,6 +1253,21 @@ index_create(Relation heapRelation,
 		/* Make the above update visible */
 		CommandCounterIncrement();
 	}
+	else if (RelationIsGlobalTemp(indexRelation))
+	{
+		/*
+		 * Each session builds a global temporary index from its own data
+		 * when it first uses it.  If this session has data already, do it
+		 * now, so that problems such as unique violations are reported by
+		 * this command.
+		 */
+		index_update_stats(heapRelation,
+						   true,
+						   -1.0);
+		CommandCounterIncrement();
+		if (OidIsValid(heapRelation->rd_node.relNode))
+			GlobalTempRelationEnsureStorage(indexRelation);
+	}
 	else
 	{
 		index_build(heapRelation, indexRelation, indexInfo, false, true);
@@ -2261,7 +2277,8 @@ index_drop(Oid indexId, bool concurrent, bool concurrent_lock_mode)
 	 * lock (see comments in RemoveRelations), and a non-concurrent DROP is
 	 * more efficient.
 	 */
-	Assert(get_rel_persistence(indexId) != RELPERSISTENCE_TEMP ||
+	Assert((get_rel_persistence(indexId) != RELPERSISTENCE_TEMP &&
+			get_rel_persistence(indexId) != RELPERSISTENCE_GLOBAL_TEMP) ||
 		   (!concurrent && !concurrent_lock_mode));
 
 	/*
@@ -2292,6 +2309,7 @@ index_drop(Oid indexId, bool concurrent, bool concurrent_lock_mode)
 	 * above locking won't prevent, so test explicitly.
 	 */
 	CheckTableNotInUse(userIndexRelation, "DROP INDEX");
+	CheckGlobalTempRelationNotInUse(userIndexRelation, "DROP INDEX");
 
 	/*
 	 * Drop Index Concurrently is more or less the reverse process of Create
@@ -2437,7 +2455,9 @@ index_drop(Oid indexId, bool concurrent, bool concurrent_lock_mode)
 	/*
 	 * Schedule physical removal of the files (if any)
 	 */
-	if (userIndexRelation->rd_rel->relkind != RELKIND_PARTITIONED_INDEX)
+	if (RelationIsGlobalTemp(userIndexRelation))
+		GlobalTempRelationDropped(userIndexRelation);
+	else if (userIndexRelation->rd_rel->relkind != RELKIND_PARTITIONED_INDEX)
 		RelationDropStorage(userIndexRelation);
 
 	/*
@@ -2902,6 +2922,30 @@ index_update_stats(Relation rel,
 	Form_pg_class rd_rel;
 	bool		dirty;
 
+	/*
+	 * The size of a global temporary relation is that of this session's
+	 * storage, which isn't recorded in pg_class.  Only relhasindex is, and
+	 * it is normally set already, so we can usually leave the catalog alone.
+	 */
+	if (RelationIsGlobalTemp(rel))
+	{
+		if (reltuples >= 0)
+		{
+			BlockNumber relallvisible;
+
+			if (rel->rd_rel->relkind != RELKIND_INDEX)
+				visibilitymap_count(rel, &relallvisible, NULL);
+			else
+				relallvisible = 0;
+			GlobalTempRelationSetStats(rel, RelationGetNumberOfBlocks(rel),
+									   reltuples, relallvisible);
+			reltuples = -1.0;
+		}
+
+		if (rel->rd_rel->relhasindex == hasindex)
+			return;
+	}
+
 	/*
 	 * We always update the pg_class row using a non-transactional,
 	 * overwrite-in-place update.  There are several reasons for this:
@@ -3069,13 +3113,13 @@ index_build(Relation heapRelation,
 	Assert(PointerIsValid(indexRelation->rd_indam->ambuildempty));
 
 	/*
-	 * Determine worker process details for parallel CREATE INDEX.  Currently,
-	 * only btree has support for parallel builds.
+	 * Determine worker process details for parallel CREATE INDEX, if the
+	 * index AM supports parallel builds.
 	 *
 	 * Note that planner considers parallel safety for us.
 	 */
 	if (parallel && IsNormalProcessingMode() &&
-		indexRelation->rd_rel->relam == BTREE_AM_OID)
+		indexRelation->rd_indam->amcanbuildparallel)
 		indexInfo->ii_ParallelWorkers =
 			plan_create_index_workers(RelationGetRelid(heapRelation),
 									  RelationGetRelid(indexRelation));
@@ -3171,10 +3215,15 @@ index_build(Relation heapRelation,
 	 * current transaction anyway.  That also means we don't need to worry
 	 * about any concurrent readers of the tuple; no other transaction can see
 	 * it yet.
+	 *
+	 * A global temporary index is built by each session separately, at any
+	 * time, so there's no pg_index update we could make for it.  Only this
+	 * session's own older snapshots could be affected.
 	 */
 	if ((indexInfo->ii_BrokenHotChain || EarlyPruningEnabled(heapRelation)) &&
 		!isreindex &&
-		!indexInfo->ii_Concurrent)
+		!indexInfo->ii_Concurrent &&
+		!RelationIsGlobalTemp(indexRelation))
 	{
 		Oid			indexId = RelationGetRelid(indexRelation);
 		Relation	pg_index;
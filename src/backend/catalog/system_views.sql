@@ -560,6 +560,18 @@ CREATE VIEW pg_backend_memory_contexts AS
 REVOKE ALL ON pg_backend_memory_contexts FROM PUBLIC;
 REVOKE EXECUTE ON FUNCTION pg_get_backend_memory_contexts() FROM PUBLIC;
 
+CREATE VIEW pg_backend_catalog_caches AS
+    SELECT * FROM pg_get_backend_catalog_caches();
+
+REVOKE ALL ON pg_backend_catalog_caches FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION pg_get_backend_catalog_caches() FROM PUBLIC;
+
+CREATE VIEW pg_backend_local_buffers AS
+    SELECT * FROM pg_get_backend_local_buffers();
+
+REVOKE ALL ON pg_backend_local_buffers FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION pg_get_backend_local_buffers() FROM PUBLIC;
+
 -- Statistics views
 
 CREATE VIEW pg_stat_all_tables AS
@@ -821,6 +833,15 @@ CREATE VIEW pg_stat_slru AS
             s.stats_reset
     FROM pg_stat_get_slru() s;
 
+CREATE VIEW pg_stat_invalidation AS
+    SELECT
+            s.pid,
+            s.queue_lag,
+            s.resets,
+            s.partial_resets,
+            s.catchup_signals
+    FROM pg_stat_get_invalidation() s;
+
 CREATE VIEW pg_stat_wal_receiver AS
     SELECT
             s.pid,
@@ -919,6 +940,8 @@ CREATE VIEW pg_stat_database AS
             pg_stat_get_db_conflict_all(D.oid) AS conflicts,
             pg_stat_get_db_temp_files(D.oid) AS temp_files,
             pg_stat_get_db_temp_bytes(D.oid) AS temp_bytes,
+            pg_stat_get_db_temp_compressed_bytes(D.oid) AS temp_compressed_bytes,
+            pg_stat_get_db_temp_uncompressed_bytes(D.oid) AS temp_uncompressed_bytes,
             pg_stat_get_db_deadlocks(D.oid) AS deadlocks,
             pg_stat_get_db_checksum_failures(D.oid) AS checksum_failures,
             pg_stat_get_db_checksum_last_failure(D.oid) AS checksum_last_failure,
@@ -28,6 +28,7 @@
 #include "access/visibilitymap.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_collation.h"
@@ -184,6 +185,16 @@ analyze_rel(Oid relid, RangeVar *relation,
 		return;
 	}
 
+	/*
+	 * Likewise ignore global temporary tables that this session has no
+	 * storage for, rather than create it just to find it empty.
+	 */
+	if (RelationLacksSessionStorage(onerel))
+	{
+		relation_close(onerel, ShareUpdateExclusiveLock);
+		return;
+	}
+
 	/*
 	 * We can ANALYZE any table except pg_statistic. See update_attstats
 	 */
@@ -589,9 +600,11 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 		 * Build extended statistics (if there are any).
 		 *
 		 * For now we only build extended statistics on individual relations,
-		 * not for relations representing inheritance trees.
+		 * not for relations representing inheritance trees.  Nor do we build
+		 * them for global temporary tables, as pg_statistic_ext_data has no
+		 * way to keep them per session.
 		 */
-		if (!inh)
+		if (!inh && !RelationIsGlobalTemp(onerel))
 			BuildRelationExtStatistics(onerel, totalrows, numrows, rows,
 									   attr_cnt, vacattrstats);
 	}
@@ -1459,10 +1472,13 @@ update_attstats(Oid relid, bool inh, int natts, VacAttrStats **vacattrstats)
 {
 	Relation	sd;
 	int			attno;
+	bool		globaltemp;
 
 	if (natts <= 0)
 		return;					/* nothing to do */
 
+	globaltemp = (get_rel_persistence(relid) == RELPERSISTENCE_GLOBAL_TEMP);
+
 	sd = table_open(StatisticRelationId, RowExclusiveLock);
 
 	for (attno = 0; attno < natts; attno++)
@@ -1557,6 +1573,19 @@ update_attstats(Oid relid, bool inh, int natts, VacAttrStats **vacattrstats)
 			}
 		}
 
+		/*
+		 * Statistics of a global temporary table describe only this session's
+		 * data, so they are kept in the session rather than in pg_statistic.
+		 */
+		if (globaltemp)
+		{
+			stup = heap_form_tuple(RelationGetDescr(sd), values, nulls);
+			GlobalTempRelationSetStatistic(relid, stats->attr->attnum, inh,
+										   stup);
+			heap_freetuple(stup);
+			continue;
+		}
+
 		/* Is there already a pg_statistic tuple for this attribute? */
 		oldtup = SearchSysCache3(STATRELATTINH,
 								 ObjectIdGetDatum(relid),
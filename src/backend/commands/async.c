@@ -24,8 +24,13 @@
  *	  All notification messages are placed in the queue and later read out
  *	  by listening backends.
  *
- *	  There is no central knowledge of which backend listens on which channel;
- *	  every backend has its own list of interesting channels.
+ *	  Every backend has its own list of interesting channels.  In addition,
+ *	  a listening backend publishes hashes of those channel names in its
+ *	  shared-memory entry (see 3. below), so that notifying backends can tell
+ *	  which listeners could possibly be interested in their notifications.
+ *	  This is only a filter: a listener whose channels don't all fit, or
+ *	  whose hash collides with a notified channel, is simply treated as
+ *	  interested.
  *
  *	  Although there is only one queue, notifications are treated as being
  *	  database-local; this is done by including the sender's database OID
@@ -44,7 +49,10 @@
  *	  database OID of the notification with its own database OID and then
  *	  compares the notified channel with the list of channels that it listens
  *	  to. In case there is a match it delivers the notification event to its
- *	  frontend.  Non-matching events are simply skipped.
+ *	  frontend.  Non-matching events are simply skipped.  The backend also
+ *	  stores hashes of its channel names in the same array entry; these are
+ *	  published before the commit of a LISTEN, and narrowed again after the
+ *	  commit or abort of an UNLISTEN or a failed LISTEN.
  *
  * 4. The NOTIFY statement (routine Async_Notify) stores the notification in
  *	  a backend-local list which will not be processed until transaction end.
@@ -62,7 +70,10 @@
  *	  page number and the offset in that page. This is done before marking the
  *	  transaction as committed in clog. If we run into problems writing the
  *	  notifications, we can still call elog(ERROR, ...) and the transaction
- *	  will roll back.
+ *	  will roll back.  Writers are serialized only while they append to the
+ *	  queue, not for the rest of their commit, so entries of a transaction
+ *	  that is still committing can precede entries of one that has already
+ *	  committed; readers stop at the former until it completes.
  *
  *	  Once we have put all of the notifications into the queue, we return to
  *	  CommitTransaction() which will then do the actual transaction commit.
@@ -73,12 +84,15 @@
  *	  Finally, after we are out of the transaction altogether, we check if
  *	  we need to signal listening backends.  In SignalBackends() we scan the
  *	  list of listening backends and send a PROCSIG_NOTIFY_INTERRUPT signal
- *	  to every listening backend (we don't know which backend is listening on
- *	  which channel so we must signal them all). We can exclude backends that
- *	  are already up to date, though, and we can also exclude backends that
- *	  are in other databases (unless they are way behind and should be kicked
- *	  to make them advance their pointers).  We don't bother with a
- *	  self-signal either, but just process the queue directly.
+ *	  to every listening backend in our database whose published channel
+ *	  hashes match one of the channels we notified.  A listener that can't
+ *	  be interested in our notifications, including any backend in another
+ *	  database, is instead moved directly past our queue entries if it had
+ *	  read everything before them, and otherwise is only signaled if it is
+ *	  way behind and should be kicked to make it advance its pointer, or if
+ *	  it is stuck behind an entry of a transaction that was still in progress
+ *	  when it last read the queue.  We don't bother with a self-signal
+ *	  either, but just process the queue directly.
  *
  * 5. Upon receipt of a PROCSIG_NOTIFY_INTERRUPT signal, the signal handler
  *	  sets the process's latch, which triggers the event to be processed
@@ -107,7 +121,7 @@
  * frontend during startup.)  The above design guarantees that notifies from
  * other backends will never be missed by ignoring self-notifies.
  *
- * The amount of shared memory used for notify management (NUM_NOTIFY_BUFFERS)
+ * The amount of shared memory used for notify management (notify_buffers)
  * can be varied without affecting anything but performance.  The maximum
  * amount of notification data that can be queued at one time is determined
  * by slru.c's wraparound limit; see QUEUE_MAX_PAGE below.
@@ -124,7 +138,6 @@
 #include "access/slru.h"
 #include "access/transam.h"
 #include "access/xact.h"
-#include "catalog/pg_database.h"
 #include "commands/async.h"
 #include "common/hashfn.h"
 #include "funcapi.h"
@@ -132,7 +145,6 @@
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "storage/ipc.h"
-#include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "storage/procsignal.h"
@@ -225,11 +237,18 @@ typedef struct QueuePosition
  *
  * Resist the temptation to make this really large.  While that would save
  * work in some places, it would add cost in others.  In particular, this
- * should likely be less than NUM_NOTIFY_BUFFERS, to ensure that backends
+ * should likely be less than notify_buffers, to ensure that backends
  * catch up before the pages they'll need to read fall out of SLRU cache.
  */
 #define QUEUE_CLEANUP_DELAY 4
 
+/*
+ * Number of channel name hashes a listening backend publishes in shared
+ * memory.  A backend listening on more distinct channels than this sets
+ * nchannels to -1, meaning it is interested in every channel.
+ */
+#define NOTIFY_LISTEN_HASHES 16
+
 /*
  * Struct describing a listening backend's status
  */
@@ -239,6 +258,9 @@ typedef struct QueueBackendStatus
 	Oid			dboid;			/* backend's database OID, or InvalidOid */
 	BackendId	nextListener;	/* id of next listener, or InvalidBackendId */
 	QueuePosition pos;			/* backend has read queue up to here */
+	bool		stalled;		/* stopped at an uncommitted entry? */
+	int			nchannels;		/* # of valid channels[] entries, or -1 */
+	uint32		channels[NOTIFY_LISTEN_HASHES]; /* hashes of channel names */
 } QueueBackendStatus;
 
 /*
@@ -253,13 +275,17 @@ typedef struct QueueBackendStatus
  * (since no other backend will inspect it).
  *
  * When holding NotifyQueueLock in EXCLUSIVE mode, backends can inspect the
- * entries of other backends and also change the head pointer. When holding
+ * entries of other backends and also change the head pointer.  A notifying
+ * backend may also advance the position of another backend over the
+ * notifier's own queue entries while holding EXCLUSIVE lock; a backend
+ * updating its own position therefore never moves it backwards. When holding
  * both NotifyQueueLock and NotifyQueueTailLock in EXCLUSIVE mode, backends
  * can change the tail pointers.
  *
- * NotifySLRULock is used as the control lock for the pg_notify SLRU buffers.
- * In order to avoid deadlocks, whenever we need multiple locks, we first get
- * NotifyQueueTailLock, then NotifyQueueLock, and lastly NotifySLRULock.
+ * The SLRU buffer area through which backends access the notification queue
+ * is protected by the SLRU bank locks of the pg_notify SLRU.  In order to
+ * avoid deadlocks, whenever we need multiple locks, we first get
+ * NotifyQueueTailLock, then NotifyQueueLock, and lastly the SLRU bank lock.
  *
  * Each backend uses the backend[] array entry with index equal to its
  * BackendId (which can range from 1 to MaxBackends).  We rely on this to make
@@ -294,6 +320,9 @@ static AsyncQueueControl *asyncQueueControl;
 #define QUEUE_BACKEND_DBOID(i)		(asyncQueueControl->backend[i].dboid)
 #define QUEUE_NEXT_LISTENER(i)		(asyncQueueControl->backend[i].nextListener)
 #define QUEUE_BACKEND_POS(i)		(asyncQueueControl->backend[i].pos)
+#define QUEUE_BACKEND_STALLED(i)	(asyncQueueControl->backend[i].stalled)
+#define QUEUE_BACKEND_NCHANNELS(i)	(asyncQueueControl->backend[i].nchannels)
+#define QUEUE_BACKEND_CHANNELS(i)	(asyncQueueControl->backend[i].channels)
 
 /*
  * The SLRU buffer area through which we access the notification queue
@@ -429,9 +458,33 @@ static bool amRegisteredListener = false;
 /* has this backend sent notifications in the current transaction? */
 static bool backendHasSentNotifications = false;
 
+/* has the current transaction started adding entries to the queue? */
+static bool queuedInXact = false;
+
 /* have we advanced to a page that's a multiple of QUEUE_CLEANUP_DELAY? */
 static bool backendTryAdvanceTail = false;
 
+/*
+ * What SignalBackends needs to know about the notifications we queued in the
+ * current transaction: the hashes of the distinct channels we notified (or
+ * numSentChannels = -1 if there were too many to remember), and the ranges of
+ * queue positions occupied by our entries.  Ranges beyond the first
+ * NOTIFY_SENT_RANGES are not remembered; that only costs some extra work.
+ */
+#define NOTIFY_SENT_CHANNELS	16
+#define NOTIFY_SENT_RANGES		4
+
+typedef struct QueueRange
+{
+	QueuePosition start;		/* position of our first entry in range */
+	QueuePosition end;			/* position just past our last entry */
+} QueueRange;
+
+static uint32 sentChannels[NOTIFY_SENT_CHANNELS];
+static int	numSentChannels = 0;
+static QueueRange sentRanges[NOTIFY_SENT_RANGES];
+static int	numSentRanges = 0;
+
 /* GUC parameter */
 bool		Trace_notify = false;
 
@@ -445,6 +498,9 @@ static void Exec_ListenCommit(const char *channel);
 static void Exec_UnlistenCommit(const char *channel);
 static void Exec_UnlistenAllCommit(void);
 static bool IsListeningOn(const char *channel);
+static int	add_channel_hash(uint32 *hashes, int nhashes, int maxhashes,
+							 const char *channel);
+static void asyncQueueSetChannels(bool includePending);
 static void asyncQueueUnregister(void);
 static bool asyncQueueIsFull(void);
 static bool asyncQueueAdvance(volatile QueuePosition *position, int entryLength);
@@ -452,7 +508,10 @@ static void asyncQueueNotificationToEntry(Notification *n, AsyncQueueEntry *qe);
 static ListCell *asyncQueueAddEntries(ListCell *nextNotify);
 static double asyncQueueUsage(void);
 static void asyncQueueFillWarning(void);
+static void asyncQueueRememberSent(QueuePosition start, QueuePosition end);
+static bool asyncQueueIsInterested(BackendId i);
 static void SignalBackends(void);
+static void SignalStalledListeners(void);
 static void asyncQueueReadAllNotifications(void);
 static bool asyncQueueProcessPageEntries(volatile QueuePosition *current,
 										 QueuePosition stop,
@@ -514,7 +573,7 @@ AsyncShmemSize(void)
 	size = mul_size(MaxBackends + 1, sizeof(QueueBackendStatus));
 	size = add_size(size, offsetof(AsyncQueueControl, backend));
 
-	size = add_size(size, SimpleLruShmemSize(NUM_NOTIFY_BUFFERS, 0));
+	size = add_size(size, SimpleLruShmemSize(notify_buffers, 0));
 
 	return size;
 }
@@ -555,6 +614,8 @@ AsyncShmemInit(void)
 			QUEUE_BACKEND_DBOID(i) = InvalidOid;
 			QUEUE_NEXT_LISTENER(i) = InvalidBackendId;
 			SET_QUEUE_POS(QUEUE_BACKEND_POS(i), 0, 0);
+			QUEUE_BACKEND_STALLED(i) = false;
+			QUEUE_BACKEND_NCHANNELS(i) = 0;
 		}
 	}
 
@@ -562,8 +623,8 @@ AsyncShmemInit(void)
 	 * Set up SLRU management of the pg_notify data.
 	 */
 	NotifyCtl->PagePrecedes = asyncQueuePagePrecedes;
-	SimpleLruInit(NotifyCtl, "Notify", NUM_NOTIFY_BUFFERS, 0,
-				  NotifySLRULock, "pg_notify", LWTRANCHE_NOTIFY_BUFFER,
+	SimpleLruInit(NotifyCtl, "Notify", notify_buffers, 0,
+				  "pg_notify", LWTRANCHE_NOTIFY_BUFFER, LWTRANCHE_NOTIFY_SLRU,
 				  SYNC_HANDLER_NONE);
 
 	if (!found)
@@ -876,7 +937,8 @@ AtPrepare_Notify(void)
  *		clog.
  *
  *		If there are pending LISTEN actions, make sure we are listed in the
- *		shared-memory listener array.  This must happen before commit to
+ *		shared-memory listener array, and that the channels are included in
+ *		our published channel hashes.  This must happen before commit to
  *		ensure we don't miss any notifies from transactions that commit
  *		just after ours.
  *
@@ -915,6 +977,14 @@ PreCommit_Notify(void)
 					break;
 			}
 		}
+
+		/*
+		 * Publish the union of the channels we listen on now and those we
+		 * are about to listen on; channels being unlistened are removed only
+		 * after commit.
+		 */
+		if (amRegisteredListener)
+			asyncQueueSetChannels(true);
 	}
 
 	/* Queue any pending notifies (must happen after the above) */
@@ -931,30 +1001,43 @@ PreCommit_Notify(void)
 		(void) GetCurrentTransactionId();
 
 		/*
-		 * Serialize writers by acquiring a special lock that we hold till
-		 * after commit.  This ensures that queue entries appear in commit
-		 * order, and in particular that there are never uncommitted queue
-		 * entries ahead of committed ones, so an uncommitted transaction
-		 * can't block delivery of deliverable notifications.
-		 *
-		 * We use a heavyweight lock so that it'll automatically be released
-		 * after either commit or abort.  This also allows deadlocks to be
-		 * detected, though really a deadlock shouldn't be possible here.
-		 *
-		 * The lock is on "database 0", which is pretty ugly but it doesn't
-		 * seem worth inventing a special locktag category just for this.
-		 * (Historical note: before PG 9.0, a similar lock on "database 0" was
-		 * used by the flatfiles mechanism.)
+		 * Remember which channels we are notifying, so that SignalBackends
+		 * can skip listeners that can't be interested in them.
 		 */
-		LockSharedObject(DatabaseRelationId, InvalidOid, 0,
-						 AccessExclusiveLock);
+		numSentChannels = 0;
+		numSentRanges = 0;
+		foreach(p, pendingNotifies->events)
+		{
+			Notification *n = (Notification *) lfirst(p);
+
+			/* the channel name is at the start of n->data */
+			numSentChannels = add_channel_hash(sentChannels, numSentChannels,
+											   NOTIFY_SENT_CHANNELS, n->data);
+			if (numSentChannels < 0)
+				break;
+		}
 
-		/* Now push the notifications into the queue */
+		/*
+		 * Now push the notifications into the queue.
+		 *
+		 * Writers are serialized only while appending, by NotifyQueueLock;
+		 * we don't hold any lock till after commit, so that notifying
+		 * transactions can commit (and flush WAL) concurrently.  Hence queue
+		 * entries don't necessarily appear in commit order, and uncommitted
+		 * entries can be ahead of committed ones.  Readers stop at the first
+		 * entry of a transaction that is still in progress, so notifications
+		 * are delivered in the order they were queued, and once we are done
+		 * we wake up any reader that was held up by our entries (see
+		 * SignalBackends).
+		 */
 		backendHasSentNotifications = true;
+		queuedInXact = true;
 
 		nextNotify = list_head(pendingNotifies->events);
 		while (nextNotify != NULL)
 		{
+			QueuePosition start;
+
 			/*
 			 * Add the pending notifications to the queue.  We acquire and
 			 * release NotifyQueueLock once per page, which might be overkill
@@ -973,7 +1056,9 @@ PreCommit_Notify(void)
 				ereport(ERROR,
 						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
 						 errmsg("too many notifications in the NOTIFY queue")));
+			start = QUEUE_HEAD;
 			nextNotify = asyncQueueAddEntries(nextNotify);
+			asyncQueueRememberSent(start, QUEUE_HEAD);
 			LWLockRelease(NotifyQueueLock);
 		}
 	}
@@ -1023,9 +1108,14 @@ AtCommit_Notify(void)
 		}
 	}
 
-	/* If no longer listening to anything, get out of listener array */
+	/*
+	 * If no longer listening to anything, get out of listener array.
+	 * Otherwise, stop advertising channels we have unlistened.
+	 */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (amRegisteredListener && pendingActions != NULL)
+		asyncQueueSetChannels(false);
 
 	/* And clean up */
 	ClearPendingActionsAndNotifies();
@@ -1098,6 +1188,8 @@ Exec_ListenPreCommit(void)
 	QUEUE_BACKEND_POS(MyBackendId) = max;
 	QUEUE_BACKEND_PID(MyBackendId) = MyProcPid;
 	QUEUE_BACKEND_DBOID(MyBackendId) = MyDatabaseId;
+	QUEUE_BACKEND_STALLED(MyBackendId) = false;
+	QUEUE_BACKEND_NCHANNELS(MyBackendId) = 0;
 	/* Insert backend into list of listeners at correct position */
 	if (prevListener > 0)
 	{
@@ -1301,6 +1393,74 @@ IsListeningOn(const char *channel)
 	return false;
 }
 
+/*
+ * Add the hash of a channel name to an array of distinct channel hashes that
+ * currently has nhashes members, and return the new count.  If that would
+ * exceed maxhashes, -1 is returned instead, meaning "any channel".  A count
+ * of -1 is passed through.
+ */
+static int
+add_channel_hash(uint32 *hashes, int nhashes, int maxhashes,
+				 const char *channel)
+{
+	uint32		hash;
+
+	if (nhashes < 0)
+		return nhashes;
+
+	hash = hash_bytes((const unsigned char *) channel, strlen(channel));
+	for (int i = 0; i < nhashes; i++)
+	{
+		if (hashes[i] == hash)
+			return nhashes;
+	}
+	if (nhashes >= maxhashes)
+		return -1;
+	hashes[nhashes] = hash;
+	return nhashes + 1;
+}
+
+/*
+ * Publish hashes of the channels we listen on in our listener array entry.
+ * If includePending, channels of pending LISTEN actions are included too.
+ *
+ * This is called after commit or abort too, so it must not fail.
+ */
+static void
+asyncQueueSetChannels(bool includePending)
+{
+	uint32		hashes[NOTIFY_LISTEN_HASHES];
+	int			nhashes = 0;
+	ListCell   *p;
+
+	Assert(amRegisteredListener);
+
+	foreach(p, listenChannels)
+		nhashes = add_channel_hash(hashes, nhashes, NOTIFY_LISTEN_HASHES,
+								   (char *) lfirst(p));
+
+	if (includePending && pendingActions != NULL)
+	{
+		foreach(p, pendingActions->actions)
+		{
+			ListenAction *actrec = (ListenAction *) lfirst(p);
+
+			if (actrec->action == LISTEN_LISTEN)
+				nhashes = add_channel_hash(hashes, nhashes,
+										   NOTIFY_LISTEN_HASHES,
+										   actrec->channel);
+		}
+	}
+
+	/* We may update our own entry while holding only shared lock */
+	LWLockAcquire(NotifyQueueLock, LW_SHARED);
+	QUEUE_BACKEND_NCHANNELS(MyBackendId) = nhashes;
+	if (nhashes > 0)
+		memcpy(QUEUE_BACKEND_CHANNELS(MyBackendId), hashes,
+			   nhashes * sizeof(uint32));
+	LWLockRelease(NotifyQueueLock);
+}
+
 /*
  * Remove our entry from the listeners array when we are no longer listening
  * on any channel.  NB: must not fail if we're already not listening.
@@ -1320,6 +1480,7 @@ asyncQueueUnregister(void)
 	/* Mark our entry as invalid */
 	QUEUE_BACKEND_PID(MyBackendId) = InvalidPid;
 	QUEUE_BACKEND_DBOID(MyBackendId) = InvalidOid;
+	QUEUE_BACKEND_NCHANNELS(MyBackendId) = 0;
 	/* and remove it from the list */
 	if (QUEUE_FIRST_LISTENER == MyBackendId)
 		QUEUE_FIRST_LISTENER = QUEUE_NEXT_LISTENER(MyBackendId);
@@ -1446,7 +1607,7 @@ asyncQueueNotificationToEntry(Notification *n, AsyncQueueEntry *qe)
  * Eventually we will return NULL indicating all is done.
  *
  * We are holding NotifyQueueLock already from the caller and grab
- * NotifySLRULock locally in this function.
+ * the page's SLRU bank lock locally in this function.
  */
 static ListCell *
 asyncQueueAddEntries(ListCell *nextNotify)
@@ -1456,9 +1617,7 @@ asyncQueueAddEntries(ListCell *nextNotify)
 	int			pageno;
 	int			offset;
 	int			slotno;
-
-	/* We hold both NotifyQueueLock and NotifySLRULock during this operation */
-	LWLockAcquire(NotifySLRULock, LW_EXCLUSIVE);
+	LWLock	   *prevlock;
 
 	/*
 	 * We work with a local copy of QUEUE_HEAD, which we write back to shared
@@ -1482,6 +1641,11 @@ asyncQueueAddEntries(ListCell *nextNotify)
 	 * wrapped around, but re-zeroing the page is harmless in that case.)
 	 */
 	pageno = QUEUE_POS_PAGE(queue_head);
+
+	/* We hold both NotifyQueueLock and SLRU bank lock during this operation */
+	prevlock = SimpleLruGetBankLock(NotifyCtl, pageno);
+	LWLockAcquire(prevlock, LW_EXCLUSIVE);
+
 	if (QUEUE_POS_IS_ZERO(queue_head))
 		slotno = SimpleLruZeroPage(NotifyCtl, pageno);
 	else
@@ -1527,6 +1691,21 @@ asyncQueueAddEntries(ListCell *nextNotify)
 		/* Advance queue_head appropriately, and detect if page is full */
 		if (asyncQueueAdvance(&(queue_head), qe.length))
 		{
+			LWLock	   *lock;
+
+			/*
+			 * The next page may belong to another SLRU bank; if so, switch
+			 * to that bank's lock.
+			 */
+			pageno = QUEUE_POS_PAGE(queue_head);
+			lock = SimpleLruGetBankLock(NotifyCtl, pageno);
+			if (lock != prevlock)
+			{
+				LWLockRelease(prevlock);
+				LWLockAcquire(lock, LW_EXCLUSIVE);
+				prevlock = lock;
+			}
+
 			/*
 			 * Page is full, so we're done here, but first fill the next page
 			 * with zeroes.  The reason to do this is to ensure that slru.c's
@@ -1535,7 +1714,7 @@ asyncQueueAddEntries(ListCell *nextNotify)
 			 * asyncQueueIsFull() ensured that there is room to create this
 			 * page without overrunning the queue.
 			 */
-			slotno = SimpleLruZeroPage(NotifyCtl, QUEUE_POS_PAGE(queue_head));
+			slotno = SimpleLruZeroPage(NotifyCtl, pageno);
 
 			/*
 			 * If the new page address is a multiple of QUEUE_CLEANUP_DELAY,
@@ -1553,7 +1732,7 @@ asyncQueueAddEntries(ListCell *nextNotify)
 	/* Success, so update the global QUEUE_HEAD */
 	QUEUE_HEAD = queue_head;
 
-	LWLockRelease(NotifySLRULock);
+	LWLockRelease(prevlock);
 
 	return nextNotify;
 }
@@ -1577,6 +1756,28 @@ pg_notification_queue_usage(PG_FUNCTION_ARGS)
 	PG_RETURN_FLOAT8(usage);
 }
 
+/*
+ * Remember that our entries occupy the queue from start to end, for the sake
+ * of SignalBackends.  A range that directly follows the previous one (no
+ * other backend appended in between) is merged into it.
+ */
+static void
+asyncQueueRememberSent(QueuePosition start, QueuePosition end)
+{
+	if (QUEUE_POS_EQUAL(start, end))
+		return;
+
+	if (numSentRanges > 0 &&
+		QUEUE_POS_EQUAL(sentRanges[numSentRanges - 1].end, start))
+		sentRanges[numSentRanges - 1].end = end;
+	else if (numSentRanges < NOTIFY_SENT_RANGES)
+	{
+		sentRanges[numSentRanges].start = start;
+		sentRanges[numSentRanges].end = end;
+		numSentRanges++;
+	}
+}
+
 /*
  * Return the fraction of the queue that is currently occupied.
  *
@@ -1655,17 +1856,53 @@ asyncQueueFillWarning(void)
 	}
 }
 
+/*
+ * Could listening backend i be interested in the notifications we sent,
+ * judging by its database and the channel hashes it has published?
+ *
+ * Caller must hold NotifyQueueLock exclusively.
+ */
+static bool
+asyncQueueIsInterested(BackendId i)
+{
+	int			nchannels = QUEUE_BACKEND_NCHANNELS(i);
+	uint32	   *channels = QUEUE_BACKEND_CHANNELS(i);
+
+	if (QUEUE_BACKEND_DBOID(i) != MyDatabaseId)
+		return false;
+	if (nchannels < 0 || numSentChannels < 0)
+		return true;
+
+	for (int j = 0; j < numSentChannels; j++)
+	{
+		for (int k = 0; k < nchannels; k++)
+		{
+			if (channels[k] == sentChannels[j])
+				return true;
+		}
+	}
+	return false;
+}
+
 /*
  * Send signals to listening backends.
  *
  * We never signal our own process; that should be handled by our caller.
  *
- * Normally we signal only backends in our own database, since only those
- * backends could be interested in notifies we send.  However, if there's
- * notify traffic in our database but no traffic in another database that
- * does have listener(s), those listeners will fall further and further
- * behind.  Waken them anyway if they're far enough behind, so that they'll
- * advance their queue position pointers, allowing the global tail to advance.
+ * Normally we signal only backends in our own database that listen on one of
+ * the channels we notified, since only those backends could be interested in
+ * notifies we send.  A listener that can't be interested and has read
+ * everything before our entries is simply moved past them, without waking it
+ * up; this is safe because our transaction has completed, so a LISTEN that
+ * this backend commits later need not see our notifications.
+ *
+ * A listener that can't be interested is still signaled if it stopped at an
+ * uncommitted entry the last time it read the queue, since it may have been
+ * held up by ours.  Also, if there's notify traffic in our database but no
+ * relevant traffic for some other listeners, those listeners may fall further
+ * and further behind.  Waken them anyway if they're far enough behind, so
+ * that they'll advance their queue position pointers, allowing the global
+ * tail to advance.
  *
  * Since we know the BackendId and the Pid the signaling is quite cheap.
  */
@@ -1699,22 +1936,47 @@ SignalBackends(void)
 		if (pid == MyProcPid)
 			continue;			/* never signal self */
 		pos = QUEUE_BACKEND_POS(i);
-		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId)
+		if (asyncQueueIsInterested(i))
 		{
 			/*
-			 * Always signal listeners in our own database, unless they're
-			 * already caught up (unlikely, but possible).
+			 * Always signal interested listeners, unless they're already
+			 * caught up (unlikely, but possible).
 			 */
 			if (QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
 				continue;
 		}
 		else
 		{
+			QueuePosition newpos = pos;
+
+			/* Move the listener past our entries, if it's right before them */
+			for (int j = 0; j < numSentRanges; j++)
+			{
+				if (QUEUE_POS_EQUAL(newpos, sentRanges[j].start))
+					newpos = sentRanges[j].end;
+			}
+
 			/*
-			 * Listeners in other databases should be signaled only if they
-			 * are far behind.
+			 * The listener might be reading the queue right now, starting at
+			 * its current position.  Don't move that position into a later
+			 * SLRU segment, else the tail could advance far enough for the
+			 * pages being read to be truncated away.
 			 */
-			if (asyncQueuePageDiff(QUEUE_POS_PAGE(QUEUE_HEAD),
+			if (QUEUE_POS_PAGE(newpos) / SLRU_PAGES_PER_SEGMENT ==
+				QUEUE_POS_PAGE(pos) / SLRU_PAGES_PER_SEGMENT)
+			{
+				pos = newpos;
+				QUEUE_BACKEND_POS(i) = pos;
+			}
+
+			/*
+			 * Other listeners should be signaled only if they might have
+			 * been held up by us, or if they are far behind.
+			 */
+			if (QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
+				continue;
+			if (!QUEUE_BACKEND_STALLED(i) &&
+				asyncQueuePageDiff(QUEUE_POS_PAGE(QUEUE_HEAD),
 								   QUEUE_POS_PAGE(pos)) < QUEUE_CLEANUP_DELAY)
 				continue;
 		}
@@ -1744,10 +2006,57 @@ SignalBackends(void)
 	pfree(ids);
 }
 
+/*
+ * Signal all listening backends that stopped reading the queue at an entry of
+ * a transaction that was in progress, because that might have been ours.
+ *
+ * This is used when our transaction aborted after adding entries to the
+ * queue.  The entries can then be skipped, but listeners held up by them
+ * would otherwise only notice that when someone else commits a NOTIFY.
+ * ProcessCompletedNotifies would signal them too, but it doesn't run if we
+ * abort while exiting.
+ */
+static void
+SignalStalledListeners(void)
+{
+	int32	   *pids;
+	BackendId  *ids;
+	int			count;
+
+	pids = (int32 *) palloc(MaxBackends * sizeof(int32));
+	ids = (BackendId *) palloc(MaxBackends * sizeof(BackendId));
+	count = 0;
+
+	LWLockAcquire(NotifyQueueLock, LW_SHARED);
+	for (BackendId i = QUEUE_FIRST_LISTENER; i > 0; i = QUEUE_NEXT_LISTENER(i))
+	{
+		int32		pid = QUEUE_BACKEND_PID(i);
+
+		Assert(pid != InvalidPid);
+		if (pid == MyProcPid || !QUEUE_BACKEND_STALLED(i))
+			continue;
+		pids[count] = pid;
+		ids[count] = i;
+		count++;
+	}
+	LWLockRelease(NotifyQueueLock);
+
+	for (int i = 0; i < count; i++)
+	{
+		/* As in SignalBackends, a failure here is harmless */
+		if (SendProcSignal(pids[i], PROCSIG_NOTIFY_INTERRUPT, ids[i]) < 0)
+			elog(DEBUG3, "could not signal backend with PID %d: %m", pids[i]);
+	}
+
+	pfree(pids);
+	pfree(ids);
+}
+
 /*
  * AtAbort_Notify
  *
- *	This is called at transaction abort.
+ *	This is called at transaction abort, after we have stopped being shown as
+ *	running in the ProcArray.
  *
  *	Gets rid of pending actions and outbound notifies that we would have
  *	executed if the transaction got committed.
@@ -1755,13 +2064,24 @@ SignalBackends(void)
 void
 AtAbort_Notify(void)
 {
+	/*
+	 * If PreCommit_Notify got as far as adding entries to the queue before we
+	 * failed, wake up the listeners that may be waiting for us to finish.
+	 * Since we're no longer running, they'll now skip our entries.
+	 */
+	if (queuedInXact)
+		SignalStalledListeners();
+
 	/*
 	 * If we LISTEN but then roll back the transaction after PreCommit_Notify,
 	 * we have registered as a listener but have not made any entry in
-	 * listenChannels.  In that case, deregister again.
+	 * listenChannels.  In that case, deregister again.  If we were already
+	 * listening, withdraw the channels published for the failed LISTENs.
 	 */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (amRegisteredListener && pendingActions != NULL)
+		asyncQueueSetChannels(false);
 
 	/* And clean up */
 	ClearPendingActionsAndNotifies();
@@ -1933,6 +2253,7 @@ asyncQueueReadAllNotifications(void)
 	volatile QueuePosition pos;
 	QueuePosition head;
 	Snapshot	snapshot;
+	volatile TransactionId stalledXid;
 
 	/* page_buffer must be adequately aligned, so use a union */
 	union
@@ -1941,6 +2262,9 @@ asyncQueueReadAllNotifications(void)
 		AsyncQueueEntry align;
 	}			page_buffer;
 
+retry:
+	stalledXid = InvalidTransactionId;
+
 	/* Fetch current state */
 	LWLockAcquire(NotifyQueueLock, LW_SHARED);
 	/* Assert checks that we have a valid state entry */
@@ -2019,7 +2343,7 @@ asyncQueueReadAllNotifications(void)
 
 			/*
 			 * We copy the data from SLRU into a local buffer, so as to avoid
-			 * holding the NotifySLRULock while we are examining the entries
+			 * holding the SLRU lock while we are examining the entries
 			 * and possibly transmitting them to our frontend.  Copy only the
 			 * part of the page we will actually inspect.
 			 */
@@ -2041,7 +2365,7 @@ asyncQueueReadAllNotifications(void)
 				   NotifyCtl->shared->page_buffer[slotno] + curoffset,
 				   copysize);
 			/* Release lock that we got from SimpleLruReadPage_ReadOnly() */
-			LWLockRelease(NotifySLRULock);
+			LWLockRelease(SimpleLruGetBankLock(NotifyCtl, curpage));
 
 			/*
 			 * Process messages up to the stop position, end of page, or an
@@ -2055,25 +2379,53 @@ asyncQueueReadAllNotifications(void)
 			 * We are not holding NotifyQueueLock here! The queue can only
 			 * extend beyond the head pointer (see above) and we leave our
 			 * backend's pointer where it is so nobody will truncate or
-			 * rewrite pages under us. Especially we don't want to hold a lock
-			 * while sending the notifications to the frontend.
+			 * rewrite pages under us.  (A notifying backend might move it
+			 * forward over its own entries, but never into another SLRU
+			 * segment.) Especially we don't want to hold a lock while
+			 * sending the notifications to the frontend.
 			 */
 			reachedStop = asyncQueueProcessPageEntries(&pos, head,
 													   page_buffer.buf,
 													   snapshot);
 		} while (!reachedStop);
+
+		/*
+		 * If we stopped short of the head, it was at an entry of a
+		 * transaction that is in progress according to our snapshot; that
+		 * entry is still in page_buffer.
+		 */
+		if (!QUEUE_POS_EQUAL(pos, head))
+			stalledXid = ((AsyncQueueEntry *)
+						  (page_buffer.buf + QUEUE_POS_OFFSET(pos)))->xid;
 	}
 	PG_FINALLY();
 	{
-		/* Update shared state */
+		QueuePosition newpos = pos;
+
+		/*
+		 * Update shared state.  A notifying backend might have moved our
+		 * position past its own entries meanwhile, so don't move it back.
+		 */
 		LWLockAcquire(NotifyQueueLock, LW_SHARED);
-		QUEUE_BACKEND_POS(MyBackendId) = pos;
+		QUEUE_BACKEND_POS(MyBackendId) =
+			QUEUE_POS_MAX(QUEUE_BACKEND_POS(MyBackendId), newpos);
+		QUEUE_BACKEND_STALLED(MyBackendId) = TransactionIdIsValid(stalledXid);
 		LWLockRelease(NotifyQueueLock);
 	}
 	PG_END_TRY();
 
 	/* Done with snapshot */
 	UnregisterSnapshot(snapshot);
+
+	/*
+	 * If we were held up by an in-progress transaction, that transaction
+	 * will signal us once it is done, because we have marked ourselves as
+	 * stalled.  But if it has already finished, it might have looked at our
+	 * entry before we did so; in that case just try again.
+	 */
+	if (TransactionIdIsValid(stalledXid) &&
+		!TransactionIdIsInProgress(stalledXid))
+		goto retry;
 }
 
 /*
@@ -2082,7 +2434,7 @@ asyncQueueReadAllNotifications(void)
  *
  * The current page must have been fetched into page_buffer from shared
  * memory.  (We could access the page right in shared memory, but that
- * would imply holding the NotifySLRULock throughout this routine.)
+ * would imply holding the SLRU bank lock throughout this routine.)
  *
  * We stop if we reach the "stop" position, or reach a notification from an
  * uncommitted transaction, or reach the end of the page.
@@ -2232,7 +2584,7 @@ asyncQueueAdvanceTail(void)
 	if (asyncQueuePagePrecedes(oldtailpage, boundary))
 	{
 		/*
-		 * SimpleLruTruncate() will ask for NotifySLRULock but will also
+		 * SimpleLruTruncate() will ask for SLRU bank locks but will also
 		 * release the lock again.
 		 */
 		SimpleLruTruncate(NotifyCtl, newtailpage);
@@ -2470,4 +2822,5 @@ ClearPendingActionsAndNotifies(void)
 	 */
 	pendingActions = NULL;
 	pendingNotifies = NULL;
+	queuedInXact = false;
 }
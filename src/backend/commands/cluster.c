@@ -390,6 +390,24 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 					 errmsg("cannot vacuum temporary tables of other sessions")));
 	}
 
+	/*
+	 * Global temporary tables can't be rewritten, since their storage isn't
+	 * described by pg_class.  A database-wide CLUSTER just skips them.
+	 */
+	if (RelationIsGlobalTemp(OldHeap))
+	{
+		if (recheck)
+		{
+			relation_close(OldHeap, AccessExclusiveLock);
+			pgstat_progress_end_command();
+			return;
+		}
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot cluster global temporary table \"%s\"",
+						RelationGetRelationName(OldHeap))));
+	}
+
 	/*
 	 * Also check for active uses of the relation in the current transaction,
 	 * including open scans and pending AFTER trigger events.
@@ -60,8 +60,10 @@
 #include "storage/smgr.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/fmgroids.h"
 #include "utils/pg_locale.h"
+#include "utils/plancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -970,6 +972,11 @@ dropdb(const char *dbname, bool missing_ok, bool force)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/* Also forget any cached relation sizes, catalog tuples and plans */
+	smgrdropdb(db_id);
+	SharedCatCacheDropDatabase(db_id);
+	SharedPlanCacheDropDatabase(db_id);
+
 	/*
 	 * Tell the stats collector to forget it immediately, too.
 	 */
@@ -1253,8 +1260,10 @@ movedb(const char *dbname, const char *tblspcname)
 	 *
 	 * Note: it'd be sufficient to get rid of buffers matching db_id and
 	 * src_tblspcoid, but bufmgr.c presently provides no API for that.
+	 * Cached relation sizes in the old location must go too.
 	 */
 	DropDatabaseBuffers(db_id);
+	smgrdropdb(db_id);
 
 	/*
 	 * Check for existence of files in the target directory, i.e., objects of
@@ -2244,6 +2253,9 @@ dbase_redo(XLogReaderState *record)
 
 		/* Drop pages for this database that are in the shared buffer cache */
 		DropDatabaseBuffers(xlrec->db_id);
+		smgrdropdb(xlrec->db_id);
+		SharedCatCacheDropDatabase(xlrec->db_id);
+		SharedPlanCacheDropDatabase(xlrec->db_id);
 
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseSyncRequests(xlrec->db_id);
@@ -14,6 +14,7 @@
 #include "postgres.h"
 
 #include "access/xact.h"
+#include "catalog/globaltemp.h"
 #include "catalog/namespace.h"
 #include "commands/async.h"
 #include "commands/discard.h"
@@ -46,6 +47,7 @@ DiscardCommand(DiscardStmt *stmt, bool isTopLevel)
 
 		case DISCARD_TEMP:
 			ResetTempTableNamespace();
+			ResetGlobalTempRelations();
 			break;
 
 		default:
@@ -74,5 +76,6 @@ DiscardAll(bool isTopLevel)
 	LockReleaseAll(USER_LOCKMETHOD, true);
 	ResetPlanCache();
 	ResetTempTableNamespace();
+	ResetGlobalTempRelations();
 	ResetSequenceCaches();
 }
@@ -26,6 +26,7 @@
 #include "nodes/nodeFuncs.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
@@ -1209,6 +1210,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_GatherMerge:
 			pname = sname = "Gather Merge";
 			break;
+		case T_Repartition:
+			pname = sname = "Repartition";
+			break;
 		case T_IndexScan:
 			pname = sname = "Index Scan";
 			break;
@@ -1964,10 +1968,21 @@ ExplainNode(PlanState *planstate, List *ancestors,
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
 			break;
+		case T_WindowAgg:
+			show_upper_qual(((WindowAgg *) plan)->runCondition,
+							"Run Condition", planstate, ancestors, es);
+			break;
 		case T_Sort:
 			show_sort_keys(castNode(SortState, planstate), ancestors, es);
 			show_sort_info(castNode(SortState, planstate), es);
 			break;
+		case T_Repartition:
+			show_sort_group_keys(planstate, "Hash Key",
+								 ((Repartition *) plan)->numCols, 0,
+								 ((Repartition *) plan)->hashColIdx,
+								 NULL, NULL, NULL,
+								 ancestors, es);
+			break;
 		case T_IncrementalSort:
 			show_incremental_sort_keys(castNode(IncrementalSortState, planstate),
 									   ancestors, es);
@@ -3405,6 +3420,16 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage, bool planning)
 			appendStringInfoChar(es->str, '\n');
 		}
 
+		/* Amount of data written to compressed temporary files, if any */
+		if (usage->temp_uncompressed_bytes > 0)
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str,
+							 "Temp Compression: uncompressed=" UINT64_FORMAT "kB compressed=" UINT64_FORMAT "kB\n",
+							 (usage->temp_uncompressed_bytes + 1023) / 1024,
+							 (usage->temp_compressed_bytes + 1023) / 1024);
+		}
+
 		/* As above, show only positive counter values. */
 		if (has_timing)
 		{
@@ -3444,6 +3469,15 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage, bool planning)
 							   usage->temp_blks_read, es);
 		ExplainPropertyInteger("Temp Written Blocks", NULL,
 							   usage->temp_blks_written, es);
+		if (temp_file_compression != TEMP_FILE_COMPRESSION_NONE)
+		{
+			ExplainPropertyInteger("Temp Uncompressed Written", "kB",
+								   (usage->temp_uncompressed_bytes + 1023) / 1024,
+								   es);
+			ExplainPropertyInteger("Temp Compressed Written", "kB",
+								   (usage->temp_compressed_bytes + 1023) / 1024,
+								   es);
+		}
 		if (track_io_timing)
 		{
 			ExplainPropertyFloat("I/O Read Time", "ms",
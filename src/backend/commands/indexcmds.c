@@ -23,6 +23,7 @@
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_am.h"
@@ -567,10 +568,13 @@ DefineIndex(Oid relationId,
 	 * Force non-concurrent build on temporary relations, even if CONCURRENTLY
 	 * was requested.  Other backends can't access a temporary relation, so
 	 * there's no harm in grabbing a stronger lock, and a non-concurrent DROP
-	 * is more efficient.  Do this before any use of the concurrent option is
-	 * done.
+	 * is more efficient.  The same goes for global temporary relations, which
+	 * we insist no other backend is using.  Do this before any use of the
+	 * concurrent option is done.
 	 */
-	if (stmt->concurrent && get_rel_persistence(relationId) != RELPERSISTENCE_TEMP)
+	if (stmt->concurrent &&
+		get_rel_persistence(relationId) != RELPERSISTENCE_TEMP &&
+		get_rel_persistence(relationId) != RELPERSISTENCE_GLOBAL_TEMP)
 		concurrent = true;
 	else
 		concurrent = false;
@@ -715,6 +719,14 @@ DefineIndex(Oid relationId,
 	if (check_not_in_use)
 		CheckTableNotInUse(rel, "CREATE INDEX");
 
+	/*
+	 * Likewise, the storage other sessions have for a global temporary table
+	 * would not get entries in the new index, so insist that no one else be
+	 * using the table.
+	 */
+	if (RelationIsGlobalTemp(rel))
+		CheckGlobalTempRelationNotInUse(rel, "CREATE INDEX");
+
 	/*
 	 * Verify we (still) have CREATE rights in the rel's namespace.
 	 * (Presumably we did when the rel was created, but maybe not anymore.)
@@ -2608,7 +2620,8 @@ ReindexIndex(RangeVar *indexRelation, ReindexParams *params, bool isTopLevel)
 	if (relkind == RELKIND_PARTITIONED_INDEX)
 		ReindexPartitions(indOid, params, isTopLevel);
 	else if ((params->options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			 persistence != RELPERSISTENCE_TEMP)
+			 persistence != RELPERSISTENCE_TEMP &&
+			 persistence != RELPERSISTENCE_GLOBAL_TEMP)
 		ReindexRelationConcurrently(indOid, params);
 	else
 	{
@@ -2717,7 +2730,8 @@ ReindexTable(RangeVar *relation, ReindexParams *params, bool isTopLevel)
 	if (get_rel_relkind(heapOid) == RELKIND_PARTITIONED_TABLE)
 		ReindexPartitions(heapOid, params, isTopLevel);
 	else if ((params->options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			 get_rel_persistence(heapOid) != RELPERSISTENCE_TEMP)
+			 get_rel_persistence(heapOid) != RELPERSISTENCE_TEMP &&
+			 get_rel_persistence(heapOid) != RELPERSISTENCE_GLOBAL_TEMP)
 	{
 		result = ReindexRelationConcurrently(heapOid, params);
 
@@ -2861,6 +2875,11 @@ ReindexMultipleTables(const char *objectName, ReindexObjectType objectKind,
 			!isTempNamespace(classtuple->relnamespace))
 			continue;
 
+		/* Likewise global temp tables we have no storage for */
+		if (classtuple->relpersistence == RELPERSISTENCE_GLOBAL_TEMP &&
+			!OidIsValid(GlobalTempRelationGetFilenode(relid)))
+			continue;
+
 		/* Check user/system classification, and optionally skip */
 		if (objectKind == REINDEX_OBJECT_SYSTEM &&
 			!IsSystemClass(relid, classtuple))
@@ -3132,7 +3151,8 @@ ReindexMultipleInternal(List *relids, ReindexParams *params)
 			   relkind != RELKIND_PARTITIONED_TABLE);
 
 		if ((params->options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			relpersistence != RELPERSISTENCE_TEMP)
+			relpersistence != RELPERSISTENCE_TEMP &&
+			relpersistence != RELPERSISTENCE_GLOBAL_TEMP)
 		{
 			ReindexParams newparams = *params;
 
@@ -3551,7 +3571,7 @@ ReindexRelationConcurrently(Oid relationOid, ReindexParams *params)
 		idx->amId = indexRel->rd_rel->relam;
 
 		/* This function shouldn't be called for temporary relations. */
-		if (indexRel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		if (RelationUsesLocalBuffers(indexRel))
 			elog(ERROR, "cannot reindex a temporary table concurrently");
 
 		pgstat_progress_start_command(PROGRESS_COMMAND_CREATE_INDEX,
@@ -45,7 +45,7 @@
 #include "utils/syscache.h"
 #include "utils/varlena.h"
 
-/* Same as MAXNUMMESSAGES in sinvaladt.c */
+/* Smallest allowed invalidation_queue_size, see sinvaladt.c */
 #define MAX_RELCACHE_INVAL_MSGS 4096
 
 static List *OpenTableList(List *tables);
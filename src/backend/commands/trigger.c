@@ -49,6 +49,7 @@
 #include "pgstat.h"
 #include "rewrite/rewriteManip.h"
 #include "storage/bufmgr.h"
+#include "storage/buffile.h"
 #include "storage/lmgr.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
@@ -66,6 +67,7 @@
 
 /* GUC variables */
 int			SessionReplicationRole = SESSION_REPLICATION_ROLE_ORIGIN;
+int			trigger_queue_work_mem = 65536;
 
 /* How many levels deep into trigger execution are we? */
 static int	MyTriggerDepth = 0;
@@ -3222,8 +3224,9 @@ TriggerEnabled(EState *estate, ResultRelInfo *relinfo,
  * records are grouped into chunks and common data for similar events in the
  * same chunk is only stored once.
  *
- * XXX We need to be able to save the per-event data in a file if it grows too
- * large.
+ * Even so, a single statement modifying hundreds of millions of rows of a
+ * table with foreign keys queues as many events, so the chunks can also be
+ * written out to a temporary file, see "Spilling event chunks" below.
  * ----------
  */
 
@@ -3354,35 +3357,80 @@ typedef struct AfterTriggerEventDataZeroCtids
 /*
  * To avoid palloc overhead, we keep trigger events in arrays in successively-
  * larger chunks (a slightly more sophisticated version of an expansible
- * array).  The space between CHUNK_DATA_START and freeptr is occupied by
- * AfterTriggerEventData records; the space between endfree and endptr is
- * occupied by AfterTriggerSharedData records.
+ * array).  The data area of a chunk is allocated separately from the chunk
+ * itself, so that it can be released when the chunk is spilled to disk.  The
+ * space between the start of the data area and freeoff is occupied by
+ * AfterTriggerEventData records; the space between endfree and size is
+ * occupied by AfterTriggerSharedData records.  All three are offsets into
+ * the data area, so that they stay valid when the data area is read back
+ * into a different place.
+ *
+ * Spilling event chunks
+ *
+ * Once the data areas of all chunks take more than trigger_queue_work_mem,
+ * chunks that are not in use are written out to a temporary file shared by
+ * all event lists of the transaction, and their data areas are freed.  A
+ * spilled chunk is read back while its events are being scanned, and spilled
+ * again once the scan moves on to the next chunk.  To keep track of that,
+ * code that needs the data area of a chunk pins it, see for_each_chunk.
+ * Pinned chunks, as well as the tail chunk of each list that new events are
+ * appended to, are never spilled.  (If an error escapes from a scan, the
+ * chunk it had pinned merely stays in memory.)
+ *
+ * The copy of a chunk on disk uses a more compact encoding than the data
+ * area, see afterTriggerEncodeChunk.  It is kept when the chunk is read
+ * back, so that spilling it again does not need to write anything unless
+ * the events were modified in the meantime.  Truncating the list at
+ * subtransaction abort keeps a prefix of the events of a chunk, and so does
+ * not invalidate the disk copy either.
  */
 typedef struct AfterTriggerEventChunk
 {
 	struct AfterTriggerEventChunk *next;	/* list link */
-	char	   *freeptr;		/* start of free space in chunk */
-	char	   *endfree;		/* end of free space in chunk */
-	char	   *endptr;			/* end of chunk */
-	/* event data follows here */
+	char	   *data;			/* data area, or NULL if spilled */
+	Size		size;			/* size of data area */
+	Size		freeoff;		/* start of free space in chunk */
+	Size		endfree;		/* end of free space in chunk */
+	int			pincount;		/* number of scans using data area */
+	bool		istail;			/* is it the tail chunk of its list? */
+	bool		dirty;			/* modified since written to disk? */
+	long		spill_block;	/* start of disk copy, or -1 if none */
+	long		spill_nblocks;	/* number of blocks reserved for it */
+	Size		spill_evbytes;	/* size of encoded events in disk copy */
 } AfterTriggerEventChunk;
 
-#define CHUNK_DATA_START(cptr) ((char *) (cptr) + MAXALIGN(sizeof(AfterTriggerEventChunk)))
+#define CHUNK_DATA_START(cptr) ((cptr)->data)
+#define CHUNK_FREEPTR(cptr) ((cptr)->data + (cptr)->freeoff)
+#define CHUNK_ENDFREE(cptr) ((cptr)->data + (cptr)->endfree)
+#define CHUNK_ENDPTR(cptr) ((cptr)->data + (cptr)->size)
+
+/* A range of free blocks in the spill file */
+typedef struct AfterTriggerSpillRange
+{
+	long		block;			/* first block of range */
+	long		nblocks;		/* number of blocks in range */
+} AfterTriggerSpillRange;
 
 /* A list of events */
 typedef struct AfterTriggerEventList
 {
 	AfterTriggerEventChunk *head;
 	AfterTriggerEventChunk *tail;
-	char	   *tailfree;		/* freeptr of tail chunk */
+	Size		tailfree;		/* freeoff of tail chunk */
 } AfterTriggerEventList;
 
-/* Macros to help in iterating over a list of events */
+/*
+ * Macros to help in iterating over a list of events.  for_each_chunk pins
+ * each chunk while it is being visited, so code that leaves the loop early
+ * must unpin the current chunk.
+ */
 #define for_each_chunk(cptr, evtlist) \
-	for (cptr = (evtlist).head; cptr != NULL; cptr = cptr->next)
+	for (cptr = afterTriggerPinChunk((evtlist).head); \
+		 cptr != NULL; \
+		 cptr = afterTriggerNextChunk(cptr))
 #define for_each_event(eptr, cptr) \
 	for (eptr = (AfterTriggerEvent) CHUNK_DATA_START(cptr); \
-		 (char *) eptr < (cptr)->freeptr; \
+		 (char *) eptr < CHUNK_FREEPTR(cptr); \
 		 eptr = (AfterTriggerEvent) (((char *) eptr) + SizeofTriggerEvent(eptr)))
 /* Use this if no special per-chunk processing is needed */
 #define for_each_event_chunk(eptr, cptr, evtlist) \
@@ -3390,10 +3438,12 @@ typedef struct AfterTriggerEventList
 
 /* Macros for iterating from a start point that might not be list start */
 #define for_each_chunk_from(cptr) \
-	for (; cptr != NULL; cptr = cptr->next)
+	for (cptr = afterTriggerPinChunk(cptr); \
+		 cptr != NULL; \
+		 cptr = afterTriggerNextChunk(cptr))
 #define for_each_event_from(eptr, cptr) \
 	for (; \
-		 (char *) eptr < (cptr)->freeptr; \
+		 (char *) eptr < CHUNK_FREEPTR(cptr); \
 		 eptr = (AfterTriggerEvent) (((char *) eptr) + SizeofTriggerEvent(eptr)))
 
 
@@ -3417,6 +3467,14 @@ typedef struct AfterTriggerEventList
  * end of the list, so it is relatively easy to discard them.  The event
  * list chunks themselves are stored in event_cxt.
  *
+ * resident_size is the total size of the data areas of the event chunks of
+ * all event lists that are currently in memory.  Once it exceeds
+ * trigger_queue_work_mem, chunks are spilled to spill_file.  spill_nblocks is
+ * the size of that file in blocks, and spill_freelist is a List of
+ * AfterTriggerSpillRanges that were released by freed or rewritten chunks.
+ * spill_buffer is the workspace for encoding and decoding chunks.  All of
+ * these live in event_cxt, too.
+ *
  * query_depth is the current depth of nested AfterTriggerBeginQuery calls
  * (-1 when the stack is empty).
  *
@@ -3483,6 +3541,13 @@ typedef struct AfterTriggersData
 	AfterTriggerEventList events;	/* deferred-event list */
 	MemoryContext event_cxt;	/* memory context for events, if any */
 
+	/* spilling of event chunks: */
+	Size		resident_size;	/* total size of chunk data areas in memory */
+	BufFile    *spill_file;		/* file holding spilled chunks, or NULL */
+	long		spill_nblocks;	/* number of blocks in spill_file */
+	List	   *spill_freelist;	/* free ranges of blocks in spill_file */
+	char	   *spill_buffer;	/* workspace for encoding chunks */
+
 	/* per-query-level data: */
 	AfterTriggersQueryData *query_stack;	/* array of structs shown below */
 	int			query_depth;	/* current index in above array */
@@ -3544,6 +3609,12 @@ static SetConstraintState SetConstraintStateCopy(SetConstraintState state);
 static SetConstraintState SetConstraintStateAddItem(SetConstraintState state,
 													Oid tgoid, bool tgisdeferred);
 static void cancel_prior_stmt_triggers(Oid relid, CmdType cmdType, int tgevent);
+static AfterTriggerEventChunk *afterTriggerPinChunk(AfterTriggerEventChunk *chunk);
+static void afterTriggerUnpinChunk(AfterTriggerEventChunk *chunk);
+static AfterTriggerEventChunk *afterTriggerNextChunk(AfterTriggerEventChunk *chunk);
+static void afterTriggerFreeChunk(AfterTriggerEventChunk *chunk);
+static void afterTriggerSpillChunk(AfterTriggerEventChunk *chunk);
+static void afterTriggerLoadChunk(AfterTriggerEventChunk *chunk);
 
 
 /*
@@ -3625,6 +3696,15 @@ afterTriggerCheckState(AfterTriggerShared evtshared)
 }
 
 
+/*
+ * Do event chunks in memory take more space than trigger_queue_work_mem?
+ */
+static inline bool
+afterTriggerMustSpill(void)
+{
+	return afterTriggers.resident_size > (Size) trigger_queue_work_mem * 1024;
+}
+
 /* ----------
  * afterTriggerAddEvent()
  *
@@ -3648,7 +3728,7 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 	 */
 	chunk = events->tail;
 	if (chunk == NULL ||
-		chunk->endfree - chunk->freeptr < needed)
+		chunk->endfree - chunk->freeoff < needed)
 	{
 		Size		chunksize;
 
@@ -3686,35 +3766,62 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 		else
 		{
 			/* preceding chunk size... */
-			chunksize = chunk->endptr - (char *) chunk;
+			chunksize = chunk->size;
 			/* check number of shared records in preceding chunk */
-			if ((chunk->endptr - chunk->endfree) <=
+			if ((chunk->size - chunk->endfree) <=
 				(100 * sizeof(AfterTriggerSharedData)))
 				chunksize *= 2; /* okay, double it */
 			else
 				chunksize /= 2; /* too many shared records */
 			chunksize = Min(chunksize, MAX_CHUNK_SIZE);
 		}
-		chunk = MemoryContextAlloc(afterTriggers.event_cxt, chunksize);
+		chunk = MemoryContextAlloc(afterTriggers.event_cxt,
+								   sizeof(AfterTriggerEventChunk));
 		chunk->next = NULL;
-		chunk->freeptr = CHUNK_DATA_START(chunk);
-		chunk->endptr = chunk->endfree = (char *) chunk + chunksize;
-		Assert(chunk->endfree - chunk->freeptr >= needed);
+		chunk->data = MemoryContextAlloc(afterTriggers.event_cxt, chunksize);
+		chunk->size = chunksize;
+		chunk->freeoff = 0;
+		chunk->endfree = chunksize;
+		chunk->pincount = 0;
+		chunk->istail = true;
+		chunk->dirty = false;
+		chunk->spill_block = -1;
+		chunk->spill_nblocks = 0;
+		chunk->spill_evbytes = 0;
+		Assert(chunk->endfree - chunk->freeoff >= needed);
+		afterTriggers.resident_size += chunksize;
 
 		if (events->head == NULL)
 			events->head = chunk;
 		else
-			events->tail->next = chunk;
+		{
+			AfterTriggerEventChunk *oldtail = events->tail;
+
+			oldtail->next = chunk;
+			oldtail->istail = false;
+
+			/* Nothing more will be added to it, so spill it if need be */
+			if (oldtail->pincount == 0 && afterTriggerMustSpill())
+				afterTriggerSpillChunk(oldtail);
+		}
 		events->tail = chunk;
 		/* events->tailfree is now out of sync, but we'll fix it below */
 	}
+	else if (chunk->data == NULL)
+	{
+		/*
+		 * The tail chunk was spilled before a subtransaction abort made it
+		 * the tail chunk again.  Read it back to add to it.
+		 */
+		afterTriggerLoadChunk(chunk);
+	}
 
 	/*
 	 * Try to locate a matching shared-data record already in the chunk. If
 	 * none, make a new one.
 	 */
-	for (newshared = ((AfterTriggerShared) chunk->endptr) - 1;
-		 (char *) newshared >= chunk->endfree;
+	for (newshared = ((AfterTriggerShared) CHUNK_ENDPTR(chunk)) - 1;
+		 (char *) newshared >= CHUNK_ENDFREE(chunk);
 		 newshared--)
 	{
 		if (newshared->ats_tgoid == evtshared->ats_tgoid &&
@@ -3724,22 +3831,23 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 			newshared->ats_firing_id == 0)
 			break;
 	}
-	if ((char *) newshared < chunk->endfree)
+	if ((char *) newshared < CHUNK_ENDFREE(chunk))
 	{
 		*newshared = *evtshared;
 		newshared->ats_firing_id = 0;	/* just to be sure */
-		chunk->endfree = (char *) newshared;
+		chunk->endfree = (char *) newshared - CHUNK_DATA_START(chunk);
 	}
 
 	/* Insert the data */
-	newevent = (AfterTriggerEvent) chunk->freeptr;
+	newevent = (AfterTriggerEvent) CHUNK_FREEPTR(chunk);
 	memcpy(newevent, event, eventsize);
 	/* ... and link the new event to its shared record */
 	newevent->ate_flags &= ~AFTER_TRIGGER_OFFSET;
 	newevent->ate_flags |= (char *) newshared - (char *) newevent;
 
-	chunk->freeptr += eventsize;
-	events->tailfree = chunk->freeptr;
+	chunk->freeoff += eventsize;
+	chunk->dirty = true;
+	events->tailfree = chunk->freeoff;
 }
 
 /* ----------
@@ -3756,10 +3864,10 @@ afterTriggerFreeEventList(AfterTriggerEventList *events)
 	while ((chunk = events->head) != NULL)
 	{
 		events->head = chunk->next;
-		pfree(chunk);
+		afterTriggerFreeChunk(chunk);
 	}
 	events->tail = NULL;
-	events->tailfree = NULL;
+	events->tailfree = 0;
 }
 
 /* ----------
@@ -3788,15 +3896,17 @@ afterTriggerRestoreEventList(AfterTriggerEventList *events,
 		for (chunk = events->tail->next; chunk != NULL; chunk = next_chunk)
 		{
 			next_chunk = chunk->next;
-			pfree(chunk);
+			afterTriggerFreeChunk(chunk);
 		}
 		/* and clean up the tail chunk to be the right length */
 		events->tail->next = NULL;
-		events->tail->freeptr = events->tailfree;
+		events->tail->freeoff = events->tailfree;
+		events->tail->istail = true;
 
 		/*
 		 * We don't make any effort to remove now-unused shared data records.
-		 * They might still be useful, anyway.
+		 * They might still be useful, anyway.  If the tail chunk is spilled,
+		 * it is left on disk until an event is added to it.
 		 */
 	}
 }
@@ -3831,13 +3941,448 @@ afterTriggerDeleteHeadEventChunk(AfterTriggersQueryData *qs)
 		{
 			table->after_trig_events.head = NULL;
 			table->after_trig_events.tail = NULL;
-			table->after_trig_events.tailfree = NULL;
+			table->after_trig_events.tailfree = 0;
 		}
 	}
 
 	/* Now we can flush the head chunk */
 	qs->events.head = target->next;
-	pfree(target);
+	afterTriggerFreeChunk(target);
+}
+
+/* ----------
+ * afterTriggerPinChunk()
+ *
+ *	Make sure that the data area of an event chunk is in memory, and keep it
+ *	there until afterTriggerUnpinChunk is called.  For convenience, the chunk
+ *	is returned, and NULL is accepted.
+ * ----------
+ */
+static AfterTriggerEventChunk *
+afterTriggerPinChunk(AfterTriggerEventChunk *chunk)
+{
+	if (chunk != NULL)
+	{
+		if (chunk->data == NULL)
+			afterTriggerLoadChunk(chunk);
+		chunk->pincount++;
+	}
+	return chunk;
+}
+
+/* ----------
+ * afterTriggerUnpinChunk()
+ *
+ *	Release a pin on an event chunk, spilling it to disk if it is no longer
+ *	in use and we are short of memory.
+ * ----------
+ */
+static void
+afterTriggerUnpinChunk(AfterTriggerEventChunk *chunk)
+{
+	Assert(chunk->pincount > 0);
+	chunk->pincount--;
+
+	if (chunk->pincount == 0 && !chunk->istail && afterTriggerMustSpill())
+		afterTriggerSpillChunk(chunk);
+}
+
+/* ----------
+ * afterTriggerNextChunk()
+ *
+ *	Advance a scan from one event chunk to the next one in the list, moving
+ *	the pin along with it.
+ * ----------
+ */
+static AfterTriggerEventChunk *
+afterTriggerNextChunk(AfterTriggerEventChunk *chunk)
+{
+	AfterTriggerEventChunk *next = chunk->next;
+
+	afterTriggerUnpinChunk(chunk);
+	return afterTriggerPinChunk(next);
+}
+
+/* ----------
+ * afterTriggerReleaseSpillSpace()
+ *
+ *	Put the blocks of the spill file holding the disk copy of an event chunk
+ *	on the free list.
+ * ----------
+ */
+static void
+afterTriggerReleaseSpillSpace(AfterTriggerEventChunk *chunk)
+{
+	MemoryContext oldcxt = MemoryContextSwitchTo(afterTriggers.event_cxt);
+	AfterTriggerSpillRange *range = palloc(sizeof(AfterTriggerSpillRange));
+
+	range->block = chunk->spill_block;
+	range->nblocks = chunk->spill_nblocks;
+	afterTriggers.spill_freelist = lappend(afterTriggers.spill_freelist, range);
+	MemoryContextSwitchTo(oldcxt);
+
+	chunk->spill_block = -1;
+	chunk->spill_nblocks = 0;
+}
+
+/* ----------
+ * afterTriggerFreeChunk()
+ *
+ *	Free an event chunk that has been removed from its list, along with its
+ *	data area and its space in the spill file.
+ * ----------
+ */
+static void
+afterTriggerFreeChunk(AfterTriggerEventChunk *chunk)
+{
+	if (chunk->data != NULL)
+	{
+		pfree(chunk->data);
+		afterTriggers.resident_size -= chunk->size;
+	}
+
+	if (chunk->spill_block >= 0)
+		afterTriggerReleaseSpillSpace(chunk);
+
+	pfree(chunk);
+}
+
+/*
+ * Helpers for the varint encoding used by afterTriggerEncodeChunk: seven
+ * bits per byte, least significant first, with the high bit set in all but
+ * the last byte.
+ */
+static inline char *
+afterTriggerEncodeVarint(char *ptr, uint64 val)
+{
+	while (val >= 0x80)
+	{
+		*ptr++ = (char) ((val & 0x7F) | 0x80);
+		val >>= 7;
+	}
+	*ptr++ = (char) val;
+
+	return ptr;
+}
+
+static inline char *
+afterTriggerDecodeVarint(char *ptr, uint64 *val)
+{
+	uint64		result = 0;
+	int			shift = 0;
+	uint8		byte;
+
+	do
+	{
+		byte = (uint8) *ptr++;
+		result |= (uint64) (byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	*val = result;
+	return ptr;
+}
+
+/*
+ * Encode a ctid relative to the previous value of the same ctid field.  The
+ * difference of the block numbers is zigzag-encoded, so that small negative
+ * differences get a short encoding, too.
+ */
+static char *
+afterTriggerEncodeCtid(char *ptr, ItemPointer ctid, ItemPointer prev)
+{
+	int64		delta;
+	uint64		zigzag;
+
+	delta = (int64) ItemPointerGetBlockNumberNoCheck(ctid) -
+		(int64) ItemPointerGetBlockNumberNoCheck(prev);
+	if (delta >= 0)
+		zigzag = (uint64) delta << 1;
+	else
+		zigzag = ((uint64) (-(delta + 1)) << 1) | 1;
+
+	ptr = afterTriggerEncodeVarint(ptr, zigzag);
+	ptr = afterTriggerEncodeVarint(ptr, ItemPointerGetOffsetNumberNoCheck(ctid));
+	ItemPointerCopy(ctid, prev);
+
+	return ptr;
+}
+
+static char *
+afterTriggerDecodeCtid(char *ptr, ItemPointer ctid, ItemPointer prev)
+{
+	uint64		zigzag;
+	uint64		offnum;
+	int64		delta;
+
+	ptr = afterTriggerDecodeVarint(ptr, &zigzag);
+	ptr = afterTriggerDecodeVarint(ptr, &offnum);
+	if (zigzag & 1)
+		delta = -(int64) (zigzag >> 1) - 1;
+	else
+		delta = (int64) (zigzag >> 1);
+
+	ItemPointerSet(ctid,
+				   (BlockNumber) ((int64) ItemPointerGetBlockNumberNoCheck(prev) + delta),
+				   (OffsetNumber) offnum);
+	ItemPointerCopy(ctid, prev);
+
+	return ptr;
+}
+
+/* Shared record numbers up to this are stored in the first byte of an event */
+#define SPILL_SHARED_ESCAPE		0x0F
+
+/* ----------
+ * afterTriggerEncodeChunk()
+ *
+ *	Encode the data area of an event chunk into spill_buffer, and return the
+ *	length of the result.  *evbytes is set to the length of the encoded
+ *	events, which are followed by the shared records of the chunk as is.
+ *
+ *	The first byte of an event holds its status and tuple bits, and the
+ *	number of its shared record counting from the end of the chunk, or
+ *	SPILL_SHARED_ESCAPE followed by a varint if that doesn't fit.  The ctids
+ *	follow, each encoded relative to the same ctid field of the preceding
+ *	event.  As rows are mostly modified in physical order, that takes three
+ *	bytes for a typical insert event instead of twelve.  The length of the
+ *	encoding doesn't depend on the status bits, so a chunk that was read
+ *	back and had events fired can be written back in place.
+ * ----------
+ */
+static Size
+afterTriggerEncodeChunk(AfterTriggerEventChunk *chunk, Size *evbytes)
+{
+	char	   *ptr = afterTriggers.spill_buffer;
+	AfterTriggerEvent event;
+	ItemPointerData prev1;
+	ItemPointerData prev2;
+
+	ItemPointerSet(&prev1, 0, 0);
+	ItemPointerSet(&prev2, 0, 0);
+
+	for_each_event(event, chunk)
+	{
+		TriggerFlags flags = event->ate_flags;
+		Size		sharedoff;
+		uint64		sharedno;
+
+		sharedoff = (char *) GetTriggerSharedData(event) - CHUNK_DATA_START(chunk);
+		sharedno = (chunk->size - sharedoff) / sizeof(AfterTriggerSharedData) - 1;
+
+		*ptr++ = (char) (((flags & ~AFTER_TRIGGER_OFFSET) >> 24) |
+						 Min(sharedno, SPILL_SHARED_ESCAPE));
+		if (sharedno >= SPILL_SHARED_ESCAPE)
+			ptr = afterTriggerEncodeVarint(ptr, sharedno - SPILL_SHARED_ESCAPE);
+
+		switch (flags & AFTER_TRIGGER_TUP_BITS)
+		{
+			case AFTER_TRIGGER_2CTID:
+				ptr = afterTriggerEncodeCtid(ptr, &event->ate_ctid1, &prev1);
+				ptr = afterTriggerEncodeCtid(ptr, &event->ate_ctid2, &prev2);
+				break;
+			case AFTER_TRIGGER_1CTID:
+				ptr = afterTriggerEncodeCtid(ptr, &event->ate_ctid1, &prev1);
+				break;
+			default:
+				break;
+		}
+	}
+	*evbytes = ptr - afterTriggers.spill_buffer;
+
+	memcpy(ptr, CHUNK_ENDFREE(chunk), chunk->size - chunk->endfree);
+	ptr += chunk->size - chunk->endfree;
+
+	return ptr - afterTriggers.spill_buffer;
+}
+
+/* ----------
+ * afterTriggerDecodeChunk()
+ *
+ *	Rebuild the data area of an event chunk from its encoded form.
+ * ----------
+ */
+static void
+afterTriggerDecodeChunk(AfterTriggerEventChunk *chunk, char *buf)
+{
+	char	   *ptr = buf;
+	Size		off = 0;
+	ItemPointerData prev1;
+	ItemPointerData prev2;
+
+	ItemPointerSet(&prev1, 0, 0);
+	ItemPointerSet(&prev2, 0, 0);
+
+	/*
+	 * The disk copy can contain more events than the chunk, if the list was
+	 * truncated at subtransaction abort since it was written; so stop at
+	 * freeoff rather than at the end of the encoded events.
+	 */
+	while (off < chunk->freeoff)
+	{
+		AfterTriggerEvent event = (AfterTriggerEvent) (CHUNK_DATA_START(chunk) + off);
+		uint8		byte = (uint8) *ptr++;
+		uint64		sharedno = byte & SPILL_SHARED_ESCAPE;
+		Size		sharedoff;
+
+		if (sharedno == SPILL_SHARED_ESCAPE)
+		{
+			ptr = afterTriggerDecodeVarint(ptr, &sharedno);
+			sharedno += SPILL_SHARED_ESCAPE;
+		}
+		sharedoff = chunk->size - (sharedno + 1) * sizeof(AfterTriggerSharedData);
+		event->ate_flags = ((TriggerFlags) (byte & 0xF0) << 24) |
+			(TriggerFlags) (sharedoff - off);
+
+		switch (event->ate_flags & AFTER_TRIGGER_TUP_BITS)
+		{
+			case AFTER_TRIGGER_2CTID:
+				ptr = afterTriggerDecodeCtid(ptr, &event->ate_ctid1, &prev1);
+				ptr = afterTriggerDecodeCtid(ptr, &event->ate_ctid2, &prev2);
+				break;
+			case AFTER_TRIGGER_1CTID:
+				ptr = afterTriggerDecodeCtid(ptr, &event->ate_ctid1, &prev1);
+				break;
+			default:
+				break;
+		}
+
+		off += SizeofTriggerEvent(event);
+	}
+	Assert(off == chunk->freeoff);
+	Assert(ptr <= buf + chunk->spill_evbytes);
+
+	memcpy(CHUNK_ENDFREE(chunk), buf + chunk->spill_evbytes,
+		   chunk->size - chunk->endfree);
+}
+
+/* ----------
+ * afterTriggerSpillChunk()
+ *
+ *	Write an event chunk out to the spill file, unless an up-to-date copy is
+ *	there already, and free its data area.
+ * ----------
+ */
+static void
+afterTriggerSpillChunk(AfterTriggerEventChunk *chunk)
+{
+	Assert(chunk->data != NULL);
+	Assert(chunk->pincount == 0 && !chunk->istail);
+
+	if (chunk->spill_block < 0 || chunk->dirty)
+	{
+		Size		len;
+		Size		evbytes;
+		long		nblocks;
+
+		/*
+		 * Open the spill file if this is the first chunk to be spilled.  Like
+		 * the events, it has to survive until the end of the transaction.
+		 */
+		if (afterTriggers.spill_file == NULL)
+		{
+			MemoryContext oldcxt;
+			ResourceOwner saveResourceOwner;
+
+			oldcxt = MemoryContextSwitchTo(afterTriggers.event_cxt);
+			saveResourceOwner = CurrentResourceOwner;
+			CurrentResourceOwner = TopTransactionResourceOwner;
+
+			/* the encoding of a chunk is at most 5/4 of its size */
+			if (afterTriggers.spill_buffer == NULL)
+				afterTriggers.spill_buffer = palloc(2 * MAX_CHUNK_SIZE);
+			afterTriggers.spill_file = BufFileCreateCompressTemp(false);
+
+			CurrentResourceOwner = saveResourceOwner;
+			MemoryContextSwitchTo(oldcxt);
+		}
+
+		len = afterTriggerEncodeChunk(chunk, &evbytes);
+		nblocks = (len + BLCKSZ - 1) / BLCKSZ;
+
+		/* Find a place for it, unless the old copy can be overwritten */
+		if (chunk->spill_block >= 0 && chunk->spill_nblocks < nblocks)
+			afterTriggerReleaseSpillSpace(chunk);
+		if (chunk->spill_block < 0)
+		{
+			ListCell   *lc;
+
+			/* first fit from the free list, else extend the file */
+			foreach(lc, afterTriggers.spill_freelist)
+			{
+				AfterTriggerSpillRange *range = lfirst(lc);
+
+				if (range->nblocks >= nblocks)
+				{
+					chunk->spill_block = range->block;
+					range->block += nblocks;
+					range->nblocks -= nblocks;
+					if (range->nblocks == 0)
+					{
+						afterTriggers.spill_freelist =
+							foreach_delete_current(afterTriggers.spill_freelist, lc);
+						pfree(range);
+					}
+					break;
+				}
+			}
+			if (chunk->spill_block < 0)
+			{
+				chunk->spill_block = afterTriggers.spill_nblocks;
+				afterTriggers.spill_nblocks += nblocks;
+			}
+			chunk->spill_nblocks = nblocks;
+		}
+
+		/* Write whole blocks, so that the file never has holes */
+		memset(afterTriggers.spill_buffer + len, 0, nblocks * BLCKSZ - len);
+		if (BufFileSeekBlock(afterTriggers.spill_file, chunk->spill_block) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %ld of temporary file",
+							chunk->spill_block)));
+		BufFileWrite(afterTriggers.spill_file, afterTriggers.spill_buffer,
+					 nblocks * BLCKSZ);
+		chunk->spill_evbytes = evbytes;
+	}
+
+	pfree(chunk->data);
+	chunk->data = NULL;
+	chunk->dirty = false;
+	afterTriggers.resident_size -= chunk->size;
+}
+
+/* ----------
+ * afterTriggerLoadChunk()
+ *
+ *	Read a spilled event chunk back into memory.  The copy on disk is kept.
+ * ----------
+ */
+static void
+afterTriggerLoadChunk(AfterTriggerEventChunk *chunk)
+{
+	Size		len = chunk->spill_evbytes + (chunk->size - chunk->endfree);
+	size_t		nread;
+
+	Assert(chunk->data == NULL && chunk->spill_block >= 0);
+
+	if (BufFileSeekBlock(afterTriggers.spill_file, chunk->spill_block) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek to block %ld of temporary file",
+						chunk->spill_block)));
+	nread = BufFileRead(afterTriggers.spill_file, afterTriggers.spill_buffer,
+						len);
+	if (nread != len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read block %ld of temporary file: read only %zu of %zu bytes",
+						chunk->spill_block, nread, len)));
+
+	chunk->data = MemoryContextAlloc(afterTriggers.event_cxt, chunk->size);
+	afterTriggerDecodeChunk(chunk, afterTriggers.spill_buffer);
+	chunk->dirty = false;
+	afterTriggers.resident_size += chunk->size;
 }
 
 
@@ -4023,6 +4568,13 @@ AfterTriggerExecute(EState *estate,
 
 	MemoryContextReset(per_tuple_context);
 
+	/*
+	 * The FK check triggers only queue their checks.  Get those done before
+	 * calling any other kind of trigger, which could depend on them.
+	 */
+	if (RI_FKey_trigger_type(LocTriggerData.tg_trigger->tgfoid) != RI_TRIGGER_FK)
+		RI_FlushPendingChecks();
+
 	/*
 	 * Call the trigger and throw away any possibly returned updated tuple.
 	 * (Don't let ExecCallTriggerFunc measure EXPLAIN time.)
@@ -4110,6 +4662,7 @@ afterTriggerMarkEvents(AfterTriggerEventList *events,
 				 */
 				evtshared->ats_firing_id = afterTriggers.firing_counter;
 				event->ate_flags |= AFTER_TRIGGER_IN_PROGRESS;
+				chunk->dirty = true;
 				found = true;
 			}
 		}
@@ -4124,6 +4677,7 @@ afterTriggerMarkEvents(AfterTriggerEventList *events,
 			afterTriggerAddEvent(move_list, event, evtshared);
 			/* mark original copy "done" so we don't do it again */
 			event->ate_flags |= AFTER_TRIGGER_DONE;
+			chunk->dirty = true;
 		}
 	}
 
@@ -4249,6 +4803,7 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 				 */
 				event->ate_flags &= ~AFTER_TRIGGER_IN_PROGRESS;
 				event->ate_flags |= AFTER_TRIGGER_DONE;
+				chunk->dirty = true;
 			}
 			else if (!(event->ate_flags & AFTER_TRIGGER_DONE))
 			{
@@ -4260,8 +4815,9 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 		/* Clear the chunk if delete_ok and nothing left of interest */
 		if (delete_ok && all_fired_in_chunk)
 		{
-			chunk->freeptr = CHUNK_DATA_START(chunk);
-			chunk->endfree = chunk->endptr;
+			chunk->freeoff = 0;
+			chunk->endfree = chunk->size;
+			chunk->dirty = true;
 
 			/*
 			 * If it's last chunk, must sync event list's tailfree too.  Note
@@ -4270,7 +4826,7 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 			 * list, since we'd fail to fix their copies of tailfree.
 			 */
 			if (chunk == events->tail)
-				events->tailfree = chunk->freeptr;
+				events->tailfree = chunk->freeoff;
 		}
 	}
 	if (slot1 != NULL)
@@ -4279,6 +4835,9 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 		ExecDropSingleTupleTableSlot(slot2);
 	}
 
+	/* Perform any FK checks queued by the triggers we fired */
+	RI_FlushPendingChecks();
+
 	/* Release working resources */
 	MemoryContextDelete(per_tuple_context);
 
@@ -4498,6 +5057,7 @@ AfterTriggerBeginXact(void)
 	Assert(afterTriggers.maxquerydepth == 0);
 	Assert(afterTriggers.event_cxt == NULL);
 	Assert(afterTriggers.events.head == NULL);
+	Assert(afterTriggers.spill_file == NULL);
 	Assert(afterTriggers.trans_stack == NULL);
 	Assert(afterTriggers.maxtransdepth == 0);
 }
@@ -4747,11 +5307,22 @@ AfterTriggerEndXact(bool isCommit)
 	 */
 	if (afterTriggers.event_cxt)
 	{
+		BufFile    *spill_file = afterTriggers.spill_file;
+
+		/* The spill file lives in event_cxt, so close it first */
+		afterTriggers.spill_file = NULL;
+		if (spill_file)
+			BufFileClose(spill_file);
+
 		MemoryContextDelete(afterTriggers.event_cxt);
 		afterTriggers.event_cxt = NULL;
 		afterTriggers.events.head = NULL;
 		afterTriggers.events.tail = NULL;
-		afterTriggers.events.tailfree = NULL;
+		afterTriggers.events.tailfree = 0;
+		afterTriggers.resident_size = 0;
+		afterTriggers.spill_nblocks = 0;
+		afterTriggers.spill_freelist = NIL;
+		afterTriggers.spill_buffer = NULL;
 	}
 
 	/*
@@ -4762,6 +5333,9 @@ AfterTriggerEndXact(bool isCommit)
 	afterTriggers.trans_stack = NULL;
 	afterTriggers.maxtransdepth = 0;
 
+	/* Forget any FK checks that didn't get performed because of an error */
+	RI_DiscardPendingChecks();
+
 
 	/*
 	 * Forget the query stack and constraint-related state information.  As
@@ -4863,6 +5437,9 @@ AfterTriggerEndSubXact(bool isCommit)
 		if (my_level >= afterTriggers.maxtransdepth)
 			return;
 
+		/* Forget any FK checks queued before the error */
+		RI_DiscardPendingChecks();
+
 		/*
 		 * Release query-level storage for queries being aborted, and restore
 		 * query_depth to its pre-subxact value.  This assumes that a
@@ -4915,8 +5492,11 @@ AfterTriggerEndSubXact(bool isCommit)
 				(AFTER_TRIGGER_DONE | AFTER_TRIGGER_IN_PROGRESS))
 			{
 				if (evtshared->ats_firing_id >= subxact_firing_id)
+				{
 					event->ate_flags &=
 						~(AFTER_TRIGGER_DONE | AFTER_TRIGGER_IN_PROGRESS);
+					chunk->dirty = true;
+				}
 			}
 		}
 	}
@@ -4967,7 +5547,7 @@ AfterTriggerEnlargeQueryState(void)
 
 		qs->events.head = NULL;
 		qs->events.tail = NULL;
-		qs->events.tailfree = NULL;
+		qs->events.tailfree = 0;
 		qs->fdw_tuplestore = NULL;
 		qs->tables = NIL;
 
@@ -5389,7 +5969,10 @@ AfterTriggerPendingOnRel(Oid relid)
 			continue;
 
 		if (evtshared->ats_relid == relid)
+		{
+			afterTriggerUnpinChunk(chunk);
 			return true;
+		}
 	}
 
 	/*
@@ -5407,7 +5990,10 @@ AfterTriggerPendingOnRel(Oid relid)
 				continue;
 
 			if (evtshared->ats_relid == relid)
+			{
+				afterTriggerUnpinChunk(chunk);
 				return true;
+			}
 		}
 	}
 
@@ -5827,22 +6413,22 @@ cancel_prior_stmt_triggers(Oid relid, CmdType cmdType, int tgevent)
 		 */
 		AfterTriggerEvent event;
 		AfterTriggerEventChunk *chunk;
+		Size		startoff;
 
 		if (table->after_trig_events.tail)
 		{
 			chunk = table->after_trig_events.tail;
-			event = (AfterTriggerEvent) table->after_trig_events.tailfree;
+			startoff = table->after_trig_events.tailfree;
 		}
 		else
 		{
 			chunk = qs->events.head;
-			event = NULL;
+			startoff = 0;
 		}
 
 		for_each_chunk_from(chunk)
 		{
-			if (event == NULL)
-				event = (AfterTriggerEvent) CHUNK_DATA_START(chunk);
+			event = (AfterTriggerEvent) (CHUNK_DATA_START(chunk) + startoff);
 			for_each_event_from(event, chunk)
 			{
 				AfterTriggerShared evtshared = GetTriggerSharedData(event);
@@ -5851,20 +6437,21 @@ cancel_prior_stmt_triggers(Oid relid, CmdType cmdType, int tgevent)
 				 * Exit loop when we reach events that aren't AS triggers for
 				 * the target relation.
 				 */
-				if (evtshared->ats_relid != relid)
-					goto done;
-				if ((evtshared->ats_event & TRIGGER_EVENT_OPMASK) != tgevent)
-					goto done;
-				if (!TRIGGER_FIRED_FOR_STATEMENT(evtshared->ats_event))
-					goto done;
-				if (!TRIGGER_FIRED_AFTER(evtshared->ats_event))
+				if (evtshared->ats_relid != relid ||
+					(evtshared->ats_event & TRIGGER_EVENT_OPMASK) != tgevent ||
+					!TRIGGER_FIRED_FOR_STATEMENT(evtshared->ats_event) ||
+					!TRIGGER_FIRED_AFTER(evtshared->ats_event))
+				{
+					afterTriggerUnpinChunk(chunk);
 					goto done;
+				}
 				/* OK, mark it DONE */
 				event->ate_flags &= ~AFTER_TRIGGER_IN_PROGRESS;
 				event->ate_flags |= AFTER_TRIGGER_DONE;
+				chunk->dirty = true;
 			}
-			/* signal we must reinitialize event ptr for next chunk */
-			event = NULL;
+			/* the next chunk must be scanned from its start */
+			startoff = 0;
 		}
 	}
 done:
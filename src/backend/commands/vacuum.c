@@ -31,6 +31,7 @@
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
+#include "catalog/globaltemp.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_inherits.h"
@@ -896,6 +897,14 @@ get_all_vacuum_rels(int options)
 			classForm->relkind != RELKIND_PARTITIONED_TABLE)
 			continue;
 
+		/*
+		 * Skip global temporary tables this session has no storage for,
+		 * rather than create it just to process it.
+		 */
+		if (classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP &&
+			!OidIsValid(GlobalTempRelationGetFilenode(relid)))
+			continue;
+
 		/*
 		 * Build VacuumRelation(s) specifying the table OIDs to be processed.
 		 * We omit a RangeVar since it wouldn't be appropriate to complain
@@ -1239,11 +1248,26 @@ vac_update_relstats(Relation relation,
 					bool in_outer_xact)
 {
 	Oid			relid = RelationGetRelid(relation);
+	bool		globaltemp = RelationIsGlobalTemp(relation);
 	Relation	rd;
 	HeapTuple	ctup;
 	Form_pg_class pgcform;
 	bool		dirty;
 
+	/*
+	 * For a global temporary table, everything but the DDL flags describes
+	 * only this session's storage, and is kept in the session instead of
+	 * pg_class.
+	 */
+	if (globaltemp)
+	{
+		GlobalTempRelationSetStats(relation, num_pages, num_tuples,
+								   num_all_visible_pages);
+		GlobalTempRelationSetXids(relation, frozenxid, minmulti);
+		if (in_outer_xact)
+			return;
+	}
+
 	rd = table_open(RelationRelationId, RowExclusiveLock);
 
 	/* Fetch a copy of the tuple to scribble on */
@@ -1256,20 +1280,23 @@ vac_update_relstats(Relation relation,
 	/* Apply statistical updates, if any, to copied tuple */
 
 	dirty = false;
-	if (pgcform->relpages != (int32) num_pages)
-	{
-		pgcform->relpages = (int32) num_pages;
-		dirty = true;
-	}
-	if (pgcform->reltuples != (float4) num_tuples)
+	if (!globaltemp)
 	{
-		pgcform->reltuples = (float4) num_tuples;
-		dirty = true;
-	}
-	if (pgcform->relallvisible != (int32) num_all_visible_pages)
-	{
-		pgcform->relallvisible = (int32) num_all_visible_pages;
-		dirty = true;
+		if (pgcform->relpages != (int32) num_pages)
+		{
+			pgcform->relpages = (int32) num_pages;
+			dirty = true;
+		}
+		if (pgcform->reltuples != (float4) num_tuples)
+		{
+			pgcform->reltuples = (float4) num_tuples;
+			dirty = true;
+		}
+		if (pgcform->relallvisible != (int32) num_all_visible_pages)
+		{
+			pgcform->relallvisible = (int32) num_all_visible_pages;
+			dirty = true;
+		}
 	}
 
 	/* Apply DDL updates, but not inside an outer transaction (see above) */
@@ -1311,7 +1338,8 @@ vac_update_relstats(Relation relation,
 	 * This should match vac_update_datfrozenxid() concerning what we consider
 	 * to be "in the future".
 	 */
-	if (TransactionIdIsNormal(frozenxid) &&
+	if (!globaltemp &&
+		TransactionIdIsNormal(frozenxid) &&
 		pgcform->relfrozenxid != frozenxid &&
 		(TransactionIdPrecedes(pgcform->relfrozenxid, frozenxid) ||
 		 TransactionIdPrecedes(ReadNextTransactionId(),
@@ -1322,7 +1350,8 @@ vac_update_relstats(Relation relation,
 	}
 
 	/* Similarly for relminmxid */
-	if (MultiXactIdIsValid(minmulti) &&
+	if (!globaltemp &&
+		MultiXactIdIsValid(minmulti) &&
 		pgcform->relminmxid != minmulti &&
 		(MultiXactIdPrecedes(pgcform->relminmxid, minmulti) ||
 		 MultiXactIdPrecedes(ReadNextMultiXactId(), pgcform->relminmxid)))
@@ -1484,6 +1513,13 @@ vac_update_datfrozenxid(void)
 	if (bogus)
 		return;
 
+	/*
+	 * The horizons of global temporary tables are kept by the sessions using
+	 * them rather than in pg_class.  Any storage created after this point
+	 * starts out no older than the initial values computed above.
+	 */
+	GetOldestGlobalTempXids(&newFrozenXid, &newMinMulti);
+
 	Assert(TransactionIdIsNormal(newFrozenXid));
 	Assert(MultiXactIdIsValid(newMinMulti));
 
@@ -1853,6 +1889,18 @@ vacuum_rel(Oid relid, RangeVar *relation, VacuumParams *params)
 		return false;
 	}
 
+	/*
+	 * Likewise ignore global temporary tables that this session has no
+	 * storage for, rather than create it just to find it empty.
+	 */
+	if (RelationLacksSessionStorage(onerel))
+	{
+		relation_close(onerel, lmode);
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		return false;
+	}
+
 	/*
 	 * Silently ignore partitioned tables as there is no work to be done.  The
 	 * useful work is on their child partitions, which have been queued up for
@@ -1867,6 +1915,21 @@ vacuum_rel(Oid relid, RangeVar *relation, VacuumParams *params)
 		return true;
 	}
 
+	/*
+	 * VACUUM FULL can't rewrite a global temporary table, whose storage is
+	 * not described by its pg_class entry.
+	 */
+	if ((params->options & VACOPT_FULL) != 0 && RelationIsGlobalTemp(onerel))
+	{
+		ereport(WARNING,
+				(errmsg("skipping \"%s\" --- cannot vacuum global temporary tables with FULL",
+						RelationGetRelationName(onerel))));
+		relation_close(onerel, lmode);
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		return false;
+	}
+
 	/*
 	 * Get a session-level lock too. This will protect our access to the
 	 * relation across multiple transactions, so that we can vacuum the
@@ -43,6 +43,7 @@
 #include "executor/nodeNestloop.h"
 #include "executor/nodeProjectSet.h"
 #include "executor/nodeRecursiveunion.h"
+#include "executor/nodeRepartition.h"
 #include "executor/nodeResult.h"
 #include "executor/nodeSamplescan.h"
 #include "executor/nodeSeqscan.h"
@@ -178,6 +179,10 @@ ExecReScan(PlanState *node)
 			ExecReScanGatherMerge((GatherMergeState *) node);
 			break;
 
+		case T_RepartitionState:
+			ExecReScanRepartition((RepartitionState *) node);
+			break;
+
 		case T_IndexScanState:
 			ExecReScanIndexScan((IndexScanState *) node);
 			break;
@@ -35,6 +35,7 @@
 #include "executor/nodeIncrementalSort.h"
 #include "executor/nodeIndexonlyscan.h"
 #include "executor/nodeIndexscan.h"
+#include "executor/nodeRepartition.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeSort.h"
 #include "executor/nodeSubplan.h"
@@ -66,7 +67,12 @@
 #define PARALLEL_KEY_JIT_INSTRUMENTATION UINT64CONST(0xE000000000000009)
 #define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xE00000000000000A)
 
-#define PARALLEL_TUPLE_QUEUE_SIZE		65536
+/*
+ * Size of the tuple queue of each worker.  This is large enough that workers
+ * producing tuples quickly can run well ahead of the leader, and that the
+ * deferred wakeups of shm_mq (a quarter of the ring) cover many batches.
+ */
+#define PARALLEL_TUPLE_QUEUE_SIZE		262144
 
 /*
  * Fixed-size random stuff that we need to pass to parallel workers.
@@ -276,6 +282,11 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecHashJoinEstimate((HashJoinState *) planstate,
 									 e->pcxt);
 			break;
+		case T_RepartitionState:
+			if (planstate->plan->parallel_aware)
+				ExecRepartitionEstimate((RepartitionState *) planstate,
+										e->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashEstimate((HashState *) planstate, e->pcxt);
@@ -496,6 +507,11 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecHashJoinInitializeDSM((HashJoinState *) planstate,
 										  d->pcxt);
 			break;
+		case T_RepartitionState:
+			if (planstate->plan->parallel_aware)
+				ExecRepartitionInitializeDSM((RepartitionState *) planstate,
+											 d->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeDSM((HashState *) planstate, d->pcxt);
@@ -985,6 +1001,11 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecHashJoinReInitializeDSM((HashJoinState *) planstate,
 											pcxt);
 			break;
+		case T_RepartitionState:
+			if (planstate->plan->parallel_aware)
+				ExecRepartitionReInitializeDSM((RepartitionState *) planstate,
+											   pcxt);
+			break;
 		case T_HashState:
 		case T_SortState:
 		case T_IncrementalSortState:
@@ -1332,6 +1353,11 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 				ExecHashJoinInitializeWorker((HashJoinState *) planstate,
 											 pwcxt);
 			break;
+		case T_RepartitionState:
+			if (planstate->plan->parallel_aware)
+				ExecRepartitionInitializeWorker((RepartitionState *) planstate,
+												pwcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeWorker((HashState *) planstate, pwcxt);
@@ -101,6 +101,7 @@
 #include "executor/nodeNestloop.h"
 #include "executor/nodeProjectSet.h"
 #include "executor/nodeRecursiveunion.h"
+#include "executor/nodeRepartition.h"
 #include "executor/nodeResult.h"
 #include "executor/nodeSamplescan.h"
 #include "executor/nodeSeqscan.h"
@@ -355,6 +356,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 													   estate, eflags);
 			break;
 
+		case T_Repartition:
+			result = (PlanState *) ExecInitRepartition((Repartition *) node,
+													   estate, eflags);
+			break;
+
 		case T_Hash:
 			result = (PlanState *) ExecInitHash((Hash *) node,
 												estate, eflags);
@@ -623,6 +629,10 @@ ExecEndNode(PlanState *node)
 			ExecEndGatherMerge((GatherMergeState *) node);
 			break;
 
+		case T_RepartitionState:
+			ExecEndRepartition((RepartitionState *) node);
+			break;
+
 		case T_IndexScanState:
 			ExecEndIndexScan((IndexScanState *) node);
 			break;
@@ -42,7 +42,6 @@
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
-#include "utils/syscache.h"
 
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
@@ -2216,6 +2215,7 @@ static void
 ExecHashBuildSkewHash(HashJoinTable hashtable, Hash *node, int mcvsToUse)
 {
 	HeapTupleData *statsTuple;
+	void		(*freefunc) (HeapTuple tuple);
 	AttStatsSlot sslot;
 
 	/* Do nothing if planner didn't identify the outer relation's join key */
@@ -2228,10 +2228,8 @@ ExecHashBuildSkewHash(HashJoinTable hashtable, Hash *node, int mcvsToUse)
 	/*
 	 * Try to find the MCV statistics for the outer relation's join key.
 	 */
-	statsTuple = SearchSysCache3(STATRELATTINH,
-								 ObjectIdGetDatum(node->skewTable),
-								 Int16GetDatum(node->skewColumn),
-								 BoolGetDatum(node->skewInherit));
+	statsTuple = get_attstatstuple(node->skewTable, node->skewColumn,
+								   node->skewInherit, &freefunc);
 	if (!HeapTupleIsValid(statsTuple))
 		return;
 
@@ -2258,7 +2256,7 @@ ExecHashBuildSkewHash(HashJoinTable hashtable, Hash *node, int mcvsToUse)
 		if (frac < SKEW_MIN_OUTER_FRACTION)
 		{
 			free_attstatsslot(&sslot);
-			ReleaseSysCache(statsTuple);
+			freefunc(statsTuple);
 			return;
 		}
 
@@ -2355,7 +2353,7 @@ ExecHashBuildSkewHash(HashJoinTable hashtable, Hash *node, int mcvsToUse)
 		free_attstatsslot(&sslot);
 	}
 
-	ReleaseSysCache(statsTuple);
+	freefunc(statsTuple);
 }
 
 /*
@@ -0,0 +1,487 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeRepartition.c
+ *	  Routines to redistribute rows among the processes of a parallel query
+ *
+ * A parallel-aware subplan below a Gather node returns an arbitrary subset of
+ * its rows in each participating process.  Some operations, such as window
+ * functions with a PARTITION BY clause, need to see all the rows with equal
+ * key values in the same process, though.  A Repartition node provides that
+ * by redistributing the rows:
+ *
+ * 1. Every participant reads its share of the subplan's output, and writes
+ *	  each row into one of a fixed number of shared batches, chosen by
+ *	  hashing the key columns.  The batches are SharedTuplestores, the same
+ *	  mechanism Parallel Hash Join uses for its batch files.
+ *
+ * 2. Once all participants have finished, each participant repeatedly claims
+ *	  a batch that nobody else has claimed yet and returns all of its rows.
+ *
+ * Since there are several batches per participant and they are handed out
+ * on demand, the work is spread fairly evenly even if the participants run
+ * at different speeds or some of the planned workers never start.  A
+ * process that attaches only after the spooling phase has finished simply
+ * skips ahead to claiming batches; the participants that did run have
+ * consumed the whole partial subplan between them by then.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeRepartition.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecRepartition			- return the rows of the batches we claim
+ *		ExecInitRepartition		- initialize node and subnodes
+ *		ExecEndRepartition		- shutdown node and subnodes
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "executor/nodeRepartition.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
+#include "storage/sharedfileset.h"
+#include "utils/memutils.h"
+#include "utils/sharedtuplestore.h"
+
+/* Number of batches we create for each planned participant */
+#define REPARTITION_BATCHES_PER_PARTICIPANT 4
+
+/* Phases of ParallelRepartitionState's barrier */
+#define REPARTITION_PHASE_SPOOLING		0
+#define REPARTITION_PHASE_READING		1
+
+/*
+ * Shared state for a Repartition node, stored in the DSM segment under the
+ * plan node ID.  It is followed by the nbatch SharedTuplestores.
+ */
+typedef struct ParallelRepartitionState
+{
+	int			nbatch;			/* number of batches */
+	int			nparticipants;	/* planned number of participants */
+	pg_atomic_uint32 next_batch;	/* next batch to be claimed */
+	Barrier		barrier;		/* for waiting until spooling is done */
+	SharedFileSet fileset;		/* space for the batch files */
+	char		batches[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRepartitionState;
+
+#define RepartitionStsSize(nparticipants) \
+	MAXALIGN(sts_estimate(nparticipants))
+
+#define RepartitionGetSts(shared, batchno) \
+	((SharedTuplestore *) ((shared)->batches + \
+						   RepartitionStsSize((shared)->nparticipants) * (batchno)))
+
+static uint32 repartition_hash(RepartitionState *node, TupleTableSlot *slot);
+static void repartition_spool(RepartitionState *node);
+static Size repartition_shared_size(int nparticipants);
+static void repartition_initialize_batches(RepartitionState *node,
+										   ParallelRepartitionState *shared);
+
+/* ----------------------------------------------------------------
+ *		ExecRepartition
+ *
+ *		On the first call, spool our share of the subplan's output into the
+ *		shared batches and wait for the other participants to do the same.
+ *		Then return the rows of every batch we manage to claim.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecRepartition(PlanState *pstate)
+{
+	RepartitionState *node = castNode(RepartitionState, pstate);
+	ParallelRepartitionState *shared = node->parallel_state;
+	TupleTableSlot *slot = node->ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/*
+	 * Without shared state, we are the only process running the subplan, so
+	 * we'll see all the rows anyway.
+	 */
+	if (shared == NULL)
+		return ExecProcNode(outerPlanState(node));
+
+	if (!node->spooled)
+	{
+		if (BarrierAttach(&shared->barrier) == REPARTITION_PHASE_SPOOLING)
+		{
+			repartition_spool(node);
+			BarrierArriveAndWait(&shared->barrier,
+								 WAIT_EVENT_REPARTITION_SPOOL);
+		}
+		Assert(BarrierPhase(&shared->barrier) == REPARTITION_PHASE_READING);
+
+		/* Nothing else waits on the barrier, so we can leave right away */
+		BarrierDetach(&shared->barrier);
+		node->spooled = true;
+	}
+
+	for (;;)
+	{
+		uint32		batchno;
+
+		if (node->cur_batch >= 0)
+		{
+			SharedTuplestoreAccessor *accessor = node->batches[node->cur_batch];
+			MinimalTuple tuple;
+
+			tuple = sts_parallel_scan_next(accessor, NULL);
+			if (tuple != NULL)
+				return ExecStoreMinimalTuple(tuple, slot, false);
+
+			/* This batch is exhausted */
+			sts_end_parallel_scan(accessor);
+			node->cur_batch = -1;
+		}
+
+		/* Claim another batch, if there are any left */
+		batchno = pg_atomic_fetch_add_u32(&shared->next_batch, 1);
+		if (batchno >= shared->nbatch)
+			return ExecClearTuple(slot);
+
+		node->cur_batch = batchno;
+		sts_begin_parallel_scan(node->batches[batchno]);
+	}
+}
+
+/*
+ * Compute the hash value of the key columns of the given tuple.
+ *
+ * This combines the per-column hash values the same way execGrouping.c
+ * does.
+ */
+static uint32
+repartition_hash(RepartitionState *node, TupleTableSlot *slot)
+{
+	Repartition *plan = (Repartition *) node->ps.plan;
+	uint32		hashkey = 0;
+	int			i;
+
+	for (i = 0; i < plan->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, plan->hashColIdx[i], &isNull);
+
+		/* treat nulls as having hash key 0 */
+		if (!isNull)
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&node->hashfunctions[i],
+													plan->hashCollations[i],
+													attr));
+			hashkey ^= hkey;
+		}
+	}
+
+	return murmurhash32(hashkey);
+}
+
+/*
+ * Read our share of the subplan's output, and write each row into the batch
+ * its hash value selects.
+ */
+static void
+repartition_spool(RepartitionState *node)
+{
+	ParallelRepartitionState *shared = node->parallel_state;
+	PlanState  *outerNode = outerPlanState(node);
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	int			i;
+
+	for (;;)
+	{
+		TupleTableSlot *slot;
+		MemoryContext oldcontext;
+		MinimalTuple tuple;
+		bool		shouldFree;
+		uint32		hashvalue;
+
+		slot = ExecProcNode(outerNode);
+		if (TupIsNull(slot))
+			break;
+
+		/* hash functions might leak, so use the per-tuple context */
+		ResetExprContext(econtext);
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+		hashvalue = repartition_hash(node, slot);
+		MemoryContextSwitchTo(oldcontext);
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		sts_puttuple(node->batches[hashvalue % shared->nbatch], NULL, tuple);
+		if (shouldFree)
+			heap_free_minimal_tuple(tuple);
+	}
+
+	/* Make our rows visible to the other participants */
+	for (i = 0; i < shared->nbatch; i++)
+		sts_end_write(node->batches[i]);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitRepartition
+ * ----------------------------------------------------------------
+ */
+RepartitionState *
+ExecInitRepartition(Repartition *node, EState *estate, int eflags)
+{
+	RepartitionState *rpstate;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	rpstate = makeNode(RepartitionState);
+	rpstate->ps.plan = (Plan *) node;
+	rpstate->ps.state = estate;
+	rpstate->ps.ExecProcNode = ExecRepartition;
+
+	rpstate->parallel_state = NULL;
+	rpstate->batches = NULL;
+	rpstate->spooled = false;
+	rpstate->cur_batch = -1;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We need an expression context only for its per-tuple memory, which we
+	 * evaluate the hash functions in.
+	 */
+	ExecAssignExprContext(estate, &rpstate->ps);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlanState(rpstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * Initialize result type and slot.  No need to initialize projection info
+	 * because this node doesn't do projections.
+	 */
+	ExecInitResultTupleSlotTL(&rpstate->ps, &TTSOpsMinimalTuple);
+	rpstate->ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Look up the hash functions for the key columns.
+	 */
+	if (node->numCols > 0)
+	{
+		Oid		   *eqFuncOids;
+
+		execTuplesHashPrepare(node->numCols, node->hashOperators,
+							  &eqFuncOids, &rpstate->hashfunctions);
+	}
+
+	return rpstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndRepartition
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndRepartition(RepartitionState *node)
+{
+	/* Close the batch we were reading, if any */
+	if (node->cur_batch >= 0)
+	{
+		sts_end_parallel_scan(node->batches[node->cur_batch]);
+		node->cur_batch = -1;
+	}
+
+	ExecFreeExprContext(&node->ps);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanRepartition
+ *
+ *		The shared batches are reset by ExecRepartitionReInitializeDSM, which
+ *		runs after this whenever a Gather above us is rescanned.
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanRepartition(RepartitionState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+	if (node->cur_batch >= 0)
+	{
+		sts_end_parallel_scan(node->batches[node->cur_batch]);
+		node->cur_batch = -1;
+	}
+	node->spooled = false;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Query Support
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Size of the shared state, including the batches, for the given number of
+ * participants.
+ */
+static Size
+repartition_shared_size(int nparticipants)
+{
+	int			nbatch = REPARTITION_BATCHES_PER_PARTICIPANT * nparticipants;
+
+	return add_size(offsetof(ParallelRepartitionState, batches),
+					mul_size(RepartitionStsSize(nparticipants), nbatch));
+}
+
+/*
+ * (Re)initialize the shared batches, and set up our accessors for them.
+ * Only the leader does this, before any workers are running.
+ */
+static void
+repartition_initialize_batches(RepartitionState *node,
+							   ParallelRepartitionState *shared)
+{
+	int			i;
+
+	if (node->batches == NULL)
+		node->batches = palloc0(sizeof(SharedTuplestoreAccessor *) *
+								shared->nbatch);
+
+	for (i = 0; i < shared->nbatch; i++)
+	{
+		SharedTuplestore *sts = RepartitionGetSts(shared, i);
+		char		name[NAMEDATALEN];
+
+		if (node->batches[i] != NULL)
+			pfree(node->batches[i]);
+
+		memset(sts, 0, RepartitionStsSize(shared->nparticipants));
+		snprintf(name, sizeof(name), "r%d", i);
+		node->batches[i] = sts_initialize(sts, shared->nparticipants,
+										  0, 0,
+										  SHARED_TUPLESTORE_SINGLE_PASS,
+										  &shared->fileset, name);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionEstimate
+ *
+ *		Estimate space required to propagate the shared state.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionEstimate(RepartitionState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   repartition_shared_size(pcxt->nworkers + 1));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionInitializeDSM
+ *
+ *		Set up the shared batches.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionInitializeDSM(RepartitionState *node, ParallelContext *pcxt)
+{
+	ParallelRepartitionState *shared;
+	int			nparticipants = pcxt->nworkers + 1;
+
+	/*
+	 * Without a real DSM segment, there can't be any workers, and we can't
+	 * have shared temporary files either.  Just pass the rows through.
+	 */
+	if (pcxt->seg == NULL)
+		return;
+
+	shared = shm_toc_allocate(pcxt->toc, repartition_shared_size(nparticipants));
+	shared->nbatch = REPARTITION_BATCHES_PER_PARTICIPANT * nparticipants;
+	shared->nparticipants = nparticipants;
+	pg_atomic_init_u32(&shared->next_batch, 0);
+	BarrierInit(&shared->barrier, 0);
+	SharedFileSetInit(&shared->fileset, pcxt->seg);
+	shm_toc_insert(pcxt->toc, node->ps.plan->plan_node_id, shared);
+
+	node->parallel_state = shared;
+	repartition_initialize_batches(node, shared);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionReInitializeDSM(RepartitionState *node, ParallelContext *pcxt)
+{
+	ParallelRepartitionState *shared = node->parallel_state;
+
+	if (shared == NULL)
+		return;
+
+	/* Clear the batch files of the previous scan. */
+	SharedFileSetDeleteAll(&shared->fileset);
+
+	pg_atomic_write_u32(&shared->next_batch, 0);
+	BarrierInit(&shared->barrier, 0);
+	repartition_initialize_batches(node, shared);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionInitializeWorker
+ *
+ *		Attach to the shared batches.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionInitializeWorker(RepartitionState *node,
+								ParallelWorkerContext *pwcxt)
+{
+	ParallelRepartitionState *shared;
+	int			i;
+
+	shared = shm_toc_lookup(pwcxt->toc, node->ps.plan->plan_node_id, true);
+	if (shared == NULL)
+		return;
+
+	SharedFileSetAttach(&shared->fileset, pwcxt->seg);
+
+	node->parallel_state = shared;
+	node->batches = palloc0(sizeof(SharedTuplestoreAccessor *) *
+							shared->nbatch);
+	for (i = 0; i < shared->nbatch; i++)
+		node->batches[i] = sts_attach(RepartitionGetSts(shared, i),
+									  ParallelWorkerNumber + 1,
+									  &shared->fileset);
+}
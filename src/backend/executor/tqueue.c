@@ -8,6 +8,13 @@
  *
  * A TupleQueueReader reads tuples from a shm_mq and returns the tuples.
  *
+ * To keep the per-message overhead of the queue down, small tuples are not
+ * sent one at a time.  The sender packs them into batches of up to
+ * TQUEUE_BATCH_SIZE bytes, each MinimalTuple starting at a MAXALIGN'd offset,
+ * and sends each batch as a single message; a tuple too large for a batch is
+ * sent in a message of its own.  The reader walks through the tuples of a
+ * message using their t_len.
+ *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -22,6 +29,9 @@
 #include "access/htup_details.h"
 #include "executor/tqueue.h"
 
+/* Maximum number of bytes of tuples to pack into one message */
+#define TQUEUE_BATCH_SIZE		8192
+
 /*
  * DestReceiver object's private contents
  *
@@ -31,6 +41,8 @@ typedef struct TQueueDestReceiver
 {
 	DestReceiver pub;			/* public fields */
 	shm_mq_handle *queue;		/* shm_mq to send to */
+	char	   *batch;			/* tuples not sent yet */
+	Size		batch_used;		/* number of bytes used in batch */
 } TQueueDestReceiver;
 
 /*
@@ -43,27 +55,26 @@ typedef struct TQueueDestReceiver
 struct TupleQueueReader
 {
 	shm_mq_handle *queue;		/* shm_mq to receive from */
+	char	   *msg;			/* current message */
+	Size		msg_len;		/* length of current message */
+	Size		msg_offset;		/* offset of next tuple in current message */
 };
 
+static bool tqueueSend(TQueueDestReceiver *tqueue, const void *data,
+					   Size nbytes);
+static bool tqueueFlushBatch(TQueueDestReceiver *tqueue);
+
 /*
- * Receive a tuple from a query, and send it to the designated shm_mq.
+ * Send one message to the designated shm_mq.
  *
  * Returns true if successful, false if shm_mq has been detached.
  */
 static bool
-tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+tqueueSend(TQueueDestReceiver *tqueue, const void *data, Size nbytes)
 {
-	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
-	MinimalTuple tuple;
 	shm_mq_result result;
-	bool		should_free;
-
-	/* Send the tuple itself. */
-	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false);
 
-	if (should_free)
-		pfree(tuple);
+	result = shm_mq_send(tqueue->queue, nbytes, data, false, false);
 
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
@@ -76,6 +87,62 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 	return true;
 }
 
+/*
+ * Send the tuples accumulated in the batch, if any.
+ */
+static bool
+tqueueFlushBatch(TQueueDestReceiver *tqueue)
+{
+	Size		nbytes = tqueue->batch_used;
+
+	if (nbytes == 0)
+		return true;
+
+	tqueue->batch_used = 0;
+	return tqueueSend(tqueue, tqueue->batch, nbytes);
+}
+
+/*
+ * Receive a tuple from a query, and send it to the designated shm_mq.
+ *
+ * Returns true if successful, false if shm_mq has been detached.
+ */
+static bool
+tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+{
+	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
+	MinimalTuple tuple;
+	Size		len;
+	bool		should_free;
+	bool		result = true;
+
+	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
+	len = MAXALIGN(tuple->t_len);
+
+	/* Make room in the batch, if the tuple doesn't fit anymore. */
+	if (tqueue->batch_used + len > TQUEUE_BATCH_SIZE)
+		result = tqueueFlushBatch(tqueue);
+
+	if (result)
+	{
+		if (len > TQUEUE_BATCH_SIZE)
+		{
+			/* Too large to batch; send the tuple itself. */
+			result = tqueueSend(tqueue, tuple, tuple->t_len);
+		}
+		else
+		{
+			memcpy(tqueue->batch + tqueue->batch_used, tuple, tuple->t_len);
+			tqueue->batch_used += len;
+		}
+	}
+
+	if (should_free)
+		pfree(tuple);
+
+	return result;
+}
+
 /*
  * Prepare to receive tuples from executor.
  */
@@ -94,7 +161,14 @@ tqueueShutdownReceiver(DestReceiver *self)
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
 	if (tqueue->queue != NULL)
+	{
+		/*
+		 * Send what's left in the batch.  The receiver may have lost interest
+		 * already, in which case there's nothing to do about it.
+		 */
+		(void) tqueueFlushBatch(tqueue);
 		shm_mq_detach(tqueue->queue);
+	}
 	tqueue->queue = NULL;
 }
 
@@ -109,6 +183,7 @@ tqueueDestroyReceiver(DestReceiver *self)
 	/* We probably already detached from queue, but let's be sure */
 	if (tqueue->queue != NULL)
 		shm_mq_detach(tqueue->queue);
+	pfree(tqueue->batch);
 	pfree(self);
 }
 
@@ -128,6 +203,8 @@ CreateTupleQueueDestReceiver(shm_mq_handle *handle)
 	self->pub.rDestroy = tqueueDestroyReceiver;
 	self->pub.mydest = DestTupleQueue;
 	self->queue = handle;
+	self->batch = palloc(TQUEUE_BATCH_SIZE);
+	self->batch_used = 0;
 
 	return (DestReceiver *) self;
 }
@@ -183,6 +260,16 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 	if (done != NULL)
 		*done = false;
 
+	/* Return the next tuple of the current message, if there's one left. */
+	if (reader->msg_offset < reader->msg_len)
+	{
+		tuple = (MinimalTuple) (reader->msg + reader->msg_offset);
+		reader->msg_offset += MAXALIGN(tuple->t_len);
+		Assert(reader->msg_offset <= MAXALIGN(reader->msg_len));
+		return tuple;
+	}
+	reader->msg_len = reader->msg_offset = 0;
+
 	/* Attempt to read a message. */
 	result = shm_mq_receive(reader->queue, &nbytes, &data, nowait);
 
@@ -201,10 +288,15 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 
 	/*
 	 * Return a pointer to the queue memory directly (which had better be
-	 * sufficiently aligned).
+	 * sufficiently aligned).  Any further tuples of the message are returned
+	 * by subsequent calls; the message stays valid until we ask the queue
+	 * for the next one.
 	 */
 	tuple = (MinimalTuple) data;
-	Assert(tuple->t_len == nbytes);
+	Assert(tuple->t_len <= nbytes);
+	reader->msg = (char *) data;
+	reader->msg_len = nbytes;
+	reader->msg_offset = MAXALIGN(tuple->t_len);
 
 	return tuple;
 }
@@ -10,15 +10,16 @@
  *
  * To deal with concurrency, it has a fixed size set of partitions, each of
  * which is independently locked.  Each bucket maps to a partition; so insert,
- * find and iterate operations normally only acquire one lock.  Therefore,
- * good concurrency is achieved whenever such operations don't collide at the
- * lock partition level.  However, when a resize operation begins, all
- * partition locks must be acquired simultaneously for a brief period.  This
- * is only expected to happen a small number of times until a stable size is
- * found, since growth is geometric.
+ * find and iterate operations normally only acquire one lock.  Sequential
+ * scans visit the partitions in order, holding only one lock at a time.
+ * Therefore, good concurrency is achieved whenever such operations don't
+ * collide at the lock partition level.  However, when a resize operation
+ * begins, all partition locks must be acquired simultaneously for a brief
+ * period.  This is only expected to happen a small number of times until a
+ * stable size is found, since growth is geometric.
  *
- * Future versions may support iterators and incremental resizing; for now
- * the implementation is minimalist.
+ * Future versions may support incremental resizing; for now the
+ * implementation is minimalist.
  *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -574,6 +575,122 @@ dshash_release_lock(dshash_table *hash_table, void *entry)
 	LWLockRelease(PARTITION_LOCK(hash_table, partition_index));
 }
 
+/*
+ * Begin a sequential scan over all entries of the hash table.
+ *
+ * Partitions are locked one at a time, in shared or exclusive mode according
+ * to 'exclusive', so a scan never blocks the whole table.  Entries inserted
+ * or deleted concurrently in partitions that the scan has not yet reached or
+ * already left may or may not be seen.  While a scan is in progress, the
+ * caller must not use dshash_find and friends on the same table, since the
+ * partition holding the current entry is locked.
+ */
+void
+dshash_seq_init(dshash_seq_status *status, dshash_table *hash_table,
+				bool exclusive)
+{
+	Assert(hash_table->control->magic == DSHASH_MAGIC);
+	Assert(!hash_table->find_locked);
+
+	status->hash_table = hash_table;
+	status->curpartition = -1;
+	status->curbucket = 0;
+	status->nbuckets = 0;
+	status->curitem = NULL;
+	status->pnextitem = InvalidDsaPointer;
+	status->exclusive = exclusive;
+}
+
+/*
+ * Return the next entry of a sequential scan, or NULL once all entries have
+ * been returned.  The partition containing the returned entry stays locked
+ * until the next call; once NULL has been returned, no lock is held.
+ */
+void *
+dshash_seq_next(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	dsa_pointer next_item_pointer = status->pnextitem;
+
+	if (status->curpartition >= DSHASH_NUM_PARTITIONS)
+		return NULL;
+
+	while (!DsaPointerIsValid(next_item_pointer))
+	{
+		/* Move to the next bucket of the current partition, if any. */
+		if (status->curpartition >= 0 &&
+			++status->curbucket < status->nbuckets)
+		{
+			next_item_pointer = hash_table->buckets[status->curbucket];
+			continue;
+		}
+
+		/* Done with this partition; move on to the next one. */
+		if (status->curpartition >= 0)
+			LWLockRelease(PARTITION_LOCK(hash_table, status->curpartition));
+		if (++status->curpartition >= DSHASH_NUM_PARTITIONS)
+		{
+			status->curitem = NULL;
+			return NULL;
+		}
+
+		/*
+		 * A resize needs all partition locks, so the bucket pointers stay
+		 * valid for as long as we hold this one.
+		 */
+		LWLockAcquire(PARTITION_LOCK(hash_table, status->curpartition),
+					  status->exclusive ? LW_EXCLUSIVE : LW_SHARED);
+		ensure_valid_bucket_pointers(hash_table);
+		status->curbucket =
+			BUCKET_INDEX_FOR_PARTITION(status->curpartition,
+									   hash_table->size_log2);
+		status->nbuckets =
+			BUCKET_INDEX_FOR_PARTITION(status->curpartition + 1,
+									   hash_table->size_log2);
+		next_item_pointer = hash_table->buckets[status->curbucket];
+	}
+
+	status->curitem = dsa_get_address(hash_table->area, next_item_pointer);
+	status->pnextitem = status->curitem->next;
+
+	return ENTRY_FROM_ITEM(status->curitem);
+}
+
+/*
+ * End a sequential scan, releasing the partition lock if one is still held.
+ * This must be called if the scan is abandoned before dshash_seq_next has
+ * returned NULL, and is harmless otherwise.
+ */
+void
+dshash_seq_term(dshash_seq_status *status)
+{
+	if (status->curpartition >= 0 &&
+		status->curpartition < DSHASH_NUM_PARTITIONS)
+		LWLockRelease(PARTITION_LOCK(status->hash_table,
+									 status->curpartition));
+	status->curpartition = DSHASH_NUM_PARTITIONS;
+	status->curitem = NULL;
+}
+
+/*
+ * Delete the entry most recently returned by an exclusive sequential scan.
+ * The scan can continue normally afterwards.
+ */
+void
+dshash_delete_current(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+
+	Assert(status->exclusive);
+	Assert(status->curitem != NULL);
+	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table,
+											   status->curpartition),
+								LW_EXCLUSIVE));
+
+	delete_item(hash_table, status->curitem);
+	status->curitem = NULL;
+}
+
 /*
  * A compare function that forwards to memcmp.
  */
@@ -401,6 +401,30 @@ _copyGatherMerge(const GatherMerge *from)
 	return newnode;
 }
 
+/*
+ * _copyRepartition
+ */
+static Repartition *
+_copyRepartition(const Repartition *from)
+{
+	Repartition *newnode = makeNode(Repartition);
+
+	/*
+	 * copy node superclass fields
+	 */
+	CopyPlanFields((const Plan *) from, (Plan *) newnode);
+
+	/*
+	 * copy remainder of node
+	 */
+	COPY_SCALAR_FIELD(numCols);
+	COPY_POINTER_FIELD(hashColIdx, from->numCols * sizeof(AttrNumber));
+	COPY_POINTER_FIELD(hashOperators, from->numCols * sizeof(Oid));
+	COPY_POINTER_FIELD(hashCollations, from->numCols * sizeof(Oid));
+
+	return newnode;
+}
+
 /*
  * CopyScanFields
  *
@@ -1083,6 +1107,8 @@ _copyWindowAgg(const WindowAgg *from)
 	COPY_SCALAR_FIELD(inRangeColl);
 	COPY_SCALAR_FIELD(inRangeAsc);
 	COPY_SCALAR_FIELD(inRangeNullsFirst);
+	COPY_NODE_FIELD(runCondition);
+	COPY_SCALAR_FIELD(topWindow);
 
 	return newnode;
 }
@@ -2548,6 +2574,7 @@ _copyWindowClause(const WindowClause *from)
 	COPY_SCALAR_FIELD(frameOptions);
 	COPY_NODE_FIELD(startOffset);
 	COPY_NODE_FIELD(endOffset);
+	COPY_NODE_FIELD(runCondition);
 	COPY_SCALAR_FIELD(startInRangeFunc);
 	COPY_SCALAR_FIELD(endInRangeFunc);
 	COPY_SCALAR_FIELD(inRangeColl);
@@ -4939,6 +4966,9 @@ copyObjectImpl(const void *from)
 		case T_GatherMerge:
 			retval = _copyGatherMerge(from);
 			break;
+		case T_Repartition:
+			retval = _copyRepartition(from);
+			break;
 		case T_SeqScan:
 			retval = _copySeqScan(from);
 			break;
@@ -2153,6 +2153,8 @@ expression_tree_walker(Node *node,
 					return true;
 				if (walker(wc->endOffset, context))
 					return true;
+				if (walker(wc->runCondition, context))
+					return true;
 			}
 			break;
 		case T_CTECycleClause:
@@ -2398,6 +2400,8 @@ query_tree_walker(Query *query,
 				return true;
 			if (walker(wc->endOffset, context))
 				return true;
+			if (walker(wc->runCondition, context))
+				return true;
 		}
 	}
 
@@ -3040,6 +3044,7 @@ expression_tree_mutator(Node *node,
 				MUTATE(newnode->orderClause, wc->orderClause, List *);
 				MUTATE(newnode->startOffset, wc->startOffset, Node *);
 				MUTATE(newnode->endOffset, wc->endOffset, Node *);
+				MUTATE(newnode->runCondition, wc->runCondition, List *);
 				return (Node *) newnode;
 			}
 			break;
@@ -3334,6 +3339,7 @@ query_tree_mutator(Query *query,
 			FLATCOPY(newnode, wc, WindowClause);
 			MUTATE(newnode->startOffset, wc->startOffset, Node *);
 			MUTATE(newnode->endOffset, wc->endOffset, Node *);
+			MUTATE(newnode->runCondition, wc->runCondition, List *);
 
 			resultlist = lappend(resultlist, (Node *) newnode);
 		}
@@ -520,6 +520,19 @@ _outGatherMerge(StringInfo str, const GatherMerge *node)
 	WRITE_BITMAPSET_FIELD(initParam);
 }
 
+static void
+_outRepartition(StringInfo str, const Repartition *node)
+{
+	WRITE_NODE_TYPE("REPARTITION");
+
+	_outPlanInfo(str, (const Plan *) node);
+
+	WRITE_INT_FIELD(numCols);
+	WRITE_ATTRNUMBER_ARRAY(hashColIdx, node->numCols);
+	WRITE_OID_ARRAY(hashOperators, node->numCols);
+	WRITE_OID_ARRAY(hashCollations, node->numCols);
+}
+
 static void
 _outScan(StringInfo str, const Scan *node)
 {
@@ -822,6 +835,8 @@ _outWindowAgg(StringInfo str, const WindowAgg *node)
 	WRITE_OID_FIELD(inRangeColl);
 	WRITE_BOOL_FIELD(inRangeAsc);
 	WRITE_BOOL_FIELD(inRangeNullsFirst);
+	WRITE_NODE_FIELD(runCondition);
+	WRITE_BOOL_FIELD(topWindow);
 }
 
 static void
@@ -2085,6 +2100,7 @@ _outWindowAggPath(StringInfo str, const WindowAggPath *node)
 
 	WRITE_NODE_FIELD(subpath);
 	WRITE_NODE_FIELD(winclause);
+	WRITE_BOOL_FIELD(topwindow);
 }
 
 static void
@@ -2175,6 +2191,17 @@ _outGatherMergePath(StringInfo str, const GatherMergePath *node)
 	WRITE_INT_FIELD(num_workers);
 }
 
+static void
+_outRepartitionPath(StringInfo str, const RepartitionPath *node)
+{
+	WRITE_NODE_TYPE("REPARTITIONPATH");
+
+	_outPathInfo(str, (const Path *) node);
+
+	WRITE_NODE_FIELD(subpath);
+	WRITE_NODE_FIELD(hashClauses);
+}
+
 static void
 _outNestPath(StringInfo str, const NestPath *node)
 {
@@ -3058,6 +3085,7 @@ _outWindowClause(StringInfo str, const WindowClause *node)
 	WRITE_INT_FIELD(frameOptions);
 	WRITE_NODE_FIELD(startOffset);
 	WRITE_NODE_FIELD(endOffset);
+	WRITE_NODE_FIELD(runCondition);
 	WRITE_OID_FIELD(startInRangeFunc);
 	WRITE_OID_FIELD(endInRangeFunc);
 	WRITE_OID_FIELD(inRangeColl);
@@ -3799,6 +3827,9 @@ outNode(StringInfo str, const void *obj)
 			case T_GatherMerge:
 				_outGatherMerge(str, obj);
 				break;
+			case T_Repartition:
+				_outRepartition(str, obj);
+				break;
 			case T_Scan:
 				_outScan(str, obj);
 				break;
@@ -4165,6 +4196,9 @@ outNode(StringInfo str, const void *obj)
 			case T_GatherMergePath:
 				_outGatherMergePath(str, obj);
 				break;
+			case T_RepartitionPath:
+				_outRepartitionPath(str, obj);
+				break;
 			case T_NestPath:
 				_outNestPath(str, obj);
 				break;
@@ -382,6 +382,7 @@ _readWindowClause(void)
 	READ_INT_FIELD(frameOptions);
 	READ_NODE_FIELD(startOffset);
 	READ_NODE_FIELD(endOffset);
+	READ_NODE_FIELD(runCondition);
 	READ_OID_FIELD(startInRangeFunc);
 	READ_OID_FIELD(endInRangeFunc);
 	READ_OID_FIELD(inRangeColl);
@@ -2323,6 +2324,8 @@ _readWindowAgg(void)
 	READ_OID_FIELD(inRangeColl);
 	READ_BOOL_FIELD(inRangeAsc);
 	READ_BOOL_FIELD(inRangeNullsFirst);
+	READ_NODE_FIELD(runCondition);
+	READ_BOOL_FIELD(topWindow);
 
 	READ_DONE();
 }
@@ -2386,6 +2389,24 @@ _readGatherMerge(void)
 	READ_DONE();
 }
 
+/*
+ * _readRepartition
+ */
+static Repartition *
+_readRepartition(void)
+{
+	READ_LOCALS(Repartition);
+
+	ReadCommonPlan(&local_node->plan);
+
+	READ_INT_FIELD(numCols);
+	READ_ATTRNUMBER_ARRAY(hashColIdx, local_node->numCols);
+	READ_OID_ARRAY(hashOperators, local_node->numCols);
+	READ_OID_ARRAY(hashCollations, local_node->numCols);
+
+	READ_DONE();
+}
+
 /*
  * _readHash
  */
@@ -2911,6 +2932,8 @@ parseNodeString(void)
 		return_value = _readGather();
 	else if (MATCH("GATHERMERGE", 11))
 		return_value = _readGatherMerge();
+	else if (MATCH("REPARTITION", 11))
+		return_value = _readRepartition();
 	else if (MATCH("HASH", 4))
 		return_value = _readHash();
 	else if (MATCH("SETOP", 5))
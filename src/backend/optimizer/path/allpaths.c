@@ -18,6 +18,7 @@
 #include <limits.h>
 #include <math.h>
 
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "access/tsmapi.h"
 #include "catalog/pg_class.h"
@@ -30,6 +31,7 @@
 #ifdef OPTIMIZER_DEBUG
 #include "nodes/print.h"
 #endif
+#include "nodes/supportnodes.h"
 #include "optimizer/appendinfo.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
@@ -138,6 +140,11 @@ static bool qual_is_pushdown_safe(Query *subquery, Index rti, Node *qual,
 								  pushdown_safety_info *safetyInfo);
 static void subquery_push_qual(Query *subquery,
 							   RangeTblEntry *rte, Index rti, Node *qual);
+static void check_and_push_window_quals(Query *subquery, Index rti,
+										Node *clause);
+static bool find_window_run_conditions(Query *subquery, WindowFunc *wfunc,
+									   Oid opno, Oid inputcollid,
+									   Expr *otherexpr, bool wfunc_left);
 static void recurse_push_qual(Node *setOp, Query *topquery,
 							  RangeTblEntry *rte, Index rti, Node *qual);
 static void remove_unused_subquery_outputs(Query *subquery, RelOptInfo *rel);
@@ -616,9 +623,11 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 			 * taught the workers to read them.  Writing a large number of
 			 * temporary buffers could be expensive, though, and we don't have
 			 * the rest of the necessary infrastructure right now anyway.  So
-			 * for now, bail out if we see a temporary table.
+			 * for now, bail out if we see a temporary table.  The same goes
+			 * for global temporary tables, whose data is session-local too.
 			 */
-			if (get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+			if (get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP ||
+				get_rel_persistence(rte->relid) == RELPERSISTENCE_GLOBAL_TEMP)
 				return;
 
 			/*
@@ -2187,6 +2196,14 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 			}
 			else
 			{
+				/*
+				 * A qual on a window function's result can't be pushed down,
+				 * but it may still let the WindowAgg stop early; see
+				 * check_and_push_window_quals.
+				 */
+				if (subquery->hasWindowFuncs && !rinfo->pseudoconstant)
+					check_and_push_window_quals(subquery, rti, clause);
+
 				/* Keep it in the upper query */
 				upperrestrictlist = lappend(upperrestrictlist, rinfo);
 			}
@@ -3504,6 +3521,231 @@ qual_is_pushdown_safe(Query *subquery, Index rti, Node *qual,
 	return safe;
 }
 
+/*
+ * check_and_push_window_quals
+ *		Check if 'clause' is a qual that can be used as a WindowAgg run
+ *		condition, and if so, attach a suitable run condition to the
+ *		subquery's WindowClause.
+ *
+ * We're looking for quals of the form "wfunc <op> pseudoconstant" (or the
+ * commutated form) where 'wfunc' is a subquery output column holding a
+ * window function whose result is monotonic within a partition.  Once such a
+ * qual becomes false for a row, it stays false for the remainder of the
+ * partition, so the WindowAgg node can stop evaluating its window functions.
+ *
+ * Unlike ordinary pushed-down quals, the clause is not removed from the upper
+ * query.  When the WindowAgg stops early it may still have to return tuples
+ * (e.g. so that upper-level WindowAggs see every row), and it returns those
+ * with NULL window function results, which the upper-level strict qual then
+ * filters out.
+ */
+static void
+check_and_push_window_quals(Query *subquery, Index rti, Node *clause)
+{
+	OpExpr	   *opexpr = (OpExpr *) clause;
+	Expr	   *lexpr;
+	Expr	   *rexpr;
+	Var		   *var;
+	bool		wfunc_left;
+	TargetEntry *tle;
+
+	/*
+	 * Set operations return the union of several queries' rows, and both
+	 * DISTINCT ON and set-returning functions in the targetlist could be
+	 * confused by the NULL results mentioned above.
+	 */
+	if (subquery->setOperations != NULL || subquery->hasDistinctOn ||
+		subquery->hasTargetSRFs)
+		return;
+
+	if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2 ||
+		opexpr->opretset)
+		return;
+
+	lexpr = linitial(opexpr->args);
+	rexpr = lsecond(opexpr->args);
+
+	if (IsA(lexpr, Var) && ((Var *) lexpr)->varno == rti)
+	{
+		var = (Var *) lexpr;
+		wfunc_left = true;
+	}
+	else if (IsA(rexpr, Var) && ((Var *) rexpr)->varno == rti)
+	{
+		var = (Var *) rexpr;
+		wfunc_left = false;
+	}
+	else
+		return;
+
+	/* Whole-row references can't be the result of a window function */
+	if (var->varattno <= 0 || var->varlevelsup != 0)
+		return;
+
+	/*
+	 * The other side must not change its value while the WindowAgg node
+	 * runs, and it must not reference the subquery's outputs.
+	 */
+	if (!is_pseudo_constant_clause((Node *) (wfunc_left ? rexpr : lexpr)) ||
+		contain_subplans((Node *) (wfunc_left ? rexpr : lexpr)))
+		return;
+
+	/*
+	 * The operator has to return false on NULL input, else the tuples
+	 * returned with NULL window function results won't be filtered out.
+	 */
+	if (!op_strict(opexpr->opno) ||
+		func_volatile(opexpr->opfuncid) == PROVOLATILE_VOLATILE)
+		return;
+
+	tle = get_tle_by_resno(subquery->targetList, var->varattno);
+	if (tle == NULL || tle->resjunk || !IsA(tle->expr, WindowFunc))
+		return;
+
+	(void) find_window_run_conditions(subquery, (WindowFunc *) tle->expr,
+									  opexpr->opno, opexpr->inputcollid,
+									  wfunc_left ? rexpr : lexpr,
+									  wfunc_left);
+}
+
+/*
+ * find_window_run_conditions
+ *		Ask the window function's support function whether its results are
+ *		monotonic, and if the comparison against 'otherexpr' is one that stays
+ *		false once it becomes false, add it to the WindowClause's
+ *		runCondition.  Returns true if a run condition was added.
+ */
+static bool
+find_window_run_conditions(Query *subquery, WindowFunc *wfunc, Oid opno,
+						   Oid inputcollid, Expr *otherexpr, bool wfunc_left)
+{
+	WindowClause *wclause = NULL;
+	Oid			prosupport;
+	SupportRequestWFuncMonotonic req;
+	SupportRequestWFuncMonotonic *res;
+	List	   *opinfos;
+	ListCell   *lc;
+	Oid			runopc = InvalidOid;
+	OpExpr	   *runopexpr;
+
+	foreach(lc, subquery->windowClause)
+	{
+		WindowClause *wc = lfirst_node(WindowClause, lc);
+
+		if (wc->winref == wfunc->winref)
+		{
+			wclause = wc;
+			break;
+		}
+	}
+	if (wclause == NULL)
+		return false;
+
+	prosupport = get_func_support(wfunc->winfnoid);
+	if (!OidIsValid(prosupport))
+		return false;
+
+	req.type = T_SupportRequestWFuncMonotonic;
+	req.window_func = wfunc;
+	req.window_clause = wclause;
+	req.monotonic = MONOTONICFUNC_NONE;
+
+	res = (SupportRequestWFuncMonotonic *)
+		DatumGetPointer(OidFunctionCall1(prosupport, PointerGetDatum(&req)));
+
+	if (res == NULL || res->monotonic == MONOTONICFUNC_NONE)
+		return false;
+
+	/*
+	 * Look for a btree interpretation of the operator that tells us which
+	 * direction the comparison goes.
+	 */
+	opinfos = get_op_btree_interpretation(opno);
+	foreach(lc, opinfos)
+	{
+		OpBtreeInterpretation *opinfo = (OpBtreeInterpretation *) lfirst(lc);
+		int			strategy = opinfo->strategy;
+
+		if (strategy == BTLessStrategyNumber ||
+			strategy == BTLessEqualStrategyNumber)
+		{
+			/*
+			 * "wfunc < const" remains false once false when the results
+			 * increase; "const < wfunc" when they decrease.
+			 */
+			if ((wfunc_left && (res->monotonic & MONOTONICFUNC_INCREASING)) ||
+				(!wfunc_left && (res->monotonic & MONOTONICFUNC_DECREASING)))
+			{
+				runopc = opno;
+				break;
+			}
+		}
+		else if (strategy == BTGreaterStrategyNumber ||
+				 strategy == BTGreaterEqualStrategyNumber)
+		{
+			if ((wfunc_left && (res->monotonic & MONOTONICFUNC_DECREASING)) ||
+				(!wfunc_left && (res->monotonic & MONOTONICFUNC_INCREASING)))
+			{
+				runopc = opno;
+				break;
+			}
+		}
+		else if (strategy == BTEqualStrategyNumber)
+		{
+			int16		newstrategy;
+
+			/*
+			 * A constant result satisfies "=" for either all or none of the
+			 * partition's rows, so the operator can be used as is.
+			 */
+			if (res->monotonic == MONOTONICFUNC_BOTH)
+			{
+				runopc = opno;
+				break;
+			}
+
+			/*
+			 * Otherwise we can stop once the result has passed the constant,
+			 * i.e. use "<=" for increasing functions and ">=" for decreasing
+			 * ones, written with the window function on the same side as in
+			 * the original qual.
+			 */
+			if (res->monotonic & MONOTONICFUNC_INCREASING)
+				newstrategy = wfunc_left ? BTLessEqualStrategyNumber :
+					BTGreaterEqualStrategyNumber;
+			else
+				newstrategy = wfunc_left ? BTGreaterEqualStrategyNumber :
+					BTLessEqualStrategyNumber;
+
+			runopc = get_opfamily_member(opinfo->opfamily_id,
+										 opinfo->oplefttype,
+										 opinfo->oprighttype,
+										 newstrategy);
+			if (OidIsValid(runopc))
+				break;
+		}
+	}
+
+	if (!OidIsValid(runopc))
+		return false;
+
+	if (wfunc_left)
+		runopexpr = (OpExpr *) make_opclause(runopc, BOOLOID, false,
+											 (Expr *) copyObject(wfunc),
+											 (Expr *) copyObject(otherexpr),
+											 InvalidOid, inputcollid);
+	else
+		runopexpr = (OpExpr *) make_opclause(runopc, BOOLOID, false,
+											 (Expr *) copyObject(otherexpr),
+											 (Expr *) copyObject(wfunc),
+											 InvalidOid, inputcollid);
+	runopexpr->opfuncid = get_opcode(runopc);
+
+	wclause->runCondition = lappend(wclause->runCondition, runopexpr);
+
+	return true;
+}
+
 /*
  * subquery_push_qual - push down a qual that we have determined is safe
  */
@@ -4040,6 +4282,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "GatherMerge";
 			subpath = ((GatherMergePath *) path)->subpath;
 			break;
+		case T_RepartitionPath:
+			ptype = "Repartition";
+			subpath = ((RepartitionPath *) path)->subpath;
+			break;
 		case T_ProjectionPath:
 			ptype = "Projection";
 			subpath = ((ProjectionPath *) path)->subpath;
@@ -133,6 +133,7 @@ bool		enable_seqscan = true;
 bool		enable_indexscan = true;
 bool		enable_indexonlyscan = true;
 bool		enable_bitmapscan = true;
+bool		enable_distinct_agg_grouping = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
 bool		enable_incremental_sort = true;
@@ -146,6 +147,8 @@ bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = true;
+bool		enable_parallel_window = true;
 bool		enable_partition_pruning = true;
 
 typedef struct
@@ -2400,6 +2403,40 @@ cost_material(Path *path,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_repartition
+ *	  Determines and returns the cost of redistributing a partial relation
+ *	  among parallel workers by the hash of 'numCols' key columns.
+ *
+ * The whole input is consumed and written out to shared temporary files
+ * before the first tuple can be returned, so all of that is startup cost.
+ * Each participant then reads back its share of the batches.  Like Material,
+ * we don't charge cpu_tuple_cost for the passes over the data, since no
+ * qual-checking or projection is done.
+ */
+void
+cost_repartition(Path *path, Cost input_total_cost,
+				 double tuples, int width, int numCols)
+{
+	Cost		startup_cost = input_total_cost;
+	Cost		run_cost = 0;
+	double		npages = ceil(relation_byte_size(tuples, width) / BLCKSZ);
+
+	path->rows = tuples;
+
+	/* hash the keys and write out every tuple */
+	startup_cost += cpu_operator_cost * numCols * tuples;
+	startup_cost += cpu_operator_cost * tuples;
+	startup_cost += seq_page_cost * npages;
+
+	/* read the batches back */
+	run_cost += cpu_operator_cost * tuples;
+	run_cost += seq_page_cost * npages;
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_agg
  *		Determines and returns the cost of performing an Agg plan node,
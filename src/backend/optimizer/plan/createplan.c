@@ -282,6 +282,7 @@ static WindowAgg *make_windowagg(List *tlist, Index winref,
 								 int frameOptions, Node *startOffset, Node *endOffset,
 								 Oid startInRangeFunc, Oid endInRangeFunc,
 								 Oid inRangeColl, bool inRangeAsc, bool inRangeNullsFirst,
+								 List *runCondition, bool topWindow,
 								 Plan *lefttree);
 static Group *make_group(List *tlist, List *qual, int numGroupCols,
 						 AttrNumber *grpColIdx, Oid *grpOperators, Oid *grpCollations,
@@ -306,6 +307,9 @@ static ModifyTable *make_modifytable(PlannerInfo *root,
 									 List *rowMarks, OnConflictExpr *onconflict, int epqParam);
 static GatherMerge *create_gather_merge_plan(PlannerInfo *root,
 											 GatherMergePath *best_path);
+static Repartition *create_repartition_plan(PlannerInfo *root,
+											RepartitionPath *best_path,
+											int flags);
 
 
 /*
@@ -526,6 +530,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 			plan = (Plan *) create_gather_merge_plan(root,
 													 (GatherMergePath *) best_path);
 			break;
+		case T_Repartition:
+			plan = (Plan *) create_repartition_plan(root,
+													(RepartitionPath *) best_path,
+													flags);
+			break;
 		default:
 			elog(ERROR, "unrecognized node type: %d",
 				 (int) best_path->pathtype);
@@ -1822,6 +1831,45 @@ create_gather_merge_plan(PlannerInfo *root, GatherMergePath *best_path)
 	return gm_plan;
 }
 
+/*
+ * create_repartition_plan
+ *
+ *	  Create a Repartition plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ */
+static Repartition *
+create_repartition_plan(PlannerInfo *root, RepartitionPath *best_path,
+						int flags)
+{
+	Repartition *plan;
+	Plan	   *subplan;
+
+	/*
+	 * We don't want any excess columns in the spooled tuples, so request a
+	 * smaller tlist.  We need the hash key columns to be labeled, too.
+	 * Otherwise, since Repartition doesn't project, tlist requirements pass
+	 * through.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath,
+								  flags | CP_SMALL_TLIST | CP_LABEL_TLIST);
+
+	plan = makeNode(Repartition);
+	plan->plan.targetlist = subplan->targetlist;
+	plan->plan.qual = NIL;
+	plan->plan.lefttree = subplan;
+	plan->plan.righttree = NULL;
+	plan->numCols = list_length(best_path->hashClauses);
+	plan->hashColIdx = extract_grouping_cols(best_path->hashClauses,
+											 subplan->targetlist);
+	plan->hashOperators = extract_grouping_ops(best_path->hashClauses);
+	plan->hashCollations = extract_grouping_collations(best_path->hashClauses,
+													   subplan->targetlist);
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_projection_plan
  *
@@ -2528,6 +2576,8 @@ create_windowagg_plan(PlannerInfo *root, WindowAggPath *best_path)
 						  wc->inRangeColl,
 						  wc->inRangeAsc,
 						  wc->inRangeNullsFirst,
+						  wc->runCondition,
+						  best_path->topwindow,
 						  subplan);
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
@@ -6483,6 +6533,7 @@ make_windowagg(List *tlist, Index winref,
 			   int frameOptions, Node *startOffset, Node *endOffset,
 			   Oid startInRangeFunc, Oid endInRangeFunc,
 			   Oid inRangeColl, bool inRangeAsc, bool inRangeNullsFirst,
+			   List *runCondition, bool topWindow,
 			   Plan *lefttree)
 {
 	WindowAgg  *node = makeNode(WindowAgg);
@@ -6505,6 +6556,8 @@ make_windowagg(List *tlist, Index winref,
 	node->inRangeColl = inRangeColl;
 	node->inRangeAsc = inRangeAsc;
 	node->inRangeNullsFirst = inRangeNullsFirst;
+	node->runCondition = runCondition;
+	node->topWindow = topWindow;
 
 	plan->targetlist = tlist;
 	plan->lefttree = lefttree;
@@ -7028,6 +7081,7 @@ is_projection_capable_path(Path *path)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_Repartition:
 		case T_Sort:
 		case T_IncrementalSort:
 		case T_Unique:
@@ -7073,6 +7127,7 @@ is_projection_capable_plan(Plan *plan)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_Repartition:
 		case T_Sort:
 		case T_Unique:
 		case T_SetOp:
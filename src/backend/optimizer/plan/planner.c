@@ -182,13 +182,14 @@ static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   bool output_target_parallel_safe,
 									   WindowFuncLists *wflists,
 									   List *activeWindows);
-static void create_one_window_path(PlannerInfo *root,
-								   RelOptInfo *window_rel,
-								   Path *path,
-								   PathTarget *input_target,
-								   PathTarget *output_target,
-								   WindowFuncLists *wflists,
-								   List *activeWindows);
+static Path *create_one_window_path(PlannerInfo *root,
+									RelOptInfo *window_rel,
+									Path *path,
+									PathTarget *input_target,
+									PathTarget *output_target,
+									WindowFuncLists *wflists,
+									List *activeWindows);
+static List *get_window_hash_clauses(List *activeWindows);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 										 RelOptInfo *input_rel);
 static RelOptInfo *create_ordered_paths(PlannerInfo *root,
@@ -649,6 +650,15 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	root->non_recursive_path = NULL;
 	root->partColsUpdated = false;
 
+	/*
+	 * If all the aggregates are DISTINCT aggregates over the same arguments,
+	 * eliminate the duplicates by grouping in a subquery instead.  This
+	 * moves the WITH list and the range table into the new subquery, so it
+	 * has to be done first.
+	 */
+	if (parse->hasAggs && enable_distinct_agg_grouping)
+		transform_distinct_aggs(root);
+
 	/*
 	 * If there is a WITH list, process each WITH query and either convert it
 	 * to RTE_SUBQUERY RTE(s) or build an initplan SubPlan structure for it.
@@ -815,6 +825,9 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 												EXPRKIND_LIMIT);
 		wc->endOffset = preprocess_expression(root, wc->endOffset,
 											  EXPRKIND_LIMIT);
+		wc->runCondition = (List *) preprocess_expression(root,
+														  (Node *) wc->runCondition,
+														  EXPRKIND_TARGET);
 	}
 
 	parse->limitOffset = preprocess_expression(root, parse->limitOffset,
@@ -4595,13 +4608,46 @@ create_window_paths(PlannerInfo *root,
 			pathkeys_count_contained_in(root->window_pathkeys, path->pathkeys,
 										&presorted_keys) ||
 			presorted_keys > 0)
-			create_one_window_path(root,
-								   window_rel,
-								   path,
-								   input_target,
-								   output_target,
-								   wflists,
-								   activeWindows);
+			add_path(window_rel,
+					 create_one_window_path(root,
+											window_rel,
+											path,
+											input_target,
+											output_target,
+											wflists,
+											activeWindows));
+	}
+
+	/*
+	 * Consider computing the window functions in parallel.  If all the
+	 * windows are partitioned by some common hashable expressions, we can
+	 * redistribute the rows of the cheapest partial path among the
+	 * participants by the hash of those expressions.  Each participant then
+	 * sees complete window partitions, and can sort them and compute the
+	 * window functions on its own.
+	 */
+	if (window_rel->consider_parallel && enable_parallel_window &&
+		input_rel->partial_pathlist != NIL)
+	{
+		List	   *hashClauses = get_window_hash_clauses(activeWindows);
+
+		if (hashClauses != NIL)
+		{
+			Path	   *path = (Path *) linitial(input_rel->partial_pathlist);
+
+			path = (Path *) create_repartition_path(root, window_rel, path,
+													hashClauses);
+			add_partial_path(window_rel,
+							 create_one_window_path(root,
+													window_rel,
+													path,
+													input_target,
+													output_target,
+													wflists,
+													activeWindows));
+
+			generate_useful_gather_paths(root, window_rel, false);
+		}
 	}
 
 	/*
@@ -4627,7 +4673,7 @@ create_window_paths(PlannerInfo *root,
 
 /*
  * Stack window-function implementation steps atop the given Path, and
- * add the result to window_rel.
+ * return the result.  The caller is responsible for adding it to window_rel.
  *
  * window_rel: upperrel to contain result
  * path: input Path to use (must return input_target)
@@ -4636,7 +4682,7 @@ create_window_paths(PlannerInfo *root,
  * wflists: result of find_window_functions
  * activeWindows: result of select_active_windows
  */
-static void
+static Path *
 create_one_window_path(PlannerInfo *root,
 					   RelOptInfo *window_rel,
 					   Path *path,
@@ -4737,10 +4783,52 @@ create_one_window_path(PlannerInfo *root,
 		path = (Path *)
 			create_windowagg_path(root, window_rel, path, window_target,
 								  wflists->windowFuncs[wc->winref],
-								  wc);
+								  wc, lnext(activeWindows, l) == NULL);
+	}
+
+	return path;
+}
+
+/*
+ * get_window_hash_clauses
+ *		Find the PARTITION BY clauses that all the active windows have in
+ *		common, for use as the hash keys when redistributing the window
+ *		input among parallel workers.
+ *
+ * Only hashable clauses are considered.  Returns NIL if there are none,
+ * which is always the case if some window has no PARTITION BY at all.
+ */
+static List *
+get_window_hash_clauses(List *activeWindows)
+{
+	WindowClause *firstwc = linitial_node(WindowClause, activeWindows);
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	foreach(lc, firstwc->partitionClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		bool		common = sgc->hashable;
+		ListCell   *l;
+
+		for_each_from(l, activeWindows, 1)
+		{
+			WindowClause *wc = lfirst_node(WindowClause, l);
+			SortGroupClause *other;
+
+			if (!common)
+				break;
+
+			other = get_sortgroupref_clause_noerr(sgc->tleSortGroupRef,
+												  wc->partitionClause);
+			common = (other != NULL && other->eqop == sgc->eqop);
+		}
+
+		if (common)
+			result = lappend(result, sgc);
 	}
 
-	add_path(window_rel, path);
+	return result;
 }
 
 /*
@@ -6440,11 +6528,11 @@ plan_create_index_workers(Oid tableOid, Oid indexOid)
 	/*
 	 * Determine if it's safe to proceed.
 	 *
-	 * Currently, parallel workers can't access the leader's temporary tables.
-	 * Furthermore, any index predicate or index expressions must be parallel
-	 * safe.
+	 * Currently, parallel workers can't access the leader's temporary tables,
+	 * global or not.  Furthermore, any index predicate or index expressions
+	 * must be parallel safe.
 	 */
-	if (heap->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+	if (RelationUsesLocalBuffers(heap) ||
 		!is_parallel_safe(root, (Node *) RelationGetIndexExpressions(index)) ||
 		!is_parallel_safe(root, (Node *) RelationGetIndexPredicate(index)))
 	{
@@ -6801,6 +6889,42 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									 havingQual,
 									 agg_costs,
 									 dNumGroups));
+
+			/*
+			 * Consider aggregating in parallel without a Finalize step.  We
+			 * redistribute the rows of the cheapest partial path among the
+			 * participants by the hash of the grouping columns, so that each
+			 * group is seen by exactly one participant.  Each participant
+			 * then builds a hash table of only its own groups, spills it on
+			 * its own if it exceeds hash_mem, and emits finished groups,
+			 * with the HAVING clause already applied.  Unlike partial
+			 * aggregation, this doesn't need combine functions, and the
+			 * leader doesn't have to merge per-worker hash tables that may
+			 * each hold nearly all the groups.
+			 */
+			if (grouped_rel->consider_parallel && enable_parallel_hashagg &&
+				input_rel->partial_pathlist != NIL)
+			{
+				Path	   *path = (Path *) linitial(input_rel->partial_pathlist);
+				double		dNumPartialGroups;
+
+				/* Each participant sees its share of the groups */
+				dNumPartialGroups = clamp_row_est(dNumGroups * path->rows /
+												  Max(cheapest_path->rows, 1.0));
+
+				path = (Path *) create_repartition_path(root, grouped_rel, path,
+														parse->groupClause);
+				add_partial_path(grouped_rel, (Path *)
+								 create_agg_path(root, grouped_rel,
+												 path,
+												 grouped_rel->reltarget,
+												 AGG_HASHED,
+												 AGGSPLIT_SIMPLE,
+												 parse->groupClause,
+												 havingQual,
+												 agg_costs,
+												 dNumPartialGroups));
+			}
 		}
 
 		/*
@@ -6826,10 +6950,11 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 	}
 
 	/*
-	 * When partitionwise aggregate is used, we might have fully aggregated
-	 * paths in the partial pathlist, because add_paths_to_append_rel() will
-	 * consider a path for grouped_rel consisting of a Parallel Append of
-	 * non-partial paths from each child.
+	 * We might have fully aggregated paths in the partial pathlist, either
+	 * the repartitioned HashAgg path generated above, or, when partitionwise
+	 * aggregate is used, because add_paths_to_append_rel() will consider a
+	 * path for grouped_rel consisting of a Parallel Append of non-partial
+	 * paths from each child.
 	 */
 	if (grouped_rel->partial_pathlist != NIL)
 		gather_grouping_paths(root, grouped_rel);
@@ -752,6 +752,7 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			break;
 
 		case T_Material:
+		case T_Repartition:
 		case T_Sort:
 		case T_IncrementalSort:
 		case T_Unique:
@@ -841,9 +842,28 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 		case T_WindowAgg:
 			{
 				WindowAgg  *wplan = (WindowAgg *) plan;
+				indexed_tlist *subplan_itlist;
 
 				set_upper_references(root, plan, rtoffset);
 
+				/*
+				 * The run condition references the same input columns as the
+				 * node's targetlist, so fix it up the same way.
+				 */
+				if (wplan->runCondition != NIL)
+				{
+					subplan_itlist =
+						build_tlist_index(plan->lefttree->targetlist);
+					wplan->runCondition = (List *)
+						fix_upper_expr(root,
+									   (Node *) wplan->runCondition,
+									   subplan_itlist,
+									   OUTER_VAR,
+									   rtoffset,
+									   NUM_EXEC_QUAL(plan));
+					pfree(subplan_itlist);
+				}
+
 				/*
 				 * Like Limit node limit/offset expressions, WindowAgg has
 				 * frame offset expressions, which cannot contain subplan
@@ -2712,6 +2712,8 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 							  &context);
 			finalize_primnode(((WindowAgg *) plan)->endOffset,
 							  &context);
+			finalize_primnode((Node *) ((WindowAgg *) plan)->runCondition,
+							  &context);
 			break;
 
 		case T_Gather:
@@ -2757,6 +2759,7 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 		case T_ProjectSet:
 		case T_Hash:
 		case T_Material:
+		case T_Repartition:
 		case T_Sort:
 		case T_IncrementalSort:
 		case T_Unique:
@@ -15,6 +15,12 @@
  * accordingly.  It also resolves polymorphic transition types, and sets
  * the 'aggtranstype' fields accordingly.
  *
+ * transform_distinct_aggs() rewrites queries whose aggregates are all
+ * DISTINCT aggregates over the same arguments, so that the duplicates are
+ * eliminated by a separate grouping step instead of per-group sorts in the
+ * Agg node.  Unlike the above, this does affect how the aggregates are
+ * executed, and has to be done before the range table is processed.
+ *
  * XXX: The AggInfo and AggTransInfo structs are thrown away after
  * planning, so executor startup has to perform some of the same lookups
  * of transition functions and initial values that we do here.  One day, we
@@ -37,6 +43,7 @@
 #include "access/htup_details.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_type.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/pathnodes.h"
 #include "optimizer/clauses.h"
@@ -45,6 +52,7 @@
 #include "optimizer/plancat.h"
 #include "optimizer/prep.h"
 #include "parser/parse_agg.h"
+#include "rewrite/rewriteManip.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
@@ -65,6 +73,23 @@ static int	find_compatible_trans(PlannerInfo *root, Aggref *newagg,
 								  List *transnos);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 
+typedef struct
+{
+	Aggref	   *distinctAgg;	/* first DISTINCT aggregate found */
+	List	   *groupExprs;		/* grouping expressions of the query */
+	List	   *groupVars;		/* Vars for them in the outer query */
+	List	   *argVars;		/* Vars for the aggregate arguments */
+	bool		failed;			/* found a reference we can't translate */
+} transform_distinct_aggs_context;
+
+static bool distinct_aggs_walker(Node *node,
+								 transform_distinct_aggs_context *context);
+static Var *distinct_aggs_add_column(Query *subquery, Expr *expr,
+									 char *resname, SortGroupClause *sgc,
+									 AttrNumber resno, List **colnames);
+static Node *distinct_aggs_mutator(Node *node,
+								   transform_distinct_aggs_context *context);
+
 /* -----------------
  * Resolve the transition type of all Aggrefs, and determine which Aggrefs
  * can share aggregate or transition state.
@@ -676,3 +701,280 @@ get_agg_clause_costs(PlannerInfo *root, AggSplit aggsplit, AggClauseCosts *costs
 		}
 	}
 }
+
+/*
+ * transform_distinct_aggs
+ *	  Compute DISTINCT aggregates by grouping on their arguments first
+ *
+ * nodeAgg.c computes a DISTINCT aggregate by sorting the input values of
+ * each group separately, and such aggregates rule out hashed grouping and
+ * parallel aggregation.  If all the aggregates in the query are DISTINCT
+ * aggregates over the same arguments, we can instead move the FROM and WHERE
+ * clauses into a subquery that groups by the query's grouping expressions
+ * plus the aggregate arguments, and aggregate its output without DISTINCT:
+ *
+ *		SELECT day, count(DISTINCT user_id) FROM events GROUP BY day
+ *
+ * becomes
+ *
+ *		SELECT day, count(user_id)
+ *		FROM (SELECT day, user_id FROM events GROUP BY day, user_id) ss
+ *		GROUP BY day
+ *
+ * Both levels are then ordinary aggregations, which the planner can
+ * implement with hashed aggregation (spilling to disk if necessary) and in
+ * parallel, as it sees fit.
+ *
+ * Without DISTINCT, the aggregates no longer see their input values in
+ * sorted order.  We therefore require every aggregate to have a combine
+ * function; parallel aggregation already relies on the results of those not
+ * depending on the input order.
+ *
+ * This must be called before anything else looks at the query's range
+ * table.  The Query is modified in place.
+ */
+void
+transform_distinct_aggs(PlannerInfo *root)
+{
+	Query	   *parse = root->parse;
+	transform_distinct_aggs_context context;
+	Aggref	   *aggref;
+	Query	   *subquery;
+	RangeTblEntry *rte;
+	RangeTblRef *rtr;
+	List	   *colnames = NIL;
+	List	   *newTlist = NIL;
+	Node	   *newHaving;
+	AttrNumber	resno = 1;
+	ListCell   *lc;
+
+	/* Only plain aggregate queries are interesting */
+	if (!parse->hasAggs || parse->hasWindowFuncs || parse->hasTargetSRFs ||
+		parse->hasSubLinks || parse->hasModifyingCTE ||
+		parse->groupingSets || parse->setOperations ||
+		parse->rowMarks || parse->constraintDeps ||
+		parse->commandType != CMD_SELECT)
+		return;
+
+	/* Check that all the aggregates qualify */
+	context.distinctAgg = NULL;
+	if (distinct_aggs_walker((Node *) parse->targetList, &context) ||
+		distinct_aggs_walker(parse->havingQual, &context) ||
+		context.distinctAgg == NULL)
+		return;
+	aggref = context.distinctAgg;
+
+	/*
+	 * Build the subquery's target list and GROUP BY clause: first the
+	 * grouping expressions of the query, then the aggregate arguments.
+	 */
+	subquery = makeNode(Query);
+	subquery->commandType = CMD_SELECT;
+	subquery->querySource = QSRC_ORIGINAL;
+	subquery->canSetTag = true;
+
+	context.groupExprs = NIL;
+	context.groupVars = NIL;
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, parse->targetList);
+
+		context.groupExprs = lappend(context.groupExprs, tle->expr);
+		context.groupVars = lappend(context.groupVars,
+									distinct_aggs_add_column(subquery, tle->expr,
+															 tle->resname, sgc,
+															 resno++,
+															 &colnames));
+	}
+
+	context.argVars = NIL;
+	foreach(lc, aggref->args)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		SortGroupClause *sgc;
+
+		sgc = get_sortgroupref_clause(tle->ressortgroupref,
+									  aggref->aggdistinct);
+		context.argVars = lappend(context.argVars,
+								  distinct_aggs_add_column(subquery, tle->expr,
+														   NULL, sgc,
+														   resno++,
+														   &colnames));
+	}
+
+	/*
+	 * Rewrite the target list and HAVING clause in terms of the subquery's
+	 * outputs.  This fails if they refer to anything else of the query's
+	 * own level, e.g. a join alias variable that the grouping expression was
+	 * written with the underlying column for.  We haven't modified the
+	 * query yet, so we can just give up in that case.
+	 */
+	context.failed = false;
+	foreach(lc, parse->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		TargetEntry *newtle = flatCopyTargetEntry(tle);
+
+		newtle->expr = (Expr *) distinct_aggs_mutator((Node *) tle->expr,
+													  &context);
+		newTlist = lappend(newTlist, newtle);
+	}
+	newHaving = distinct_aggs_mutator(parse->havingQual, &context);
+	if (context.failed)
+		return;
+
+	/*
+	 * Move the FROM and WHERE clauses and the WITH list into the subquery.
+	 * Any references to outer query levels in them are now one level further
+	 * away.
+	 */
+	subquery->rtable = parse->rtable;
+	subquery->jointree = parse->jointree;
+	subquery->cteList = parse->cteList;
+	subquery->hasRecursive = parse->hasRecursive;
+	subquery->hasRowSecurity = parse->hasRowSecurity;
+	IncrementVarSublevelsUp((Node *) subquery, 1, 1);
+
+	rte = makeNode(RangeTblEntry);
+	rte->rtekind = RTE_SUBQUERY;
+	rte->subquery = subquery;
+	rte->eref = makeAlias("*DISTINCT*", colnames);
+	rte->inFromCl = true;
+
+	rtr = makeNode(RangeTblRef);
+	rtr->rtindex = 1;
+
+	parse->rtable = list_make1(rte);
+	parse->jointree = makeFromExpr(list_make1(rtr), NULL);
+	parse->cteList = NIL;
+	parse->hasRecursive = false;
+	parse->targetList = newTlist;
+	parse->havingQual = newHaving;
+}
+
+/*
+ * Check that all the aggregates in the given expression are DISTINCT
+ * aggregates over the same arguments, which have combine functions.
+ * The first one is saved in context->distinctAgg.  Returns true if an
+ * aggregate that doesn't qualify is found.
+ */
+static bool
+distinct_aggs_walker(Node *node, transform_distinct_aggs_context *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Aggref))
+	{
+		Aggref	   *aggref = (Aggref *) node;
+		HeapTuple	aggTuple;
+		Oid			aggcombinefn;
+
+		if (aggref->agglevelsup != 0 ||
+			aggref->aggkind != AGGKIND_NORMAL ||
+			aggref->aggdistinct == NIL ||
+			aggref->aggorder != NIL ||
+			aggref->aggfilter != NULL)
+			return true;
+
+		if (context->distinctAgg == NULL)
+			context->distinctAgg = aggref;
+		else if (!equal(aggref->args, context->distinctAgg->args) ||
+				 !equal(aggref->aggdistinct,
+						context->distinctAgg->aggdistinct))
+			return true;
+
+		aggTuple = SearchSysCache1(AGGFNOID,
+								   ObjectIdGetDatum(aggref->aggfnoid));
+		if (!HeapTupleIsValid(aggTuple))
+			elog(ERROR, "cache lookup failed for aggregate %u",
+				 aggref->aggfnoid);
+		aggcombinefn = ((Form_pg_aggregate) GETSTRUCT(aggTuple))->aggcombinefn;
+		ReleaseSysCache(aggTuple);
+
+		if (!OidIsValid(aggcombinefn))
+			return true;
+
+		/* The arguments can't contain aggregates of this level */
+		return false;
+	}
+	if (IsA(node, GroupingFunc))
+		return true;
+	return expression_tree_walker(node, distinct_aggs_walker,
+								  (void *) context);
+}
+
+/*
+ * Add a grouping column to the subquery built by transform_distinct_aggs,
+ * and return a Var referencing it from the outer query.
+ */
+static Var *
+distinct_aggs_add_column(Query *subquery, Expr *expr, char *resname,
+						 SortGroupClause *sgc, AttrNumber resno,
+						 List **colnames)
+{
+	TargetEntry *tle;
+	SortGroupClause *newsgc;
+
+	tle = makeTargetEntry(copyObject(expr), resno,
+						  resname ? pstrdup(resname) : NULL, false);
+	tle->ressortgroupref = resno;
+	subquery->targetList = lappend(subquery->targetList, tle);
+
+	newsgc = copyObject(sgc);
+	newsgc->tleSortGroupRef = resno;
+	subquery->groupClause = lappend(subquery->groupClause, newsgc);
+
+	*colnames = lappend(*colnames,
+						makeString(resname ? pstrdup(resname) : "?column?"));
+
+	return makeVar(1, resno, exprType((Node *) expr),
+				   exprTypmod((Node *) expr), exprCollation((Node *) expr), 0);
+}
+
+/*
+ * Replace grouping expressions and DISTINCT aggregate arguments with
+ * references to the subquery built by transform_distinct_aggs, and remove
+ * DISTINCT from the aggregates.  Sets context->failed if the expression
+ * refers to any other variable of the query's own level.
+ */
+static Node *
+distinct_aggs_mutator(Node *node, transform_distinct_aggs_context *context)
+{
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Aggref))
+	{
+		Aggref	   *aggref = (Aggref *) node;
+		Aggref	   *newagg = makeNode(Aggref);
+		List	   *newargs = NIL;
+
+		memcpy(newagg, aggref, sizeof(Aggref));
+		forboth(lc1, aggref->args, lc2, context->argVars)
+		{
+			TargetEntry *newtle = flatCopyTargetEntry(lfirst(lc1));
+
+			newtle->expr = (Expr *) copyObject(lfirst(lc2));
+			newtle->ressortgroupref = 0;
+			newargs = lappend(newargs, newtle);
+		}
+		newagg->args = newargs;
+		newagg->aggdistinct = NIL;
+		return (Node *) newagg;
+	}
+	forboth(lc1, context->groupExprs, lc2, context->groupVars)
+	{
+		if (equal(node, lfirst(lc1)))
+			return (Node *) copyObject(lfirst(lc2));
+	}
+	if (IsA(node, Var) && ((Var *) node)->varlevelsup == 0)
+	{
+		context->failed = true;
+		return node;
+	}
+	return expression_tree_mutator(node, distinct_aggs_mutator,
+								   (void *) context);
+}
@@ -1862,6 +1862,45 @@ create_gather_merge_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	return pathnode;
 }
 
+/*
+ * create_repartition_path
+ *	  Creates a pathnode that represents redistributing the rows of a partial
+ *	  path among the participants of a parallel query, so that all the rows
+ *	  with equal values of 'hashClauses' end up in the same participant.
+ *
+ * 'hashClauses' is a list of hashable SortGroupClauses.  The output is
+ * unordered.
+ */
+RepartitionPath *
+create_repartition_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+						List *hashClauses)
+{
+	RepartitionPath *pathnode = makeNode(RepartitionPath);
+
+	Assert(subpath->parallel_safe);
+	Assert(hashClauses != NIL);
+
+	pathnode->path.pathtype = T_Repartition;
+	pathnode->path.parent = rel;
+	pathnode->path.pathtarget = subpath->pathtarget;
+	/* For now, assume we are above any joins, so no parameterization */
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = true;
+	pathnode->path.parallel_safe = rel->consider_parallel &&
+		subpath->parallel_safe;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	/* Repartition does not preserve the input order */
+	pathnode->path.pathkeys = NIL;
+
+	pathnode->subpath = subpath;
+	pathnode->hashClauses = hashClauses;
+
+	cost_repartition(&pathnode->path, subpath->total_cost, subpath->rows,
+					 subpath->pathtarget->width, list_length(hashClauses));
+
+	return pathnode;
+}
+
 /*
  * translate_sub_tlist - get subquery column numbers represented by tlist
  *
@@ -3322,6 +3361,7 @@ create_minmaxagg_path(PlannerInfo *root,
  * 'target' is the PathTarget to be computed
  * 'windowFuncs' is a list of WindowFunc structs
  * 'winclause' is a WindowClause that is common to all the WindowFuncs
+ * 'topwindow' is true if this is the topmost WindowAgg of the window stack
  *
  * The input must be sorted according to the WindowClause's PARTITION keys
  * plus ORDER BY keys.
@@ -3332,7 +3372,8 @@ create_windowagg_path(PlannerInfo *root,
 					  Path *subpath,
 					  PathTarget *target,
 					  List *windowFuncs,
-					  WindowClause *winclause)
+					  WindowClause *winclause,
+					  bool topwindow)
 {
 	WindowAggPath *pathnode = makeNode(WindowAggPath);
 
@@ -3350,6 +3391,7 @@ create_windowagg_path(PlannerInfo *root,
 
 	pathnode->subpath = subpath;
 	pathnode->winclause = winclause;
+	pathnode->topwindow = topwindow;
 
 	/*
 	 * For costing purposes, assume that there are no redundant partitioning
@@ -422,14 +422,18 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 					info->tuples = rel->tuples;
 			}
 
-			if (info->relam == BTREE_AM_OID)
+			if (info->relam == BTREE_AM_OID &&
+				!RelationLacksSessionStorage(indexRelation))
 			{
 				/* For btrees, get tree height while we have the index open */
 				info->tree_height = _bt_getrootheight(indexRelation);
 			}
 			else
 			{
-				/* For other index types, just set it to "unknown" for now */
+				/*
+				 * For other index types, or an index without storage yet,
+				 * just set it to "unknown" for now
+				 */
 				info->tree_height = -1;
 			}
 
@@ -2112,6 +2112,14 @@ do_autovacuum(void)
 			continue;
 		}
 
+		/*
+		 * Global temporary tables have no storage of their own; the data is
+		 * in the private storage of each session using them, which we can't
+		 * process either.
+		 */
+		if (classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			continue;
+
 		/* Fetch reloptions and the pgstat entry for this table */
 		relopts = extract_autovac_opts(tuple, pg_class_desc);
 		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
@@ -2176,8 +2184,10 @@ do_autovacuum(void)
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
+		 * Likewise for the TOAST tables of global temporary tables.
 		 */
-		if (classForm->relpersistence == RELPERSISTENCE_TEMP)
+		if (classForm->relpersistence == RELPERSISTENCE_TEMP ||
+			classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
 			continue;
 
 		relid = classForm->oid;
@@ -385,6 +385,7 @@ static void pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len
 static void pgstat_recv_connstat(PgStat_MsgConn *msg, int len);
 static void pgstat_recv_replslot(PgStat_MsgReplSlot *msg, int len);
 static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
+static void pgstat_recv_tempcompression(PgStat_MsgTempCompression *msg, int len);
 
 /* ------------------------------------------------------------
  * Public functions called from postmaster follow
@@ -1766,6 +1767,29 @@ pgstat_report_tempfile(size_t filesize)
 	pgstat_send(&msg, sizeof(msg));
 }
 
+/* --------
+ * pgstat_report_tempfile_compression() -
+ *
+ *	Tell the collector how much data was written to a compressed temporary
+ *	file, after and before compression.
+ * --------
+ */
+void
+pgstat_report_tempfile_compression(uint64 compressed_bytes,
+								   uint64 uncompressed_bytes)
+{
+	PgStat_MsgTempCompression msg;
+
+	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+		return;
+
+	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TEMPCOMPRESSION);
+	msg.m_databaseid = MyDatabaseId;
+	msg.m_compressed_bytes = compressed_bytes;
+	msg.m_uncompressed_bytes = uncompressed_bytes;
+	pgstat_send(&msg, sizeof(msg));
+}
+
 /* ----------
  * pgstat_report_replslot() -
  *
@@ -4112,6 +4136,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_RECOVERY_PAUSE:
 			event_name = "RecoveryPause";
 			break;
+		case WAIT_EVENT_REPARTITION_SPOOL:
+			event_name = "RepartitionSpool";
+			break;
 		case WAIT_EVENT_REPLICATION_ORIGIN_DROP:
 			event_name = "ReplicationOriginDrop";
 			break;
@@ -5032,6 +5059,11 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_tempfile(&msg.msg_tempfile, len);
 					break;
 
+				case PGSTAT_MTYPE_TEMPCOMPRESSION:
+					pgstat_recv_tempcompression(&msg.msg_tempcompression,
+												len);
+					break;
+
 				case PGSTAT_MTYPE_CHECKSUMFAILURE:
 					pgstat_recv_checksum_failure(&msg.msg_checksumfailure,
 												 len);
@@ -5114,6 +5146,8 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 	dbentry->n_conflict_startup_deadlock = 0;
 	dbentry->n_temp_files = 0;
 	dbentry->n_temp_bytes = 0;
+	dbentry->n_temp_compressed_bytes = 0;
+	dbentry->n_temp_uncompressed_bytes = 0;
 	dbentry->n_deadlocks = 0;
 	dbentry->n_checksum_failures = 0;
 	dbentry->last_checksum_failure = 0;
@@ -7133,6 +7167,23 @@ pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
 	dbentry->n_temp_files += 1;
 }
 
+/* ----------
+ * pgstat_recv_tempcompression() -
+ *
+ *	Process a TEMPCOMPRESSION message.
+ * ----------
+ */
+static void
+pgstat_recv_tempcompression(PgStat_MsgTempCompression *msg, int len)
+{
+	PgStat_StatDBEntry *dbentry;
+
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+
+	dbentry->n_temp_compressed_bytes += msg->m_compressed_bytes;
+	dbentry->n_temp_uncompressed_bytes += msg->m_uncompressed_bytes;
+}
+
 /* ----------
  * pgstat_recv_funcstat() -
  *
@@ -756,7 +756,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isLocalBuf)
 	{
-		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, &found);
+		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, strategy, &found);
 		if (found)
 			pgBufferUsage.local_blks_hit++;
 		else if (isExtend)
@@ -2860,6 +2860,10 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 BlockNumber
 RelationGetNumberOfBlocksInFork(Relation relation, ForkNumber forkNum)
 {
+	/* A global temporary relation is empty until this session uses it */
+	if (RelationLacksSessionStorage(relation))
+		return 0;
+
 	switch (relation->rd_rel->relkind)
 	{
 		case RELKIND_SEQUENCE:
@@ -3458,9 +3462,6 @@ FlushRelationBuffers(Relation rel)
 				 (BM_VALID | BM_DIRTY)) == (BM_VALID | BM_DIRTY))
 			{
 				ErrorContextCallback errcallback;
-				Page		localpage;
-
-				localpage = (char *) LocalBufHdrGetBlock(bufHdr);
 
 				/* Setup error traceback support for ereport() */
 				errcallback.callback = local_buffer_write_error_callback;
@@ -3468,16 +3469,7 @@ FlushRelationBuffers(Relation rel)
 				errcallback.previous = error_context_stack;
 				error_context_stack = &errcallback;
 
-				PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
-
-				smgrwrite(rel->rd_smgr,
-						  bufHdr->tag.forkNum,
-						  bufHdr->tag.blockNum,
-						  localpage,
-						  false);
-
-				buf_state &= ~(BM_DIRTY | BM_JUST_DIRTIED);
-				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+				FlushLocalBuffer(bufHdr, rel->rd_smgr);
 
 				/* Pop the error context stack */
 				error_context_stack = errcallback.previous;
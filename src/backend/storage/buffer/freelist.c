@@ -625,7 +625,7 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 	 * slot by calling AddBufferToRing with the new buffer.
 	 */
 	bufnum = strategy->buffers[strategy->current];
-	if (bufnum == InvalidBuffer)
+	if (bufnum == InvalidBuffer || BufferIsLocal(bufnum))
 	{
 		strategy->current_was_in_ring = false;
 		return NULL;
@@ -671,6 +671,64 @@ AddBufferToRing(BufferAccessStrategy strategy, BufferDesc *buf)
 	strategy->buffers[strategy->current] = BufferDescriptorGetBuffer(buf);
 }
 
+/*
+ * StrategyGetLocalBuffer -- returns a local buffer from the ring, or NULL
+ *		if the caller should run the local clock sweep instead.
+ *
+ * This is the counterpart of GetBufferFromRing for temporary relations.
+ * Local buffers share the ring array with shared ones (they're told apart by
+ * the sign of the buffer number), but only the first 1/8th of the local pool
+ * worth of slots is used, so that a ring never crowds out the session's other
+ * temporary data.  No locking is needed since local buffers are private.
+ */
+BufferDesc *
+StrategyGetLocalBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
+{
+	BufferDesc *buf;
+	Buffer		bufnum;
+	uint32		local_buf_state;
+	int			ring_size;
+
+	ring_size = Min(strategy->ring_size, NLocBuffer / 8);
+	if (ring_size < 1)
+		ring_size = 1;
+
+	/* Advance to next ring slot */
+	if (++strategy->current >= ring_size)
+		strategy->current = 0;
+
+	/* An empty slot, or one holding a shared buffer, is filled by caller */
+	bufnum = strategy->buffers[strategy->current];
+	if (!BufferIsLocal(bufnum))
+	{
+		strategy->current_was_in_ring = false;
+		return NULL;
+	}
+
+	/* Same reuse rules as for shared buffers, see GetBufferFromRing */
+	buf = GetLocalBufferDescriptor(-bufnum - 1);
+	local_buf_state = pg_atomic_read_u32(&buf->state);
+	if (LocalRefCount[-bufnum - 1] == 0
+		&& BUF_STATE_GET_USAGECOUNT(local_buf_state) <= 1)
+	{
+		strategy->current_was_in_ring = true;
+		*buf_state = local_buf_state;
+		return buf;
+	}
+
+	strategy->current_was_in_ring = false;
+	return NULL;
+}
+
+/*
+ * StrategyAddLocalBuffer -- put a local buffer into the current ring slot
+ */
+void
+StrategyAddLocalBuffer(BufferAccessStrategy strategy, BufferDesc *buf)
+{
+	strategy->buffers[strategy->current] = BufferDescriptorGetBuffer(buf);
+}
+
 /*
  * StrategyRejectBuffer -- consider rejecting a dirty buffer
  *
@@ -18,8 +18,10 @@
 #include "access/parallel.h"
 #include "catalog/catalog.h"
 #include "executor/instrument.h"
+#include "funcapi.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
@@ -48,9 +50,30 @@ static int	nextFreeLocalBuf = 0;
 
 static HTAB *LocalBufHash = NULL;
 
+/* number of buffers that have been given memory by GetLocalBufferStorage */
+static int	total_bufs_allocated = 0;
+
+/* statistics, reported by pg_get_backend_local_buffers() */
+typedef struct LocalBufferStats
+{
+	int64		hits;			/* lookups that found the page in a buffer */
+	int64		misses;			/* lookups that had to claim a buffer */
+	int64		writes;			/* dirty pages written out */
+	int64		writes_coalesced;	/* ... of which written with a victim */
+	int64		ring_reuses;	/* victims taken from a strategy ring */
+} LocalBufferStats;
+
+static LocalBufferStats localBufferStats;
+
+/* maximum number of pages written out together when evicting a dirty page */
+#define MAX_LOCAL_WRITE_RUN	32
+
 
 static void InitLocalBuffers(void);
+static void GrowLocalBuffers(int nbufs);
 static Block GetLocalBufferStorage(void);
+static void FlushLocalBufferRun(BufferDesc *victim);
+static BufferDesc *LocalBufferToFlush(BufferTag *tag);
 
 
 /*
@@ -102,12 +125,13 @@ PrefetchLocalBuffer(SMgrRelation smgr, ForkNumber forkNum,
  *
  * API is similar to bufmgr.c's BufferAlloc, except that we do not need
  * to do any locking since this is all local.   Also, IO_IN_PROGRESS
- * does not get set.  Lastly, we support only default access strategy
- * (hence, usage_count is always advanced).
+ * does not get set.  As for shared buffers, a non-default access strategy
+ * makes us recycle a small ring of buffers instead of pushing the rest of
+ * the session's temporary data out of the pool.
  */
 BufferDesc *
 LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
-				 bool *foundPtr)
+				 BufferAccessStrategy strategy, bool *foundPtr)
 {
 	BufferTag	newTag;			/* identity of requested block */
 	LocalBufferLookupEnt *hresult;
@@ -141,13 +165,22 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 		/* this part is equivalent to PinBuffer for a shared buffer */
 		if (LocalRefCount[b] == 0)
 		{
-			if (BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT)
+			if (strategy == NULL)
+			{
+				if (BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT)
+				{
+					buf_state += BUF_USAGECOUNT_ONE;
+					pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+				}
+			}
+			else if (BUF_STATE_GET_USAGECOUNT(buf_state) == 0)
 			{
 				buf_state += BUF_USAGECOUNT_ONE;
 				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
 			}
 		}
 		LocalRefCount[b]++;
+		localBufferStats.hits++;
 		ResourceOwnerRememberBuffer(CurrentResourceOwner,
 									BufferDescriptorGetBuffer(bufHdr));
 		if (buf_state & BM_VALID)
@@ -166,6 +199,25 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 			-nextFreeLocalBuf - 1);
 #endif
 
+	localBufferStats.misses++;
+
+	/*
+	 * If we're using a ring, try to recycle one of its buffers first.
+	 */
+	if (strategy != NULL)
+	{
+		bufHdr = StrategyGetLocalBuffer(strategy, &buf_state);
+		if (bufHdr != NULL)
+		{
+			b = -bufHdr->buf_id - 2;
+			LocalRefCount[b]++;
+			ResourceOwnerRememberBuffer(CurrentResourceOwner,
+										BufferDescriptorGetBuffer(bufHdr));
+			localBufferStats.ring_reuses++;
+			goto have_victim;
+		}
+	}
+
 	/*
 	 * Need to get a new buffer.  We use a clock sweep algorithm (essentially
 	 * the same as what freelist.c does now...)
@@ -205,32 +257,21 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 					 errmsg("no empty local buffer available")));
 	}
 
+	/* Remember the clock sweep's choice in the ring, if we have one */
+	if (strategy != NULL)
+		StrategyAddLocalBuffer(strategy, bufHdr);
+
+have_victim:
+
 	/*
 	 * this buffer is not referenced but it might still be dirty. if that's
-	 * the case, write it out before reusing it!
+	 * the case, write it out before reusing it, along with its dirty
+	 * neighbours.
 	 */
 	if (buf_state & BM_DIRTY)
 	{
-		SMgrRelation oreln;
-		Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
-
-		/* Find smgr relation for buffer */
-		oreln = smgropen(bufHdr->tag.rnode, MyBackendId);
-
-		PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
-
-		/* And write... */
-		smgrwrite(oreln,
-				  bufHdr->tag.forkNum,
-				  bufHdr->tag.blockNum,
-				  localpage,
-				  false);
-
-		/* Mark not-dirty now in case we error out below */
-		buf_state &= ~BM_DIRTY;
-		pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
-
-		pgBufferUsage.local_blks_written++;
+		FlushLocalBufferRun(bufHdr);
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
 	}
 
 	/*
@@ -278,6 +319,117 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 	return bufHdr;
 }
 
+/*
+ * FlushLocalBuffer -
+ *	  write out a dirty local buffer and mark it clean
+ *
+ * reln may be passed if the caller already has the buffer's relation open;
+ * otherwise we look it up.
+ */
+void
+FlushLocalBuffer(BufferDesc *bufHdr, SMgrRelation reln)
+{
+	Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
+	uint32		buf_state;
+
+	/* Find smgr relation for buffer */
+	if (reln == NULL)
+		reln = smgropen(bufHdr->tag.rnode, MyBackendId);
+
+	PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
+
+	/* And write... */
+	smgrwrite(reln,
+			  bufHdr->tag.forkNum,
+			  bufHdr->tag.blockNum,
+			  localpage,
+			  false);
+
+	/* Mark not-dirty now in case we error out later */
+	buf_state = pg_atomic_read_u32(&bufHdr->state);
+	buf_state &= ~(BM_DIRTY | BM_JUST_DIRTIED);
+	pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+
+	pgBufferUsage.local_blks_written++;
+	localBufferStats.writes++;
+}
+
+/*
+ * FlushLocalBufferRun -
+ *	  write out a dirty victim buffer, and the run of dirty pages around it
+ *
+ * A temporary table that doesn't fit in temp_buffers is usually filled and
+ * evicted in block order, so the pages next to the victim are typically
+ * dirty too and would be written one at a time by the next evictions,
+ * between reads of other pages.  Writing the whole run of adjacent dirty,
+ * unpinned pages of the same fork in block order gives the kernel one
+ * sequential stream instead, and lets the following evictions reuse clean
+ * buffers.  The neighbours stay cached; they are merely cleaned.
+ */
+static void
+FlushLocalBufferRun(BufferDesc *victim)
+{
+	BufferTag	tag = victim->tag;
+	BlockNumber victimBlock = tag.blockNum;
+	BlockNumber firstBlock = victimBlock;
+	BlockNumber lastBlock = victimBlock;
+	SMgrRelation reln;
+
+	/* Find how far the run extends on either side of the victim */
+	while (lastBlock - firstBlock + 1 < MAX_LOCAL_WRITE_RUN &&
+		   firstBlock > 0)
+	{
+		tag.blockNum = firstBlock - 1;
+		if (LocalBufferToFlush(&tag) == NULL)
+			break;
+		firstBlock--;
+	}
+	while (lastBlock - firstBlock + 1 < MAX_LOCAL_WRITE_RUN &&
+		   lastBlock < MaxBlockNumber)
+	{
+		tag.blockNum = lastBlock + 1;
+		if (LocalBufferToFlush(&tag) == NULL)
+			break;
+		lastBlock++;
+	}
+
+	reln = smgropen(tag.rnode, MyBackendId);
+
+	for (tag.blockNum = firstBlock; tag.blockNum <= lastBlock; tag.blockNum++)
+	{
+		if (tag.blockNum == victimBlock)
+			FlushLocalBuffer(victim, reln);
+		else
+		{
+			FlushLocalBuffer(LocalBufferToFlush(&tag), reln);
+			localBufferStats.writes_coalesced++;
+		}
+	}
+}
+
+/*
+ * LocalBufferToFlush -
+ *	  return the buffer holding the given page if it is dirty and unpinned,
+ *	  else NULL
+ */
+static BufferDesc *
+LocalBufferToFlush(BufferTag *tag)
+{
+	LocalBufferLookupEnt *hresult;
+	BufferDesc *bufHdr;
+
+	hresult = (LocalBufferLookupEnt *)
+		hash_search(LocalBufHash, (void *) tag, HASH_FIND, NULL);
+	if (!hresult || LocalRefCount[hresult->id] != 0)
+		return NULL;
+
+	bufHdr = GetLocalBufferDescriptor(hresult->id);
+	if (!(pg_atomic_read_u32(&bufHdr->state) & BM_DIRTY))
+		return NULL;
+
+	return bufHdr;
+}
+
 /*
  * MarkLocalBufferDirty -
  *	  mark a local buffer dirty
@@ -480,6 +632,69 @@ InitLocalBuffers(void)
 	NLocBuffer = nbufs;
 }
 
+/*
+ * GrowLocalBuffers -
+ *	  enlarge the local buffer pool to nbufs buffers
+ *
+ * temp_buffers may be raised after the pool has been set up.  We can't
+ * simply move the buffer headers while someone might hold a pointer to one,
+ * so this is only done at end of transaction, when no local buffer is
+ * pinned.  Buffer numbers and page memory stay where they are, so existing
+ * hash table entries and strategy rings remain valid.  The pool never
+ * shrinks.
+ */
+static void
+GrowLocalBuffers(int nbufs)
+{
+	BufferDesc *newdescs;
+	Block	   *newblocks;
+	int32	   *newrefcounts;
+	int			i;
+
+	Assert(nbufs > NLocBuffer);
+
+	/*
+	 * realloc() leaves the old array alone on failure, so if we run out of
+	 * memory part way through we can just keep using the old pool size.
+	 */
+	newdescs = (BufferDesc *)
+		realloc(LocalBufferDescriptors, nbufs * sizeof(BufferDesc));
+	if (newdescs == NULL)
+		goto oom;
+	LocalBufferDescriptors = newdescs;
+
+	newblocks = (Block *)
+		realloc(LocalBufferBlockPointers, nbufs * sizeof(Block));
+	if (newblocks == NULL)
+		goto oom;
+	LocalBufferBlockPointers = newblocks;
+
+	newrefcounts = (int32 *) realloc(LocalRefCount, nbufs * sizeof(int32));
+	if (newrefcounts == NULL)
+		goto oom;
+	LocalRefCount = newrefcounts;
+
+	/* Set up the new entries the same way InitLocalBuffers does */
+	MemSet(LocalBufferDescriptors + NLocBuffer, 0,
+		   (nbufs - NLocBuffer) * sizeof(BufferDesc));
+	MemSet(LocalBufferBlockPointers + NLocBuffer, 0,
+		   (nbufs - NLocBuffer) * sizeof(Block));
+	MemSet(LocalRefCount + NLocBuffer, 0,
+		   (nbufs - NLocBuffer) * sizeof(int32));
+	for (i = NLocBuffer; i < nbufs; i++)
+		GetLocalBufferDescriptor(i)->buf_id = -i - 2;
+
+	NLocBuffer = nbufs;
+	return;
+
+oom:
+	ereport(WARNING,
+			(errcode(ERRCODE_OUT_OF_MEMORY),
+			 errmsg("out of memory"),
+			 errdetail("Could not enlarge local buffer pool from %d to %d buffers.",
+					   NLocBuffer, nbufs)));
+}
+
 /*
  * GetLocalBufferStorage - allocate memory for a local buffer
  *
@@ -495,7 +710,6 @@ GetLocalBufferStorage(void)
 	static char *cur_block = NULL;
 	static int	next_buf_in_block = 0;
 	static int	num_bufs_in_block = 0;
-	static int	total_bufs_allocated = 0;
 	static MemoryContext LocalBufferContext = NULL;
 
 	char	   *this_buf;
@@ -577,6 +791,23 @@ void
 AtEOXact_LocalBuffers(bool isCommit)
 {
 	CheckForLocalBufferLeaks();
+
+	/*
+	 * If temp_buffers has been raised since the pool was created, enlarge it
+	 * now that nothing is pinned.  (If the pool doesn't exist yet, it'll be
+	 * created at the current size on first use.)
+	 */
+	if (LocalBufHash != NULL && num_temp_buffers > NLocBuffer)
+	{
+		int			i;
+
+		for (i = 0; i < NLocBuffer; i++)
+		{
+			if (LocalRefCount[i] != 0)
+				return;
+		}
+		GrowLocalBuffers(num_temp_buffers);
+	}
 }
 
 /*
@@ -594,3 +825,50 @@ AtProcExit_LocalBuffers(void)
 	 */
 	CheckForLocalBufferLeaks();
 }
+
+/*
+ * pg_get_backend_local_buffers
+ *		SQL function showing the size and statistics of the local buffer
+ *		pool of the current backend.
+ */
+Datum
+pg_get_backend_local_buffers(PG_FUNCTION_ARGS)
+{
+#define PG_GET_BACKEND_LOCAL_BUFFERS_COLS	9
+	TupleDesc	tupdesc;
+	Datum		values[PG_GET_BACKEND_LOCAL_BUFFERS_COLS];
+	bool		nulls[PG_GET_BACKEND_LOCAL_BUFFERS_COLS];
+	int			ndirty = 0;
+	int			npinned = 0;
+	int			i;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	for (i = 0; i < NLocBuffer; i++)
+	{
+		uint32		buf_state;
+
+		buf_state = pg_atomic_read_u32(&GetLocalBufferDescriptor(i)->state);
+		if (buf_state & BM_DIRTY)
+			ndirty++;
+		if (LocalRefCount[i] != 0)
+			npinned++;
+	}
+
+	MemSet(nulls, 0, sizeof(nulls));
+
+	/* Until the pool has been created, report the size it would have */
+	values[0] = Int32GetDatum(LocalBufHash != NULL ?
+							  NLocBuffer : num_temp_buffers);
+	values[1] = Int32GetDatum(total_bufs_allocated);
+	values[2] = Int32GetDatum(ndirty);
+	values[3] = Int32GetDatum(npinned);
+	values[4] = Int64GetDatum(localBufferStats.hits);
+	values[5] = Int64GetDatum(localBufferStats.misses);
+	values[6] = Int64GetDatum(localBufferStats.writes);
+	values[7] = Int64GetDatum(localBufferStats.writes_coalesced);
+	values[8] = Int64GetDatum(localBufferStats.ring_reuses);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -40,18 +40,28 @@
  * when the corresponding files need to be survived across the transaction and
  * need to be opened and closed multiple times.  Such files need to be created
  * as a member of a SharedFileSet.
+ *
+ * Finally, private temporary files can be compressed, see "Compressed
+ * BufFiles" below.
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
 #include "commands/tablespace.h"
+#include "common/pg_lzcompress.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/buf_internals.h"
 #include "storage/buffile.h"
 #include "storage/fd.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
 #include "utils/resowner.h"
 
 /*
@@ -62,6 +72,49 @@
 #define MAX_PHYSICAL_FILESIZE	0x40000000
 #define BUFFILE_SEG_SIZE		(MAX_PHYSICAL_FILESIZE / BLCKSZ)
 
+/*
+ * Compressed BufFiles
+ *
+ * A BufFile created by BufFileCreateCompressTemp() while temp_file_compression
+ * is enabled compresses each BLCKSZ-sized logical block of its contents
+ * separately when the block is written out.  The compressed images are
+ * stored one after another in the underlying physical files, and an
+ * in-memory map records where the image of each logical block lives.  That
+ * keeps the file randomly accessible at block granularity, which logtape.c
+ * relies on.  A rewritten block is stored back at its old location if its
+ * new image fits there, and is appended at the end otherwise.  To make the
+ * former more likely, space is reserved in units of BUFFILE_COMPRESS_ALIGN.
+ *
+ * The buffer of a compressed file always holds one whole logical block:
+ * curOffset is a multiple of BLCKSZ, and nbytes is the logical length of the
+ * block, which can be less than BLCKSZ only for the last block of the file.
+ * Compressed files cannot be shared with other backends, and do not support
+ * seeking past the end of the data.  (Ordinary BufFiles would leave a hole in
+ * the file in that case, which none of the users of compression need.)
+ */
+#define BUFFILE_COMPRESS_ALIGN	(BLCKSZ / 16)
+
+#ifdef USE_LZ4
+#define BUFFILE_COMPRESS_BUFSIZE	Max(PGLZ_MAX_OUTPUT(BLCKSZ), \
+										LZ4_COMPRESSBOUND(BLCKSZ))
+#else
+#define BUFFILE_COMPRESS_BUFSIZE	PGLZ_MAX_OUTPUT(BLCKSZ)
+#endif
+
+/*
+ * Location of the image of one logical block of a compressed BufFile.
+ * "offset" is a position in the concatenation of the physical files; images
+ * never cross the boundary between two physical files.
+ */
+typedef struct BufFileBlock
+{
+	int64		offset;			/* start of the reserved space */
+	uint16		capacity;		/* bytes reserved at offset */
+	uint16		len;			/* length of the image */
+	uint16		rawlen;			/* logical length of the block; if equal to
+								 * len, the block is stored uncompressed */
+} BufFileBlock;
+
 /*
  * This data structure represents a buffered file that consists of one or
  * more physical files (each accessed through a virtual file descriptor
@@ -95,9 +148,41 @@ struct BufFile
 	off_t		curOffset;		/* offset part of current pos */
 	int			pos;			/* next read/write position in buffer */
 	int			nbytes;			/* total # of valid bytes in buffer */
+
+	/*
+	 * Compressed files only, see "Compressed BufFiles" above.  compression is
+	 * TEMP_FILE_COMPRESSION_NONE for ordinary files.
+	 */
+	int			compression;	/* compression method */
+	BufFileBlock *blocks;		/* palloc'd map of logical blocks */
+	long		nblocks;		/* # of logical blocks stored */
+	long		maxblocks;		/* allocated length of blocks array */
+	int64		physEnd;		/* end of reserved physical space */
+	uint64		compressedBytes;	/* bytes written, after compression */
+	uint64		uncompressedBytes;	/* bytes written, before compression */
+
 	PGAlignedBlock buffer;
 };
 
+/* GUC variables */
+int			temp_file_compression = TEMP_FILE_COMPRESSION_NONE;
+
+const struct config_enum_entry temp_file_compression_options[] = {
+	{"pglz", TEMP_FILE_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", TEMP_FILE_COMPRESSION_LZ4, false},
+#endif
+	{"off", TEMP_FILE_COMPRESSION_NONE, false},
+	{"none", TEMP_FILE_COMPRESSION_NONE, true},
+	{NULL, 0, false}
+};
+
+/*
+ * Workspace for compressed block images, shared by all compressed files of
+ * the backend.  Allocated on first use.
+ */
+static char *compress_buffer = NULL;
+
 static BufFile *makeBufFileCommon(int nfiles);
 static BufFile *makeBufFile(File firstfile);
 static void extendBufFile(BufFile *file);
@@ -105,6 +190,13 @@ static void BufFileLoadBuffer(BufFile *file);
 static void BufFileDumpBuffer(BufFile *file);
 static void BufFileFlush(BufFile *file);
 static File MakeNewSharedSegment(BufFile *file, int segment);
+static void BufFileLoadCompressed(BufFile *file);
+static void BufFileDumpCompressed(BufFile *file);
+static void BufFileNextBlock(BufFile *file);
+static int	BufFileCompress(BufFile *file);
+static void BufFileDecompress(BufFile *file, BufFileBlock *blk);
+static int64 BufFileLogicalSize(BufFile *file);
+static int	BufFileSeekCompressed(BufFile *file, int fileno, off_t offset);
 
 /*
  * Create BufFile and perform the common initialization.
@@ -122,6 +214,13 @@ makeBufFileCommon(int nfiles)
 	file->curOffset = 0L;
 	file->pos = 0;
 	file->nbytes = 0;
+	file->compression = TEMP_FILE_COMPRESSION_NONE;
+	file->blocks = NULL;
+	file->nblocks = 0;
+	file->maxblocks = 0;
+	file->physEnd = 0;
+	file->compressedBytes = 0;
+	file->uncompressedBytes = 0;
 
 	return file;
 }
@@ -210,6 +309,33 @@ BufFileCreateTemp(bool interXact)
 	return file;
 }
 
+/*
+ * Create a BufFile for a new temporary file like BufFileCreateTemp, which is
+ * compressed if temp_file_compression says so.
+ *
+ * The caller must be content with the restrictions on compressed files: they
+ * can't be shared, and can't be seeked past their end.
+ */
+BufFile *
+BufFileCreateCompressTemp(bool interXact)
+{
+	BufFile    *file = BufFileCreateTemp(interXact);
+
+	if (temp_file_compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		file->compression = temp_file_compression;
+		file->maxblocks = 64;	/* grows as needed */
+		file->blocks = (BufFileBlock *)
+			palloc(file->maxblocks * sizeof(BufFileBlock));
+
+		if (compress_buffer == NULL)
+			compress_buffer = MemoryContextAlloc(TopMemoryContext,
+												 BUFFILE_COMPRESS_BUFSIZE);
+	}
+
+	return file;
+}
+
 /*
  * Build the name for a given segment of a given BufFile.
  */
@@ -401,6 +527,13 @@ BufFileClose(BufFile *file)
 	/* close and delete the underlying file(s) */
 	for (i = 0; i < file->numFiles; i++)
 		FileClose(file->files[i]);
+	if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		if (file->uncompressedBytes > 0)
+			pgstat_report_tempfile_compression(file->compressedBytes,
+											   file->uncompressedBytes);
+		pfree(file->blocks);
+	}
 	/* release the buffer space */
 	pfree(file->files);
 	pfree(file);
@@ -418,6 +551,12 @@ BufFileLoadBuffer(BufFile *file)
 {
 	File		thisfile;
 
+	if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		BufFileLoadCompressed(file);
+		return;
+	}
+
 	/*
 	 * Advance to next component file if necessary and possible.
 	 */
@@ -466,6 +605,12 @@ BufFileDumpBuffer(BufFile *file)
 	int			bytestowrite;
 	File		thisfile;
 
+	if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		BufFileDumpCompressed(file);
+		return;
+	}
+
 	/*
 	 * Unlike BufFileLoadBuffer, we must dump the whole buffer even if it
 	 * crosses a component-file boundary; so we need a loop.
@@ -551,6 +696,17 @@ BufFileRead(BufFile *file, void *ptr, size_t size)
 	{
 		if (file->pos >= file->nbytes)
 		{
+			if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+			{
+				/* Only a full block can be followed by another one */
+				if (file->pos < BLCKSZ)
+					break;
+				BufFileNextBlock(file);
+				if (file->nbytes <= 0)
+					break;		/* no more data available */
+				continue;
+			}
+
 			/* Try to load more data into buffer. */
 			file->curOffset += file->pos;
 			file->pos = 0;
@@ -593,8 +749,14 @@ BufFileWrite(BufFile *file, void *ptr, size_t size)
 	{
 		if (file->pos >= BLCKSZ)
 		{
+			if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+			{
+				/* Write out this block, and move on to the next one */
+				BufFileFlush(file);
+				BufFileNextBlock(file);
+			}
 			/* Buffer full, dump it out */
-			if (file->dirty)
+			else if (file->dirty)
 				BufFileDumpBuffer(file);
 			else
 			{
@@ -672,6 +834,14 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 			break;
 		case SEEK_END:
 
+			/* The size of a compressed file is known from its block map */
+			if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+			{
+				newFile = 0;
+				newOffset = BufFileLogicalSize(file);
+				break;
+			}
+
 			/*
 			 * The file size of the last file gives us the end offset of that
 			 * file.
@@ -695,6 +865,8 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 			return EOF;
 		newOffset += MAX_PHYSICAL_FILESIZE;
 	}
+	if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+		return BufFileSeekCompressed(file, newFile, newOffset);
 	if (newFile == file->curFile &&
 		newOffset >= file->curOffset &&
 		newOffset <= file->curOffset + file->nbytes)
@@ -947,3 +1119,288 @@ BufFileTruncateShared(BufFile *file, int fileno, off_t offset)
 	}
 	/* Nothing to do, if the truncate point is beyond current file. */
 }
+
+/*
+ * Logical block number of the current buffer of a compressed file.
+ */
+static inline long
+BufFileCurrentBlock(BufFile *file)
+{
+	return (long) file->curFile * BUFFILE_SEG_SIZE + file->curOffset / BLCKSZ;
+}
+
+/*
+ * BufFileLoadCompressed
+ *
+ * Load the logical block at curOffset of a compressed file into the buffer.
+ * At call, must have dirty = false.  On exit, nbytes is the length of the
+ * block, or 0 if it hasn't been written yet.
+ */
+static void
+BufFileLoadCompressed(BufFile *file)
+{
+	long		blknum = BufFileCurrentBlock(file);
+	BufFileBlock *blk;
+	File		thisfile;
+	char	   *image;
+	int			nread;
+
+	Assert(!file->dirty);
+
+	file->nbytes = 0;
+	if (blknum >= file->nblocks)
+		return;
+
+	blk = &file->blocks[blknum];
+	thisfile = file->files[blk->offset / MAX_PHYSICAL_FILESIZE];
+	image = (blk->len == blk->rawlen) ? file->buffer.data : compress_buffer;
+	nread = FileRead(thisfile,
+					 image,
+					 blk->len,
+					 blk->offset % MAX_PHYSICAL_FILESIZE,
+					 WAIT_EVENT_BUFFILE_READ);
+	if (nread < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						FilePathName(thisfile))));
+	if (nread != blk->len)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("could not read file \"%s\": read only %d of %d bytes",
+						FilePathName(thisfile), nread, (int) blk->len)));
+
+	if (blk->len != blk->rawlen)
+		BufFileDecompress(file, blk);
+	file->nbytes = blk->rawlen;
+
+	pgBufferUsage.temp_blks_read++;
+}
+
+/*
+ * BufFileDumpCompressed
+ *
+ * Compress the block in the buffer of a compressed file, and write it out.
+ * At call, should have dirty = true, nbytes > 0.  Unlike BufFileDumpBuffer,
+ * this leaves the buffer and the logical position alone.
+ */
+static void
+BufFileDumpCompressed(BufFile *file)
+{
+	long		blknum = BufFileCurrentBlock(file);
+	BufFileBlock *blk;
+	File		thisfile;
+	char	   *image;
+	int			len;
+	int			nwritten;
+
+	Assert(file->dirty && file->nbytes > 0);
+	/* We never seek past the end, so the block map can't have holes */
+	Assert(blknum <= file->nblocks);
+
+	len = BufFileCompress(file);
+	if (len >= 0)
+		image = compress_buffer;
+	else
+	{
+		/* Incompressible, store as is */
+		image = file->buffer.data;
+		len = file->nbytes;
+	}
+
+	if (blknum == file->nblocks)
+	{
+		if (file->nblocks >= file->maxblocks)
+		{
+			file->maxblocks *= 2;
+			file->blocks = (BufFileBlock *)
+				repalloc(file->blocks, file->maxblocks * sizeof(BufFileBlock));
+		}
+		file->blocks[file->nblocks++].capacity = 0;
+	}
+	blk = &file->blocks[blknum];
+
+	/* Reserve new space at the end, unless the image fits in the old space */
+	if (len > blk->capacity)
+	{
+		int			capacity = (int) TYPEALIGN(BUFFILE_COMPRESS_ALIGN, len);
+
+		if (file->physEnd % MAX_PHYSICAL_FILESIZE + capacity > MAX_PHYSICAL_FILESIZE)
+			file->physEnd += MAX_PHYSICAL_FILESIZE -
+				file->physEnd % MAX_PHYSICAL_FILESIZE;
+		blk->offset = file->physEnd;
+		blk->capacity = capacity;
+		file->physEnd += capacity;
+
+		while (blk->offset / MAX_PHYSICAL_FILESIZE >= file->numFiles)
+			extendBufFile(file);
+	}
+	blk->len = len;
+	blk->rawlen = file->nbytes;
+
+	thisfile = file->files[blk->offset / MAX_PHYSICAL_FILESIZE];
+	nwritten = FileWrite(thisfile,
+						 image,
+						 len,
+						 blk->offset % MAX_PHYSICAL_FILESIZE,
+						 WAIT_EVENT_BUFFILE_WRITE);
+	if (nwritten != len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m",
+						FilePathName(thisfile))));
+	file->dirty = false;
+
+	file->compressedBytes += len;
+	file->uncompressedBytes += file->nbytes;
+	pgBufferUsage.temp_blks_written++;
+	pgBufferUsage.temp_compressed_bytes += len;
+	pgBufferUsage.temp_uncompressed_bytes += file->nbytes;
+}
+
+/*
+ * BufFileNextBlock
+ *
+ * Advance a compressed file to the start of the next logical block, and load
+ * that block.  At call, must have dirty = false.
+ */
+static void
+BufFileNextBlock(BufFile *file)
+{
+	Assert(!file->dirty);
+
+	file->curOffset += BLCKSZ;
+	if (file->curOffset >= MAX_PHYSICAL_FILESIZE)
+	{
+		file->curFile++;
+		file->curOffset = 0L;
+	}
+	file->pos = 0;
+	BufFileLoadCompressed(file);
+}
+
+/*
+ * Return the logical size of a compressed file, including any data in the
+ * buffer that hasn't been written out yet.
+ */
+static int64
+BufFileLogicalSize(BufFile *file)
+{
+	int64		size = 0;
+	int64		bufend;
+
+	if (file->nblocks > 0)
+		size = (int64) (file->nblocks - 1) * BLCKSZ +
+			file->blocks[file->nblocks - 1].rawlen;
+
+	bufend = (int64) file->curFile * MAX_PHYSICAL_FILESIZE +
+		file->curOffset + file->nbytes;
+
+	return Max(size, bufend);
+}
+
+/*
+ * BufFileSeekCompressed
+ *
+ * The part of BufFileSeek specific to compressed files.  fileno and offset
+ * are the target position, already normalized so that offset >= 0.
+ */
+static int
+BufFileSeekCompressed(BufFile *file, int fileno, off_t offset)
+{
+	int64		target = (int64) fileno * MAX_PHYSICAL_FILESIZE + offset;
+	int64		bufstart = (int64) file->curFile * MAX_PHYSICAL_FILESIZE +
+	file->curOffset;
+
+	if (target >= bufstart && target <= bufstart + file->nbytes)
+	{
+		/* Seek is within the current block, as in BufFileSeek */
+		file->pos = (int) (target - bufstart);
+		return 0;
+	}
+
+	if (target > BufFileLogicalSize(file))
+		return EOF;
+
+	/* Write out the current block, and load the one containing the target */
+	BufFileFlush(file);
+	file->curFile = (int) (target / MAX_PHYSICAL_FILESIZE);
+	file->curOffset = (target % MAX_PHYSICAL_FILESIZE) - (target % BLCKSZ);
+	BufFileLoadCompressed(file);
+	file->pos = (int) (target % BLCKSZ);
+	return 0;
+}
+
+/*
+ * Compress the contents of the buffer into compress_buffer, using the
+ * compression method of the file.  Returns the compressed length, or -1 if
+ * compression would not save any space.
+ */
+static int
+BufFileCompress(BufFile *file)
+{
+	int			len;
+
+	switch ((TempFileCompression) file->compression)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			len = pglz_compress(file->buffer.data, file->nbytes,
+								compress_buffer, PGLZ_strategy_default);
+			break;
+
+#ifdef USE_LZ4
+		case TEMP_FILE_COMPRESSION_LZ4:
+			len = LZ4_compress_default(file->buffer.data, compress_buffer,
+									   file->nbytes, BUFFILE_COMPRESS_BUFSIZE);
+			if (len <= 0)
+				len = -1;		/* failure */
+			break;
+#endif
+
+		default:
+			elog(ERROR, "invalid temporary file compression method: %d",
+				 file->compression);
+			len = -1;			/* keep compiler quiet */
+			break;
+	}
+
+	if (len >= file->nbytes)
+		len = -1;
+
+	return len;
+}
+
+/*
+ * Decompress the image of the given block from compress_buffer into the buffer.
+ */
+static void
+BufFileDecompress(BufFile *file, BufFileBlock *blk)
+{
+	int			rawlen;
+
+	switch ((TempFileCompression) file->compression)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			rawlen = pglz_decompress(compress_buffer, blk->len,
+									 file->buffer.data, blk->rawlen, true);
+			break;
+
+#ifdef USE_LZ4
+		case TEMP_FILE_COMPRESSION_LZ4:
+			rawlen = LZ4_decompress_safe(compress_buffer, file->buffer.data,
+										 blk->len, blk->rawlen);
+			break;
+#endif
+
+		default:
+			elog(ERROR, "invalid temporary file compression method: %d",
+				 file->compression);
+			rawlen = -1;		/* keep compiler quiet */
+			break;
+	}
+
+	if (rawlen != blk->rawlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed data in temporary file is corrupted")));
+}
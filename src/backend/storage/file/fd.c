@@ -2155,6 +2155,96 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileZero - write zeroes over the given range of a file
+ *
+ * Returns 0 on success, or -1 with errno set on failure (a short write is
+ * reported as ENOSPC).  The range may extend past the current end of file.
+ */
+int
+FileZero(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+	static const PGAlignedBlock zerobuf = {{0}};
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileZero: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	while (amount > 0)
+	{
+		int			chunk = (int) Min(amount, (off_t) BLCKSZ);
+		int			written;
+
+		written = FileWrite(file, (char *) zerobuf.data, chunk, offset,
+							wait_event_info);
+		if (written != chunk)
+		{
+			if (written >= 0)
+				errno = ENOSPC;
+			return -1;
+		}
+
+		offset += chunk;
+		amount -= chunk;
+	}
+
+	return 0;
+}
+
+/*
+ * FileFallocate - allocate disk space for the given range of a file
+ *
+ * The new space reads as zeroes.  Where posix_fallocate() is available this
+ * just reserves the space, which is much cheaper than writing out zeroes;
+ * otherwise, or if the filesystem doesn't support it, we fall back to
+ * FileZero().  Returns 0 on success, or -1 with errno set on failure.
+ */
+int
+FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileFallocate: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	/* temp files need their size tracked, which FileZero takes care of */
+	if (VfdCache[file].fdstate & FD_TEMP_FILE_LIMIT)
+		return FileZero(file, offset, amount, wait_event_info);
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = posix_fallocate(VfdCache[file].fd, offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+	else if (returnCode == EINTR)
+		goto retry;
+
+	/* for compatibility with %m printing etc */
+	errno = returnCode;
+
+	/*
+	 * Return in case of a "real" failure; if fallocate is not supported,
+	 * fall through to the FileZero() backed implementation.
+	 */
+	if (returnCode != EINVAL && returnCode != EOPNOTSUPP)
+		return -1;
+#endif
+
+	return FileZero(file, offset, amount, wait_event_info);
+}
+
 int
 FileSync(File file, uint32 wait_event_info)
 {
@@ -22,6 +22,7 @@
 #include "access/subtrans.h"
 #include "access/syncscan.h"
 #include "access/twophase.h"
+#include "catalog/globaltemp.h"
 #include "commands/async.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -44,7 +45,10 @@
 #include "storage/procarray.h"
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
+#include "storage/smgr.h"
 #include "storage/spin.h"
+#include "utils/catcache.h"
+#include "utils/plancache.h"
 #include "utils/snapmgr.h"
 
 /* GUCs */
@@ -122,6 +126,7 @@ CreateSharedMemoryAndSemaphores(void)
 												 sizeof(ShmemIndexEnt)));
 		size = add_size(size, dsm_estimate_size());
 		size = add_size(size, BufferShmemSize());
+		size = add_size(size, SmgrShmemSize());
 		size = add_size(size, LockShmemSize());
 		size = add_size(size, PredicateLockShmemSize());
 		size = add_size(size, ProcGlobalShmemSize());
@@ -149,6 +154,9 @@ CreateSharedMemoryAndSemaphores(void)
 		size = add_size(size, BTreeShmemSize());
 		size = add_size(size, SyncScanShmemSize());
 		size = add_size(size, AsyncShmemSize());
+		size = add_size(size, CatCacheShmemSize());
+		size = add_size(size, PlanCacheShmemSize());
+		size = add_size(size, GlobalTempShmemSize());
 #ifdef EXEC_BACKEND
 		size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -213,7 +221,7 @@ CreateSharedMemoryAndSemaphores(void)
 	dsm_shmem_init();
 
 	/*
-	 * Set up xlog, clog, and buffers
+	 * Set up xlog, clog, buffers, and the relation size cache
 	 */
 	XLOGShmemInit();
 	CLOGShmemInit();
@@ -221,6 +229,7 @@ CreateSharedMemoryAndSemaphores(void)
 	SUBTRANSShmemInit();
 	MultiXactShmemInit();
 	InitBufferPool();
+	SmgrShmemInit();
 
 	/*
 	 * Set up lock manager
@@ -267,6 +276,9 @@ CreateSharedMemoryAndSemaphores(void)
 	BTreeShmemInit();
 	SyncScanShmemInit();
 	AsyncShmemInit();
+	CatCacheShmemInit();
+	PlanCacheShmemInit();
+	GlobalTempShmemInit();
 
 #ifdef EXEC_BACKEND
 
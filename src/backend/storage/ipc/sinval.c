@@ -16,11 +16,14 @@
 
 #include "access/xact.h"
 #include "commands/async.h"
+#include "common/hashfn.h"
 #include "miscadmin.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
+#include "utils/catcache.h"
 #include "utils/inval.h"
+#include "utils/plancache.h"
 
 
 uint64		SharedInvalidMessageCounter;
@@ -40,15 +43,198 @@ uint64		SharedInvalidMessageCounter;
  */
 volatile sig_atomic_t catchupInterruptPending = false;
 
+/*
+ * Hash table of the messages seen by CoalesceInvalidationMessages, keyed by
+ * the message with its unused bytes zeroed.
+ */
+typedef struct InvalMsgEntry
+{
+	SharedInvalidationMessage msg;	/* hash key */
+	char		status;			/* hash status */
+} InvalMsgEntry;
+
+#define SH_PREFIX invalmsg
+#define SH_ELEMENT_TYPE InvalMsgEntry
+#define SH_KEY_TYPE SharedInvalidationMessage
+#define SH_KEY msg
+#define SH_HASH_KEY(tb, key) \
+	hash_bytes((const unsigned char *) &(key), sizeof(SharedInvalidationMessage))
+#define SH_EQUAL(tb, a, b) \
+	(memcmp(&(a), &(b), sizeof(SharedInvalidationMessage)) == 0)
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+/*
+ * Batches smaller than this are sent as they are.  They take little room in
+ * the queue anyway, and building a hash table for them costs more than
+ * receivers would save.
+ */
+#define INVALMSG_COALESCE_MIN	32
+
+static void NormalizeInvalidationMessage(const SharedInvalidationMessage *msg,
+										 SharedInvalidationMessage *norm);
+static SharedInvalidationMessage *CoalesceInvalidationMessages(const SharedInvalidationMessage *msgs,
+															   int *n);
+
 
 /*
  * SendSharedInvalidMessages
  *	Add shared-cache-invalidation message(s) to the global SI message queue.
+ *
+ * Duplicate messages are sent only once, so that they take up less room in
+ * the queue, and every backend doesn't have to process them again.
  */
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
+	SharedInvalidationMessage *coalesced;
+
+	coalesced = CoalesceInvalidationMessages(msgs, &n);
+	if (coalesced)
+		msgs = coalesced;
+
+	/*
+	 * The shared catalog cache must not hold invalidated tuples by the time
+	 * anyone can process the messages.
+	 */
+	if (shared_catalog_cache_size > 0)
+	{
+		int			i;
+
+		for (i = 0; i < n; i++)
+		{
+			if (msgs[i].id >= 0)
+				SharedCatCacheInvalidate(msgs[i].cc.id, msgs[i].cc.dbId,
+										 msgs[i].cc.hashValue);
+			else if (msgs[i].id == SHAREDINVALCATALOG_ID)
+				SharedCatCacheReset();
+		}
+	}
+
 	SIInsertDataEntries(msgs, n);
+
+	/*
+	 * Plans in the shared plan cache are checked against invalidation
+	 * counters instead, which must advance only once the messages can be
+	 * read.
+	 */
+	if (shared_plan_cache_size > 0)
+	{
+		int			i;
+
+		for (i = 0; i < n; i++)
+		{
+			if (msgs[i].id >= 0)
+				SharedPlanCacheInvalidateObject(msgs[i].cc.id,
+												msgs[i].cc.hashValue);
+			else if (msgs[i].id == SHAREDINVALRELCACHE_ID)
+				SharedPlanCacheInvalidateRelation(msgs[i].rc.relId);
+			else if (msgs[i].id == SHAREDINVALCATALOG_ID)
+				SharedPlanCacheReset();
+		}
+	}
+
+	if (coalesced)
+		pfree(coalesced);
+}
+
+/*
+ * Copy the fields of an invalidation message that matter into a zeroed
+ * message, so that equal messages compare equal bytewise.
+ */
+static void
+NormalizeInvalidationMessage(const SharedInvalidationMessage *msg,
+							 SharedInvalidationMessage *norm)
+{
+	memset(norm, 0, sizeof(SharedInvalidationMessage));
+
+	if (msg->id >= 0)
+	{
+		norm->cc.id = msg->cc.id;
+		norm->cc.dbId = msg->cc.dbId;
+		norm->cc.hashValue = msg->cc.hashValue;
+	}
+	else if (msg->id == SHAREDINVALCATALOG_ID)
+	{
+		norm->cat.id = msg->cat.id;
+		norm->cat.dbId = msg->cat.dbId;
+		norm->cat.catId = msg->cat.catId;
+	}
+	else if (msg->id == SHAREDINVALRELCACHE_ID)
+	{
+		norm->rc.id = msg->rc.id;
+		norm->rc.dbId = msg->rc.dbId;
+		norm->rc.relId = msg->rc.relId;
+	}
+	else if (msg->id == SHAREDINVALSMGR_ID)
+	{
+		norm->sm.id = msg->sm.id;
+		norm->sm.backend_hi = msg->sm.backend_hi;
+		norm->sm.backend_lo = msg->sm.backend_lo;
+		norm->sm.rnode = msg->sm.rnode;
+	}
+	else if (msg->id == SHAREDINVALRELMAP_ID)
+	{
+		norm->rm.id = msg->rm.id;
+		norm->rm.dbId = msg->rm.dbId;
+	}
+	else if (msg->id == SHAREDINVALSNAPSHOT_ID)
+	{
+		norm->sn.id = msg->sn.id;
+		norm->sn.dbId = msg->sn.dbId;
+		norm->sn.relId = msg->sn.relId;
+	}
+	else
+		*norm = *msg;
+}
+
+/*
+ * Remove duplicates from a batch of invalidation messages.
+ *
+ * Processing a message twice has no more effect than processing it once, so
+ * only the first of each set of equal messages is kept; the messages stay in
+ * order otherwise.  Returns a palloc'd array of the remaining messages and
+ * updates *n, or returns NULL if there are no duplicates.  We don't bother
+ * for small batches, nor in a critical section, where we must not allocate
+ * memory.
+ */
+static SharedInvalidationMessage *
+CoalesceInvalidationMessages(const SharedInvalidationMessage *msgs, int *n)
+{
+	invalmsg_hash *seen;
+	SharedInvalidationMessage *result;
+	int			nresult = 0;
+	int			i;
+
+	if (*n < INVALMSG_COALESCE_MIN || CritSectionCount > 0)
+		return NULL;
+
+	seen = invalmsg_create(CurrentMemoryContext, *n, NULL);
+	result = palloc(sizeof(SharedInvalidationMessage) * *n);
+
+	for (i = 0; i < *n; i++)
+	{
+		SharedInvalidationMessage norm;
+		bool		found;
+
+		NormalizeInvalidationMessage(&msgs[i], &norm);
+		(void) invalmsg_insert(seen, norm, &found);
+		if (!found)
+			result[nresult++] = msgs[i];
+	}
+
+	invalmsg_destroy(seen);
+
+	if (nresult == *n)
+	{
+		pfree(result);
+		return NULL;
+	}
+
+	*n = nresult;
+	return result;
 }
 
 /*
@@ -19,6 +19,7 @@
 
 #include "access/transam.h"
 #include "miscadmin.h"
+#include "port/pg_bitutils.h"
 #include "storage/backendid.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
@@ -26,6 +27,7 @@
 #include "storage/shmem.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
+#include "utils/syscache.h"
 
 /*
  * Conceptually, the shared cache invalidation messages are stored in an
@@ -42,16 +44,24 @@
  * smallest nextMsgNum --- it may lag behind.  We only update it when
  * SICleanupQueue is called, and we try not to do that often.)
  *
- * In reality, the messages are stored in a circular buffer of MAXNUMMESSAGES
- * entries.  We translate MsgNum values into circular-buffer indexes by
- * computing MsgNum % MAXNUMMESSAGES (this should be fast as long as
- * MAXNUMMESSAGES is a constant and a power of 2).  As long as maxMsgNum
- * doesn't exceed minMsgNum by more than MAXNUMMESSAGES, we have enough space
- * in the buffer.  If the buffer does overflow, we recover by setting the
- * "reset" flag for each backend that has fallen too far behind.  A backend
- * that is in "reset" state is ignored while determining minMsgNum.  When
- * it does finally attempt to receive inval messages, it must discard all
- * its invalidatable state, since it won't know what it missed.
+ * In reality, the messages are stored in a circular buffer of numMessages
+ * entries, which is invalidation_queue_size rounded up to a power of 2.  We
+ * translate MsgNum values into circular-buffer indexes by masking off the
+ * high bits of MsgNum.  As long as maxMsgNum doesn't exceed minMsgNum by more
+ * than numMessages, we have enough space in the buffer.  If the buffer does
+ * overflow, backends that have fallen too far behind must skip the messages
+ * that are in the way.  Rather than making them discard all their
+ * invalidatable state, we record a summary of the skipped messages in their
+ * ProcState: the catcaches and catalogs that they touched, and the relations
+ * whose relcache entries they invalidated, up to a limit.  Messages that
+ * can't be summarized, like smgr invalidations, or too many relations, make
+ * the summary cover the whole relcache.  When the backend next receives
+ * inval messages, it gets messages made from the summary first, which flush
+ * the affected caches as a whole.  Only when the summary would be too long
+ * do we fall back to setting the backend's "reset" flag.  A backend that is
+ * in "reset" state is ignored while determining minMsgNum.  When it does
+ * finally attempt to receive inval messages, it must discard all its
+ * invalidatable state, since it won't know what it missed.
  *
  * To reduce the probability of needing resets, we send a "catchup" interrupt
  * to any backend that seems to be falling unreasonably far behind.  The
@@ -73,7 +83,7 @@
  * whenever minMsgNum exceeds MSGNUMWRAPAROUND, we subtract MSGNUMWRAPAROUND
  * from all the MsgNum variables simultaneously.  MSGNUMWRAPAROUND can be
  * large so that we don't need to do this often.  It must be a multiple of
- * MAXNUMMESSAGES so that the existing circular-buffer entries don't need
+ * numMessages so that the existing circular-buffer entries don't need
  * to be moved when we do it.
  *
  * Access to the shared sinval array is protected by two locks, SInvalReadLock
@@ -106,11 +116,13 @@
 /*
  * Configurable parameters.
  *
- * MAXNUMMESSAGES: max number of shared-inval messages we can buffer.
- * Must be a power of 2 for speed.
+ * invalidation_queue_size: number of shared-inval messages we can buffer.
+ * It's rounded up to a power of 2 for speed, and saved in numMessages.
  *
  * MSGNUMWRAPAROUND: how often to reduce MsgNum variables to avoid overflow.
- * Must be a multiple of MAXNUMMESSAGES.  Should be large.
+ * Must be a multiple of numMessages, which it is because it's a power of 2
+ * no smaller than the largest allowed invalidation_queue_size.  Should be
+ * large.
  *
  * CLEANUP_MIN: the minimum number of messages that must be in the buffer
  * before we bother to call SICleanupQueue.
@@ -127,13 +139,41 @@
  * per iteration.
  */
 
-#define MAXNUMMESSAGES 4096
-#define MSGNUMWRAPAROUND (MAXNUMMESSAGES * 262144)
-#define CLEANUP_MIN (MAXNUMMESSAGES / 2)
-#define CLEANUP_QUANTUM (MAXNUMMESSAGES / 16)
-#define SIG_THRESHOLD (MAXNUMMESSAGES / 2)
+int			invalidation_queue_size = 16384;
+
+#define MSGNUMWRAPAROUND (1 << 30)
+#define CLEANUP_MIN(segP) ((segP)->numMessages / 2)
+#define CLEANUP_QUANTUM(segP) ((segP)->numMessages / 16)
+#define SIG_THRESHOLD(segP) ((segP)->numMessages / 2)
 #define WRITE_QUANTUM 64
 
+/* circular buffer slot of a MsgNum */
+#define SI_BUFFER_SLOT(segP, msgnum) ((msgnum) & ((segP)->numMessages - 1))
+
+/*
+ * Limits on the summary of messages a backend missed.  The summary can
+ * expand into at most SI_LOST_MAX_MSGS messages.
+ */
+#define SI_LOST_MAX_RELS 32
+#define SI_LOST_MAX_CATALOGS 8
+#define SI_LOST_CATCACHE_WORDS ((SysCacheSize + 31) / 32)
+#define SI_LOST_MAX_MSGS \
+	(3 + SysCacheSize + SI_LOST_MAX_CATALOGS + SI_LOST_MAX_RELS)
+
+/* Summary of the messages a backend had to skip; see top of file */
+typedef struct SILostSummary
+{
+	bool		pending;		/* were any messages skipped? */
+	bool		overflow;		/* too much to summarize, must reset */
+	bool		allRels;		/* must invalidate the whole relcache */
+	bool		relmap;			/* must reload the relation maps */
+	int			nrels;			/* # of valid entries in rels[] */
+	int			ncatalogs;		/* # of valid entries in catalogs[] */
+	Oid			rels[SI_LOST_MAX_RELS]; /* relcache entries to invalidate */
+	Oid			catalogs[SI_LOST_MAX_CATALOGS]; /* catalogs to flush */
+	uint32		catcaches[SI_LOST_CATCACHE_WORDS];	/* catcaches to flush */
+} SILostSummary;
+
 /* Per-backend state in shared invalidation structure */
 typedef struct ProcState
 {
@@ -154,6 +194,14 @@ typedef struct ProcState
 	 */
 	bool		sendOnly;		/* backend only sends, never receives */
 
+	/* Messages skipped since the backend last read, if not resetState */
+	SILostSummary lost;
+
+	/* Statistics, see SIBackendStatus */
+	uint64		resets;
+	uint64		partialResets;
+	uint64		catchupSignals;
+
 	/*
 	 * Next LocalTransactionId to use for each idle backend slot.  We keep
 	 * this here because it is indexed by BackendId and it is convenient to
@@ -174,26 +222,72 @@ typedef struct SISeg
 	int			nextThreshold;	/* # of messages to call SICleanupQueue */
 	int			lastBackend;	/* index of last active procState entry, +1 */
 	int			maxBackends;	/* size of procState array */
+	int			numMessages;	/* size of the circular buffer */
 
 	slock_t		msgnumLock;		/* spinlock protecting maxMsgNum */
 
-	/*
-	 * Circular buffer holding shared-inval messages
-	 */
-	SharedInvalidationMessage buffer[MAXNUMMESSAGES];
-
 	/*
 	 * Per-backend invalidation state info (has MaxBackends entries).
+	 *
+	 * The circular buffer holding shared-inval messages, and scratch space
+	 * for SICleanupQueue, follow.
 	 */
 	ProcState	procState[FLEXIBLE_ARRAY_MEMBER];
 } SISeg;
 
 static SISeg *shmInvalBuffer;	/* pointer to the shared inval buffer */
+static SharedInvalidationMessage *shmInvalMessages; /* its circular buffer */
+static int *shmInvalLagging;	/* its scratch space */
+
+/*
+ * Messages made from this backend's summary of skipped messages, which
+ * SIGetDataEntries hasn't returned yet.
+ */
+static SharedInvalidationMessage lostMessages[SI_LOST_MAX_MSGS];
+static int	numLostMessages = 0;
+static int	nextLostMessage = 0;
 
 
 static LocalTransactionId nextLocalTransactionId;
 
 static void CleanupInvalidationState(int status, Datum arg);
+static int	SIQueueSize(void);
+static bool SIAddLostOid(Oid *oids, int *noids, int maxoids, Oid oid);
+static void SIAddLostMessage(SILostSummary *lost,
+							 const SharedInvalidationMessage *msg);
+static void SIMergeLostSummary(SILostSummary *dst, const SILostSummary *src);
+static int	SIExpandLostSummary(const SILostSummary *lost,
+								SharedInvalidationMessage *msgs);
+static int	SICompareLagging(const void *a, const void *b, void *arg);
+static void SISkipLostMessages(SISeg *segP, int nlagging, int lowbound);
+
+
+/*
+ * Size of the circular buffer: invalidation_queue_size rounded up to a power
+ * of 2.
+ */
+static int
+SIQueueSize(void)
+{
+	return (int) pg_nextpower2_32((uint32) invalidation_queue_size);
+}
+
+/*
+ * Offsets of the circular buffer and the scratch space in SISeg
+ */
+static Size
+SIMessagesOffset(int maxBackends)
+{
+	return MAXALIGN(add_size(offsetof(SISeg, procState),
+							 mul_size(sizeof(ProcState), maxBackends)));
+}
+
+static Size
+SILaggingOffset(int maxBackends, int numMessages)
+{
+	return add_size(SIMessagesOffset(maxBackends),
+					mul_size(sizeof(SharedInvalidationMessage), numMessages));
+}
 
 
 /*
@@ -204,8 +298,8 @@ SInvalShmemSize(void)
 {
 	Size		size;
 
-	size = offsetof(SISeg, procState);
-	size = add_size(size, mul_size(sizeof(ProcState), MaxBackends));
+	size = SILaggingOffset(MaxBackends, SIQueueSize());
+	size = add_size(size, mul_size(sizeof(int), MaxBackends));
 
 	return size;
 }
@@ -223,15 +317,23 @@ CreateSharedInvalidationState(void)
 	/* Allocate space in shared memory */
 	shmInvalBuffer = (SISeg *)
 		ShmemInitStruct("shmInvalBuffer", SInvalShmemSize(), &found);
+	shmInvalMessages = (SharedInvalidationMessage *)
+		((char *) shmInvalBuffer + SIMessagesOffset(MaxBackends));
+	shmInvalLagging = (int *)
+		((char *) shmInvalBuffer + SILaggingOffset(MaxBackends, SIQueueSize()));
 	if (found)
 		return;
 
-	/* Clear message counters, save size of procState array, init spinlock */
+	/*
+	 * Clear message counters, save sizes of procState array and circular
+	 * buffer, init spinlock
+	 */
 	shmInvalBuffer->minMsgNum = 0;
 	shmInvalBuffer->maxMsgNum = 0;
-	shmInvalBuffer->nextThreshold = CLEANUP_MIN;
 	shmInvalBuffer->lastBackend = 0;
 	shmInvalBuffer->maxBackends = MaxBackends;
+	shmInvalBuffer->numMessages = SIQueueSize();
+	shmInvalBuffer->nextThreshold = CLEANUP_MIN(shmInvalBuffer);
 	SpinLockInit(&shmInvalBuffer->msgnumLock);
 
 	/* The buffer[] array is initially all unused, so we need not fill it */
@@ -245,6 +347,7 @@ CreateSharedInvalidationState(void)
 		shmInvalBuffer->procState[i].resetState = false;
 		shmInvalBuffer->procState[i].signaled = false;
 		shmInvalBuffer->procState[i].hasMessages = false;
+		memset(&shmInvalBuffer->procState[i].lost, 0, sizeof(SILostSummary));
 		shmInvalBuffer->procState[i].nextLXID = InvalidLocalTransactionId;
 	}
 }
@@ -314,6 +417,10 @@ SharedInvalBackendInit(bool sendOnly)
 	stateP->signaled = false;
 	stateP->hasMessages = false;
 	stateP->sendOnly = sendOnly;
+	memset(&stateP->lost, 0, sizeof(SILostSummary));
+	stateP->resets = 0;
+	stateP->partialResets = 0;
+	stateP->catchupSignals = 0;
 
 	LWLockRelease(SInvalWriteLock);
 
@@ -353,6 +460,7 @@ CleanupInvalidationState(int status, Datum arg)
 	stateP->nextMsgNum = 0;
 	stateP->resetState = false;
 	stateP->signaled = false;
+	memset(&stateP->lost, 0, sizeof(SILostSummary));
 
 	/* Recompute index of last active backend */
 	for (i = segP->lastBackend; i > 0; i--)
@@ -464,7 +572,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		for (;;)
 		{
 			numMsgs = segP->maxMsgNum - segP->minMsgNum;
-			if (numMsgs + nthistime > MAXNUMMESSAGES ||
+			if (numMsgs + nthistime > segP->numMessages ||
 				numMsgs >= segP->nextThreshold)
 				SICleanupQueue(true, nthistime);
 			else
@@ -477,7 +585,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		max = segP->maxMsgNum;
 		while (nthistime-- > 0)
 		{
-			segP->buffer[max % MAXNUMMESSAGES] = *data++;
+			shmInvalMessages[SI_BUFFER_SLOT(segP, max)] = *data++;
 			max++;
 		}
 
@@ -531,6 +639,9 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
  *
  * Note: we assume that "datasize" is not so large that it might be important
  * to break our hold on SInvalReadLock into segments.
+ *
+ * If we had to skip messages, the messages made from the summary of what we
+ * skipped come first.  They can take more than one call to return.
  */
 int
 SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
@@ -543,6 +654,13 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	segP = shmInvalBuffer;
 	stateP = &segP->procState[MyBackendId - 1];
 
+	/* Return the rest of a summary first */
+	n = 0;
+	while (n < datasize && nextLostMessage < numLostMessages)
+		data[n++] = lostMessages[nextLostMessage++];
+	if (n == datasize)
+		return n;
+
 	/*
 	 * Before starting to take locks, do a quick, unlocked test to see whether
 	 * there can possibly be anything to read.  On a multiprocessor system,
@@ -555,7 +673,7 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	 * invalidation had arrived slightly later in the first place.
 	 */
 	if (!stateP->hasMessages)
-		return 0;
+		return n;
 
 	LWLockAcquire(SInvalReadLock, LW_SHARED);
 
@@ -585,10 +703,28 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 		stateP->nextMsgNum = max;
 		stateP->resetState = false;
 		stateP->signaled = false;
+		stateP->resets++;
 		LWLockRelease(SInvalReadLock);
+		/* the reset covers any summary not yet returned, too */
+		numLostMessages = nextLostMessage = 0;
 		return -1;
 	}
 
+	/*
+	 * If we had to skip messages, turn the summary into messages that we
+	 * return before the ones that are still in the queue.
+	 */
+	if (stateP->lost.pending)
+	{
+		numLostMessages = SIExpandLostSummary(&stateP->lost, lostMessages);
+		nextLostMessage = 0;
+		memset(&stateP->lost, 0, sizeof(SILostSummary));
+		stateP->partialResets++;
+
+		while (n < datasize && nextLostMessage < numLostMessages)
+			data[n++] = lostMessages[nextLostMessage++];
+	}
+
 	/*
 	 * Retrieve messages and advance backend's counter, until data array is
 	 * full or there are no more messages.
@@ -597,10 +733,9 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	 * cannot delete them here.  SICleanupQueue() will eventually remove them
 	 * from the queue.
 	 */
-	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		data[n++] = shmInvalMessages[SI_BUFFER_SLOT(segP, stateP->nextMsgNum)];
 		stateP->nextMsgNum++;
 	}
 
@@ -611,7 +746,7 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	 * If we haven't caught up completely, reset the hasMessages flag so that
 	 * we see the remaining messages next time.
 	 */
-	if (stateP->nextMsgNum >= max)
+	if (stateP->nextMsgNum >= max && nextLostMessage >= numLostMessages)
 		stateP->signaled = false;
 	else
 		stateP->hasMessages = true;
@@ -627,8 +762,9 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
  * callerHasWriteLock is true if caller is holding SInvalWriteLock.
  * minFree is the minimum number of message slots to make free.
  *
- * Possible side effects of this routine include marking one or more
- * backends as "reset" in the array, and sending PROCSIG_CATCHUP_INTERRUPT
+ * Possible side effects of this routine include making one or more backends
+ * skip messages, which marks them as "reset" in the array if their summary
+ * of the skipped messages overflows, and sending PROCSIG_CATCHUP_INTERRUPT
  * to some backend that seems to be getting too far behind.  We signal at
  * most one backend at a time, for reasons explained at the top of the file.
  *
@@ -644,6 +780,7 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 				minsig,
 				lowbound,
 				numMsgs,
+				nlagging,
 				i;
 	ProcState  *needSig = NULL;
 
@@ -654,14 +791,15 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 
 	/*
 	 * Recompute minMsgNum = minimum of all backends' nextMsgNum, identify the
-	 * furthest-back backend that needs signaling (if any), and reset any
+	 * furthest-back backend that needs signaling (if any), and collect any
 	 * backends that are too far back.  Note that because we ignore sendOnly
 	 * backends here it is possible for them to keep sending messages without
 	 * a problem even when they are the only active backend.
 	 */
 	min = segP->maxMsgNum;
-	minsig = min - SIG_THRESHOLD;
-	lowbound = min - MAXNUMMESSAGES + minFree;
+	minsig = min - SIG_THRESHOLD(segP);
+	lowbound = min - segP->numMessages + minFree;
+	nlagging = 0;
 
 	for (i = 0; i < segP->lastBackend; i++)
 	{
@@ -673,14 +811,13 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 			continue;
 
 		/*
-		 * If we must free some space and this backend is preventing it, force
-		 * him into reset state and then ignore until he catches up.
+		 * If we must free some space and this backend is preventing it, it
+		 * will have to skip the messages before lowbound; see below.
 		 */
 		if (n < lowbound)
 		{
-			stateP->resetState = true;
-			/* no point in signaling him ... */
-			continue;
+			shmInvalLagging[nlagging++] = i;
+			n = lowbound;
 		}
 
 		/* Track the global minimum nextMsgNum */
@@ -696,6 +833,9 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	}
 	segP->minMsgNum = min;
 
+	if (nlagging > 0)
+		SISkipLostMessages(segP, nlagging, lowbound);
+
 	/*
 	 * When minMsgNum gets really large, decrement all message counters so as
 	 * to forestall overflow of the counters.  This happens seldom enough that
@@ -717,10 +857,11 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * threshold at which we should repeat SICleanupQueue().
 	 */
 	numMsgs = segP->maxMsgNum - segP->minMsgNum;
-	if (numMsgs < CLEANUP_MIN)
-		segP->nextThreshold = CLEANUP_MIN;
+	if (numMsgs < CLEANUP_MIN(segP))
+		segP->nextThreshold = CLEANUP_MIN(segP);
 	else
-		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM + 1) * CLEANUP_QUANTUM;
+		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM(segP) + 1) *
+			CLEANUP_QUANTUM(segP);
 
 	/*
 	 * Lastly, signal anyone who needs a catchup interrupt.  Since
@@ -733,6 +874,7 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 		BackendId	his_backendId = (needSig - &segP->procState[0]) + 1;
 
 		needSig->signaled = true;
+		needSig->catchupSignals++;
 		LWLockRelease(SInvalReadLock);
 		LWLockRelease(SInvalWriteLock);
 		elog(DEBUG4, "sending sinval catchup signal to PID %d", (int) his_pid);
@@ -748,6 +890,291 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	}
 }
 
+/*
+ * SISkipLostMessages
+ *		Make backends that are too far behind skip the messages before
+ *		lowbound, recording a summary of what they skipped
+ *
+ * The indexes of the backends are in shmInvalLagging.  We build the summary
+ * starting from the newest skipped message, and merge it into a backend's
+ * summary when we reach the first message that the backend skipped.  That
+ * way, we look at each skipped message only once.  The caller must hold
+ * SInvalReadLock and SInvalWriteLock exclusively.
+ */
+static void
+SISkipLostMessages(SISeg *segP, int nlagging, int lowbound)
+{
+	SILostSummary summary;
+	int			msgnum = lowbound;
+	int			i;
+
+	/* Nearest backend first */
+	qsort_arg(shmInvalLagging, nlagging, sizeof(int), SICompareLagging, segP);
+
+	memset(&summary, 0, sizeof(SILostSummary));
+	for (i = 0; i < nlagging; i++)
+	{
+		ProcState  *stateP = &segP->procState[shmInvalLagging[i]];
+
+		while (msgnum > stateP->nextMsgNum)
+		{
+			msgnum--;
+			SIAddLostMessage(&summary,
+							 &shmInvalMessages[SI_BUFFER_SLOT(segP, msgnum)]);
+		}
+
+		SIMergeLostSummary(&stateP->lost, &summary);
+		if (stateP->lost.overflow)
+		{
+			/* Force him into reset state, which covers everything */
+			memset(&stateP->lost, 0, sizeof(SILostSummary));
+			stateP->resetState = true;
+		}
+		stateP->nextMsgNum = lowbound;
+	}
+}
+
+static int
+SICompareLagging(const void *a, const void *b, void *arg)
+{
+	SISeg	   *segP = (SISeg *) arg;
+	int			na = segP->procState[*(const int *) a].nextMsgNum;
+	int			nb = segP->procState[*(const int *) b].nextMsgNum;
+
+	if (na > nb)
+		return -1;
+	if (na < nb)
+		return 1;
+	return 0;
+}
+
+/*
+ * Add an OID to an array of at most maxoids OIDs, unless it's there already.
+ * Returns false if there was no room.
+ */
+static bool
+SIAddLostOid(Oid *oids, int *noids, int maxoids, Oid oid)
+{
+	int			i;
+
+	for (i = 0; i < *noids; i++)
+	{
+		if (oids[i] == oid)
+			return true;
+	}
+	if (*noids >= maxoids)
+		return false;
+	oids[(*noids)++] = oid;
+	return true;
+}
+
+/*
+ * Add a skipped message to a summary.
+ *
+ * Snapshot invalidations need no recording, since expanding a summary always
+ * invalidates the catalog snapshot.  Closing all smgr relations is part of
+ * invalidating the whole relcache.
+ */
+static void
+SIAddLostMessage(SILostSummary *lost, const SharedInvalidationMessage *msg)
+{
+	lost->pending = true;
+
+	if (msg->id >= 0)
+	{
+		if (msg->cc.id < SysCacheSize)
+			lost->catcaches[msg->cc.id / 32] |= ((uint32) 1) << (msg->cc.id % 32);
+		else
+			lost->overflow = true;
+	}
+	else if (msg->id == SHAREDINVALCATALOG_ID)
+	{
+		if (!SIAddLostOid(lost->catalogs, &lost->ncatalogs,
+						  SI_LOST_MAX_CATALOGS, msg->cat.catId))
+			lost->overflow = true;
+	}
+	else if (msg->id == SHAREDINVALRELCACHE_ID)
+	{
+		if (!OidIsValid(msg->rc.relId) ||
+			(!lost->allRels &&
+			 !SIAddLostOid(lost->rels, &lost->nrels, SI_LOST_MAX_RELS,
+						   msg->rc.relId)))
+			lost->allRels = true;
+	}
+	else if (msg->id == SHAREDINVALSMGR_ID)
+		lost->allRels = true;
+	else if (msg->id == SHAREDINVALRELMAP_ID)
+		lost->relmap = true;
+}
+
+/*
+ * Merge summary src into dst.
+ */
+static void
+SIMergeLostSummary(SILostSummary *dst, const SILostSummary *src)
+{
+	int			i;
+
+	if (!src->pending)
+		return;
+
+	dst->pending = true;
+	dst->overflow |= src->overflow;
+	dst->allRels |= src->allRels;
+	dst->relmap |= src->relmap;
+
+	for (i = 0; i < SI_LOST_CATCACHE_WORDS; i++)
+		dst->catcaches[i] |= src->catcaches[i];
+
+	for (i = 0; i < src->ncatalogs; i++)
+	{
+		if (!SIAddLostOid(dst->catalogs, &dst->ncatalogs,
+						  SI_LOST_MAX_CATALOGS, src->catalogs[i]))
+			dst->overflow = true;
+	}
+
+	for (i = 0; i < src->nrels && !dst->allRels; i++)
+	{
+		if (!SIAddLostOid(dst->rels, &dst->nrels, SI_LOST_MAX_RELS,
+						  src->rels[i]))
+			dst->allRels = true;
+	}
+}
+
+/*
+ * Turn a summary of skipped messages into messages that have the same
+ * effect, or more.  Returns the number of messages stored in msgs, which
+ * must have room for SI_LOST_MAX_MSGS.
+ *
+ * The catalog snapshot goes first, and the relation maps before the
+ * relcache, as in InvalidateSystemCaches.  Each catcache becomes a message
+ * that flushes its whole catalog.  The messages are for any database, since
+ * we don't know which ones the skipped messages were for.
+ */
+static int
+SIExpandLostSummary(const SILostSummary *lost, SharedInvalidationMessage *msgs)
+{
+	int			n = 0;
+	int			first_catalog;
+	int			cacheId;
+	int			i;
+
+	memset(msgs, 0, sizeof(SharedInvalidationMessage) * SI_LOST_MAX_MSGS);
+
+	msgs[n].sn.id = SHAREDINVALSNAPSHOT_ID;
+	msgs[n].sn.dbId = InvalidOid;
+	msgs[n].sn.relId = InvalidOid;
+	n++;
+
+	if (lost->relmap)
+	{
+		msgs[n].rm.id = SHAREDINVALRELMAP_ID;
+		msgs[n].rm.dbId = InvalidOid;
+		n++;
+		if (OidIsValid(MyDatabaseId))
+		{
+			msgs[n].rm.id = SHAREDINVALRELMAP_ID;
+			msgs[n].rm.dbId = MyDatabaseId;
+			n++;
+		}
+	}
+
+	first_catalog = n;
+	for (cacheId = 0; cacheId < SysCacheSize; cacheId++)
+	{
+		Oid			catId;
+
+		if ((lost->catcaches[cacheId / 32] & (((uint32) 1) << (cacheId % 32))) == 0)
+			continue;
+
+		/* Several caches can be on the same catalog */
+		catId = SysCacheGetRelationId(cacheId);
+		for (i = first_catalog; i < n; i++)
+		{
+			if (msgs[i].cat.catId == catId)
+				break;
+		}
+		if (i < n)
+			continue;
+
+		msgs[n].cat.id = SHAREDINVALCATALOG_ID;
+		msgs[n].cat.dbId = InvalidOid;
+		msgs[n].cat.catId = catId;
+		n++;
+	}
+	for (i = 0; i < lost->ncatalogs; i++)
+	{
+		msgs[n].cat.id = SHAREDINVALCATALOG_ID;
+		msgs[n].cat.dbId = InvalidOid;
+		msgs[n].cat.catId = lost->catalogs[i];
+		n++;
+	}
+
+	if (lost->allRels)
+	{
+		msgs[n].rc.id = SHAREDINVALRELCACHE_ID;
+		msgs[n].rc.dbId = InvalidOid;
+		msgs[n].rc.relId = InvalidOid;
+		n++;
+	}
+	else
+	{
+		for (i = 0; i < lost->nrels; i++)
+		{
+			msgs[n].rc.id = SHAREDINVALRELCACHE_ID;
+			msgs[n].rc.dbId = InvalidOid;
+			msgs[n].rc.relId = lost->rels[i];
+			n++;
+		}
+	}
+
+	Assert(n <= SI_LOST_MAX_MSGS);
+	return n;
+}
+
+/*
+ * SIGetBackendStatus
+ *		Get the invalidation statistics of all active backends
+ *
+ * status must have room for MaxBackends entries.  Returns the number of
+ * entries filled in.  The counters of different backends are not read at
+ * exactly the same time.
+ */
+int
+SIGetBackendStatus(SIBackendStatus *status)
+{
+	SISeg	   *segP = shmInvalBuffer;
+	int			max;
+	int			n = 0;
+	int			i;
+
+	/* Lock out additions/removals of backends, and SICleanupQueue */
+	LWLockAcquire(SInvalWriteLock, LW_SHARED);
+
+	SpinLockAcquire(&segP->msgnumLock);
+	max = segP->maxMsgNum;
+	SpinLockRelease(&segP->msgnumLock);
+
+	for (i = 0; i < segP->lastBackend; i++)
+	{
+		ProcState  *stateP = &segP->procState[i];
+
+		if (stateP->procPid == 0 || stateP->sendOnly)
+			continue;
+
+		status[n].pid = stateP->procPid;
+		status[n].lag = stateP->resetState ? -1 : max - stateP->nextMsgNum;
+		status[n].resets = stateP->resets;
+		status[n].partialResets = stateP->partialResets;
+		status[n].catchupSignals = stateP->catchupSignals;
+		n++;
+	}
+
+	LWLockRelease(SInvalWriteLock);
+
+	return n;
+}
+
 
 /*
  * GetNextLocalTransactionId --- allocate a new LocalTransactionId
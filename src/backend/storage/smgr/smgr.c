@@ -18,10 +18,14 @@
 #include "postgres.h"
 
 #include "access/xlog.h"
+#include "common/hashfn.h"
 #include "lib/ilist.h"
+#include "miscadmin.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/lwlock.h"
 #include "storage/md.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
@@ -50,6 +54,8 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks, bool skipFsync);
 	bool		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
@@ -75,6 +81,7 @@ static const f_smgr smgrsw[] = {
 		.smgr_exists = mdexists,
 		.smgr_unlink = mdunlink,
 		.smgr_extend = mdextend,
+		.smgr_zeroextend = mdzeroextend,
 		.smgr_prefetch = mdprefetch,
 		.smgr_read = mdread,
 		.smgr_write = mdwrite,
@@ -95,8 +102,69 @@ static HTAB *SMgrRelationHash = NULL;
 
 static dlist_head unowned_relns;
 
+/*
+ * Shared relation size cache.
+ *
+ * Asking the kernel for the size of a relation fork costs one lseek() per
+ * segment, and it happens for every planner estimate and the start of every
+ * sequential scan.  To avoid that, the sizes of non-temporary relation forks
+ * are remembered in a fixed-size table in shared memory.
+ *
+ * The table is set-associative: a fork's tag hashes to one set of
+ * RELSIZE_SET_SIZE entries, and only that set is searched or has an entry
+ * evicted to make room.  Sets are protected by a smaller number of partition
+ * locks.  An entry holds exactly what smgr_nblocks would return, so dropping
+ * an entry is always safe; the next lookup just asks the kernel again.
+ *
+ * To keep entries from going stale, the rules are:
+ *
+ * - On a miss, the size is read from the kernel and inserted while holding
+ *	 the partition lock exclusively.  Anyone who has extended the fork
+ *	 concurrently must take the same lock to publish the new size, so they
+ *	 either finish before our lseek() (which then sees their block) or fix
+ *	 up our entry afterwards.
+ *
+ * - smgrextend() advances an existing entry after the new block has been
+ *	 written, but never creates one, since it can't know whether someone else
+ *	 extended the fork further in the meantime.
+ *
+ * - Truncation, unlinking and creation just remove the entries involved.
+ */
+#define RELSIZE_SET_SIZE		8
+#define NUM_RELSIZE_PARTITIONS	64
+
+typedef struct RelSizeTag
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} RelSizeTag;
+
+typedef struct RelSizeEntry
+{
+	RelSizeTag	tag;
+	BlockNumber nblocks;		/* InvalidBlockNumber if entry is unused */
+	int			usage;			/* clock sweep usage count */
+} RelSizeEntry;
+
+typedef struct RelSizeCacheData
+{
+	int			nsets;
+	LWLockPadded locks[NUM_RELSIZE_PARTITIONS];
+	RelSizeEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} RelSizeCacheData;
+
+static RelSizeCacheData *RelSizeCache = NULL;
+
+/* GUC variable */
+int			relation_size_cache_entries = 8192;
+
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
+static int	RelSizeCacheNumSets(void);
+static BlockNumber RelSizeCacheLookup(SMgrRelation reln, ForkNumber forknum);
+static void RelSizeCacheExtended(SMgrRelation reln, ForkNumber forknum,
+								 BlockNumber nblocks);
+static void RelSizeCacheForget(RelFileNode rnode, ForkNumber forknum);
 
 
 /*
@@ -137,6 +205,259 @@ smgrshutdown(int code, Datum arg)
 	}
 }
 
+/*
+ * Number of sets in the shared relation size cache.
+ */
+static int
+RelSizeCacheNumSets(void)
+{
+	return (relation_size_cache_entries + RELSIZE_SET_SIZE - 1) /
+		RELSIZE_SET_SIZE;
+}
+
+/*
+ *	SmgrShmemSize() -- Report shared-memory space needed by smgr.c
+ */
+Size
+SmgrShmemSize(void)
+{
+	Size		size;
+
+	size = offsetof(RelSizeCacheData, entries);
+	size = add_size(size, mul_size(mul_size(RelSizeCacheNumSets(),
+											RELSIZE_SET_SIZE),
+								   sizeof(RelSizeEntry)));
+
+	return size;
+}
+
+/*
+ *	SmgrShmemInit() -- Initialize the shared relation size cache
+ */
+void
+SmgrShmemInit(void)
+{
+	bool		found;
+
+	RelSizeCache = (RelSizeCacheData *)
+		ShmemInitStruct("Relation Size Cache", SmgrShmemSize(), &found);
+
+	if (!IsUnderPostmaster)
+	{
+		int			nentries;
+
+		Assert(!found);
+
+		RelSizeCache->nsets = RelSizeCacheNumSets();
+		nentries = RelSizeCache->nsets * RELSIZE_SET_SIZE;
+		for (int i = 0; i < NUM_RELSIZE_PARTITIONS; i++)
+			LWLockInitialize(&RelSizeCache->locks[i].lock,
+							 LWTRANCHE_RELSIZE_CACHE);
+		for (int i = 0; i < nentries; i++)
+		{
+			RelSizeCache->entries[i].nblocks = InvalidBlockNumber;
+			RelSizeCache->entries[i].usage = 0;
+		}
+	}
+	else
+		Assert(found);
+}
+
+/*
+ * Find the set a relation fork's size would be cached in, and the partition
+ * lock protecting it.  Returns NULL if the cache is disabled.
+ */
+static RelSizeEntry *
+RelSizeCacheGetSet(RelFileNode rnode, ForkNumber forknum, RelSizeTag *tag,
+				   LWLock **lock)
+{
+	uint32		setno;
+
+	if (RelSizeCache == NULL || RelSizeCache->nsets == 0)
+		return NULL;
+
+	tag->rnode = rnode;
+	tag->forknum = forknum;
+
+	setno = hash_bytes((const unsigned char *) tag, sizeof(RelSizeTag)) %
+		RelSizeCache->nsets;
+	*lock = &RelSizeCache->locks[setno % NUM_RELSIZE_PARTITIONS].lock;
+
+	return &RelSizeCache->entries[setno * RELSIZE_SET_SIZE];
+}
+
+static inline bool
+RelSizeEntryMatches(RelSizeEntry *entry, RelSizeTag *tag)
+{
+	return entry->nblocks != InvalidBlockNumber &&
+		entry->tag.forknum == tag->forknum &&
+		RelFileNodeEquals(entry->tag.rnode, tag->rnode);
+}
+
+/*
+ * Return the size of a relation fork, from the shared cache if possible,
+ * otherwise from the storage manager, remembering the answer.
+ */
+static BlockNumber
+RelSizeCacheLookup(SMgrRelation reln, ForkNumber forknum)
+{
+	RelSizeEntry *set;
+	RelSizeEntry *victim;
+	RelSizeTag	tag;
+	LWLock	   *lock;
+	BlockNumber result;
+	int			i;
+
+	/* Temporary relations are private to a backend, don't share them */
+	set = NULL;
+	if (!SmgrIsTemp(reln))
+		set = RelSizeCacheGetSet(reln->smgr_rnode.node, forknum, &tag, &lock);
+	if (set == NULL)
+		return smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+
+	LWLockAcquire(lock, LW_SHARED);
+	for (i = 0; i < RELSIZE_SET_SIZE; i++)
+	{
+		if (RelSizeEntryMatches(&set[i], &tag))
+		{
+			result = set[i].nblocks;
+
+			/*
+			 * Like SlruRecentlyUsed, this isn't safe against concurrent
+			 * updates with only a shared lock, but we don't care.
+			 */
+			set[i].usage = 1;
+			LWLockRelease(lock);
+			return result;
+		}
+	}
+	LWLockRelease(lock);
+
+	/*
+	 * Not found.  Ask the storage manager while holding the lock exclusively,
+	 * so that a concurrent extension can't be lost; see the rules above.
+	 */
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+	victim = NULL;
+	for (i = 0; i < RELSIZE_SET_SIZE; i++)
+	{
+		if (RelSizeEntryMatches(&set[i], &tag))
+		{
+			/* someone else got here first */
+			result = set[i].nblocks;
+			LWLockRelease(lock);
+			return result;
+		}
+		if (victim == NULL && set[i].nblocks == InvalidBlockNumber)
+			victim = &set[i];
+	}
+
+	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+
+	/* If no free entry, evict one with a clock sweep over the set */
+	for (i = 0; victim == NULL; i = (i + 1) % RELSIZE_SET_SIZE)
+	{
+		if (set[i].usage > 0)
+			set[i].usage = 0;
+		else
+			victim = &set[i];
+	}
+
+	victim->tag = tag;
+	victim->nblocks = result;
+	victim->usage = 1;
+	LWLockRelease(lock);
+
+	return result;
+}
+
+/*
+ * Advance the cached size of a relation fork after it has been extended to
+ * at least nblocks blocks.  Nothing is done if the size isn't cached.
+ */
+static void
+RelSizeCacheExtended(SMgrRelation reln, ForkNumber forknum,
+					 BlockNumber nblocks)
+{
+	RelSizeEntry *set;
+	RelSizeTag	tag;
+	LWLock	   *lock;
+
+	if (SmgrIsTemp(reln))
+		return;
+	set = RelSizeCacheGetSet(reln->smgr_rnode.node, forknum, &tag, &lock);
+	if (set == NULL)
+		return;
+
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+	for (int i = 0; i < RELSIZE_SET_SIZE; i++)
+	{
+		if (RelSizeEntryMatches(&set[i], &tag))
+		{
+			if (set[i].nblocks < nblocks)
+				set[i].nblocks = nblocks;
+			break;
+		}
+	}
+	LWLockRelease(lock);
+}
+
+/*
+ * Remove the cached size of a relation fork, if any.
+ */
+static void
+RelSizeCacheForget(RelFileNode rnode, ForkNumber forknum)
+{
+	RelSizeEntry *set;
+	RelSizeTag	tag;
+	LWLock	   *lock;
+
+	set = RelSizeCacheGetSet(rnode, forknum, &tag, &lock);
+	if (set == NULL)
+		return;
+
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+	for (int i = 0; i < RELSIZE_SET_SIZE; i++)
+	{
+		if (RelSizeEntryMatches(&set[i], &tag))
+		{
+			set[i].nblocks = InvalidBlockNumber;
+			break;
+		}
+	}
+	LWLockRelease(lock);
+}
+
+/*
+ *	smgrdropdb() -- Forget cached sizes of all relations in a database.
+ *
+ *		This is needed when a database's files are removed or moved without
+ *		going through smgrdounlinkall(), so that the entries can't be
+ *		mistaken for those of a later database with the same OID.
+ */
+void
+smgrdropdb(Oid dbid)
+{
+	if (RelSizeCache == NULL)
+		return;
+
+	for (int setno = 0; setno < RelSizeCache->nsets; setno++)
+	{
+		RelSizeEntry *set = &RelSizeCache->entries[setno * RELSIZE_SET_SIZE];
+		LWLock	   *lock;
+
+		lock = &RelSizeCache->locks[setno % NUM_RELSIZE_PARTITIONS].lock;
+		LWLockAcquire(lock, LW_EXCLUSIVE);
+		for (int i = 0; i < RELSIZE_SET_SIZE; i++)
+		{
+			if (set[i].nblocks != InvalidBlockNumber &&
+				set[i].tag.rnode.dbNode == dbid)
+				set[i].nblocks = InvalidBlockNumber;
+		}
+		LWLockRelease(lock);
+	}
+}
+
 /*
  *	smgropen() -- Return an SMgrRelation object, creating it if need be.
  *
@@ -332,6 +653,10 @@ smgrclosenode(RelFileNodeBackend rnode)
 void
 smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 {
+	/* The file might exist already in redo, so don't trust any cached size */
+	if (!SmgrIsTemp(reln))
+		RelSizeCacheForget(reln->smgr_rnode.node, forknum);
+
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
 }
 
@@ -442,7 +767,11 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 		int			which = rels[i]->smgr_which;
 
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		{
 			smgrsw[which].smgr_unlink(rnodes[i], forknum, isRedo);
+			if (!RelFileNodeBackendIsTemp(rnodes[i]))
+				RelSizeCacheForget(rnodes[i].node, forknum);
+		}
 	}
 
 	pfree(rnodes);
@@ -474,6 +803,33 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		reln->smgr_cached_nblocks[forknum] = blocknum + 1;
 	else
 		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	/* Let other backends see the new size, if they've cached it */
+	RelSizeCacheExtended(reln, forknum, blocknum + 1);
+}
+
+/*
+ *	smgrzeroextend() -- Add new zeroed out blocks to a file.
+ *
+ *		Similar to smgrextend(), except the relation can be extended by
+ *		multiple blocks at once and the added blocks will be filled with
+ *		zeroes.  The storage manager may merely reserve the space, so this
+ *		is much cheaper than writing out the blocks one at a time.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											 nblocks, skipFsync);
+
+	/* As in smgrextend(), keep the cached sizes up to date if we can */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	RelSizeCacheExtended(reln, forknum, blocknum + nblocks);
 }
 
 /*
@@ -554,7 +910,11 @@ smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 	if (result != InvalidBlockNumber)
 		return result;
 
-	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+	/*
+	 * Otherwise consult the shared relation size cache, which will ask the
+	 * storage manager if necessary.
+	 */
+	result = RelSizeCacheLookup(reln, forknum);
 
 	reln->smgr_cached_nblocks[forknum] = result;
 
@@ -619,9 +979,19 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks, BlockNumber *nb
 	{
 		/* Make the cached size is invalid if we encounter an error. */
 		reln->smgr_cached_nblocks[forknum[i]] = InvalidBlockNumber;
+		if (!SmgrIsTemp(reln))
+			RelSizeCacheForget(reln->smgr_rnode.node, forknum[i]);
 
 		smgrsw[reln->smgr_which].smgr_truncate(reln, forknum[i], nblocks[i]);
 
+		/*
+		 * Nobody else should be looking at the relation while we hold
+		 * AccessExclusiveLock, but forget the shared size again in case
+		 * something cached the pre-truncation size meanwhile.
+		 */
+		if (!SmgrIsTemp(reln))
+			RelSizeCacheForget(reln->smgr_rnode.node, forknum[i]);
+
 		/*
 		 * We might as well update the local smgr_cached_nblocks values. The
 		 * smgr cache inval message that this function sent will cause other
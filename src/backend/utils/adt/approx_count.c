@@ -0,0 +1,222 @@
+/*-------------------------------------------------------------------------
+ *
+ * approx_count.c
+ *	  Approximate distinct counting with HyperLogLog.
+ *
+ * approx_count_distinct(anyelement) estimates the number of distinct
+ * non-null input values with a fixed-size HyperLogLog estimator per group,
+ * instead of remembering every value like count(DISTINCT ...) has to.
+ * Estimators of different partial aggregations can be merged, so the
+ * aggregate supports parallel and partial aggregation.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/adt/approx_count.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "fmgr.h"
+#include "lib/hyperloglog.h"
+#include "libpq/pqformat.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
+
+/*
+ * Number of bits of the hash used to select a register.  2^14 registers give
+ * a standard error of about 0.8%, for 16kB of state per group.
+ */
+#define APPROX_COUNT_BWIDTH		14
+
+static hyperLogLogState *makeApproxCountState(MemoryContext aggcontext);
+
+/*
+ * Create a new, empty transition state in the given context.
+ */
+static hyperLogLogState *
+makeApproxCountState(MemoryContext aggcontext)
+{
+	hyperLogLogState *state;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	state = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+	initHyperLogLog(state, APPROX_COUNT_BWIDTH);
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
+/*
+ * Transition function: add the hash of a non-null input value.
+ *
+ * The hash function of the input type is looked up once per query, and
+ * cached in fn_extra.
+ */
+Datum
+approx_count_distinct_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state;
+	FmgrInfo   *hashfn;
+	uint32		hash;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	/* Ignore null values, like count() does */
+	if (PG_ARGISNULL(1))
+	{
+		if (state == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state);
+	}
+
+	hashfn = (FmgrInfo *) fcinfo->flinfo->fn_extra;
+	if (hashfn == NULL)
+	{
+		Oid			argtype = get_fn_expr_argtype(fcinfo->flinfo, 1);
+		TypeCacheEntry *typentry;
+
+		typentry = lookup_type_cache(argtype, TYPECACHE_HASH_PROC_FINFO);
+		if (!OidIsValid(typentry->hash_proc_finfo.fn_oid))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify a hash function for type %s",
+							format_type_be(argtype))));
+
+		hashfn = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(FmgrInfo));
+		fmgr_info_copy(hashfn, &typentry->hash_proc_finfo,
+					   fcinfo->flinfo->fn_mcxt);
+		fcinfo->flinfo->fn_extra = hashfn;
+	}
+
+	if (state == NULL)
+		state = makeApproxCountState(aggcontext);
+
+	hash = DatumGetUInt32(FunctionCall1Coll(hashfn, PG_GET_COLLATION(),
+											PG_GETARG_DATUM(1)));
+	addHyperLogLog(state, hash);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Final function: return the estimate, rounded to the nearest integer.
+ */
+Datum
+approx_count_distinct_finalfn(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	/* No non-null input values at all */
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_INT64((int64) rint(estimateHyperLogLog(state)));
+}
+
+/*
+ * Combine function: merge the registers of two transition states.
+ */
+Datum
+approx_count_distinct_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state1;
+	hyperLogLogState *state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	/* Manufacture an empty state to merge into, if we don't have one yet */
+	if (state1 == NULL)
+		state1 = makeApproxCountState(aggcontext);
+
+	mergeHyperLogLog(state1, state2);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * Serialization function: the bit width, followed by the registers.
+ */
+Datum
+approx_count_distinct_serialize(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+	StringInfoData buf;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	pq_begintypsend(&buf);
+	pq_sendbyte(&buf, state->registerWidth);
+	pq_sendbytes(&buf, (char *) state->hashesArr, state->nRegisters);
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+/*
+ * Deserialization function, the inverse of the above.
+ */
+Datum
+approx_count_distinct_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	hyperLogLogState *result;
+	StringInfoData buf;
+	uint8		bwidth;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	/*
+	 * Copy the bytea into a StringInfo so that we can "receive" it using the
+	 * standard recv-function infrastructure.
+	 */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf,
+						   VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+	bwidth = pq_getmsgbyte(&buf);
+
+	result = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+	initHyperLogLog(result, bwidth);
+	memcpy(result->hashesArr, pq_getmsgbytes(&buf, result->nRegisters),
+		   result->nRegisters);
+
+	pq_getmsgend(&buf);
+	pfree(buf.data);
+
+	PG_RETURN_POINTER(result);
+}
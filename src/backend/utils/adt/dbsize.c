@@ -16,6 +16,7 @@
 #include "access/htup_details.h"
 #include "access/relation.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_authid.h"
 #include "catalog/pg_tablespace.h"
@@ -865,7 +866,9 @@ pg_relation_filenode(PG_FUNCTION_ARGS)
 
 	if (RELKIND_HAS_STORAGE(relform->relkind))
 	{
-		if (relform->relfilenode)
+		if (relform->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			result = GlobalTempRelationGetFilenode(relid);
+		else if (relform->relfilenode)
 			result = relform->relfilenode;
 		else				/* Consult the relation mapper */
 			result = RelationMapOidToFilenode(relid,
@@ -944,7 +947,9 @@ pg_relation_filepath(PG_FUNCTION_ARGS)
 			rnode.dbNode = InvalidOid;
 		else
 			rnode.dbNode = MyDatabaseId;
-		if (relform->relfilenode)
+		if (relform->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			rnode.relNode = GlobalTempRelationGetFilenode(relid);
+		else if (relform->relfilenode)
 			rnode.relNode = relform->relfilenode;
 		else				/* Consult the relation mapper */
 			rnode.relNode = RelationMapOidToFilenode(relid,
@@ -982,6 +987,9 @@ pg_relation_filepath(PG_FUNCTION_ARGS)
 				Assert(backend != InvalidBackendId);
 			}
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			backend = BackendIdForTempRelations();
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c", relform->relpersistence);
 			backend = InvalidBackendId; /* placate compiler */
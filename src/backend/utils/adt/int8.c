@@ -839,6 +839,61 @@ int8inc(PG_FUNCTION_ARGS)
 	}
 }
 
+/*
+ * int8inc_support
+ *		prosupport function for count(*) and count(any), whose transition
+ *		function is int8inc
+ */
+Datum
+int8inc_support(PG_FUNCTION_ARGS)
+{
+	Node	   *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+	if (IsA(rawreq, SupportRequestWFuncMonotonic))
+	{
+		SupportRequestWFuncMonotonic *req = (SupportRequestWFuncMonotonic *) rawreq;
+		MonotonicFunction monotonic = MONOTONICFUNC_NONE;
+		int			frameOptions = req->window_clause->frameOptions;
+
+		/* Frame exclusions can make the count go either way */
+		if (frameOptions & FRAMEOPTION_EXCLUSION)
+		{
+			req->monotonic = MONOTONICFUNC_NONE;
+			PG_RETURN_POINTER(req);
+		}
+
+		/*
+		 * Without an ORDER BY clause, all rows are peers, so in RANGE or
+		 * GROUPS mode every row sees the same frame and the count is
+		 * constant within the partition.
+		 */
+		if (req->window_clause->orderClause == NIL &&
+			(frameOptions & (FRAMEOPTION_RANGE | FRAMEOPTION_GROUPS)))
+			monotonic = MONOTONICFUNC_BOTH;
+		else
+		{
+			/*
+			 * When the frame starts at the start of the partition, the frame
+			 * can only grow, so the count can never decrease.
+			 */
+			if (frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING)
+				monotonic |= MONOTONICFUNC_INCREASING;
+
+			/*
+			 * Likewise, when the frame ends at the end of the partition, the
+			 * frame can only shrink and the count can never increase.
+			 */
+			if (frameOptions & FRAMEOPTION_END_UNBOUNDED_FOLLOWING)
+				monotonic |= MONOTONICFUNC_DECREASING;
+		}
+
+		req->monotonic = monotonic;
+		PG_RETURN_POINTER(req);
+	}
+
+	PG_RETURN_POINTER(NULL);
+}
+
 Datum
 int8dec(PG_FUNCTION_ARGS)
 {
@@ -13,6 +13,9 @@
  *	There is not currently any provision for throwing away a no-longer-needed
  *	plan --- consider improving this someday.
  *
+ *	Checks queued by RI_FKey_check() live in a memory context of their own,
+ *	which is reset whenever the queue is flushed or discarded.
+ *
  *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  *
@@ -23,11 +26,15 @@
 
 #include "postgres.h"
 
+#include "access/detoast.h"
+#include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_operator.h"
@@ -63,6 +70,8 @@
 #define RI_INIT_CONSTRAINTHASHSIZE		64
 #define RI_INIT_QUERYHASHSIZE			(RI_INIT_CONSTRAINTHASHSIZE * 4)
 
+#define RI_MAX_PENDING_CHECKS			1024
+
 #define RI_KEYS_ALL_NULL				0
 #define RI_KEYS_SOME_NULL				1
 #define RI_KEYS_NONE_NULL				2
@@ -108,6 +117,7 @@ typedef struct RI_ConstraintInfo
 	NameData	conname;		/* name of the FK constraint */
 	Oid			pk_relid;		/* referenced relation */
 	Oid			fk_relid;		/* referencing relation */
+	Oid			conindid;		/* unique index on referenced columns */
 	char		confupdtype;	/* foreign key's ON UPDATE action */
 	char		confdeltype;	/* foreign key's ON DELETE action */
 	char		confmatchtype;	/* foreign key's match type */
@@ -162,6 +172,43 @@ typedef struct RI_CompareHashEntry
 	FmgrInfo	cast_func_finfo;	/* in case we must coerce input */
 } RI_CompareHashEntry;
 
+/*
+ * RI_BatchConstraint
+ *
+ * Per-constraint information about the checks queued by RI_FKey_check().
+ * The scan keys are in the order of the PK index's columns; keyidx maps
+ * them to the constraint's keys.  The rest of the fields are set up only
+ * while ri_FlushPendingChecks() runs.
+ */
+typedef struct RI_BatchConstraint
+{
+	Oid			constraint_id;	/* OID of pg_constraint entry */
+	bool		batchable;		/* can checks be queued at all? */
+	int			nkeys;			/* number of key columns */
+	int			keyidx[RI_MAX_NUMKEYS]; /* key of each index column */
+	AttrNumber	pk_attnums[RI_MAX_NUMKEYS]; /* PK attnum of each index column */
+	bool		fk_byval[RI_MAX_NUMKEYS];	/* typbyval of each FK key */
+	int16		fk_len[RI_MAX_NUMKEYS]; /* typlen of each FK key */
+	FmgrInfo	cast_finfo[RI_MAX_NUMKEYS]; /* in case we must coerce FK keys */
+	ScanKeyData skey[RI_MAX_NUMKEYS];	/* PK index scan keys */
+	Relation	pk_rel;			/* referenced relation, while flushing */
+	Relation	idx_rel;		/* its unique index, while flushing */
+	IndexScanDesc scan;			/* index scan, while flushing */
+	TupleTableSlot *slot;		/* slot for PK rows, while flushing */
+	Datum	   *last_values;	/* key looked up last, while flushing */
+} RI_BatchConstraint;
+
+/*
+ * RI_PendingCheck
+ *
+ * An FK key queued by RI_FKey_check(), to be looked up in the PK table.
+ */
+typedef struct RI_PendingCheck
+{
+	RI_BatchConstraint *constraint; /* constraint to check */
+	Datum	   *values;			/* FK key values, none of them NULL */
+} RI_PendingCheck;
+
 
 /*
  * Local data
@@ -172,6 +219,11 @@ static HTAB *ri_compare_cache = NULL;
 static dlist_head ri_constraint_cache_valid_list;
 static int	ri_constraint_cache_valid_count = 0;
 
+static MemoryContext ri_pending_cxt = NULL;
+static List *ri_batch_constraints = NIL;
+static RI_PendingCheck *ri_pending_checks = NULL;
+static int	ri_num_pending = 0;
+
 
 /*
  * Local function prototypes
@@ -179,6 +231,21 @@ static int	ri_constraint_cache_valid_count = 0;
 static bool ri_Check_Pk_Match(Relation pk_rel, Relation fk_rel,
 							  TupleTableSlot *oldslot,
 							  const RI_ConstraintInfo *riinfo);
+static RI_BatchConstraint *ri_GetBatchConstraint(const RI_ConstraintInfo *riinfo,
+												 Relation fk_rel, Relation pk_rel);
+static bool ri_InitBatchConstraint(RI_BatchConstraint *bc,
+								   const RI_ConstraintInfo *riinfo,
+								   Relation fk_rel, Relation pk_rel);
+static void ri_QueuePendingCheck(RI_BatchConstraint *bc,
+								 const RI_ConstraintInfo *riinfo,
+								 TupleTableSlot *slot);
+static bool ri_PendingKeysEqual(RI_BatchConstraint *bc,
+								Datum *values1, Datum *values2);
+static bool ri_LookupPendingKey(RI_BatchConstraint *bc, Datum *values,
+								Snapshot snapshot);
+static void ri_ReportPendingViolation(RI_BatchConstraint *bc,
+									  Datum *values) pg_attribute_noreturn();
+static void ri_ResetPendingChecks(void);
 static Datum ri_restrict(TriggerData *trigdata, bool is_no_action);
 static Datum ri_set(TriggerData *trigdata, bool is_set_null);
 static void quoteOneName(char *buffer, const char *name);
@@ -239,6 +306,7 @@ RI_FKey_check(TriggerData *trigdata)
 	Relation	fk_rel;
 	Relation	pk_rel;
 	TupleTableSlot *newslot;
+	RI_BatchConstraint *bc;
 	RI_QueryKey qkey;
 	SPIPlanPtr	qplan;
 
@@ -337,6 +405,22 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/*
+	 * If we can, just queue the key.  It's looked up in the PK table,
+	 * together with other queued keys, when the trigger manager is done with
+	 * the current batch of events or is about to fire some other trigger.
+	 */
+	if (ri_num_pending >= RI_MAX_PENDING_CHECKS)
+		RI_FlushPendingChecks();
+
+	bc = ri_GetBatchConstraint(riinfo, fk_rel, pk_rel);
+	if (bc->batchable)
+	{
+		ri_QueuePendingCheck(bc, riinfo, newslot);
+		table_close(pk_rel, RowShareLock);
+		return PointerGetDatum(NULL);
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -440,6 +524,480 @@ RI_FKey_check_upd(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * RI_FlushPendingChecks -
+ *
+ * Look up all the keys queued by RI_FKey_check(), and report the first one
+ * that's not present in its PK table.
+ *
+ * This does the same as the "SELECT 1 FROM ONLY <pktable> x WHERE ... FOR
+ * KEY SHARE OF x" query that RI_FKey_check() would otherwise run for every
+ * key, but with one snapshot and one index scan per constraint for the whole
+ * batch, and without going through SPI and the executor.  A key equal to the
+ * one looked up just before for the same constraint needn't be looked up
+ * again, which is common when loading many rows referencing the same PK row.
+ */
+void
+RI_FlushPendingChecks(void)
+{
+	MemoryContext oldcxt;
+	Snapshot	snapshot;
+	ListCell   *lc;
+
+	if (ri_num_pending == 0)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(ri_pending_cxt);
+
+	/* Get a snapshot the same way as SPI would, for a non-read-only query */
+	CommandCounterIncrement();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	UpdateActiveSnapshotCommandId();
+	snapshot = GetActiveSnapshot();
+
+	for (int i = 0; i < ri_num_pending; i++)
+	{
+		RI_PendingCheck *check = &ri_pending_checks[i];
+		RI_BatchConstraint *bc = check->constraint;
+		Oid			save_userid;
+		int			save_sec_context;
+		bool		found;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (bc->last_values != NULL &&
+			ri_PendingKeysEqual(bc, bc->last_values, check->values))
+			continue;
+
+		if (bc->scan == NULL)
+		{
+			const RI_ConstraintInfo *riinfo;
+
+			riinfo = ri_LoadConstraintInfo(bc->constraint_id);
+
+			/*
+			 * Like the SELECT FOR KEY SHARE query, keep the locks until the
+			 * end of the transaction.
+			 */
+			bc->pk_rel = table_open(riinfo->pk_relid, RowShareLock);
+			bc->idx_rel = index_open(riinfo->conindid, AccessShareLock);
+			bc->slot = table_slot_create(bc->pk_rel, NULL);
+			bc->scan = index_beginscan(bc->pk_rel, bc->idx_rel, snapshot,
+									   bc->nkeys, 0);
+		}
+
+		/* Look up the key as the PK table's owner, like the query would */
+		GetUserIdAndSecContext(&save_userid, &save_sec_context);
+		SetUserIdAndSecContext(RelationGetForm(bc->pk_rel)->relowner,
+							   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+							   SECURITY_NOFORCE_RLS);
+
+		found = ri_LookupPendingKey(bc, check->values, snapshot);
+
+		SetUserIdAndSecContext(save_userid, save_sec_context);
+
+		if (!found)
+			ri_ReportPendingViolation(bc, check->values);
+
+		bc->last_values = check->values;
+	}
+
+	foreach(lc, ri_batch_constraints)
+	{
+		RI_BatchConstraint *bc = (RI_BatchConstraint *) lfirst(lc);
+
+		if (bc->scan == NULL)
+			continue;
+		index_endscan(bc->scan);
+		ExecDropSingleTupleTableSlot(bc->slot);
+		index_close(bc->idx_rel, NoLock);
+		table_close(bc->pk_rel, NoLock);
+	}
+
+	PopActiveSnapshot();
+
+	MemoryContextSwitchTo(oldcxt);
+
+	ri_ResetPendingChecks();
+}
+
+/*
+ * RI_DiscardPendingChecks -
+ *
+ * Forget about the queued checks, at transaction or subtransaction abort.
+ * Any relations, scans and buffer pins are released by the resource owner.
+ */
+void
+RI_DiscardPendingChecks(void)
+{
+	ri_ResetPendingChecks();
+}
+
+/*
+ * ri_ResetPendingChecks -
+ *
+ * Empty the queue of checks, and release its memory.
+ */
+static void
+ri_ResetPendingChecks(void)
+{
+	if (ri_pending_cxt != NULL)
+		MemoryContextReset(ri_pending_cxt);
+	ri_batch_constraints = NIL;
+	ri_pending_checks = NULL;
+	ri_num_pending = 0;
+}
+
+/*
+ * ri_GetBatchConstraint -
+ *
+ * Find or create the entry for the constraint in the current batch.
+ */
+static RI_BatchConstraint *
+ri_GetBatchConstraint(const RI_ConstraintInfo *riinfo,
+					  Relation fk_rel, Relation pk_rel)
+{
+	RI_BatchConstraint *bc;
+	MemoryContext oldcxt;
+	ListCell   *lc;
+
+	foreach(lc, ri_batch_constraints)
+	{
+		bc = (RI_BatchConstraint *) lfirst(lc);
+		if (bc->constraint_id == riinfo->constraint_id)
+			return bc;
+	}
+
+	if (ri_pending_cxt == NULL)
+		ri_pending_cxt = AllocSetContextCreate(TopMemoryContext,
+											   "RI pending checks",
+											   ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(ri_pending_cxt);
+
+	bc = palloc0(sizeof(RI_BatchConstraint));
+	bc->constraint_id = riinfo->constraint_id;
+	bc->nkeys = riinfo->nkeys;
+	bc->batchable = ri_InitBatchConstraint(bc, riinfo, fk_rel, pk_rel);
+	ri_batch_constraints = lappend(ri_batch_constraints, bc);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return bc;
+}
+
+/*
+ * ri_InitBatchConstraint -
+ *
+ * Set up the scan keys for looking up the constraint's FK keys in the PK
+ * index, and return whether its checks can be queued at all.
+ *
+ * We leave anything out of the ordinary to the SPI query, which is then
+ * also responsible for reporting any errors: a partitioned PK table, a PK
+ * table that its owner can't read or lock with table-level privileges, an
+ * index whose collation differs from the PK column's, and FK values that
+ * need more than a cast function to be compared with the PK index's
+ * equality operators.
+ */
+static bool
+ri_InitBatchConstraint(RI_BatchConstraint *bc,
+					   const RI_ConstraintInfo *riinfo,
+					   Relation fk_rel, Relation pk_rel)
+{
+	Oid			pk_relid = RelationGetRelid(pk_rel);
+	Oid			pk_owner = RelationGetForm(pk_rel)->relowner;
+	Relation	idx_rel;
+	bool		result = true;
+
+	if (pk_rel->rd_rel->relkind != RELKIND_RELATION ||
+		!OidIsValid(riinfo->conindid))
+		return false;
+
+	if (pg_class_aclcheck(pk_relid, pk_owner, ACL_SELECT) != ACLCHECK_OK ||
+		pg_class_aclcheck(pk_relid, pk_owner, ACL_UPDATE) != ACLCHECK_OK)
+		return false;
+
+	idx_rel = index_open(riinfo->conindid, AccessShareLock);
+
+	if (idx_rel->rd_rel->relam != BTREE_AM_OID ||
+		IndexRelationGetNumberOfKeyAttributes(idx_rel) != riinfo->nkeys)
+		result = false;
+
+	for (int j = 0; result && j < riinfo->nkeys; j++)
+	{
+		AttrNumber	pk_attnum = idx_rel->rd_index->indkey.values[j];
+		Form_pg_attribute fk_att;
+		Oid			eq_opr;
+		Oid			lefttype,
+					righttype;
+		Oid			castfunc = InvalidOid;
+		int			i;
+
+		for (i = 0; i < riinfo->nkeys; i++)
+		{
+			if (riinfo->pk_attnums[i] == pk_attnum)
+				break;
+		}
+		if (i >= riinfo->nkeys ||
+			idx_rel->rd_indcollation[j] != RIAttCollation(pk_rel, pk_attnum))
+		{
+			result = false;
+			break;
+		}
+
+		eq_opr = riinfo->pf_eq_oprs[i];
+		if (get_op_opfamily_strategy(eq_opr, idx_rel->rd_opfamily[j]) !=
+			BTEqualStrategyNumber)
+		{
+			result = false;
+			break;
+		}
+
+		/* As in ri_HashCompareOp, find out how to coerce the FK value */
+		fk_att = TupleDescAttr(RelationGetDescr(fk_rel),
+							   riinfo->fk_attnums[i] - 1);
+		op_input_types(eq_opr, &lefttype, &righttype);
+		if (fk_att->atttypid != righttype)
+		{
+			CoercionPathType pathtype;
+
+			pathtype = find_coercion_pathway(righttype, fk_att->atttypid,
+											 COERCION_IMPLICIT,
+											 &castfunc);
+			if (pathtype != COERCION_PATH_FUNC &&
+				pathtype != COERCION_PATH_RELABELTYPE &&
+				!IsBinaryCoercible(fk_att->atttypid, righttype))
+			{
+				result = false;
+				break;
+			}
+		}
+		if (OidIsValid(castfunc))
+			fmgr_info(castfunc, &bc->cast_finfo[j]);
+		else
+			bc->cast_finfo[j].fn_oid = InvalidOid;
+
+		bc->keyidx[j] = i;
+		bc->pk_attnums[j] = pk_attnum;
+		bc->fk_byval[i] = fk_att->attbyval;
+		bc->fk_len[i] = fk_att->attlen;
+		ScanKeyEntryInitialize(&bc->skey[j],
+							   0,
+							   j + 1,
+							   BTEqualStrategyNumber,
+							   righttype,
+							   idx_rel->rd_indcollation[j],
+							   get_opcode(eq_opr),
+							   (Datum) 0);
+	}
+
+	index_close(idx_rel, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * ri_QueuePendingCheck -
+ *
+ * Add the FK key of a row to the queue of checks.  Caller has made sure that
+ * there's room in the queue, and that none of the key values is NULL.
+ */
+static void
+ri_QueuePendingCheck(RI_BatchConstraint *bc, const RI_ConstraintInfo *riinfo,
+					 TupleTableSlot *slot)
+{
+	MemoryContext oldcxt;
+	RI_PendingCheck *check;
+
+	Assert(ri_num_pending < RI_MAX_PENDING_CHECKS);
+
+	oldcxt = MemoryContextSwitchTo(ri_pending_cxt);
+
+	if (ri_pending_checks == NULL)
+		ri_pending_checks = palloc(sizeof(RI_PendingCheck) *
+								   RI_MAX_PENDING_CHECKS);
+
+	check = &ri_pending_checks[ri_num_pending];
+	check->constraint = bc;
+	check->values = palloc(sizeof(Datum) * riinfo->nkeys);
+
+	for (int i = 0; i < riinfo->nkeys; i++)
+	{
+		Datum		value;
+		bool		isnull;
+
+		value = slot_getattr(slot, riinfo->fk_attnums[i], &isnull);
+		Assert(!isnull);
+
+		/* Don't keep pointers into the FK table's TOAST table */
+		if (bc->fk_len[i] == -1 &&
+			VARATT_IS_EXTERNAL(DatumGetPointer(value)))
+			value = PointerGetDatum(detoast_external_attr((struct varlena *)
+														  DatumGetPointer(value)));
+		else
+			value = datumCopy(value, bc->fk_byval[i], bc->fk_len[i]);
+
+		check->values[i] = value;
+	}
+
+	ri_num_pending++;
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * ri_PendingKeysEqual -
+ *
+ * Are two queued keys of the same constraint binary equal?
+ */
+static bool
+ri_PendingKeysEqual(RI_BatchConstraint *bc, Datum *values1, Datum *values2)
+{
+	for (int i = 0; i < bc->nkeys; i++)
+	{
+		if (!datum_image_eq(values1[i], values2[i],
+							bc->fk_byval[i], bc->fk_len[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * ri_LookupPendingKey -
+ *
+ * Look up a queued key in the PK index, and lock the PK row found in
+ * KEY SHARE mode.  Returns whether a row was found.
+ *
+ * The row locking follows ExecLockRows(), including the recheck of a row
+ * version that we only got to by following its update chain.
+ */
+static bool
+ri_LookupPendingKey(RI_BatchConstraint *bc, Datum *values, Snapshot snapshot)
+{
+	TupleTableSlot *slot = bc->slot;
+
+	for (int j = 0; j < bc->nkeys; j++)
+	{
+		Datum		value = values[bc->keyidx[j]];
+
+		if (OidIsValid(bc->cast_finfo[j].fn_oid))
+			value = FunctionCall3(&bc->cast_finfo[j],
+								  value,
+								  Int32GetDatum(-1),	/* typmod */
+								  BoolGetDatum(false)); /* implicit coercion */
+		bc->skey[j].sk_argument = value;
+	}
+
+	index_rescan(bc->scan, bc->skey, bc->nkeys, NULL, 0);
+
+	while (index_getnext_slot(bc->scan, ForwardScanDirection, slot))
+	{
+		ItemPointerData tid = slot->tts_tid;
+		TM_FailureData tmfd;
+		TM_Result	test;
+		int			lockflags;
+		bool		matches = true;
+
+		lockflags = TUPLE_LOCK_FLAG_LOCK_UPDATE_IN_PROGRESS;
+		if (!IsolationUsesXactSnapshot())
+			lockflags |= TUPLE_LOCK_FLAG_FIND_LAST_VERSION;
+
+		test = table_tuple_lock(bc->pk_rel, &tid, snapshot, slot,
+								GetCurrentCommandId(true),
+								LockTupleKeyShare, LockWaitBlock,
+								lockflags, &tmfd);
+
+		switch (test)
+		{
+			case TM_SelfModified:
+				/* updated or deleted by ourselves; treat it as deleted */
+				continue;
+
+			case TM_Ok:
+				break;
+
+			case TM_Updated:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent update")));
+				elog(ERROR, "unexpected table_tuple_lock status: %u",
+					 test);
+				break;
+
+			case TM_Deleted:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent update")));
+				/* tuple was deleted, so it doesn't count */
+				continue;
+
+			case TM_Invisible:
+				elog(ERROR, "attempted to lock invisible tuple");
+				break;
+
+			default:
+				elog(ERROR, "unrecognized table_tuple_lock status: %u",
+					 test);
+		}
+
+		/* If we locked a newer version of the row, it must still match */
+		if (tmfd.traversed)
+		{
+			for (int j = 0; matches && j < bc->nkeys; j++)
+			{
+				Datum		pkvalue;
+				bool		isnull;
+
+				pkvalue = slot_getattr(slot, bc->pk_attnums[j], &isnull);
+				matches = !isnull &&
+					DatumGetBool(FunctionCall2Coll(&bc->skey[j].sk_func,
+												   bc->skey[j].sk_collation,
+												   pkvalue,
+												   bc->skey[j].sk_argument));
+			}
+		}
+
+		if (matches)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * ri_ReportPendingViolation -
+ *
+ * Report a queued key that's not present in the PK table, with the same
+ * error as the SPI query would.
+ */
+static void
+ri_ReportPendingViolation(RI_BatchConstraint *bc, Datum *values)
+{
+	const RI_ConstraintInfo *riinfo = ri_LoadConstraintInfo(bc->constraint_id);
+	Relation	fk_rel;
+	TupleTableSlot *slot;
+
+	fk_rel = table_open(riinfo->fk_relid, AccessShareLock);
+
+	/* ri_ReportViolation only looks at the key columns */
+	slot = MakeSingleTupleTableSlot(RelationGetDescr(fk_rel), &TTSOpsVirtual);
+	ExecClearTuple(slot);
+	memset(slot->tts_isnull, true,
+		   sizeof(bool) * RelationGetDescr(fk_rel)->natts);
+	for (int i = 0; i < riinfo->nkeys; i++)
+	{
+		slot->tts_values[riinfo->fk_attnums[i] - 1] = values[i];
+		slot->tts_isnull[riinfo->fk_attnums[i] - 1] = false;
+	}
+	ExecStoreVirtualTuple(slot);
+
+	ri_ReportViolation(riinfo, bc->pk_rel, fk_rel, slot, NULL,
+					   RI_PLAN_CHECK_LOOKUPPK, false);
+}
+
+
 /*
  * ri_Check_Pk_Match
  *
@@ -2084,6 +2642,7 @@ ri_LoadConstraintInfo(Oid constraintOid)
 	memcpy(&riinfo->conname, &conForm->conname, sizeof(NameData));
 	riinfo->pk_relid = conForm->confrelid;
 	riinfo->fk_relid = conForm->conrelid;
+	riinfo->conindid = conForm->conindid;
 	riinfo->confupdtype = conForm->confupdtype;
 	riinfo->confdeltype = conForm->confdeltype;
 	riinfo->confmatchtype = conForm->confmatchtype;
@@ -4890,11 +4890,8 @@ examine_variable(PlannerInfo *root, Node *node, int varRelid,
 						else if (index->indpred == NIL)
 						{
 							vardata->statsTuple =
-								SearchSysCache3(STATRELATTINH,
-												ObjectIdGetDatum(index->indexoid),
-												Int16GetDatum(pos + 1),
-												BoolGetDatum(false));
-							vardata->freefunc = ReleaseSysCache;
+								get_attstatstuple(index->indexoid, pos + 1,
+												  false, &vardata->freefunc);
 
 							if (HeapTupleIsValid(vardata->statsTuple))
 							{
@@ -5023,11 +5020,8 @@ examine_simple_variable(PlannerInfo *root, Var *var,
 		 * Plain table or parent of an inheritance appendrel, so look up the
 		 * column in pg_statistic
 		 */
-		vardata->statsTuple = SearchSysCache3(STATRELATTINH,
-											  ObjectIdGetDatum(rte->relid),
-											  Int16GetDatum(var->varattno),
-											  BoolGetDatum(rte->inh));
-		vardata->freefunc = ReleaseSysCache;
+		vardata->statsTuple = get_attstatstuple(rte->relid, var->varattno,
+												rte->inh, &vardata->freefunc);
 
 		if (HeapTupleIsValid(vardata->statsTuple))
 		{
@@ -6256,8 +6250,39 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	int			num_skip_cols;
+	double		num_skip_scans;
 	ListCell   *lc;
 
+	/*
+	 * If the leading index columns have no quals, but later ones do, nbtree
+	 * performs a skip scan: it does a separate descent of the index for each
+	 * distinct value of the unconstrained prefix columns, and within each one
+	 * the remaining quals act as boundary quals.  (Parallel scans don't skip.)
+	 * Estimate the number of such descents from the number of distinct
+	 * prefixes.
+	 */
+	num_skip_cols = 0;
+	num_skip_scans = 1;
+	if (path->indexclauses != NIL && !path->path.parallel_aware)
+		num_skip_cols = linitial_node(IndexClause, path->indexclauses)->indexcol;
+	if (num_skip_cols > 0)
+	{
+		List	   *prefixExprs = NIL;
+		int			i;
+
+		for (i = 0; i < num_skip_cols; i++)
+		{
+			TargetEntry *tle = list_nth_node(TargetEntry, index->indextlist, i);
+
+			prefixExprs = lappend(prefixExprs, tle->expr);
+		}
+		num_skip_scans = estimate_num_groups(root, prefixExprs,
+											 index->rel->tuples, NULL);
+		num_skip_scans = Max(num_skip_scans, 1.0);
+		list_free(prefixExprs);
+	}
+
 	/*
 	 * For a btree scan, only leading '=' quals plus inequality quals for the
 	 * immediately next attribute contribute to index selectivity (these are
@@ -6273,10 +6298,11 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 *
 	 * If there's a ScalarArrayOpExpr in the quals, we'll actually perform N
 	 * index scans not one, but the ScalarArrayOpExpr's operator can be
-	 * considered to act the same as it normally does.
+	 * considered to act the same as it normally does.  Likewise, in a skip
+	 * scan the skipped columns act as though they had '=' quals.
 	 */
 	indexBoundQuals = NIL;
-	indexcol = 0;
+	indexcol = num_skip_cols;
 	eqQualHere = false;
 	found_saop = false;
 	found_is_null_op = false;
@@ -6365,6 +6391,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * NullTest invalidates that theory, even though it sets eqQualHere.
 	 */
 	if (index->unique &&
+		num_skip_cols == 0 &&
 		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
@@ -6404,6 +6431,24 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 
 	genericcostestimate(root, path, loop_count, &costs);
 
+	/*
+	 * A skip scan visits at least one leaf page per distinct prefix, even if
+	 * the boundary quals select fewer tuples than that, so charge for any
+	 * extra leaf pages that implies.
+	 */
+	if (num_skip_scans > 1)
+	{
+		double		skip_pages;
+
+		skip_pages = Min(num_skip_scans, (double) index->pages);
+		if (skip_pages > costs.numIndexPages)
+		{
+			costs.indexTotalCost += costs.num_sa_scans *
+				(skip_pages - costs.numIndexPages) * costs.spc_random_page_cost;
+			costs.numIndexPages = skip_pages;
+		}
+	}
+
 	/*
 	 * Add a CPU-cost component to represent the costs of initial btree
 	 * descent.  We don't charge any I/O cost for touching upper btree levels,
@@ -6413,13 +6458,18 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 *
 	 * If there are ScalarArrayOpExprs, charge this once per SA scan.  The
 	 * ones after the first one are not startup cost so far as the overall
-	 * plan is concerned, so add them only to "total" cost.
+	 * plan is concerned, so add them only to "total" cost.  A skip scan
+	 * descends twice per distinct prefix: once to find the prefix, and once
+	 * to position the scan within it.
 	 */
 	if (index->tuples > 1)		/* avoid computing log(0) */
 	{
 		descentCost = ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
 		costs.indexStartupCost += descentCost;
 		costs.indexTotalCost += costs.num_sa_scans * descentCost;
+		if (num_skip_scans > 1)
+			costs.indexTotalCost += costs.num_sa_scans *
+				(2 * num_skip_scans - 1) * descentCost;
 	}
 
 	/*
@@ -6435,6 +6485,9 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	descentCost = (index->tree_height + 1) * 50.0 * cpu_operator_cost;
 	costs.indexStartupCost += descentCost;
 	costs.indexTotalCost += costs.num_sa_scans * descentCost;
+	if (num_skip_scans > 1)
+		costs.indexTotalCost += costs.num_sa_scans *
+			(2 * num_skip_scans - 1) * descentCost;
 
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
@@ -6469,11 +6522,8 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		}
 		else
 		{
-			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
-												 ObjectIdGetDatum(relid),
-												 Int16GetDatum(colnum),
-												 BoolGetDatum(rte->inh));
-			vardata.freefunc = ReleaseSysCache;
+			vardata.statsTuple = get_attstatstuple(relid, colnum, rte->inh,
+												   &vardata.freefunc);
 		}
 	}
 	else
@@ -6495,11 +6545,8 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		}
 		else
 		{
-			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
-												 ObjectIdGetDatum(relid),
-												 Int16GetDatum(colnum),
-												 BoolGetDatum(false));
-			vardata.freefunc = ReleaseSysCache;
+			vardata.statsTuple = get_attstatstuple(relid, colnum, false,
+												   &vardata.freefunc);
 		}
 	}
 
@@ -7040,7 +7087,10 @@ gincostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	{
 		/* Lock should have already been obtained in plancat.c */
 		indexRel = index_open(index->indexoid, NoLock);
-		ginGetStats(indexRel, &ginStats);
+		if (RelationLacksSessionStorage(indexRel))
+			memset(&ginStats, 0, sizeof(ginStats));
+		else
+			ginGetStats(indexRel, &ginStats);
 		index_close(indexRel, NoLock);
 	}
 	else
@@ -7353,6 +7403,7 @@ brincostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	double		estimatedRanges;
 	double		selec;
 	Relation	indexRel;
+	bool		have_stats = false;
 	ListCell   *l;
 	VariableStatData vardata;
 
@@ -7366,6 +7417,7 @@ brincostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	/*
 	 * Obtain some data from the index itself, if possible.  Otherwise invent
 	 * some plausible internal statistics based on the relation page count.
+	 * A global temporary index might not have storage in this session yet.
 	 */
 	if (!index->hypothetical)
 	{
@@ -7373,9 +7425,16 @@ brincostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		 * A lock should have already been obtained on the index in plancat.c.
 		 */
 		indexRel = index_open(index->indexoid, NoLock);
-		brinGetStats(indexRel, &statsData);
+		if (!RelationLacksSessionStorage(indexRel))
+		{
+			brinGetStats(indexRel, &statsData);
+			have_stats = true;
+		}
 		index_close(indexRel, NoLock);
+	}
 
+	if (have_stats)
+	{
 		/* work out the actual number of ranges in the index */
 		indexRanges = Max(ceil((double) baserel->pages /
 							   statsData.pagesPerRange), 1.0);
@@ -7426,11 +7485,8 @@ brincostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 			else
 			{
 				vardata.statsTuple =
-					SearchSysCache3(STATRELATTINH,
-									ObjectIdGetDatum(rte->relid),
-									Int16GetDatum(attnum),
-									BoolGetDatum(false));
-				vardata.freefunc = ReleaseSysCache;
+					get_attstatstuple(rte->relid, attnum, false,
+									  &vardata.freefunc);
 			}
 		}
 		else
@@ -7456,11 +7512,8 @@ brincostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 			}
 			else
 			{
-				vardata.statsTuple = SearchSysCache3(STATRELATTINH,
-													 ObjectIdGetDatum(index->indexoid),
-													 Int16GetDatum(attnum),
-													 BoolGetDatum(false));
-				vardata.freefunc = ReleaseSysCache;
+				vardata.statsTuple = get_attstatstuple(index->indexoid, attnum,
+													   false, &vardata.freefunc);
 			}
 		}
 
@@ -19,24 +19,31 @@
 #include "access/relscan.h"
 #include "access/sysattr.h"
 #include "access/table.h"
+#include "access/transam.h"
 #include "access/valid.h"
 #include "access/xact.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
+#include "funcapi.h"
+#include "lib/dshash.h"
 #include "miscadmin.h"
 #ifdef CATCACHE_STATS
 #include "storage/ipc.h"		/* for on_proc_exit */
 #endif
 #include "storage/lmgr.h"
+#include "storage/shmem.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
+#include "utils/dsa.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/relcache.h"
 #include "utils/resowner_private.h"
+#include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
 
@@ -63,6 +70,118 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/*
+ * Memory budget for the catalog caches and the relcache together, in kB.
+ * Zero means no limit.
+ */
+int			catalog_cache_memory_limit = 0;
+
+/*
+ * Number of transactions ended by this backend, used to recognize entries
+ * accessed by the current transaction; see CatCTup.lru_epoch.
+ */
+static uint32 catcache_epoch = 0;
+
+/*
+ * When over budget, prune down to this fraction of the limit, so that we
+ * don't have to prune again right away.
+ */
+#define CATCACHE_PRUNE_TARGET	0.9
+
+/*
+ * The shared catalog cache
+ *
+ * When shared_catalog_cache_size is set, catalog tuples that backends load
+ * are also kept in a hashtable in shared memory, and searches that miss in
+ * the local cache look there before reading the catalog.  This spares new
+ * backends most of the catalog reads of warming up their caches.  Searches
+ * for lists are not shared.
+ *
+ * The hashtable is keyed by database, cache ID and hash value of the search
+ * keys, like the local hash buckets, and each entry holds a chain of tuples
+ * with that hash value.  Negative entries are shared too; they are stored as
+ * tuples that have only the key columns set.
+ *
+ * Entries are removed when the invalidation messages for the tuple are sent
+ * at commit (see SendSharedInvalidMessages), so that nobody who processes
+ * the messages can find the old tuple in the shared cache afterwards.  We
+ * must also prevent a backend that read the old version of the tuple, with a
+ * snapshot taken before the commit, from entering it after it has been
+ * invalidated.  For that, invalidating an entry records the current
+ * xactCompletionCount in one of SHARED_CATCACHE_STRIPES counters chosen by
+ * the key, and a tuple is entered only if the snapshot it was read with has
+ * a newer xactCompletionCount than that.  The check is made while holding
+ * the hashtable partition lock, and invalidation advances the counter before
+ * it removes the entry under that lock, so either the insertion sees the
+ * counter or the removal sees the entry.
+ *
+ * A backend whose transaction has modified the catalogs doesn't use the
+ * shared cache at all, because it must see its own changes, and must not
+ * share them before they're committed.  Neither do historic snapshots of
+ * logical decoding.
+ *
+ * When the tuples use more than shared_catalog_cache_size, entries that have
+ * not been used since the last sweep are removed.
+ */
+int			shared_catalog_cache_size = 0;
+
+#define SHARED_CATCACHE_STRIPES		256
+
+/* Extra space for the hashtable and DSA's own bookkeeping */
+#define SHARED_CATCACHE_AREA_SLACK	(4 * 1024 * 1024)
+
+typedef struct SharedCatCacheKey
+{
+	Oid			dbid;			/* database, or InvalidOid if shared catalog */
+	int			cacheid;		/* cache identifier */
+	uint32		hash_value;		/* hash value of the search keys */
+} SharedCatCacheKey;
+
+typedef struct SharedCatCacheEntry
+{
+	SharedCatCacheKey key;		/* hash key; must be first */
+	bool		referenced;		/* used since the last sweep? */
+	dsa_pointer items;			/* chain of SharedCatCacheItems */
+} SharedCatCacheEntry;
+
+typedef struct SharedCatCacheItem
+{
+	dsa_pointer next;			/* next item with the same key */
+	Size		size;			/* allocated size of this item */
+	bool		negative;		/* negative cache entry? */
+	ItemPointerData t_self;
+	Oid			t_tableOid;
+	uint32		t_len;
+	/* MAXALIGN'd tuple data follows */
+} SharedCatCacheItem;
+
+#define SharedCatCacheItemData(item) \
+	((HeapTupleHeader) ((char *) (item) + MAXALIGN(sizeof(SharedCatCacheItem))))
+
+typedef struct SharedCatCacheControl
+{
+	dshash_table_handle hash_handle;	/* the hashtable in the area */
+	pg_atomic_uint64 item_bytes;	/* memory used by all items */
+	pg_atomic_flag sweeping;	/* is somebody removing entries? */
+	pg_atomic_uint64 inval_count[SHARED_CATCACHE_STRIPES];
+	/* the DSA area follows */
+} SharedCatCacheControl;
+
+#define SHARED_CATCACHE_AREA_PLACE(ctl) \
+	((char *) (ctl) + MAXALIGN(sizeof(SharedCatCacheControl)))
+
+static SharedCatCacheControl *SharedCatCacheCtl = NULL;
+static dsa_area *SharedCatCacheArea = NULL;
+static dshash_table *SharedCatCacheHash = NULL;
+
+static const dshash_parameters SharedCatCacheHashParams = {
+	sizeof(SharedCatCacheKey),
+	sizeof(SharedCatCacheEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_CATCACHE
+};
+
 static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   int nkeys,
 											   Datum v1, Datum v2,
@@ -88,6 +207,24 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static inline void CatCacheTouchEntry(CatCTup *ct);
+static void CatCacheEnforceLimit(bool eoxact);
+static void CatCachePrune(Size target);
+static Size SharedCatCacheAreaSize(void);
+static void SharedCatCacheAttach(void);
+static bool SharedCatCacheUsable(CatCache *cache);
+static void SharedCatCacheMakeKey(CatCache *cache, uint32 hashValue,
+								  SharedCatCacheKey *key);
+static bool SharedCatCacheItemMatches(CatCache *cache,
+									  SharedCatCacheItem *item,
+									  Datum *arguments);
+static CatCTup *SharedCatCacheLookup(CatCache *cache, uint32 hashValue,
+									 Index hashIndex, Datum *arguments);
+static void SharedCatCacheInsert(CatCache *cache, uint32 hashValue,
+								 Datum *arguments, HeapTuple tuple,
+								 uint64 completionCount);
+static void SharedCatCacheFreeItems(SharedCatCacheEntry *entry);
+static void SharedCatCacheSweep(void);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 										Datum *arguments,
@@ -471,8 +608,9 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		return;					/* nothing left to do */
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&ct->cache_elem);
+	dlist_delete(&ct->lru_elem);
 
 	/*
 	 * Free keys when we're dealing with a negative entry, normal entries just
@@ -482,6 +620,9 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		CatCacheFreeKeys(cache->cc_tupdesc, cache->cc_nkeys,
 						 cache->cc_keyno, ct->keys);
 
+	cache->cc_memory -= GetMemoryChunkSpace(ct);
+	CacheHdr->ch_memory -= GetMemoryChunkSpace(ct);
+
 	pfree(ct);
 
 	--cache->cc_ntup;
@@ -526,9 +667,94 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 	CatCacheFreeKeys(cache->cc_tupdesc, cl->nkeys,
 					 cache->cc_keyno, cl->keys);
 
+	cache->cc_memory -= GetMemoryChunkSpace(cl);
+	CacheHdr->ch_memory -= GetMemoryChunkSpace(cl);
+
 	pfree(cl);
 }
 
+/*
+ *		CatCacheTouchEntry
+ *
+ * Mark the given cache entry as just used, for the purposes of pruning.
+ */
+static inline void
+CatCacheTouchEntry(CatCTup *ct)
+{
+	dlist_move_head(&CacheHdr->ch_lru, &ct->lru_elem);
+	ct->lru_epoch = catcache_epoch;
+}
+
+/*
+ *		CatCacheEnforceLimit
+ *
+ * If the catalog caches and the relcache together use more memory than
+ * catalog_cache_memory_limit allows, prune their least recently used entries
+ * until we're comfortably below it.  Both caches give up the same fraction
+ * of their memory.  The relcache can only be pruned between transactions
+ * (see RelationCachePrune), so when called within a transaction only the
+ * catalog caches shrink.
+ */
+static void
+CatCacheEnforceLimit(bool eoxact)
+{
+	Size		limit = (Size) catalog_cache_memory_limit * 1024;
+	Size		relcache_memory = RelationCacheMemoryUsed();
+	Size		total = CacheHdr->ch_memory + relcache_memory;
+	double		fraction;
+
+	if (total <= limit)
+		return;
+
+	fraction = (limit * CATCACHE_PRUNE_TARGET) / total;
+
+	if (eoxact)
+		RelationCachePrune((Size) (relcache_memory * fraction));
+	CatCachePrune((Size) (CacheHdr->ch_memory * fraction));
+}
+
+/*
+ *		CatCachePrune
+ *
+ * Remove least recently used entries from the catalog caches, until they use
+ * no more than "target" bytes or no more candidates are left.  Entries that
+ * are referenced, directly or through a list, are skipped, and so is
+ * everything that the current transaction has used.
+ */
+static void
+CatCachePrune(Size target)
+{
+	dlist_node *cur;
+
+	cur = CacheHdr->ch_lru.head.prev;
+	while (CacheHdr->ch_memory > target && cur != &CacheHdr->ch_lru.head)
+	{
+		CatCTup    *ct = dlist_container(CatCTup, lru_elem, cur);
+		bool		in_list = (ct->c_list != NULL);
+
+		/* everything from here on was used by the current transaction */
+		if (ct->lru_epoch == catcache_epoch)
+			break;
+
+		cur = cur->prev;
+
+		if (ct->refcount > 0 ||
+			(ct->c_list && ct->c_list->refcount > 0))
+			continue;
+
+		ct->my_cache->cc_nevictions++;
+		CatCacheRemoveCTup(ct->my_cache, ct);
+
+		/*
+		 * Removing a list member removes the whole list, which can take
+		 * other members with it, possibly including the one we were about to
+		 * look at next.  Start over from the end.
+		 */
+		if (in_list)
+			cur = CacheHdr->ch_lru.head.prev;
+	}
+}
+
 
 /*
  *	CatCacheInvalidate
@@ -802,6 +1028,8 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		CacheHdr->ch_memory = 0;
+		dlist_init(&CacheHdr->ch_lru);
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1264,6 +1492,10 @@ SearchCatCacheInternal(CatCache *cache,
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
 
+		cache->cc_nhits++;
+		if (catalog_cache_memory_limit > 0)
+			CatCacheTouchEntry(ct);
+
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
 		 * negative, we can report failure to the caller.
@@ -1322,6 +1554,8 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	Datum		arguments[CATCACHE_MAXKEYS];
+	bool		use_shared;
+	uint64		completionCount = 0;
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1329,6 +1563,28 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * See if another backend has loaded the tuple into the shared catalog
+	 * cache already.
+	 */
+	use_shared = SharedCatCacheUsable(cache);
+	if (use_shared)
+	{
+		ct = SharedCatCacheLookup(cache, hashValue, hashIndex, arguments);
+		if (ct != NULL)
+		{
+			if (ct->negative)
+				return NULL;
+
+			ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+			ct->refcount++;
+			ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+			return &ct->tuple;
+		}
+	}
+
+	cache->cc_nmisses++;
+
 	/*
 	 * Ok, need to make a lookup in the relation, copy the scankey and fill
 	 * out any per-call fields.
@@ -1377,6 +1633,11 @@ SearchCatCacheMiss(CatCache *cache,
 		break;					/* assume only one match */
 	}
 
+	/* Remember how recent the snapshot was, for the shared catalog cache */
+	if (use_shared && scandesc->snapshot &&
+		scandesc->snapshot->snapshot_type == SNAPSHOT_MVCC)
+		completionCount = scandesc->snapshot->snapXactCompletionCount;
+
 	systable_endscan(scandesc);
 
 	table_close(relation, AccessShareLock);
@@ -1400,6 +1661,10 @@ SearchCatCacheMiss(CatCache *cache,
 									 hashValue, hashIndex,
 									 true);
 
+		if (completionCount != 0)
+			SharedCatCacheInsert(cache, hashValue, arguments, NULL,
+								 completionCount);
+
 		CACHE_elog(DEBUG2, "SearchCatCache(%s): Contains %d/%d tuples",
 				   cache->cc_relname, cache->cc_ntup, CacheHdr->ch_ntup);
 		CACHE_elog(DEBUG2, "SearchCatCache(%s): put neg entry in bucket %d",
@@ -1413,6 +1678,10 @@ SearchCatCacheMiss(CatCache *cache,
 		return NULL;
 	}
 
+	if (completionCount != 0)
+		SharedCatCacheInsert(cache, hashValue, arguments, &ct->tuple,
+							 completionCount);
+
 	CACHE_elog(DEBUG2, "SearchCatCache(%s): Contains %d/%d tuples",
 			   cache->cc_relname, cache->cc_ntup, CacheHdr->ch_ntup);
 	CACHE_elog(DEBUG2, "SearchCatCache(%s): put in bucket %d",
@@ -1582,6 +1851,13 @@ SearchCatCacheList(CatCache *cache,
 		 */
 		dlist_move_head(&cache->cc_lists, &cl->cache_elem);
 
+		cache->cc_nhits++;
+		if (catalog_cache_memory_limit > 0)
+		{
+			for (i = 0; i < cl->n_members; i++)
+				CatCacheTouchEntry(cl->members[i]);
+		}
+
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
 		cl->refcount++;
@@ -1607,6 +1883,8 @@ SearchCatCacheList(CatCache *cache,
 	 * block to ensure we can undo those refcounts if we get an error before
 	 * we finish constructing the CatCList.
 	 */
+	cache->cc_nmisses++;
+
 	ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
 
 	ctlist = NIL;
@@ -1685,6 +1963,8 @@ SearchCatCacheList(CatCache *cache,
 											 hashValue, hashIndex,
 											 false);
 			}
+			else if (catalog_cache_memory_limit > 0)
+				CatCacheTouchEntry(ct);
 
 			/* Careful here: add entry to ctlist, then bump its refcount */
 			/* This way leaves state correct if lappend runs out of memory */
@@ -1763,6 +2043,9 @@ SearchCatCacheList(CatCache *cache,
 
 	dlist_push_head(&cache->cc_lists, &cl->cache_elem);
 
+	cache->cc_memory += GetMemoryChunkSpace(cl);
+	CacheHdr->ch_memory += GetMemoryChunkSpace(cl);
+
 	/* Finally, bump the list's refcount and return it */
 	cl->refcount++;
 	ResourceOwnerRememberCatCacheListRef(CurrentResourceOwner, cl);
@@ -1810,6 +2093,14 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	HeapTuple	dtp;
 	MemoryContext oldcxt;
 
+	/*
+	 * If we are over budget, make room first.  The new entry is marked as
+	 * used by the current transaction, so it's not at risk either way, but
+	 * doing it now avoids a useless visit to it.
+	 */
+	if (catalog_cache_memory_limit > 0)
+		CatCacheEnforceLimit(false);
+
 	/* negative entries have no tuple associated */
 	if (ntp)
 	{
@@ -1891,8 +2182,13 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
 
+	ct->lru_epoch = catcache_epoch;
+	dlist_push_head(&CacheHdr->ch_lru, &ct->lru_elem);
+
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	cache->cc_memory += GetMemoryChunkSpace(ct);
+	CacheHdr->ch_memory += GetMemoryChunkSpace(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
@@ -2063,6 +2359,628 @@ PrepareToInvalidateCacheTuple(Relation relation,
 }
 
 
+/*
+ * Size of the DSA area holding the shared catalog cache.  DSA rounds
+ * requests up to size classes and keeps partially used superblocks around,
+ * so we're generous.
+ */
+static Size
+SharedCatCacheAreaSize(void)
+{
+	return add_size(mul_size(shared_catalog_cache_size, 2 * 1024),
+					SHARED_CATCACHE_AREA_SLACK);
+}
+
+/*
+ * CatCacheShmemSize
+ *		Report the shared memory needed by the shared catalog cache
+ */
+Size
+CatCacheShmemSize(void)
+{
+	if (shared_catalog_cache_size == 0)
+		return 0;
+
+	return add_size(MAXALIGN(sizeof(SharedCatCacheControl)),
+					SharedCatCacheAreaSize());
+}
+
+/*
+ * CatCacheShmemInit
+ *		Create or attach to the shared catalog cache
+ */
+void
+CatCacheShmemInit(void)
+{
+	bool		found;
+	MemoryContext oldcontext;
+	int			i;
+
+	if (shared_catalog_cache_size == 0)
+		return;
+
+	SharedCatCacheCtl = (SharedCatCacheControl *)
+		ShmemInitStruct("Shared Catalog Cache", CatCacheShmemSize(), &found);
+
+	if (found)
+		return;
+
+	pg_atomic_init_u64(&SharedCatCacheCtl->item_bytes, 0);
+	pg_atomic_init_flag(&SharedCatCacheCtl->sweeping);
+	for (i = 0; i < SHARED_CATCACHE_STRIPES; i++)
+		pg_atomic_init_u64(&SharedCatCacheCtl->inval_count[i], 0);
+
+	/*
+	 * Create the area and the hashtable in it.  The area must never grow
+	 * beyond the space reserved for it, so that we don't create DSM segments
+	 * behind the postmaster's back.  Processes forked from the postmaster
+	 * inherit its attachment, so the backend-local state has to live in
+	 * TopMemoryContext.
+	 */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	SharedCatCacheArea = dsa_create_in_place(SHARED_CATCACHE_AREA_PLACE(SharedCatCacheCtl),
+											 SharedCatCacheAreaSize(),
+											 LWTRANCHE_SHARED_CATCACHE, NULL);
+	dsa_set_size_limit(SharedCatCacheArea, SharedCatCacheAreaSize());
+	SharedCatCacheHash = dshash_create(SharedCatCacheArea,
+									   &SharedCatCacheHashParams, NULL);
+	SharedCatCacheCtl->hash_handle =
+		dshash_get_hash_table_handle(SharedCatCacheHash);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Attach to the shared catalog cache, unless this process is attached
+ * already.  This does real work only in EXEC_BACKEND builds.  The area is
+ * never destroyed, so there's no need to detach at process exit.
+ */
+static void
+SharedCatCacheAttach(void)
+{
+	MemoryContext oldcontext;
+
+	if (SharedCatCacheHash)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	SharedCatCacheArea =
+		dsa_attach_in_place(SHARED_CATCACHE_AREA_PLACE(SharedCatCacheCtl), NULL);
+	SharedCatCacheHash = dshash_attach(SharedCatCacheArea,
+									   &SharedCatCacheHashParams,
+									   SharedCatCacheCtl->hash_handle, NULL);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Can the given cache use the shared catalog cache right now?
+ */
+static bool
+SharedCatCacheUsable(CatCache *cache)
+{
+	if (SharedCatCacheCtl == NULL || IsBootstrapProcessingMode())
+		return false;
+
+	/* see the comments at the top of the file */
+	if (HasPendingInvalidations() || HistoricSnapshotActive())
+		return false;
+
+	return cache->cc_relisshared || OidIsValid(MyDatabaseId);
+}
+
+static void
+SharedCatCacheMakeKey(CatCache *cache, uint32 hashValue,
+					  SharedCatCacheKey *key)
+{
+	/* zero padding, if any, since we hash and compare the bytes */
+	memset(key, 0, sizeof(SharedCatCacheKey));
+	key->dbid = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+	key->cacheid = cache->id;
+	key->hash_value = hashValue;
+}
+
+static inline pg_atomic_uint64 *
+SharedCatCacheStripe(SharedCatCacheKey *key)
+{
+	uint32		h = hash_bytes((const unsigned char *) key,
+							   sizeof(SharedCatCacheKey));
+
+	return &SharedCatCacheCtl->inval_count[h % SHARED_CATCACHE_STRIPES];
+}
+
+/*
+ * Do the keys of a shared item match the given search keys?
+ */
+static bool
+SharedCatCacheItemMatches(CatCache *cache, SharedCatCacheItem *item,
+						  Datum *arguments)
+{
+	HeapTupleData tuple;
+	Datum		keys[CATCACHE_MAXKEYS];
+	int			i;
+
+	tuple.t_len = item->t_len;
+	tuple.t_self = item->t_self;
+	tuple.t_tableOid = item->t_tableOid;
+	tuple.t_data = SharedCatCacheItemData(item);
+
+	for (i = 0; i < cache->cc_nkeys; i++)
+	{
+		bool		isnull;
+
+		keys[i] = heap_getattr(&tuple, cache->cc_keyno[i],
+							   cache->cc_tupdesc, &isnull);
+		Assert(!isnull);
+	}
+
+	return CatalogCacheCompareTuple(cache, cache->cc_nkeys, keys, arguments);
+}
+
+/*
+ * SharedCatCacheLookup
+ *
+ * Look for a tuple matching the search keys in the shared catalog cache.  If
+ * one is found, a local entry is made from it and returned, just like
+ * CatalogCacheCreateEntry would; else NULL.
+ */
+static CatCTup *
+SharedCatCacheLookup(CatCache *cache, uint32 hashValue, Index hashIndex,
+					 Datum *arguments)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	dsa_pointer itemp;
+	HeapTupleData tuple;
+	char	   *copy = NULL;
+	bool		negative = false;
+	CatCTup    *ct;
+
+	SharedCatCacheAttach();
+	SharedCatCacheMakeKey(cache, hashValue, &key);
+
+	entry = dshash_find(SharedCatCacheHash, &key, false);
+	if (entry == NULL)
+		return NULL;
+
+	for (itemp = entry->items; DsaPointerIsValid(itemp);)
+	{
+		SharedCatCacheItem *item = dsa_get_address(SharedCatCacheArea, itemp);
+
+		if (!SharedCatCacheItemMatches(cache, item, arguments))
+		{
+			itemp = item->next;
+			continue;
+		}
+
+		/*
+		 * Copy the tuple out, so that we don't hold the partition lock while
+		 * making the local entry.  Don't risk an error while holding it.
+		 */
+		copy = MemoryContextAllocExtended(CurrentMemoryContext, item->t_len,
+										  MCXT_ALLOC_NO_OOM);
+		if (copy != NULL)
+		{
+			memcpy(copy, SharedCatCacheItemData(item), item->t_len);
+			tuple.t_len = item->t_len;
+			tuple.t_self = item->t_self;
+			tuple.t_tableOid = item->t_tableOid;
+			tuple.t_data = (HeapTupleHeader) copy;
+			negative = item->negative;
+			entry->referenced = true;
+		}
+		break;
+	}
+
+	dshash_release_lock(SharedCatCacheHash, entry);
+
+	if (copy == NULL)
+		return NULL;
+
+	ct = CatalogCacheCreateEntry(cache, negative ? NULL : &tuple, arguments,
+								 hashValue, hashIndex, negative);
+	pfree(copy);
+
+	cache->cc_nsharedhits++;
+
+	return ct;
+}
+
+/*
+ * SharedCatCacheInsert
+ *
+ * Enter a tuple that was just read from the catalog into the shared catalog
+ * cache, or a negative entry if tuple is NULL.  completionCount is the
+ * xactCompletionCount of the snapshot the catalog was read with.
+ */
+static void
+SharedCatCacheInsert(CatCache *cache, uint32 hashValue, Datum *arguments,
+					 HeapTuple tuple, uint64 completionCount)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	SharedCatCacheItem *item;
+	HeapTuple	negtuple = NULL;
+	dsa_pointer itemp;
+	Size		size;
+	bool		found;
+
+	SharedCatCacheAttach();
+
+	if (pg_atomic_read_u64(&SharedCatCacheCtl->item_bytes) >
+		(Size) shared_catalog_cache_size * 1024)
+		SharedCatCacheSweep();
+
+	/* Make a tuple holding just the keys for a negative entry */
+	if (tuple == NULL)
+	{
+		Datum	   *values;
+		bool	   *nulls;
+		int			i;
+
+		values = palloc0(cache->cc_tupdesc->natts * sizeof(Datum));
+		nulls = palloc(cache->cc_tupdesc->natts * sizeof(bool));
+		memset(nulls, true, cache->cc_tupdesc->natts * sizeof(bool));
+		for (i = 0; i < cache->cc_nkeys; i++)
+		{
+			int			attnum = cache->cc_keyno[i];
+
+			Assert(attnum > 0 && attnum <= cache->cc_tupdesc->natts);
+			values[attnum - 1] = arguments[i];
+			nulls[attnum - 1] = false;
+		}
+		negtuple = heap_form_tuple(cache->cc_tupdesc, values, nulls);
+		pfree(values);
+		pfree(nulls);
+	}
+
+	SharedCatCacheMakeKey(cache, hashValue, &key);
+
+	entry = dshash_find_or_insert(SharedCatCacheHash, &key, &found);
+	if (!found)
+	{
+		entry->referenced = false;
+		entry->items = InvalidDsaPointer;
+	}
+
+	/* Don't enter anything that might have been invalidated meanwhile */
+	if (completionCount <= pg_atomic_read_u64(SharedCatCacheStripe(&key)))
+		goto done;
+
+	/* Someone else might have entered the tuple already */
+	for (itemp = entry->items; DsaPointerIsValid(itemp); itemp = item->next)
+	{
+		item = dsa_get_address(SharedCatCacheArea, itemp);
+		if (SharedCatCacheItemMatches(cache, item, arguments))
+			goto done;
+	}
+
+	if (negtuple)
+		tuple = negtuple;
+	size = MAXALIGN(sizeof(SharedCatCacheItem)) + tuple->t_len;
+	itemp = dsa_allocate_extended(SharedCatCacheArea, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(itemp))
+		goto done;
+
+	item = dsa_get_address(SharedCatCacheArea, itemp);
+	item->size = size;
+	item->negative = (negtuple != NULL);
+	item->t_self = tuple->t_self;
+	item->t_tableOid = tuple->t_tableOid;
+	item->t_len = tuple->t_len;
+	memcpy(SharedCatCacheItemData(item), tuple->t_data, tuple->t_len);
+
+	item->next = entry->items;
+	entry->items = itemp;
+	pg_atomic_fetch_add_u64(&SharedCatCacheCtl->item_bytes, size);
+
+done:
+	if (DsaPointerIsValid(entry->items))
+		dshash_release_lock(SharedCatCacheHash, entry);
+	else
+		dshash_delete_entry(SharedCatCacheHash, entry);
+
+	if (negtuple)
+		heap_freetuple(negtuple);
+}
+
+/*
+ * Free all the items of a shared catalog cache entry.  The caller must hold
+ * the entry's partition lock exclusively.
+ */
+static void
+SharedCatCacheFreeItems(SharedCatCacheEntry *entry)
+{
+	dsa_pointer itemp = entry->items;
+
+	while (DsaPointerIsValid(itemp))
+	{
+		SharedCatCacheItem *item = dsa_get_address(SharedCatCacheArea, itemp);
+		dsa_pointer next = item->next;
+
+		pg_atomic_fetch_sub_u64(&SharedCatCacheCtl->item_bytes, item->size);
+		dsa_free(SharedCatCacheArea, itemp);
+		itemp = next;
+	}
+	entry->items = InvalidDsaPointer;
+}
+
+/*
+ * SharedCatCacheSweep
+ *
+ * Make room in the shared catalog cache, by removing entries that have not
+ * been used since the previous sweep, until the items use no more than
+ * CATCACHE_PRUNE_TARGET of shared_catalog_cache_size.  If somebody else is
+ * sweeping already, we don't wait for them.
+ */
+static void
+SharedCatCacheSweep(void)
+{
+	dshash_seq_status status;
+	SharedCatCacheEntry *entry;
+	uint64		target;
+
+	if (!pg_atomic_test_set_flag(&SharedCatCacheCtl->sweeping))
+		return;
+
+	target = (uint64) (shared_catalog_cache_size * 1024.0 *
+					   CATCACHE_PRUNE_TARGET);
+
+	dshash_seq_init(&status, SharedCatCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (entry->referenced)
+		{
+			entry->referenced = false;
+			continue;
+		}
+
+		SharedCatCacheFreeItems(entry);
+		dshash_delete_current(&status);
+
+		if (pg_atomic_read_u64(&SharedCatCacheCtl->item_bytes) <= target)
+			break;
+	}
+	dshash_seq_term(&status);
+
+	pg_atomic_clear_flag(&SharedCatCacheCtl->sweeping);
+}
+
+/*
+ * Advance the invalidation counter of a stripe to the current
+ * xactCompletionCount.
+ */
+static void
+SharedCatCacheAdvanceStripe(pg_atomic_uint64 *stripe, uint64 count)
+{
+	uint64		old = pg_atomic_read_u64(stripe);
+
+	while (old < count)
+	{
+		if (pg_atomic_compare_exchange_u64(stripe, &old, count))
+			break;
+	}
+}
+
+static uint64
+SharedCatCacheCompletionCount(void)
+{
+	uint64		count;
+
+	LWLockAcquire(ProcArrayLock, LW_SHARED);
+	count = ShmemVariableCache->xactCompletionCount;
+	LWLockRelease(ProcArrayLock);
+
+	return count;
+}
+
+/*
+ * SharedCatCacheInvalidate
+ *
+ * Remove the shared catalog cache entry for the given catcache
+ * invalidation message.  This is called by SendSharedInvalidMessages, in
+ * the backend that committed the catalog change, or in the startup process
+ * during recovery.
+ */
+void
+SharedCatCacheInvalidate(int cacheId, Oid dbId, uint32 hashValue)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+
+	if (SharedCatCacheCtl == NULL)
+		return;
+
+	SharedCatCacheAttach();
+
+	memset(&key, 0, sizeof(key));
+	key.dbid = dbId;
+	key.cacheid = cacheId;
+	key.hash_value = hashValue;
+
+	/* This must come first, see the comments at the top of the file */
+	SharedCatCacheAdvanceStripe(SharedCatCacheStripe(&key),
+								SharedCatCacheCompletionCount());
+
+	entry = dshash_find(SharedCatCacheHash, &key, true);
+	if (entry)
+	{
+		SharedCatCacheFreeItems(entry);
+		dshash_delete_entry(SharedCatCacheHash, entry);
+	}
+}
+
+/*
+ * SharedCatCacheReset
+ *
+ * Remove all entries from the shared catalog cache.  This is used for
+ * catalog invalidation messages, which are sent when a catalog is rewritten;
+ * they're rare enough that we don't bother to be selective.
+ */
+void
+SharedCatCacheReset(void)
+{
+	dshash_seq_status status;
+	SharedCatCacheEntry *entry;
+	uint64		count;
+	int			i;
+
+	if (SharedCatCacheCtl == NULL)
+		return;
+
+	SharedCatCacheAttach();
+
+	count = SharedCatCacheCompletionCount();
+	for (i = 0; i < SHARED_CATCACHE_STRIPES; i++)
+		SharedCatCacheAdvanceStripe(&SharedCatCacheCtl->inval_count[i], count);
+
+	dshash_seq_init(&status, SharedCatCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		SharedCatCacheFreeItems(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
+
+/*
+ * SharedCatCacheDropDatabase
+ *
+ * Remove all entries of a database that is being dropped from the shared
+ * catalog cache, so that they can't be found by a later database that
+ * happens to get the same OID.
+ */
+void
+SharedCatCacheDropDatabase(Oid dbId)
+{
+	dshash_seq_status status;
+	SharedCatCacheEntry *entry;
+
+	if (SharedCatCacheCtl == NULL)
+		return;
+
+	SharedCatCacheAttach();
+
+	dshash_seq_init(&status, SharedCatCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (entry->key.dbid != dbId)
+			continue;
+		SharedCatCacheFreeItems(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
+
+/*
+ * AtEOXact_CatCache
+ *
+ * Clean up at main transaction end.  The entries used by the finished
+ * transaction become candidates for pruning, and if we are over the memory
+ * budget, we prune now.  This must be called after the transaction's catcache
+ * and relcache references have been released.
+ */
+void
+AtEOXact_CatCache(void)
+{
+	catcache_epoch++;
+
+	if (catalog_cache_memory_limit > 0 && CacheHdr != NULL)
+		CatCacheEnforceLimit(true);
+}
+
+/*
+ * pg_get_backend_catalog_caches
+ *		SQL SRF showing the size and statistics of the catalog caches and
+ *		the relcache of the current backend.
+ */
+Datum
+pg_get_backend_catalog_caches(PG_FUNCTION_ARGS)
+{
+#define PG_GET_BACKEND_CATALOG_CACHES_COLS	9
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	Datum		values[PG_GET_BACKEND_CATALOG_CACHES_COLS];
+	bool		nulls[PG_GET_BACKEND_CATALOG_CACHES_COLS];
+	long		rel_entries;
+	Size		rel_memory;
+	uint64		rel_hits;
+	uint64		rel_misses;
+	uint64		rel_evictions;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (CacheHdr != NULL)
+	{
+		slist_iter	iter;
+
+		slist_foreach(iter, &CacheHdr->ch_caches)
+		{
+			CatCache   *cache = slist_container(CatCache, cc_next, iter.cur);
+
+			/* skip caches that haven't been used yet */
+			if (cache->cc_tupdesc == NULL)
+				continue;
+
+			memset(nulls, 0, sizeof(nulls));
+			values[0] = CStringGetTextDatum(cache->cc_relname);
+			values[1] = Int32GetDatum(cache->id);
+			values[2] = ObjectIdGetDatum(cache->cc_indexoid);
+			values[3] = Int64GetDatum(cache->cc_ntup);
+			values[4] = Int64GetDatum(cache->cc_memory);
+			values[5] = Int64GetDatum(cache->cc_nhits);
+			values[6] = Int64GetDatum(cache->cc_nmisses);
+			values[7] = Int64GetDatum(cache->cc_nevictions);
+			values[8] = Int64GetDatum(cache->cc_nsharedhits);
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	/* and one row for the relcache */
+	RelationCacheGetStats(&rel_entries, &rel_memory,
+						  &rel_hits, &rel_misses, &rel_evictions);
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = CStringGetTextDatum("relcache");
+	nulls[1] = true;
+	nulls[2] = true;
+	values[3] = Int64GetDatum(rel_entries);
+	values[4] = Int64GetDatum(rel_memory);
+	values[5] = Int64GetDatum(rel_hits);
+	values[6] = Int64GetDatum(rel_misses);
+	values[7] = Int64GetDatum(rel_evictions);
+	nulls[8] = true;
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+
 /*
  * Subroutines for warning about reference leaks.  These are exported so
  * that resowner.c can call them.
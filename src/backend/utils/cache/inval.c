@@ -756,6 +756,17 @@ PrepareInvalidationState(void)
 	transInvalInfo = myInfo;
 }
 
+/*
+ * HasPendingInvalidations
+ *		Has the current transaction queued any invalidations, that is,
+ *		modified the catalogs?
+ */
+bool
+HasPendingInvalidations(void)
+{
+	return transInvalInfo != NULL;
+}
+
 /*
  * PostPrepare_Inval
  *		Clean up after successful PREPARE.
@@ -19,6 +19,7 @@
 #include "access/htup_details.h"
 #include "access/nbtree.h"
 #include "bootstrap/bootstrap.h"
+#include "catalog/globaltemp.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_am.h"
 #include "catalog/pg_amop.h"
@@ -3105,6 +3106,7 @@ int32
 get_attavgwidth(Oid relid, AttrNumber attnum)
 {
 	HeapTuple	tp;
+	void		(*freefunc) (HeapTuple tuple);
 	int32		stawidth;
 
 	if (get_attavgwidth_hook)
@@ -3113,20 +3115,47 @@ get_attavgwidth(Oid relid, AttrNumber attnum)
 		if (stawidth > 0)
 			return stawidth;
 	}
-	tp = SearchSysCache3(STATRELATTINH,
-						 ObjectIdGetDatum(relid),
-						 Int16GetDatum(attnum),
-						 BoolGetDatum(false));
+	tp = get_attstatstuple(relid, attnum, false, &freefunc);
 	if (HeapTupleIsValid(tp))
 	{
 		stawidth = ((Form_pg_statistic) GETSTRUCT(tp))->stawidth;
-		ReleaseSysCache(tp);
+		freefunc(tp);
 		if (stawidth > 0)
 			return stawidth;
 	}
 	return 0;
 }
 
+/*
+ * get_attstatstuple
+ *
+ *	  Look up the pg_statistic tuple for the specified relation column.
+ *	  Returns NULL if there is none.  Otherwise *freefunc is set to the
+ *	  function the caller must release the tuple with.
+ *
+ * Statistics of global temporary tables are kept by the session rather than
+ * in pg_statistic, so this should be used instead of a direct syscache
+ * lookup wherever such a relation can appear.
+ */
+HeapTuple
+get_attstatstuple(Oid relid, AttrNumber attnum, bool inh,
+				  void (**freefunc) (HeapTuple tuple))
+{
+	HeapTuple	tp;
+
+	if (GlobalTempRelationGetStatistic(relid, attnum, inh, &tp))
+	{
+		*freefunc = heap_freetuple;
+		return tp;
+	}
+
+	*freefunc = ReleaseSysCache;
+	return SearchSysCache3(STATRELATTINH,
+						   ObjectIdGetDatum(relid),
+						   Int16GetDatum(attnum),
+						   BoolGetDatum(inh));
+}
+
 /*
  * get_attstatsslot
  *
@@ -58,15 +58,19 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "common/hashfn.h"
 #include "executor/executor.h"
+#include "lib/dshash.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
 #include "parser/analyze.h"
 #include "parser/parsetree.h"
 #include "storage/lmgr.h"
+#include "storage/shmem.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
+#include "utils/dsa.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
@@ -114,6 +118,13 @@ static TupleDesc PlanCacheComputeResultDesc(List *stmt_list);
 static void PlanCacheRelCallback(Datum arg, Oid relid);
 static void PlanCacheObjectCallback(Datum arg, int cacheid, uint32 hashvalue);
 static void PlanCacheSysCallback(Datum arg, int cacheid, uint32 hashvalue);
+static void SharedPlanCacheAttach(void);
+static bool SharedPlanCacheUsable(CachedPlanSource *plansource,
+								  QueryEnvironment *queryEnv);
+static uint64 SharedPlanCacheStartPlanning(void);
+static List *SharedPlanCacheLookup(CachedPlanSource *plansource);
+static void SharedPlanCacheInsert(CachedPlanSource *plansource,
+								  List *stmt_list, uint64 valid_seq);
 
 /* GUC parameter */
 int			plan_cache_mode;
@@ -220,6 +231,7 @@ CreateCachedPlan(RawStmt *raw_parse_tree,
 	plansource->total_custom_cost = 0;
 	plansource->num_generic_plans = 0;
 	plansource->num_custom_plans = 0;
+	plansource->num_shared_plans = 0;
 
 	MemoryContextSwitchTo(oldcxt);
 
@@ -288,6 +300,7 @@ CreateOneShotCachedPlan(RawStmt *raw_parse_tree,
 	plansource->total_custom_cost = 0;
 	plansource->num_generic_plans = 0;
 	plansource->num_custom_plans = 0;
+	plansource->num_shared_plans = 0;
 
 	return plansource;
 }
@@ -886,6 +899,19 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
 	ListCell   *lc;
+	bool		share;
+	uint64		share_seq = 0;
+	bool		adopted;
+
+	/*
+	 * If the generic plan could come from or go to the shared plan cache,
+	 * catch up with invalidations first.  See the comments on the shared
+	 * plan cache, below.
+	 */
+	share = (boundParams == NULL &&
+			 SharedPlanCacheUsable(plansource, queryEnv));
+	if (share)
+		share_seq = SharedPlanCacheStartPlanning();
 
 	/*
 	 * Normally the querytree should be valid already, but if it's not,
@@ -903,41 +929,50 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	if (!plansource->is_valid)
 		qlist = RevalidateCachedQuery(plansource, queryEnv);
 
-	/*
-	 * If we don't already have a copy of the querytree list that can be
-	 * scribbled on by the planner, make one.  For a one-shot plan, we assume
-	 * it's okay to scribble on the original query_list.
-	 */
-	if (qlist == NIL)
-	{
-		if (!plansource->is_oneshot)
-			qlist = copyObject(plansource->query_list);
-		else
-			qlist = plansource->query_list;
-	}
+	/* Adopt another backend's generic plan, if there is one */
+	plist = share ? SharedPlanCacheLookup(plansource) : NIL;
+	adopted = (plist != NIL);
+	if (adopted)
+		plansource->num_shared_plans++;
 
-	/*
-	 * If a snapshot is already set (the normal case), we can just use that
-	 * for planning.  But if it isn't, and we need one, install one.
-	 */
-	snapshot_set = false;
-	if (!ActiveSnapshotSet() &&
-		plansource->raw_parse_tree &&
-		analyze_requires_snapshot(plansource->raw_parse_tree))
+	if (!adopted)
 	{
-		PushActiveSnapshot(GetTransactionSnapshot());
-		snapshot_set = true;
-	}
+		/*
+		 * If we don't already have a copy of the querytree list that can be
+		 * scribbled on by the planner, make one.  For a one-shot plan, we
+		 * assume it's okay to scribble on the original query_list.
+		 */
+		if (qlist == NIL)
+		{
+			if (!plansource->is_oneshot)
+				qlist = copyObject(plansource->query_list);
+			else
+				qlist = plansource->query_list;
+		}
 
-	/*
-	 * Generate the plan.
-	 */
-	plist = pg_plan_queries(qlist, plansource->query_string,
-							plansource->cursor_options, boundParams);
+		/*
+		 * If a snapshot is already set (the normal case), we can just use
+		 * that for planning.  But if it isn't, and we need one, install one.
+		 */
+		snapshot_set = false;
+		if (!ActiveSnapshotSet() &&
+			plansource->raw_parse_tree &&
+			analyze_requires_snapshot(plansource->raw_parse_tree))
+		{
+			PushActiveSnapshot(GetTransactionSnapshot());
+			snapshot_set = true;
+		}
 
-	/* Release snapshot if we got one */
-	if (snapshot_set)
-		PopActiveSnapshot();
+		/*
+		 * Generate the plan.
+		 */
+		plist = pg_plan_queries(qlist, plansource->query_string,
+								plansource->cursor_options, boundParams);
+
+		/* Release snapshot if we got one */
+		if (snapshot_set)
+			PopActiveSnapshot();
+	}
 
 	/*
 	 * Normally we make a dedicated memory context for the CachedPlan and its
@@ -1007,6 +1042,14 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 
 	MemoryContextSwitchTo(oldcxt);
 
+	/*
+	 * Offer a new generic plan to other backends, unless it's transient or
+	 * depends on the role in a way that the shared plan cache doesn't track.
+	 */
+	if (share && !adopted && !is_transient &&
+		(!plan->dependsOnRole || plansource->dependsOnRLS))
+		SharedPlanCacheInsert(plansource, plist, share_seq);
+
 	return plan;
 }
 
@@ -1580,6 +1623,7 @@ CopyCachedPlan(CachedPlanSource *plansource)
 	newsource->total_custom_cost = plansource->total_custom_cost;
 	newsource->num_generic_plans = plansource->num_generic_plans;
 	newsource->num_custom_plans = plansource->num_custom_plans;
+	newsource->num_shared_plans = plansource->num_shared_plans;
 
 	MemoryContextSwitchTo(oldcxt);
 
@@ -2236,3 +2280,758 @@ ResetPlanCache(void)
 		cexpr->is_valid = false;
 	}
 }
+
+/*
+ * The shared plan cache
+ *
+ * When shared_plan_cache_size is set, generic plans are also stored in a
+ * hashtable in shared memory, in nodeToString() form, so that other backends
+ * preparing the same statement can adopt them instead of running the planner.
+ * A plan is looked up by the query string, the parameter types, the cursor
+ * options and the search path the query was analyzed with; and, if the query
+ * is subject to row-level security, by the role and the row_security setting
+ * too.  Queries analyzed with a parser hook (such as PL/pgSQL's) or with a
+ * query environment don't take part, since their meaning depends on more than
+ * that; neither do sessions that have a temporary schema, where unqualified
+ * names might refer to temporary objects.  A transaction that has modified
+ * the catalogs doesn't use the shared plan cache either, because it must see
+ * its own changes, and must not share them before they're committed.
+ *
+ * Shared plans are not removed when they're invalidated.  Instead, each plan
+ * records the "stripes" of the relations and objects it depends on, which are
+ * the same dependencies that are tracked for local plans.  Sending an
+ * invalidation message for one of them (see SendSharedInvalidMessages) takes
+ * a new number from a global sequence, and advances the stripe's counter to
+ * it; messages that invalidate all plans advance a separate reset counter.
+ * The backend making a plan reads the sequence, processes all invalidation
+ * messages sent so far, and only then plans.  The plan is stamped with the
+ * number it read, and is current as long as neither the reset counter nor
+ * any of its stripes have advanced beyond the stamp.  The counters are
+ * advanced only after the messages have been queued, so that a backend that
+ * reads a number is sure to see the messages sent before it was taken.
+ *
+ * The backend adopting a plan has processed the invalidation messages before
+ * analyzing the query in the same way, so the plan fits its query tree.
+ *
+ * When the plans use more than shared_plan_cache_size, entries that have not
+ * been used since the last sweep are removed.  Note that plans are shared
+ * regardless of the planner settings of the backends using them.
+ */
+int			shared_plan_cache_size = 0;
+
+#define SHARED_PLANCACHE_STRIPES	1024
+
+/* Extra space for the hashtable and DSA's own bookkeeping */
+#define SHARED_PLANCACHE_AREA_SLACK	(4 * 1024 * 1024)
+
+/* Fraction of shared_plan_cache_size that a sweep brings usage down to */
+#define SHARED_PLANCACHE_SWEEP_TARGET	0.9
+
+typedef struct SharedPlanKey
+{
+	Oid			dbid;			/* database */
+	Oid			userid;			/* role, if the query depends on RLS */
+	int			cursor_options; /* cursor options of the query */
+	bool		row_security;	/* row_security, if the query depends on RLS */
+	uint32		query_hash;		/* hash of the query string */
+	uint32		env_hash;		/* hash of search path and parameter types */
+} SharedPlanKey;
+
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;			/* hash key; must be first */
+	bool		referenced;		/* used since the last sweep? */
+	dsa_pointer plan;			/* the SharedPlan */
+} SharedPlanEntry;
+
+typedef struct SharedPlan
+{
+	Size		size;			/* allocated size of this plan */
+	uint64		valid_seq;		/* invalidation sequence number when made */
+	bool		addCatalog;		/* search path, as in OverrideSearchPath */
+	bool		addTemp;
+	int			nschemas;
+	int			num_params;		/* number of parameter types */
+	int			nstripes;		/* number of invalidation stripes */
+	int			query_len;		/* length of the query string */
+
+	/*
+	 * The schema OIDs of the search path, the parameter type OIDs, the
+	 * stripes as uint16s, and the query and plan strings follow.
+	 */
+} SharedPlan;
+
+#define SharedPlanSchemas(sp) \
+	((Oid *) ((char *) (sp) + MAXALIGN(sizeof(SharedPlan))))
+#define SharedPlanParamTypes(sp) \
+	(SharedPlanSchemas(sp) + (sp)->nschemas)
+#define SharedPlanStripes(sp) \
+	((uint16 *) (SharedPlanParamTypes(sp) + (sp)->num_params))
+#define SharedPlanQueryString(sp) \
+	((char *) (SharedPlanStripes(sp) + (sp)->nstripes))
+#define SharedPlanPlanString(sp) \
+	(SharedPlanQueryString(sp) + (sp)->query_len + 1)
+
+typedef struct SharedPlanCacheControl
+{
+	dshash_table_handle hash_handle;	/* the hashtable in the area */
+	pg_atomic_uint64 plan_bytes;	/* memory used by all plans */
+	pg_atomic_flag sweeping;	/* is somebody removing entries? */
+	pg_atomic_uint64 inval_seq; /* last invalidation sequence number */
+	pg_atomic_uint64 reset_seq; /* ... that invalidated all plans */
+	pg_atomic_uint64 stripe_seq[SHARED_PLANCACHE_STRIPES];
+	/* the DSA area follows */
+} SharedPlanCacheControl;
+
+#define SHARED_PLANCACHE_AREA_PLACE(ctl) \
+	((char *) (ctl) + MAXALIGN(sizeof(SharedPlanCacheControl)))
+
+static SharedPlanCacheControl *SharedPlanCacheCtl = NULL;
+static dsa_area *SharedPlanCacheArea = NULL;
+static dshash_table *SharedPlanCacheHash = NULL;
+
+static const dshash_parameters SharedPlanCacheHashParams = {
+	sizeof(SharedPlanKey),
+	sizeof(SharedPlanEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_PLANCACHE
+};
+
+static void SharedPlanCacheFreePlan(SharedPlanEntry *entry);
+static void SharedPlanCacheSweep(void);
+
+/*
+ * Size of the DSA area holding the shared plan cache.  Plans are mostly
+ * large allocations, which DSA doesn't round up by much.
+ */
+static Size
+SharedPlanCacheAreaSize(void)
+{
+	return add_size(mul_size(shared_plan_cache_size, 1280),
+					SHARED_PLANCACHE_AREA_SLACK);
+}
+
+/*
+ * PlanCacheShmemSize
+ *		Report the shared memory needed by the shared plan cache
+ */
+Size
+PlanCacheShmemSize(void)
+{
+	if (shared_plan_cache_size == 0)
+		return 0;
+
+	return add_size(MAXALIGN(sizeof(SharedPlanCacheControl)),
+					SharedPlanCacheAreaSize());
+}
+
+/*
+ * PlanCacheShmemInit
+ *		Create or attach to the shared plan cache
+ */
+void
+PlanCacheShmemInit(void)
+{
+	bool		found;
+	MemoryContext oldcontext;
+	int			i;
+
+	if (shared_plan_cache_size == 0)
+		return;
+
+	SharedPlanCacheCtl = (SharedPlanCacheControl *)
+		ShmemInitStruct("Shared Plan Cache", PlanCacheShmemSize(), &found);
+
+	if (found)
+		return;
+
+	pg_atomic_init_u64(&SharedPlanCacheCtl->plan_bytes, 0);
+	pg_atomic_init_flag(&SharedPlanCacheCtl->sweeping);
+	pg_atomic_init_u64(&SharedPlanCacheCtl->inval_seq, 0);
+	pg_atomic_init_u64(&SharedPlanCacheCtl->reset_seq, 0);
+	for (i = 0; i < SHARED_PLANCACHE_STRIPES; i++)
+		pg_atomic_init_u64(&SharedPlanCacheCtl->stripe_seq[i], 0);
+
+	/* This works like the shared catalog cache, see CatCacheShmemInit */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	SharedPlanCacheArea = dsa_create_in_place(SHARED_PLANCACHE_AREA_PLACE(SharedPlanCacheCtl),
+											  SharedPlanCacheAreaSize(),
+											  LWTRANCHE_SHARED_PLANCACHE, NULL);
+	dsa_set_size_limit(SharedPlanCacheArea, SharedPlanCacheAreaSize());
+	SharedPlanCacheHash = dshash_create(SharedPlanCacheArea,
+										&SharedPlanCacheHashParams, NULL);
+	SharedPlanCacheCtl->hash_handle =
+		dshash_get_hash_table_handle(SharedPlanCacheHash);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Attach to the shared plan cache, unless this process is attached already.
+ */
+static void
+SharedPlanCacheAttach(void)
+{
+	MemoryContext oldcontext;
+
+	if (SharedPlanCacheHash)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	SharedPlanCacheArea =
+		dsa_attach_in_place(SHARED_PLANCACHE_AREA_PLACE(SharedPlanCacheCtl), NULL);
+	SharedPlanCacheHash = dshash_attach(SharedPlanCacheArea,
+										&SharedPlanCacheHashParams,
+										SharedPlanCacheCtl->hash_handle, NULL);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Can the generic plan of the given CachedPlanSource be shared right now?
+ */
+static bool
+SharedPlanCacheUsable(CachedPlanSource *plansource, QueryEnvironment *queryEnv)
+{
+	Node	   *stmt;
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+
+	if (SharedPlanCacheCtl == NULL || plansource->is_oneshot)
+		return false;
+
+	/* see the comments at the top of this section */
+	if (plansource->raw_parse_tree == NULL ||
+		plansource->parserSetup != NULL || queryEnv != NULL)
+		return false;
+
+	stmt = plansource->raw_parse_tree->stmt;
+	if (!IsA(stmt, SelectStmt) && !IsA(stmt, InsertStmt) &&
+		!IsA(stmt, UpdateStmt) && !IsA(stmt, DeleteStmt))
+		return false;
+
+	if (HasPendingInvalidations())
+		return false;
+
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+	return !OidIsValid(tempNamespaceId);
+}
+
+static void
+SharedPlanCacheMakeKey(CachedPlanSource *plansource, SharedPlanKey *key)
+{
+	OverrideSearchPath *path = plansource->search_path;
+	uint32		env_hash;
+	ListCell   *lc;
+
+	/* zero padding, since we hash and compare the bytes */
+	memset(key, 0, sizeof(SharedPlanKey));
+	key->dbid = MyDatabaseId;
+	if (plansource->dependsOnRLS)
+	{
+		key->userid = GetUserId();
+		key->row_security = row_security;
+	}
+	key->cursor_options = plansource->cursor_options;
+	key->query_hash = hash_bytes((const unsigned char *) plansource->query_string,
+								 strlen(plansource->query_string));
+
+	env_hash = (path->addCatalog ? 1 : 0) | (path->addTemp ? 2 : 0);
+	foreach(lc, path->schemas)
+		env_hash = hash_combine(env_hash, hash_uint32(lfirst_oid(lc)));
+	if (plansource->num_params > 0)
+		env_hash = hash_combine(env_hash,
+								hash_bytes((const unsigned char *) plansource->param_types,
+										   plansource->num_params * sizeof(Oid)));
+	key->env_hash = env_hash;
+}
+
+/*
+ * Is a shared plan for the same statement as the given CachedPlanSource?
+ * The key could be the same by chance.
+ */
+static bool
+SharedPlanMatches(SharedPlan *sp, CachedPlanSource *plansource)
+{
+	OverrideSearchPath *path = plansource->search_path;
+	Oid		   *schemas = SharedPlanSchemas(sp);
+	ListCell   *lc;
+	int			i;
+
+	if (sp->addCatalog != path->addCatalog ||
+		sp->addTemp != path->addTemp ||
+		sp->nschemas != list_length(path->schemas) ||
+		sp->num_params != plansource->num_params ||
+		sp->query_len != strlen(plansource->query_string))
+		return false;
+
+	i = 0;
+	foreach(lc, path->schemas)
+	{
+		if (schemas[i++] != lfirst_oid(lc))
+			return false;
+	}
+
+	if (sp->num_params > 0 &&
+		memcmp(SharedPlanParamTypes(sp), plansource->param_types,
+			   sp->num_params * sizeof(Oid)) != 0)
+		return false;
+
+	return memcmp(SharedPlanQueryString(sp), plansource->query_string,
+				  sp->query_len) == 0;
+}
+
+static inline int
+SharedPlanRelationStripe(Oid relid)
+{
+	return hash_uint32(relid) % SHARED_PLANCACHE_STRIPES;
+}
+
+static inline int
+SharedPlanObjectStripe(int cacheId, uint32 hashValue)
+{
+	return hash_combine(hash_uint32(cacheId), hashValue) %
+		SHARED_PLANCACHE_STRIPES;
+}
+
+/*
+ * Mark the stripes of the given dependencies in the stripes array.
+ */
+static void
+SharedPlanMarkStripes(List *relationOids, List *invalItems, bool *stripes)
+{
+	ListCell   *lc;
+
+	foreach(lc, relationOids)
+		stripes[SharedPlanRelationStripe(lfirst_oid(lc))] = true;
+
+	foreach(lc, invalItems)
+	{
+		PlanInvalItem *item = (PlanInvalItem *) lfirst(lc);
+
+		stripes[SharedPlanObjectStripe(item->cacheId, item->hashValue)] = true;
+	}
+}
+
+/*
+ * Has nothing the shared plan depends on been invalidated since it was made?
+ */
+static bool
+SharedPlanIsCurrent(SharedPlan *sp)
+{
+	uint16	   *stripes = SharedPlanStripes(sp);
+	int			i;
+
+	if (pg_atomic_read_u64(&SharedPlanCacheCtl->reset_seq) > sp->valid_seq)
+		return false;
+
+	for (i = 0; i < sp->nstripes; i++)
+	{
+		if (pg_atomic_read_u64(&SharedPlanCacheCtl->stripe_seq[stripes[i]]) >
+			sp->valid_seq)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * SharedPlanCacheStartPlanning
+ *
+ * Catch up with invalidation messages before analyzing or planning a query
+ * whose generic plan could be shared.  Returns the invalidation sequence
+ * number that a plan made afterwards is current as of.
+ */
+static uint64
+SharedPlanCacheStartPlanning(void)
+{
+	uint64		seq;
+
+	SharedPlanCacheAttach();
+
+	seq = pg_atomic_read_u64(&SharedPlanCacheCtl->inval_seq);
+	AcceptInvalidationMessages();
+
+	return seq;
+}
+
+/*
+ * SharedPlanCacheLookup
+ *
+ * Look for a current generic plan for the given CachedPlanSource in the
+ * shared plan cache.  If one is found, it is returned as a list of
+ * PlannedStmts in the caller's memory context, and the locks needed to run
+ * it have been acquired; else NIL.
+ */
+static List *
+SharedPlanCacheLookup(CachedPlanSource *plansource)
+{
+	SharedPlanKey key;
+	SharedPlanEntry *entry;
+	SharedPlan *sp = NULL;
+	List	   *stmt_list;
+
+	SharedPlanCacheMakeKey(plansource, &key);
+
+	entry = dshash_find(SharedPlanCacheHash, &key, false);
+	if (entry == NULL)
+		return NIL;
+
+	if (DsaPointerIsValid(entry->plan))
+	{
+		SharedPlan *shared = dsa_get_address(SharedPlanCacheArea, entry->plan);
+
+		/*
+		 * Copy the plan out, so that we don't hold the partition lock while
+		 * reading it.  Don't risk an error while holding it.
+		 */
+		if (SharedPlanMatches(shared, plansource) &&
+			SharedPlanIsCurrent(shared))
+		{
+			sp = MemoryContextAllocExtended(CurrentMemoryContext, shared->size,
+											MCXT_ALLOC_NO_OOM);
+			if (sp != NULL)
+			{
+				memcpy(sp, shared, shared->size);
+				entry->referenced = true;
+			}
+		}
+	}
+
+	dshash_release_lock(SharedPlanCacheHash, entry);
+
+	if (sp == NULL)
+		return NIL;
+
+	stmt_list = (List *) stringToNode(SharedPlanPlanString(sp));
+
+	/*
+	 * Unlike the planner, we haven't locked the relations that the plan
+	 * might have added to the query's, such as partitions.  Lock them now,
+	 * and make sure that the plan wasn't invalidated before we got the locks.
+	 */
+	AcquireExecutorLocks(stmt_list, true);
+	if (!SharedPlanIsCurrent(sp))
+	{
+		AcquireExecutorLocks(stmt_list, false);
+		stmt_list = NIL;
+	}
+
+	pfree(sp);
+
+	return stmt_list;
+}
+
+/*
+ * SharedPlanCacheInsert
+ *
+ * Enter a generic plan just made for the given CachedPlanSource into the
+ * shared plan cache.  valid_seq is the result of the
+ * SharedPlanCacheStartPlanning call before planning.
+ */
+static void
+SharedPlanCacheInsert(CachedPlanSource *plansource, List *stmt_list,
+					  uint64 valid_seq)
+{
+	SharedPlanKey key;
+	SharedPlanEntry *entry;
+	SharedPlan *sp;
+	bool		stripes[SHARED_PLANCACHE_STRIPES];
+	int			nstripes;
+	uint16	   *sp_stripes;
+	char	   *plan_string;
+	Size		query_len;
+	Size		plan_len;
+	Size		size;
+	dsa_pointer spp;
+	bool		found;
+	ListCell   *lc;
+	int			i;
+
+	/*
+	 * If the query tree was invalidated while we planned, the plan might be
+	 * out of date already.
+	 */
+	if (!plansource->is_valid)
+		return;
+
+	memset(stripes, 0, sizeof(stripes));
+	SharedPlanMarkStripes(plansource->relationOids, plansource->invalItems,
+						  stripes);
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		/* Rules could have added utility statements; don't bother */
+		if (plannedstmt->commandType == CMD_UTILITY)
+			return;
+
+		SharedPlanMarkStripes(plannedstmt->relationOids,
+							  plannedstmt->invalItems, stripes);
+		SharedPlanMarkStripes(plannedstmt->partitionOids, NIL, stripes);
+	}
+	nstripes = 0;
+	for (i = 0; i < SHARED_PLANCACHE_STRIPES; i++)
+	{
+		if (stripes[i])
+			nstripes++;
+	}
+
+	plan_string = nodeToString(stmt_list);
+	plan_len = strlen(plan_string);
+	query_len = strlen(plansource->query_string);
+	size = MAXALIGN(sizeof(SharedPlan)) +
+		(list_length(plansource->search_path->schemas) +
+		 plansource->num_params) * sizeof(Oid) +
+		nstripes * sizeof(uint16) + query_len + 1 + plan_len + 1;
+
+	/* Don't let a single plan take over a large part of the cache */
+	if (size > (Size) shared_plan_cache_size * 1024 / 4)
+	{
+		pfree(plan_string);
+		return;
+	}
+
+	if (pg_atomic_read_u64(&SharedPlanCacheCtl->plan_bytes) >
+		(Size) shared_plan_cache_size * 1024)
+		SharedPlanCacheSweep();
+
+	SharedPlanCacheMakeKey(plansource, &key);
+
+	entry = dshash_find_or_insert(SharedPlanCacheHash, &key, &found);
+	if (!found)
+	{
+		entry->referenced = false;
+		entry->plan = InvalidDsaPointer;
+	}
+	else if (DsaPointerIsValid(entry->plan))
+	{
+		/*
+		 * Somebody else might have entered a current plan meanwhile.  If the
+		 * plan there is out of date, or for another statement whose key
+		 * happens to be the same, replace it.
+		 */
+		sp = dsa_get_address(SharedPlanCacheArea, entry->plan);
+		if (SharedPlanMatches(sp, plansource) && SharedPlanIsCurrent(sp))
+			goto done;
+		SharedPlanCacheFreePlan(entry);
+	}
+
+	/*
+	 * Don't bother entering a plan that has been invalidated while we made
+	 * it.  Invalidations after this check are noticed by whoever adopts the
+	 * plan.
+	 */
+	if (pg_atomic_read_u64(&SharedPlanCacheCtl->reset_seq) > valid_seq)
+		goto done;
+	for (i = 0; i < SHARED_PLANCACHE_STRIPES; i++)
+	{
+		if (stripes[i] &&
+			pg_atomic_read_u64(&SharedPlanCacheCtl->stripe_seq[i]) > valid_seq)
+			goto done;
+	}
+
+	spp = dsa_allocate_extended(SharedPlanCacheArea, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(spp))
+		goto done;
+
+	sp = dsa_get_address(SharedPlanCacheArea, spp);
+	sp->size = size;
+	sp->valid_seq = valid_seq;
+	sp->addCatalog = plansource->search_path->addCatalog;
+	sp->addTemp = plansource->search_path->addTemp;
+	sp->nschemas = list_length(plansource->search_path->schemas);
+	sp->num_params = plansource->num_params;
+	sp->nstripes = nstripes;
+	sp->query_len = query_len;
+
+	i = 0;
+	foreach(lc, plansource->search_path->schemas)
+		SharedPlanSchemas(sp)[i++] = lfirst_oid(lc);
+	if (sp->num_params > 0)
+		memcpy(SharedPlanParamTypes(sp), plansource->param_types,
+			   sp->num_params * sizeof(Oid));
+	sp_stripes = SharedPlanStripes(sp);
+	nstripes = 0;
+	for (i = 0; i < SHARED_PLANCACHE_STRIPES; i++)
+	{
+		if (stripes[i])
+			sp_stripes[nstripes++] = i;
+	}
+	memcpy(SharedPlanQueryString(sp), plansource->query_string, query_len + 1);
+	memcpy(SharedPlanPlanString(sp), plan_string, plan_len + 1);
+
+	entry->plan = spp;
+	pg_atomic_fetch_add_u64(&SharedPlanCacheCtl->plan_bytes, size);
+
+done:
+	if (DsaPointerIsValid(entry->plan))
+		dshash_release_lock(SharedPlanCacheHash, entry);
+	else
+		dshash_delete_entry(SharedPlanCacheHash, entry);
+
+	pfree(plan_string);
+}
+
+/*
+ * Free the plan of a shared plan cache entry.  The caller must hold the
+ * entry's partition lock exclusively.
+ */
+static void
+SharedPlanCacheFreePlan(SharedPlanEntry *entry)
+{
+	SharedPlan *sp = dsa_get_address(SharedPlanCacheArea, entry->plan);
+
+	pg_atomic_fetch_sub_u64(&SharedPlanCacheCtl->plan_bytes, sp->size);
+	dsa_free(SharedPlanCacheArea, entry->plan);
+	entry->plan = InvalidDsaPointer;
+}
+
+/*
+ * SharedPlanCacheSweep
+ *
+ * Make room in the shared plan cache, by removing entries that have not been
+ * used since the previous sweep, until the plans use no more than
+ * SHARED_PLANCACHE_SWEEP_TARGET of shared_plan_cache_size.  If somebody else
+ * is sweeping already, we don't wait for them.
+ */
+static void
+SharedPlanCacheSweep(void)
+{
+	dshash_seq_status status;
+	SharedPlanEntry *entry;
+	uint64		target;
+
+	if (!pg_atomic_test_set_flag(&SharedPlanCacheCtl->sweeping))
+		return;
+
+	target = (uint64) (shared_plan_cache_size * 1024.0 *
+					   SHARED_PLANCACHE_SWEEP_TARGET);
+
+	dshash_seq_init(&status, SharedPlanCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (entry->referenced)
+		{
+			entry->referenced = false;
+			continue;
+		}
+
+		SharedPlanCacheFreePlan(entry);
+		dshash_delete_current(&status);
+
+		if (pg_atomic_read_u64(&SharedPlanCacheCtl->plan_bytes) <= target)
+			break;
+	}
+	dshash_seq_term(&status);
+
+	pg_atomic_clear_flag(&SharedPlanCacheCtl->sweeping);
+}
+
+/*
+ * Advance an invalidation counter of the shared plan cache to a new number
+ * from the invalidation sequence.
+ */
+static void
+SharedPlanCacheAdvance(pg_atomic_uint64 *counter)
+{
+	uint64		seq = pg_atomic_add_fetch_u64(&SharedPlanCacheCtl->inval_seq, 1);
+	uint64		old = pg_atomic_read_u64(counter);
+
+	while (old < seq)
+	{
+		if (pg_atomic_compare_exchange_u64(counter, &old, seq))
+			break;
+	}
+}
+
+/*
+ * SharedPlanCacheInvalidateRelation
+ *
+ * Invalidate the shared plans that depend on the given relation, or all of
+ * them if relid is InvalidOid.  This is called by SendSharedInvalidMessages
+ * for relcache invalidation messages, after they have been queued.
+ */
+void
+SharedPlanCacheInvalidateRelation(Oid relid)
+{
+	if (SharedPlanCacheCtl == NULL)
+		return;
+
+	if (OidIsValid(relid))
+		SharedPlanCacheAdvance(&SharedPlanCacheCtl->stripe_seq[SharedPlanRelationStripe(relid)]);
+	else
+		SharedPlanCacheReset();
+}
+
+/*
+ * SharedPlanCacheInvalidateObject
+ *
+ * Likewise for catcache invalidation messages.  The caches are the ones that
+ * InitPlanCache registers callbacks for, and treated the same way.
+ */
+void
+SharedPlanCacheInvalidateObject(int cacheId, uint32 hashValue)
+{
+	if (SharedPlanCacheCtl == NULL)
+		return;
+
+	switch (cacheId)
+	{
+		case PROCOID:
+		case TYPEOID:
+			SharedPlanCacheAdvance(&SharedPlanCacheCtl->stripe_seq[SharedPlanObjectStripe(cacheId, hashValue)]);
+			break;
+		case NAMESPACEOID:
+		case OPEROID:
+		case AMOPOPID:
+		case FOREIGNSERVEROID:
+		case FOREIGNDATAWRAPPEROID:
+			SharedPlanCacheReset();
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * SharedPlanCacheReset
+ *
+ * Invalidate all shared plans.
+ */
+void
+SharedPlanCacheReset(void)
+{
+	if (SharedPlanCacheCtl == NULL)
+		return;
+
+	SharedPlanCacheAdvance(&SharedPlanCacheCtl->reset_seq);
+}
+
+/*
+ * SharedPlanCacheDropDatabase
+ *
+ * Remove all plans of a database that is being dropped from the shared plan
+ * cache, so that they can't be found by a later database that happens to get
+ * the same OID.
+ */
+void
+SharedPlanCacheDropDatabase(Oid dbId)
+{
+	dshash_seq_status status;
+	SharedPlanEntry *entry;
+
+	if (SharedPlanCacheCtl == NULL)
+		return;
+
+	SharedPlanCacheAttach();
+
+	dshash_seq_init(&status, SharedPlanCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (entry->key.dbid != dbId)
+			continue;
+		SharedPlanCacheFreePlan(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
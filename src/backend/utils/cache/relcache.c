@@ -42,6 +42,7 @@
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
@@ -78,6 +79,7 @@
 #include "storage/smgr.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
@@ -122,15 +124,30 @@ static const FormData_pg_attribute Desc_pg_subscription[Natts_pg_subscription] =
  *
  *		We used to index the cache by both name and OID, but now there
  *		is only an index by OID.
+ *
+ *		All entries are also kept in a list in order of last access, and
+ *		their approximate size is tracked, so that cold entries can be
+ *		pruned when catalog_cache_memory_limit is exceeded.  The list order
+ *		is only maintained for lookups while there is a limit.
  */
 typedef struct relidcacheent
 {
 	Oid			reloid;
 	Relation	reldesc;
+	dlist_node	lru_elem;		/* list member of RelationCacheLRU */
+	Size		size;			/* memory charged for this entry */
 } RelIdCacheEnt;
 
 static HTAB *RelationIdCache;
 
+static dlist_head RelationCacheLRU = DLIST_STATIC_INIT(RelationCacheLRU);
+static Size RelationCacheMemory = 0;
+
+/* statistics, shown in pg_backend_catalog_caches */
+static uint64 RelationCacheHits = 0;
+static uint64 RelationCacheMisses = 0;
+static uint64 RelationCacheEvictions = 0;
+
 /*
  * This flag is false until we have prepared the critical relcache entries
  * that are needed to do indexscans on the tables read by relcache building.
@@ -203,9 +220,16 @@ do { \
 		else if (!IsBootstrapProcessingMode()) \
 			elog(WARNING, "leaking still-referenced relcache entry for \"%s\"", \
 				 RelationGetRelationName(_old_rel)); \
+		RelationCacheMemory -= hentry->size; \
+		dlist_move_head(&RelationCacheLRU, &hentry->lru_elem); \
 	} \
 	else \
+	{ \
 		hentry->reldesc = (RELATION); \
+		dlist_push_head(&RelationCacheLRU, &hentry->lru_elem); \
+	} \
+	hentry->size = RelationCacheEntrySize(RELATION); \
+	RelationCacheMemory += hentry->size; \
 } while(0)
 
 #define RelationIdCacheLookup(ID, RELATION) \
@@ -229,6 +253,11 @@ do { \
 	if (hentry == NULL) \
 		elog(WARNING, "failed to delete relcache entry for OID %u", \
 			 (RELATION)->rd_id); \
+	else \
+	{ \
+		dlist_delete(&hentry->lru_elem); \
+		RelationCacheMemory -= hentry->size; \
+	} \
 } while(0)
 
 
@@ -255,6 +284,7 @@ static HTAB *OpClassCache = NULL;
 
 static void RelationDestroyRelation(Relation relation, bool remember_tupdesc);
 static void RelationClearRelation(Relation relation, bool rebuild);
+static Size RelationCacheEntrySize(Relation relation);
 
 static void RelationReloadIndexInfo(Relation relation);
 static void RelationReloadNailed(Relation relation);
@@ -1144,6 +1174,10 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 				relation->rd_islocaltemp = false;
 			}
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			relation->rd_backend = BackendIdForTempRelations();
+			relation->rd_islocaltemp = false;
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c",
 				 relation->rd_rel->relpersistence);
@@ -1293,7 +1327,12 @@ RelationInitPhysicalAddr(Relation relation)
 	else
 		relation->rd_node.dbNode = MyDatabaseId;
 
-	if (relation->rd_rel->relfilenode)
+	if (RelationIsGlobalTemp(relation))
+	{
+		/* Each session has its own storage, if any; see globaltemp.c */
+		GlobalTempRelationInitPhysicalAddr(relation);
+	}
+	else if (relation->rd_rel->relfilenode)
 	{
 		/*
 		 * Even if we are using a decoding snapshot that doesn't represent the
@@ -2016,6 +2055,7 @@ formrdesc(const char *relationName, Oid relationReltype,
 Relation
 RelationIdGetRelation(Oid relationId)
 {
+	RelIdCacheEnt *hentry;
 	Relation	rd;
 
 	/* Make sure we're in an xact, even if this ends up being a cache hit */
@@ -2024,10 +2064,18 @@ RelationIdGetRelation(Oid relationId)
 	/*
 	 * first try to find reldesc in the cache
 	 */
-	RelationIdCacheLookup(relationId, rd);
+	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache,
+										   (void *) &relationId,
+										   HASH_FIND, NULL);
 
-	if (RelationIsValid(rd))
+	if (hentry)
 	{
+		rd = hentry->reldesc;
+
+		RelationCacheHits++;
+		if (catalog_cache_memory_limit > 0)
+			dlist_move_head(&RelationCacheLRU, &hentry->lru_elem);
+
 		/* return NULL for dropped relations */
 		if (rd->rd_droppedSubid != InvalidSubTransactionId)
 		{
@@ -2067,6 +2115,7 @@ RelationIdGetRelation(Oid relationId)
 	 * no reldesc in the cache, so have RelationBuildDesc() build one and add
 	 * it.
 	 */
+	RelationCacheMisses++;
 	rd = RelationBuildDesc(relationId, true);
 	if (RelationIsValid(rd))
 		RelationIncrementReferenceCount(rd);
@@ -2956,6 +3005,33 @@ RelationCloseSmgrByOid(Oid relationId)
 	RelationCloseSmgr(relation);
 }
 
+/*
+ * RelationCacheResetStorage - recompute a relcache entry's physical address
+ *
+ * Needed when a global temporary relation's storage changes, since that
+ * doesn't involve any catalog update whose invalidation would do it for us.
+ * Information the access method cached about the old storage is dropped as
+ * well.
+ */
+void
+RelationCacheResetStorage(Oid relationId)
+{
+	Relation	relation;
+
+	RelationIdCacheLookup(relationId, relation);
+
+	if (!PointerIsValid(relation))
+		return;					/* not in cache, nothing to do */
+
+	RelationCloseSmgr(relation);
+	if (relation->rd_amcache)
+	{
+		pfree(relation->rd_amcache);
+		relation->rd_amcache = NULL;
+	}
+	RelationInitPhysicalAddr(relation);
+}
+
 static void
 RememberToFreeTupleDescAtEOX(TupleDesc td)
 {
@@ -3347,6 +3423,108 @@ AtEOSubXact_cleanup(Relation relation, bool isCommit,
 }
 
 
+/*
+ * RelationCacheEntrySize
+ *
+ *	Estimate the memory used by a relcache entry, for the purposes of
+ *	catalog_cache_memory_limit.  Only the main allocations are counted, and
+ *	the estimate is taken when the entry is entered into the cache, so
+ *	information loaded lazily later is not included.
+ */
+static Size
+RelationCacheEntrySize(Relation relation)
+{
+	Size		size = GetMemoryChunkSpace(relation);
+
+	if (relation->rd_rel)
+		size += GetMemoryChunkSpace(relation->rd_rel);
+	if (relation->rd_att)
+		size += GetMemoryChunkSpace(relation->rd_att);
+	if (relation->rd_options)
+		size += GetMemoryChunkSpace(relation->rd_options);
+	if (relation->rd_indexcxt)
+		size += MemoryContextMemAllocated(relation->rd_indexcxt, true);
+	if (relation->rd_rulescxt)
+		size += MemoryContextMemAllocated(relation->rd_rulescxt, true);
+	if (relation->rd_rsdesc)
+		size += MemoryContextMemAllocated(relation->rd_rsdesc->rscxt, true);
+	if (relation->rd_partkeycxt)
+		size += MemoryContextMemAllocated(relation->rd_partkeycxt, true);
+	if (relation->rd_pdcxt)
+		size += MemoryContextMemAllocated(relation->rd_pdcxt, true);
+	if (relation->rd_partcheckcxt)
+		size += MemoryContextMemAllocated(relation->rd_partcheckcxt, true);
+
+	return size;
+}
+
+/*
+ * RelationCacheMemoryUsed
+ *
+ *	Return the estimated memory used by all relcache entries.
+ */
+Size
+RelationCacheMemoryUsed(void)
+{
+	return RelationCacheMemory;
+}
+
+/*
+ * RelationCachePrune
+ *
+ *	Remove least recently used relcache entries, until the relcache uses no
+ *	more than "target" bytes or no more candidates are left.
+ *
+ * Only entries that nobody references and that carry no transaction state
+ * can be removed.  This is meant to be called at main transaction end (see
+ * AtEOXact_CatCache), after the relcache references have been released.  We
+ * don't prune during a transaction, since some code paths scan the relcache
+ * hashtable or keep pointers into it, expecting entries to stay put unless
+ * an invalidation arrives.
+ */
+void
+RelationCachePrune(Size target)
+{
+	dlist_node *cur;
+
+	cur = RelationCacheLRU.head.prev;
+	while (RelationCacheMemory > target && cur != &RelationCacheLRU.head)
+	{
+		RelIdCacheEnt *idhentry = dlist_container(RelIdCacheEnt, lru_elem, cur);
+		Relation	relation = idhentry->reldesc;
+
+		cur = cur->prev;
+
+		if (!RelationHasReferenceCountZero(relation) ||
+			relation->rd_isnailed ||
+			relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_firstRelfilenodeSubid != InvalidSubTransactionId ||
+			relation->rd_droppedSubid != InvalidSubTransactionId)
+			continue;
+
+		RelationCacheEvictions++;
+		RelationClearRelation(relation, false);
+	}
+}
+
+/*
+ * RelationCacheGetStats
+ *
+ *	Report the size and statistics of the relcache, for
+ *	pg_backend_catalog_caches.
+ */
+void
+RelationCacheGetStats(long *entries, Size *memory, uint64 *hits,
+					  uint64 *misses, uint64 *evictions)
+{
+	*entries = RelationIdCache ? hash_get_num_entries(RelationIdCache) : 0;
+	*memory = RelationCacheMemory;
+	*hits = RelationCacheHits;
+	*misses = RelationCacheMisses;
+	*evictions = RelationCacheEvictions;
+}
+
+
 /*
  *		RelationBuildLocalRelation
  *			Build a relcache entry for an about-to-be-created relation,
@@ -3493,6 +3671,10 @@ RelationBuildLocalRelation(const char *relname,
 			rel->rd_backend = BackendIdForTempRelations();
 			rel->rd_islocaltemp = true;
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			rel->rd_backend = BackendIdForTempRelations();
+			rel->rd_islocaltemp = false;
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c", relpersistence);
 			break;
@@ -3607,6 +3789,17 @@ RelationSetNewRelfilenode(Relation relation, char persistence)
 	TransactionId freezeXid = InvalidTransactionId;
 	RelFileNode newrnode;
 
+	/*
+	 * A global temporary relation's storage belongs to the session and is
+	 * not recorded in pg_class.
+	 */
+	if (RelationIsGlobalTemp(relation))
+	{
+		Assert(persistence == RELPERSISTENCE_GLOBAL_TEMP);
+		GlobalTempRelationSetNewFilenode(relation);
+		return;
+	}
+
 	/* Allocate a new relfilenode */
 	newrelfilenode = GetNewRelFileNode(relation->rd_rel->reltablespace, NULL,
 									   persistence);
@@ -1469,6 +1469,21 @@ SysCacheInvalidate(int cacheId, uint32 hashValue)
 	CatCacheInvalidate(SysCache[cacheId], hashValue);
 }
 
+/*
+ * SysCacheGetRelationId
+ *
+ *	Return the OID of the catalog the specified cache is on.  This doesn't
+ *	need the cache to be initialized.
+ */
+Oid
+SysCacheGetRelationId(int cacheId)
+{
+	if (cacheId < 0 || cacheId >= SysCacheSize)
+		elog(ERROR, "invalid cache ID: %d", cacheId);
+
+	return cacheinfo[cacheId].reloid;
+}
+
 /*
  * Certain relations that do not have system caches send snapshot invalidation
  * messages in lieu of catcache messages.  This is for the benefit of
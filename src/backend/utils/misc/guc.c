@@ -32,6 +32,7 @@
 #include "access/commit_ts.h"
 #include "access/gin.h"
 #include "access/rmgr.h"
+#include "access/slru.h"
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/twophase.h"
@@ -75,6 +76,7 @@
 #include "replication/syncrep.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
@@ -82,12 +84,15 @@
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
+#include "storage/smgr.h"
+#include "storage/sinvaladt.h"
 #include "storage/standby.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/bytea.h"
+#include "utils/catcache.h"
 #include "utils/float.h"
 #include "utils/guc_tables.h"
 #include "utils/memutils.h"
@@ -203,6 +208,13 @@ static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource sourc
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
 static bool check_maintenance_io_concurrency(int *newval, void **extra, GucSource source);
 static bool check_huge_page_size(int *newval, void **extra, GucSource source);
+static bool check_commit_ts_buffers(int *newval, void **extra, GucSource source);
+static bool check_multixact_member_buffers(int *newval, void **extra, GucSource source);
+static bool check_multixact_offset_buffers(int *newval, void **extra, GucSource source);
+static bool check_notify_buffers(int *newval, void **extra, GucSource source);
+static bool check_serial_buffers(int *newval, void **extra, GucSource source);
+static bool check_subtrans_buffers(int *newval, void **extra, GucSource source);
+static bool check_transaction_buffers(int *newval, void **extra, GucSource source);
 static void assign_pgstat_temp_directory(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
 static void assign_application_name(const char *newval, void *extra);
@@ -507,7 +519,9 @@ extern const struct config_enum_entry wal_level_options[];
 extern const struct config_enum_entry archive_mode_options[];
 extern const struct config_enum_entry recovery_target_action_options[];
 extern const struct config_enum_entry sync_method_options[];
+extern const struct config_enum_entry wal_compression_options[];
 extern const struct config_enum_entry dynamic_shared_memory_options[];
+extern const struct config_enum_entry temp_file_compression_options[];
 
 /*
  * GUC option variables that are exported from this module
@@ -970,6 +984,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_distinct_agg_grouping", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of grouping to eliminate duplicates for DISTINCT aggregates."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_distinct_agg_grouping,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_tidscan", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of TID scan plans."),
@@ -1099,6 +1123,26 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel hashed aggregation plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_hashagg,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_window", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel window aggregation plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_window,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and execution-time partition pruning."),
@@ -1262,16 +1306,6 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
-	{
-		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
-			gettext_noop("Compresses full-page writes written in WAL file."),
-			NULL
-		},
-		&wal_compression,
-		false,
-		NULL, NULL, NULL
-	},
-
 	{
 		{"wal_init_zero", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Writes zeroes to new WAL files before first use."),
@@ -1770,6 +1804,28 @@ static struct config_bool ConfigureNamesBool[] =
 	},
 #endif
 
+	{
+		{"optimize_specialized_sort", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Use sort routines specialized for common datatypes."),
+			NULL,
+			GUC_NOT_IN_SAMPLE
+		},
+		&optimize_specialized_sort,
+		true,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"optimize_radix_sort", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Use radix sort for integer and abbreviated sort keys."),
+			NULL,
+			GUC_NOT_IN_SAMPLE
+		},
+		&optimize_radix_sort,
+		true,
+		NULL, NULL, NULL
+	},
+
 #ifdef WAL_DEBUG
 	{
 		{"wal_debug", PGC_SUSET, DEVELOPER_OPTIONS,
@@ -2290,6 +2346,125 @@ static struct config_int ConfigureNamesInt[] =
 		check_temp_buffers, NULL, NULL
 	},
 
+	{
+		{"commit_timestamp_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the commit timestamp cache."),
+			gettext_noop("Specify 0 to have this value determined as a fraction of shared_buffers."),
+			GUC_UNIT_BLOCKS
+		},
+		&commit_timestamp_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_commit_ts_buffers, NULL, NULL
+	},
+
+	{
+		{"multixact_member_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact member cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_member_buffers,
+		32, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_multixact_member_buffers, NULL, NULL
+	},
+
+	{
+		{"multixact_offset_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact offset cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_offset_buffers,
+		16, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_multixact_offset_buffers, NULL, NULL
+	},
+
+	{
+		{"notify_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the LISTEN/NOTIFY message cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&notify_buffers,
+		16, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_notify_buffers, NULL, NULL
+	},
+
+	{
+		{"serializable_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the serializable transaction cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&serializable_buffers,
+		32, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_serial_buffers, NULL, NULL
+	},
+
+	{
+		{"subtransaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the subtransaction cache."),
+			gettext_noop("Specify 0 to have this value determined as a fraction of shared_buffers."),
+			GUC_UNIT_BLOCKS
+		},
+		&subtransaction_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_subtrans_buffers, NULL, NULL
+	},
+
+	{
+		{"transaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the transaction status cache."),
+			gettext_noop("Specify 0 to have this value determined as a fraction of shared_buffers."),
+			GUC_UNIT_BLOCKS
+		},
+		&transaction_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_transaction_buffers, NULL, NULL
+	},
+
+	{
+		{"relation_size_cache_entries", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of relation fork sizes cached in shared memory."),
+			gettext_noop("Specify 0 to disable the cache.")
+		},
+		&relation_size_cache_entries,
+		8192, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_catalog_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of memory used for catalog tuples cached in shared memory."),
+			gettext_noop("Specify 0 to disable the cache."),
+			GUC_UNIT_KB
+		},
+		&shared_catalog_cache_size,
+		0, 0, MAX_KILOBYTES / 2,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_plan_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of memory used for generic plans shared between sessions."),
+			gettext_noop("Specify 0 to disable the cache."),
+			GUC_UNIT_KB
+		},
+		&shared_plan_cache_size,
+		0, 0, MAX_KILOBYTES / 2,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"invalidation_queue_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of cache invalidation messages buffered in shared memory."),
+			NULL
+		},
+		&invalidation_queue_size,
+		16384, 4096, 1 << 20,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the TCP port the server listens on."),
@@ -2380,6 +2555,31 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"trigger_queue_work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for queued AFTER trigger events."),
+			gettext_noop("This much memory can be used by the events queued "
+						 "in a transaction before they are spilled to disk."),
+			GUC_UNIT_KB
+		},
+		&trigger_queue_work_mem,
+		65536, 64, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"catalog_cache_memory_limit", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for the catalog and relation caches."),
+			gettext_noop("When the caches of a session grow beyond this, the "
+						 "least recently used entries are removed. "
+						 "0 means no limit."),
+			GUC_UNIT_KB
+		},
+		&catalog_cache_memory_limit,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We use the hopefully-safely-small value of 100kB as the compiled-in
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
@@ -2751,6 +2951,16 @@ static struct config_int ConfigureNamesInt[] =
 		check_wal_buffers, NULL, NULL
 	},
 
+	{
+		{"wal_compression_zstd_level", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Sets the compression level used for full-page writes compressed with zstd."),
+			NULL
+		},
+		&wal_compression_zstd_level,
+		3, 1, 22,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_writer_delay", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Time between WAL flushes performed in the WAL writer."),
@@ -4731,6 +4941,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"temp_file_compression", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Compresses temporary files of sorts, hash joins and hash aggregation with the specified method."),
+			NULL
+		},
+		&temp_file_compression,
+		TEMP_FILE_COMPRESSION_NONE, temp_file_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"shared_memory_type", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Selects the shared memory implementation used for the main shared memory region."),
@@ -4741,6 +4961,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Compresses full-page writes written in WAL file with specified method."),
+			NULL
+		},
+		&wal_compression,
+		WAL_COMPRESSION_NONE, wal_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_sync_method", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Selects the method used for forcing WAL updates to disk."),
@@ -11464,16 +11694,63 @@ static bool
 check_temp_buffers(int *newval, void **extra, GucSource source)
 {
 	/*
-	 * Once local buffers have been initialized, it's too late to change this.
+	 * Once local buffers have been initialized, the pool can grow (at the
+	 * next transaction boundary) but never shrink.
 	 */
-	if (NLocBuffer && NLocBuffer != *newval)
+	if (NLocBuffer && *newval < NLocBuffer)
 	{
-		GUC_check_errdetail("\"temp_buffers\" cannot be changed after any temporary tables have been accessed in the session.");
+		GUC_check_errdetail("\"temp_buffers\" cannot be decreased after any temporary tables have been accessed in the session.");
 		return false;
 	}
 	return true;
 }
 
+/*
+ * The SLRU buffer pools are divided into banks, so their sizes must be
+ * multiples of the bank size; see check_slru_buffers().
+ */
+static bool
+check_commit_ts_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("commit_timestamp_buffers", newval);
+}
+
+static bool
+check_multixact_member_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("multixact_member_buffers", newval);
+}
+
+static bool
+check_multixact_offset_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("multixact_offset_buffers", newval);
+}
+
+static bool
+check_notify_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("notify_buffers", newval);
+}
+
+static bool
+check_serial_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("serializable_buffers", newval);
+}
+
+static bool
+check_subtrans_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("subtransaction_buffers", newval);
+}
+
+static bool
+check_transaction_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("transaction_buffers", newval);
+}
+
 static bool
 check_bonjour(bool *newval, void **extra, GucSource source)
 {
@@ -713,7 +713,8 @@ LogicalTapeSetCreate(int ntapes, bool preallocate, TapeShare *shared,
 	 * Leader concatenates worker tapes, which requires special adjustment to
 	 * final tapeset data.  Things are simpler for the worker case and the
 	 * serial case, though.  They are generally very similar -- workers use a
-	 * shared fileset, whereas serial sorts use a conventional serial BufFile.
+	 * shared fileset, whereas serial sorts use a conventional serial BufFile,
+	 * which is compressed if temp_file_compression is enabled.
 	 */
 	if (shared)
 		ltsConcatWorkerTapes(lts, shared, fileset);
@@ -725,7 +726,7 @@ LogicalTapeSetCreate(int ntapes, bool preallocate, TapeShare *shared,
 		lts->pfile = BufFileCreateShared(fileset, filename);
 	}
 	else
-		lts->pfile = BufFileCreateTemp(false);
+		lts->pfile = BufFileCreateCompressTemp(false);
 
 	return lts;
 }
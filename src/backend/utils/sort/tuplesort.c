@@ -96,15 +96,20 @@
 
 #include <limits.h>
 
+#include "access/gin.h"
+#include "access/gin_tuple.h"
 #include "access/hash.h"
 #include "access/htup_details.h"
 #include "access/nbtree.h"
 #include "catalog/index.h"
 #include "catalog/pg_am.h"
+#include "catalog/pg_collation.h"
 #include "commands/tablespace.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "port/pg_bitutils.h"
+#include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
@@ -113,6 +118,7 @@
 #include "utils/rel.h"
 #include "utils/sortsupport.h"
 #include "utils/tuplesort.h"
+#include "utils/typcache.h"
 
 
 /* sort-type codes for sort__start probes */
@@ -144,6 +150,9 @@ bool		trace_sort = false;
 bool		optimize_bounded_sort = true;
 #endif
 
+bool		optimize_specialized_sort = true;
+bool		optimize_radix_sort = true;
+
 
 /*
  * The objects we actually sort are SortTuple structs.  These contain
@@ -435,6 +444,12 @@ struct Tuplesortstate
 	 */
 	SortSupport onlyKey;
 
+	/*
+	 * Whether SortTuple's datum1 and isnull1 members are maintained by the
+	 * above routines.  If not, some sort specializations are disabled.
+	 */
+	bool		haveDatum1;
+
 	/*
 	 * Additional state for managing "abbreviated key" sortsupport routines
 	 * (which currently may be used by all cases except the hash index case).
@@ -654,6 +669,12 @@ static void writetup_index(Tuplesortstate *state, int tapenum,
 						   SortTuple *stup);
 static void readtup_index(Tuplesortstate *state, SortTuple *stup,
 						  int tapenum, unsigned int len);
+static int	comparetup_index_gin(const SortTuple *a, const SortTuple *b,
+								 Tuplesortstate *state);
+static void writetup_index_gin(Tuplesortstate *state, int tapenum,
+							   SortTuple *stup);
+static void readtup_index_gin(Tuplesortstate *state, SortTuple *stup,
+							  int tapenum, unsigned int len);
 static int	comparetup_datum(const SortTuple *a, const SortTuple *b,
 							 Tuplesortstate *state);
 static void copytup_datum(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -698,6 +719,143 @@ static void tuplesort_updatemax(Tuplesortstate *state);
 #define ST_DEFINE
 #include "lib/sort_template.h"
 
+/*
+ * Specialized comparators that we can inline into specialized sorts.  They
+ * are used when the leading key's comparator is one of the ssup_datum_*_cmp
+ * functions, which lets us compare two tuples by their datum1 without
+ * following the pointer to the comparator, or to the tuple.  Only ties on
+ * the leading key need the generic comparetup function, and not even those
+ * when there is only one key and no abbreviation.
+ *
+ * XXX: comparetup compares the leading datum a second time.
+ */
+static pg_attribute_always_inline int
+qsort_tuple_unsigned_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplyUnsignedSortComparator(a->datum1, a->isnull1,
+										  b->datum1, b->isnull1,
+										  &state->sortKeys[0]);
+	if (compare != 0)
+		return compare;
+
+	/*
+	 * No need to waste effort calling the tiebreak function when there are
+	 * no other keys to sort on.
+	 */
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+
+#if SIZEOF_DATUM >= 8
+/* Used if first key's comparator is ssup_datum_signed_cmp */
+static pg_attribute_always_inline int
+qsort_tuple_signed_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplySignedSortComparator(a->datum1, a->isnull1,
+										b->datum1, b->isnull1,
+										&state->sortKeys[0]);
+
+	if (compare != 0)
+		return compare;
+
+	/*
+	 * No need to waste effort calling the tiebreak function when there are
+	 * no other keys to sort on.
+	 */
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+#endif
+
+/* Used if first key's comparator is ssup_datum_int32_cmp */
+static pg_attribute_always_inline int
+qsort_tuple_int32_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplyInt32SortComparator(a->datum1, a->isnull1,
+									   b->datum1, b->isnull1,
+									   &state->sortKeys[0]);
+
+	if (compare != 0)
+		return compare;
+
+	/*
+	 * No need to waste effort calling the tiebreak function when there are
+	 * no other keys to sort on.
+	 */
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+
+#define ST_SORT qsort_tuple_unsigned
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_tuple_unsigned_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#define ST_CHECK_FOR_INTERRUPTS
+#define ST_SCOPE static
+#define ST_DEFINE
+#include "lib/sort_template.h"
+
+#if SIZEOF_DATUM >= 8
+#define ST_SORT qsort_tuple_signed
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_tuple_signed_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#define ST_CHECK_FOR_INTERRUPTS
+#define ST_SCOPE static
+#define ST_DEFINE
+#include "lib/sort_template.h"
+#endif
+
+#define ST_SORT qsort_tuple_int32
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_tuple_int32_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#define ST_CHECK_FOR_INTERRUPTS
+#define ST_SCOPE static
+#define ST_DEFINE
+#include "lib/sort_template.h"
+
+/*
+ * Description of a specialized sort for the leading key's comparator.
+ *
+ * Besides the matching quicksort routine, this describes how to turn datum1
+ * into an unsigned integer of 'keybytes' bytes whose natural order is the
+ * sort order, for radix sorting: we keep the bits in 'mask', and then invert
+ * the bits in 'flip'.  Inverting the sign bit makes signed integers sort
+ * correctly, and inverting all the bits implements a descending sort.
+ */
+typedef struct SortSpecialization
+{
+	void		(*qsort_fn) (SortTuple *data, size_t n, Tuplesortstate *state);
+	Datum		mask;
+	Datum		flip;
+	int			keybytes;
+} SortSpecialization;
+
+/*
+ * Radix sort is only used for at least this many tuples.  Smaller partitions
+ * are handed over to the specialized quicksort, since the cost of a radix
+ * pass over the 256 buckets isn't worth it.
+ */
+#define RADIX_SORT_THRESHOLD	1024
+
+#define RADIX_KEY(datum, spec) \
+	(((datum) & (spec)->mask) ^ (spec)->flip)
+#define RADIX_BYTE(datum, spec, shift) \
+	((uint8) (RADIX_KEY(datum, spec) >> (shift)))
+
 /*
  *		tuplesort_begin_xxx
  *
@@ -929,6 +1087,7 @@ tuplesort_begin_heap(TupleDesc tupDesc,
 	state->copytup = copytup_heap;
 	state->writetup = writetup_heap;
 	state->readtup = readtup_heap;
+	state->haveDatum1 = true;
 
 	state->tupDesc = tupDesc;	/* assume we need not copy tupDesc */
 	state->abbrevNext = 10;
@@ -1008,6 +1167,12 @@ tuplesort_begin_cluster(TupleDesc tupDesc,
 
 	state->indexInfo = BuildIndexInfo(indexRel);
 
+	/*
+	 * If we don't have a simple leading attribute, we don't currently
+	 * initialize datum1, so disable optimizations that require it.
+	 */
+	state->haveDatum1 = (state->indexInfo->ii_IndexAttrNumbers[0] != 0);
+
 	state->tupDesc = tupDesc;	/* assume we need not copy tupDesc */
 
 	indexScanKey = _bt_mkscankey(indexRel, NULL);
@@ -1099,6 +1264,7 @@ tuplesort_begin_index_btree(Relation heapRel,
 	state->copytup = copytup_index;
 	state->writetup = writetup_index;
 	state->readtup = readtup_index;
+	state->haveDatum1 = true;
 	state->abbrevNext = 10;
 
 	state->heapRel = heapRel;
@@ -1213,6 +1379,7 @@ tuplesort_begin_index_gist(Relation heapRel,
 	state->copytup = copytup_index;
 	state->writetup = writetup_index;
 	state->readtup = readtup_index;
+	state->haveDatum1 = true;
 
 	state->heapRel = heapRel;
 	state->indexRel = indexRel;
@@ -1243,6 +1410,86 @@ tuplesort_begin_index_gist(Relation heapRel,
 	return state;
 }
 
+/*
+ * Sort GinTuples produced by the participants of a parallel GIN build.
+ *
+ * There is one sort key per index attribute, each using the attribute's
+ * GIN compare function (or the default btree comparator for the key type,
+ * like initGinState()).  comparetup_index_gin picks the one to apply based
+ * on the attribute number of the tuples being compared.
+ */
+Tuplesortstate *
+tuplesort_begin_index_gin(Relation heapRel,
+						  Relation indexRel,
+						  int workMem, SortCoordinate coordinate,
+						  bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, coordinate,
+												   randomAccess);
+	MemoryContext oldcontext;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(state->maincontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = IndexRelationGetNumberOfKeyAttributes(indexRel);
+
+	state->comparetup = comparetup_index_gin;
+	state->copytup = copytup_index;
+	state->writetup = writetup_index_gin;
+	state->readtup = readtup_index_gin;
+
+	state->heapRel = heapRel;
+	state->indexRel = indexRel;
+
+	/* Prepare SortSupport data for each column */
+	state->sortKeys = (SortSupport) palloc0(state->nKeys *
+											sizeof(SortSupportData));
+
+	for (i = 0; i < state->nKeys; i++)
+	{
+		SortSupport sortKey = state->sortKeys + i;
+		Form_pg_attribute att = TupleDescAttr(RelationGetDescr(indexRel), i);
+		Oid			cmpFunc;
+
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = indexRel->rd_indcollation[i];
+		if (!OidIsValid(sortKey->ssup_collation))
+			sortKey->ssup_collation = DEFAULT_COLLATION_OID;
+		sortKey->ssup_nulls_first = false;
+		sortKey->ssup_attno = i + 1;
+		sortKey->abbreviate = false;
+
+		AssertState(sortKey->ssup_attno != 0);
+
+		cmpFunc = index_getprocid(indexRel, i + 1, GIN_COMPARE_PROC);
+		if (!OidIsValid(cmpFunc))
+		{
+			TypeCacheEntry *typentry;
+
+			typentry = lookup_type_cache(att->atttypid, TYPECACHE_CMP_PROC);
+			if (!OidIsValid(typentry->cmp_proc))
+				ereport(ERROR,
+						(errcode(ERRCODE_UNDEFINED_FUNCTION),
+						 errmsg("could not identify a comparison function for type %s",
+								format_type_be(att->atttypid))));
+			cmpFunc = typentry->cmp_proc;
+		}
+
+		PrepareSortSupportComparisonShim(cmpFunc, sortKey);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_datum(Oid datumType, Oid sortOperator, Oid sortCollation,
 					  bool nullsFirstFlag, int workMem,
@@ -1276,6 +1523,7 @@ tuplesort_begin_datum(Oid datumType, Oid sortOperator, Oid sortCollation,
 	state->copytup = copytup_datum;
 	state->writetup = writetup_datum;
 	state->readtup = readtup_datum;
+	state->haveDatum1 = true;
 	state->abbrevNext = 10;
 
 	state->datumType = datumType;
@@ -1796,6 +2044,34 @@ tuplesort_putindextuplevalues(Tuplesortstate *state, Relation rel,
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Collect one GinTuple while collecting input data for sort.  The tuple is
+ * copied, so the caller may reuse its memory.
+ */
+void
+tuplesort_putgintuple(Tuplesortstate *state, GinTuple *tuple, Size size)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->tuplecontext);
+	SortTuple	stup;
+	GinTuple   *ctup;
+
+	Assert(size == tuple->tuplen);
+
+	ctup = palloc(size);
+	memcpy(ctup, tuple, size);
+	USEMEM(state, GetMemoryChunkSpace(ctup));
+
+	stup.tuple = ctup;
+	stup.datum1 = GinTupleGetKey(ctup);
+	stup.isnull1 = (ctup->category != GIN_CAT_NORM_KEY);
+
+	MemoryContextSwitchTo(state->sortcontext);
+
+	puttuple_common(state, &stup);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
 /*
  * Accept one Datum while collecting input data for sort.
  *
@@ -2475,6 +2751,30 @@ tuplesort_getindextuple(Tuplesortstate *state, bool forward)
 	return (IndexTuple) stup.tuple;
 }
 
+/*
+ * Fetch the next GinTuple in either forward or back direction, setting *len
+ * to its length.  Returns NULL if no more tuples.  The same memory lifetime
+ * rules as for tuplesort_getindextuple apply.
+ */
+GinTuple *
+tuplesort_getgintuple(Tuplesortstate *state, Size *len, bool forward)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->sortcontext);
+	SortTuple	stup;
+	GinTuple   *tup;
+
+	if (!tuplesort_gettuple_common(state, forward, &stup))
+		stup.tuple = NULL;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	tup = (GinTuple *) stup.tuple;
+	if (tup)
+		*len = tup->tuplen;
+
+	return tup;
+}
+
 /*
  * Fetch the next Datum in either forward or back direction.
  * Returns false if no more datums.
@@ -3546,10 +3846,223 @@ sort_bounded_heap(Tuplesortstate *state)
 	state->boundUsed = true;
 }
 
+/*
+ * Check whether there is a specialized sort for the given leading sort key,
+ * and fill in *spec if so.
+ */
+static bool
+get_sort_specialization(SortSupport ssup, SortSpecialization *spec)
+{
+	if (ssup->comparator == ssup_datum_unsigned_cmp)
+	{
+		spec->qsort_fn = qsort_tuple_unsigned;
+		spec->mask = ~((Datum) 0);
+		spec->flip = 0;
+		spec->keybytes = SIZEOF_DATUM;
+	}
+#if SIZEOF_DATUM >= 8
+	else if (ssup->comparator == ssup_datum_signed_cmp)
+	{
+		spec->qsort_fn = qsort_tuple_signed;
+		spec->mask = ~((Datum) 0);
+		spec->flip = ((Datum) 1) << 63;
+		spec->keybytes = SIZEOF_DATUM;
+	}
+#endif
+	else if (ssup->comparator == ssup_datum_int32_cmp)
+	{
+		/* int32 Datums are sign-extended, so only look at the low bits */
+		spec->qsort_fn = qsort_tuple_int32;
+		spec->mask = (Datum) PG_UINT32_MAX;
+		spec->flip = ((Datum) 1) << 31;
+		spec->keybytes = sizeof(int32);
+	}
+	else
+		return false;
+
+	if (ssup->ssup_reverse)
+		spec->flip ^= spec->mask;
+
+	return true;
+}
+
+/*
+ * Recursive step of radix_sort_memtuples: sort the n tuples starting at
+ * 'data', which have equal key bytes before 'level', by their key byte at
+ * 'level' (the most significant byte being level 0).
+ *
+ * We distribute the tuples into 256 buckets in place, in the manner of an
+ * "American flag sort", and then sort each bucket on the following bytes.
+ * Buckets in which all the key bytes are equal only need tie-breaking.
+ */
+static void
+radix_sort_tuple(SortTuple *data, size_t n, int level,
+				 SortSpecialization *spec, Tuplesortstate *state)
+{
+	size_t		count[256];
+	size_t		next[256];
+	size_t		end[256];
+	int			shift = (spec->keybytes - level - 1) * BITS_PER_BYTE;
+	size_t		pos;
+	size_t		i;
+	int			b;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Compute the size and position of each bucket */
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++)
+		count[RADIX_BYTE(data[i].datum1, spec, shift)]++;
+
+	pos = 0;
+	for (b = 0; b < 256; b++)
+	{
+		next[b] = pos;
+		pos += count[b];
+		end[b] = pos;
+	}
+
+	/*
+	 * Move each tuple into its bucket.  next[b] is the first position in
+	 * bucket b that doesn't hold a tuple known to belong there yet.
+	 */
+	for (b = 0; b < 256; b++)
+	{
+		while (next[b] < end[b])
+		{
+			SortTuple  *cur = &data[next[b]];
+			int			target = RADIX_BYTE(cur->datum1, spec, shift);
+
+			if (target == b)
+				next[b]++;
+			else
+			{
+				SortTuple	tmp = data[next[target]];
+
+				data[next[target]++] = *cur;
+				*cur = tmp;
+			}
+		}
+	}
+
+	/* Sort the buckets */
+	pos = 0;
+	for (b = 0; b < 256; b++)
+	{
+		SortTuple  *bucket = data + pos;
+		size_t		nbucket = count[b];
+
+		pos += nbucket;
+
+		if (nbucket < 2)
+			continue;
+
+		if (level == spec->keybytes - 1)
+		{
+			/* All leading keys are equal, so only tie-breaking is left */
+			if (state->onlyKey == NULL)
+				qsort_tuple(bucket, nbucket, state->comparetup, state);
+		}
+		else if (nbucket < RADIX_SORT_THRESHOLD)
+			spec->qsort_fn(bucket, nbucket, state);
+		else
+			radix_sort_tuple(bucket, nbucket, level + 1, spec, state);
+	}
+}
+
+/*
+ * Sort all memtuples with a most-significant-digit-first radix sort on the
+ * leading key, as described by 'spec'.
+ *
+ * NULLs are moved to the appropriate end first, since they don't have a
+ * meaningful datum1.  We also skip the leading key bytes that are equal in
+ * all the tuples, so that e.g. small values in a bigint column don't cost
+ * one pass per byte.
+ */
+static void
+radix_sort_memtuples(Tuplesortstate *state, SortSpecialization *spec)
+{
+	SortTuple  *data = state->memtuples;
+	size_t		n = state->memtupcount;
+	bool		nulls_first = state->sortKeys[0].ssup_nulls_first;
+	SortTuple  *nulls;
+	size_t		nnulls;
+	size_t		nfront = 0;
+	Datum		minkey;
+	Datum		maxkey;
+	Datum		diff;
+	size_t		i;
+	int			level;
+
+	/* Move the tuples that sort first, NULL or not, to the front */
+	for (i = 0; i < n; i++)
+	{
+		if (data[i].isnull1 == nulls_first)
+		{
+			SortTuple	tmp = data[i];
+
+			data[i] = data[nfront];
+			data[nfront++] = tmp;
+		}
+	}
+
+	if (nulls_first)
+	{
+		nulls = data;
+		nnulls = nfront;
+		data += nfront;
+		n -= nfront;
+	}
+	else
+	{
+		nulls = data + nfront;
+		nnulls = n - nfront;
+		n = nfront;
+	}
+
+	/* The NULLs only need tie-breaking */
+	if (nnulls > 1 && state->onlyKey == NULL)
+		qsort_tuple(nulls, nnulls, state->comparetup, state);
+
+	if (n < 2)
+		return;
+
+	/* Find the first key byte that is not the same in all tuples */
+	minkey = maxkey = RADIX_KEY(data[0].datum1, spec);
+	for (i = 1; i < n; i++)
+	{
+		Datum		key = RADIX_KEY(data[i].datum1, spec);
+
+		if (key < minkey)
+			minkey = key;
+		if (key > maxkey)
+			maxkey = key;
+	}
+	diff = minkey ^ maxkey;
+
+	if (diff == 0)
+	{
+		/* All leading keys are equal */
+		if (state->onlyKey == NULL)
+			qsort_tuple(data, n, state->comparetup, state);
+		return;
+	}
+
+#if SIZEOF_DATUM == 8
+	level = spec->keybytes - 1 - pg_leftmost_one_pos64(diff) / BITS_PER_BYTE;
+#else
+	level = spec->keybytes - 1 - pg_leftmost_one_pos32(diff) / BITS_PER_BYTE;
+#endif
+
+	radix_sort_tuple(data, n, level, spec, state);
+}
+
 /*
  * Sort all memtuples using specialized qsort() routines.
  *
- * Quicksort is used for small in-memory sorts, and external sort runs.
+ * Quicksort is used for small in-memory sorts, and external sort runs.  If
+ * the leading key's comparator has a specialization, we use a quicksort
+ * routine with that comparator inlined, or a radix sort for large inputs.
  */
 static void
 tuplesort_sort_memtuples(Tuplesortstate *state)
@@ -3558,6 +4071,24 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 
 	if (state->memtupcount > 1)
 	{
+		SortSpecialization spec;
+
+		/*
+		 * Do we have the leading column's value or abbreviation in datum1,
+		 * and is there a specialization for its comparator?
+		 */
+		if (optimize_specialized_sort && state->haveDatum1 &&
+			state->sortKeys != NULL &&
+			get_sort_specialization(&state->sortKeys[0], &spec))
+		{
+			if (optimize_radix_sort &&
+				state->memtupcount >= RADIX_SORT_THRESHOLD)
+				radix_sort_memtuples(state, &spec);
+			else
+				spec.qsort_fn(state->memtuples, state->memtupcount, state);
+			return;
+		}
+
 		/* Can we use the single-key sort function? */
 		if (state->onlyKey != NULL)
 			qsort_ssup(state->memtuples, state->memtupcount,
@@ -4433,6 +4964,82 @@ readtup_index(Tuplesortstate *state, SortTuple *stup,
 								 &stup->isnull1);
 }
 
+/*
+ * Routines specialized for the GinTuple case
+ */
+
+static int
+comparetup_index_gin(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state)
+{
+	GinTuple   *tuple1 = (GinTuple *) a->tuple;
+	GinTuple   *tuple2 = (GinTuple *) b->tuple;
+	int			compare;
+
+	if (tuple1->attrnum != tuple2->attrnum)
+		return (tuple1->attrnum < tuple2->attrnum) ? -1 : 1;
+
+	/* same ordering of categories as ginCompareEntries() */
+	if (tuple1->category != tuple2->category)
+		return (tuple1->category < tuple2->category) ? -1 : 1;
+
+	if (tuple1->category == GIN_CAT_NORM_KEY)
+	{
+		compare = ApplySortComparator(a->datum1, false,
+									  b->datum1, false,
+									  &state->sortKeys[tuple1->attrnum - 1]);
+		if (compare != 0)
+			return compare;
+	}
+
+	/*
+	 * For equal keys, sort on the first TID, so that the leader can merge the
+	 * TID lists cheaply.
+	 */
+	return ItemPointerCompare(GinTupleGetItems(tuple1),
+							  GinTupleGetItems(tuple2));
+}
+
+static void
+writetup_index_gin(Tuplesortstate *state, int tapenum, SortTuple *stup)
+{
+	GinTuple   *tuple = (GinTuple *) stup->tuple;
+	unsigned int tuplen;
+
+	tuplen = tuple->tuplen + sizeof(tuplen);
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) &tuplen, sizeof(tuplen));
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) tuple, tuple->tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeWrite(state->tapeset, tapenum,
+						 (void *) &tuplen, sizeof(tuplen));
+
+	if (!state->slabAllocatorUsed)
+	{
+		FREEMEM(state, GetMemoryChunkSpace(tuple));
+		pfree(tuple);
+	}
+}
+
+static void
+readtup_index_gin(Tuplesortstate *state, SortTuple *stup,
+				  int tapenum, unsigned int len)
+{
+	unsigned int tuplen = len - sizeof(unsigned int);
+	GinTuple   *tuple = (GinTuple *) readtup_alloc(state, tuplen);
+
+	LogicalTapeReadExact(state->tapeset, tapenum,
+						 tuple, tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeReadExact(state->tapeset, tapenum,
+							 &tuplen, sizeof(tuplen));
+	stup->tuple = (void *) tuple;
+	/* set up key value */
+	stup->datum1 = GinTupleGetKey(tuple);
+	stup->isnull1 = (tuple->category != GIN_CAT_NORM_KEY);
+}
+
 /*
  * Routines specialized for DatumTuple case
  */
@@ -4776,3 +5383,49 @@ free_sort_tuple(Tuplesortstate *state, SortTuple *stup)
 	FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
 	pfree(stup->tuple);
 }
+
+/*
+ * Datum comparators for sort keys that the specialized sort routines above
+ * know how to handle.  Datatypes whose sort support can use one of these as
+ * their comparator, or as their abbreviated comparator, should do so.
+ */
+int
+ssup_datum_unsigned_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	if (x < y)
+		return -1;
+	else if (x > y)
+		return 1;
+	else
+		return 0;
+}
+
+#if SIZEOF_DATUM >= 8
+int
+ssup_datum_signed_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		xx = DatumGetInt64(x);
+	int64		yy = DatumGetInt64(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
+#endif
+
+int
+ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int32		xx = DatumGetInt32(x);
+	int32		yy = DatumGetInt32(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
@@ -632,6 +632,12 @@ static const BuiltinScript builtin_script[] =
 		"<builtin: select only>",
 		"\\set aid random(1, " CppAsString2(naccounts) " * :scale)\n"
 		"SELECT abalance FROM pgbench_accounts WHERE aid = :aid;\n"
+	},
+	{
+		"notify",
+		"<builtin: notify>",
+		"\\set channel random(1, 100)\n"
+		"SELECT pg_notify('pgbench_' || :channel, :client_id::text);\n"
 	}
 };
 
@@ -189,6 +189,17 @@ pgbench(
 	],
 	'pgbench select only');
 
+pgbench(
+	'-t 50 -c 2 -b notify -n',
+	0,
+	[
+		qr{builtin: notify},
+		qr{clients: 2\b},
+		qr{processed: 100/100}
+	],
+	[qr{^$}],
+	'pgbench notify');
+
 # check if threads are supported
 my $nthreads = 2;
 
@@ -0,0 +1,66 @@
+/*--------------------------------------------------------------------------
+ * gin_tuple.h
+ *	  Public header file for the intermediate tuple format used while
+ *	  building GIN indexes in parallel.
+ *
+ *	Copyright (c) 2006-2021, PostgreSQL Global Development Group
+ *
+ *	src/include/access/gin_tuple.h
+ *--------------------------------------------------------------------------
+ */
+#ifndef GIN_TUPLE_H
+#define GIN_TUPLE_H
+
+#include "access/ginblock.h"
+#include "storage/itemptr.h"
+
+/*
+ * A GinTuple carries one index key and a sorted list of heap TIDs for it.
+ * Participants of a parallel GIN build feed these through a shared tuplesort,
+ * which orders them by (attrnum, category, key, first TID), so that the
+ * leader sees all the TID lists of a given key one after another.
+ *
+ * The key is stored at a MAXALIGN'd offset from the start of the tuple, so
+ * that pass-by-reference keys can be used in place.  Pass-by-value keys are
+ * stored as a full Datum.  The TIDs follow the key, SHORTALIGN'd.
+ */
+typedef struct GinTuple
+{
+	int			tuplen;			/* length of the whole tuple */
+	OffsetNumber attrnum;		/* attnum of index key */
+	int16		typlen;			/* typlen of the key */
+	bool		typbyval;		/* typbyval of the key */
+	signed char category;		/* category: normal or NULL? */
+	int			keylen;			/* bytes in data for key value */
+	int			nitems;			/* number of TIDs in the data */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} GinTuple;
+
+#define GinTupleKeyOffset	MAXALIGN(offsetof(GinTuple, data))
+
+static inline ItemPointer
+GinTupleGetItems(GinTuple *tup)
+{
+	return (ItemPointer) ((char *) tup +
+						  SHORTALIGN(GinTupleKeyOffset + tup->keylen));
+}
+
+static inline Datum
+GinTupleGetKey(GinTuple *tup)
+{
+	char	   *ptr = (char *) tup + GinTupleKeyOffset;
+	Datum		key;
+
+	if (tup->category != GIN_CAT_NORM_KEY)
+		return (Datum) 0;
+
+	if (tup->typbyval)
+	{
+		memcpy(&key, ptr, sizeof(Datum));
+		return key;
+	}
+
+	return PointerGetDatum(ptr);
+}
+
+#endif							/* GIN_TUPLE_H */
@@ -24,12 +24,19 @@
  * If current_buf isn't InvalidBuffer, then we are holding an extra pin
  * on that buffer.
  *
+ * If next_free isn't InvalidBlockNumber, the blocks from next_free through
+ * last_free were added to the relation by an earlier extension and are
+ * reserved for this bulk insert.
+ *
  * "typedef struct BulkInsertStateData *BulkInsertState" is in heapam.h
  */
 typedef struct BulkInsertStateData
 {
 	BufferAccessStrategy strategy;	/* our BULKWRITE strategy object */
 	Buffer		current_buf;	/* current insertion target page */
+	BlockNumber next_free;		/* next reserved block, if any */
+	BlockNumber last_free;		/* last reserved block */
+	uint32		already_extended_by;	/* blocks this state has added */
 } BulkInsertStateData;
 
 
@@ -38,6 +45,7 @@ extern void RelationPutHeapTuple(Relation relation, Buffer buffer,
 extern Buffer RelationGetBufferForTuple(Relation relation, Size len,
 										Buffer otherBuffer, int options,
 										BulkInsertStateData *bistate,
-										Buffer *vmbuffer, Buffer *vmbuffer_other);
+										Buffer *vmbuffer, Buffer *vmbuffer_other,
+										int num_pages);
 
 #endif							/* HIO_H */
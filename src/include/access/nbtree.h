@@ -998,7 +998,13 @@ typedef BTScanPosData *BTScanPos;
 		(scanpos).nextTupleOffset = 0; \
 	} while (0)
 
-/* We need one of these for each equality-type SK_SEARCHARRAY scan key */
+/*
+ * We need one of these for each equality-type SK_SEARCHARRAY scan key, and
+ * for each skip key.  A skip key is an equality key that we generate for a
+ * leading index column that the scan has no qual for.  It doesn't have a
+ * fixed set of elements; instead its successive values are found by probing
+ * the index for the next distinct prefix (see _bt_skip_next()).
+ */
 typedef struct BTArrayKeyInfo
 {
 	int			scan_key;		/* index of associated key in arrayKeyData */
@@ -1006,6 +1012,13 @@ typedef struct BTArrayKeyInfo
 	int			mark_elem;		/* index of marked element in elem_values */
 	int			num_elems;		/* number of elems in current array value */
 	Datum	   *elem_values;	/* array of num_elems Datums */
+
+	/* these fields are used only by skip keys */
+	bool		skip;			/* is this a skip key? */
+	bool		cur_null;		/* current value is NULL? */
+	bool		mark_null;		/* marked value is NULL? */
+	Datum		cur_value;		/* current value, if not NULL */
+	Datum		mark_value;		/* marked value, if not NULL */
 } BTArrayKeyInfo;
 
 typedef struct BTScanOpaqueData
@@ -1015,10 +1028,19 @@ typedef struct BTScanOpaqueData
 	int			numberOfKeys;	/* number of preprocessed scan keys */
 	ScanKey		keyData;		/* array of preprocessed scan keys */
 
-	/* workspace for SK_SEARCHARRAY support */
-	ScanKey		arrayKeyData;	/* modified copy of scan->keyData */
+	/* workspace for SK_SEARCHARRAY and skip scan support */
+	ScanKey		arrayKeyData;	/* modified copy of scan->keyData, preceded
+								 * by any skip keys */
+	int			numArrayKeyData;	/* number of keys in arrayKeyData */
 	int			numArrayKeys;	/* number of equality-type array keys (-1 if
 								 * there are any unsatisfiable array keys) */
+	int			numSkipKeys;	/* number of leading arrayKeys that are skip
+								 * keys */
+	bool		skipFallback;	/* gave up skipping for the rest of the scan? */
+	bool		markSkipFallback;	/* skipFallback when the mark was set */
+	BlockNumber skipPrevBlock;	/* leaf page the last prefix was found on */
+	int			skipSamePage;	/* # of consecutive prefixes found on the
+								 * same leaf page as the one before */
 	int			arrayKeyCount;	/* count indicating number of array scan keys
 								 * processed */
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
@@ -1207,6 +1229,7 @@ extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 							   Snapshot snapshot);
+extern bool _bt_skip_next(IndexScanDesc scan, ScanDirection dir, bool first);
 
 /*
  * prototypes for functions in nbtutils.c
@@ -1214,8 +1237,10 @@ extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 extern BTScanInsert _bt_mkscankey(Relation rel, IndexTuple itup);
 extern void _bt_freestack(BTStack stack);
 extern void _bt_preprocess_array_keys(IndexScanDesc scan);
-extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
+extern void _bt_set_skip_key(IndexScanDesc scan, int skipidx, Datum value,
+							 bool isnull);
 extern void _bt_mark_array_keys(IndexScanDesc scan);
 extern void _bt_restore_array_keys(IndexScanDesc scan);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
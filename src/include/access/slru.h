@@ -14,9 +14,16 @@
 #define SLRU_H
 
 #include "access/xlogdefs.h"
+#include "port/atomics.h"
 #include "storage/lwlock.h"
 #include "storage/sync.h"
 
+/*
+ * To avoid overflowing internal arithmetic and the size_t data type, the
+ * number of buffers must not exceed this number.
+ */
+#define SLRU_MAX_ALLOWED_BUFFERS ((1024 * 1024 * 1024) / BLCKSZ)
+
 
 /*
  * Define SLRU segment size.  A page is the same BLCKSZ as is used everywhere
@@ -33,6 +40,18 @@
  */
 #define SLRU_PAGES_PER_SEGMENT	32
 
+/*
+ * SLRU buffers are divided into banks of SLRU_BANK_SIZE slots each.  A page
+ * can only ever be cached in the bank selected by its page number, so page
+ * lookup and victim selection only need to consider the slots of one bank,
+ * no matter how many buffers the SLRU has.  Each bank is protected by its
+ * own LWLock, which also spreads out contention on large SLRUs.  The number
+ * of buffers of each SLRU is therefore required to be a multiple of
+ * SLRU_BANK_SIZE.
+ */
+#define SLRU_BANK_BITSHIFT		4
+#define SLRU_BANK_SIZE			(1 << SLRU_BANK_BITSHIFT)
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be true only in the VALID or WRITE_IN_PROGRESS states;
@@ -52,8 +71,6 @@ typedef enum
  */
 typedef struct SlruSharedData
 {
-	LWLock	   *ControlLock;
-
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
@@ -66,8 +83,17 @@ typedef struct SlruSharedData
 	bool	   *page_dirty;
 	int		   *page_number;
 	int		   *page_lru_count;
+
+	/* Per-buffer locks, used to synchronize I/O on each buffer slot */
 	LWLockPadded *buffer_locks;
 
+	/*
+	 * Locks to protect the in memory buffer slot access in SLRU bank.  The
+	 * lock for a bank must be held to examine or modify the state of any of
+	 * the bank's slots.  See SimpleLruGetBankLock().
+	 */
+	LWLockPadded *bank_locks;
+
 	/*
 	 * Optional array of WAL flush LSNs associated with entries in the SLRU
 	 * pages.  If not zero/NULL, we must flush WAL before writing pages (true
@@ -80,22 +106,29 @@ typedef struct SlruSharedData
 	int			lsn_groups_per_page;
 
 	/*----------
+	 * A bank-wise LRU counter is maintained because we do a victim buffer
+	 * search within a bank.  Furthermore, manipulating an individual bank
+	 * counter avoids frequent cache invalidation since we update it every
+	 * time we access the page.
+	 *
 	 * We mark a page "most recently used" by setting
-	 *		page_lru_count[slotno] = ++cur_lru_count;
-	 * The oldest page is therefore the one with the highest value of
-	 *		cur_lru_count - page_lru_count[slotno]
+	 *		page_lru_count[slotno] = ++bank_cur_lru_count[bankno];
+	 * The oldest page in the bank is therefore the one with the highest value
+	 * of
+	 *		bank_cur_lru_count[bankno] - page_lru_count[slotno]
 	 * The counts will eventually wrap around, but this calculation still
 	 * works as long as no page's age exceeds INT_MAX counts.
 	 *----------
 	 */
-	int			cur_lru_count;
+	int		   *bank_cur_lru_count;
 
 	/*
 	 * latest_page_number is the page number of the current end of the log;
 	 * this is not critical data, since we use it only to avoid swapping out
-	 * the latest page.
+	 * the latest page.  It is not protected by any single bank lock, so it
+	 * is accessed atomically.
 	 */
-	int			latest_page_number;
+	pg_atomic_uint32 latest_page_number;
 
 	/* SLRU's index for statistics purposes (might not be unique) */
 	int			slru_stats_idx;
@@ -111,6 +144,9 @@ typedef struct SlruCtlData
 {
 	SlruShared	shared;
 
+	/* Number of banks in this SLRU. */
+	uint16		nbanks;
+
 	/*
 	 * Which sync handler function to use when handing sync requests over to
 	 * the checkpointer.  SYNC_HANDLER_NONE to disable fsync (eg pg_notify).
@@ -139,10 +175,41 @@ typedef struct SlruCtlData
 typedef SlruCtlData *SlruCtl;
 
 
+/*
+ * Get the SLRU bank lock for the given pageno.
+ *
+ * This lock needs to be acquired to access the slru buffer slots in the
+ * respective bank.
+ */
+static inline LWLock *
+SimpleLruGetBankLock(SlruCtl ctl, int pageno)
+{
+	int			bankno;
+
+	bankno = pageno % ctl->nbanks;
+	return &(ctl->shared->bank_locks[bankno].lock);
+}
+
+/*
+ * Read or set the latest page number of an SLRU.
+ */
+static inline int
+SimpleLruGetLatestPage(SlruCtl ctl)
+{
+	return (int) pg_atomic_read_u32(&ctl->shared->latest_page_number);
+}
+
+static inline void
+SimpleLruSetLatestPage(SlruCtl ctl, int pageno)
+{
+	pg_atomic_write_u32(&ctl->shared->latest_page_number, (uint32) pageno);
+}
+
 extern Size SimpleLruShmemSize(int nslots, int nlsns);
+extern int	SimpleLruAutotuneBuffers(int divisor, int max);
 extern void SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
-						  LWLock *ctllock, const char *subdir, int tranche_id,
-						  SyncRequestHandler sync_handler);
+						  const char *subdir, int buffer_tranche_id,
+						  int bank_tranche_id, SyncRequestHandler sync_handler);
 extern int	SimpleLruZeroPage(SlruCtl ctl, int pageno);
 extern int	SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 							  TransactionId xid);
@@ -170,5 +237,6 @@ extern bool SlruScanDirCbReportPresence(SlruCtl ctl, char *filename,
 										int segpage, void *data);
 extern bool SlruScanDirCbDeleteAll(SlruCtl ctl, char *filename, int segpage,
 								   void *data);
+extern bool check_slru_buffers(const char *name, int *newval);
 
 #endif							/* SLRU_H */
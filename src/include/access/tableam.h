@@ -20,6 +20,7 @@
 #include "access/relscan.h"
 #include "access/sdir.h"
 #include "access/xact.h"
+#include "catalog/globaltemp.h"
 #include "utils/guc.h"
 #include "utils/rel.h"
 #include "utils/snapshot.h"
@@ -870,6 +871,19 @@ extern const TupleTableSlotOps *table_slot_callbacks(Relation rel);
 extern TupleTableSlot *table_slot_create(Relation rel, List **reglist);
 
 
+/*
+ * A global temporary table gets this session's storage, along with its
+ * indexes and TOAST table, when it is first scanned or inserted into.  See
+ * catalog/globaltemp.c.
+ */
+static inline void
+table_ensure_storage(Relation rel)
+{
+	if (unlikely(RelationLacksSessionStorage(rel)))
+		GlobalTempRelationEnsureStorage(rel);
+}
+
+
 /* ----------------------------------------------------------------------------
  * Table scan functions.
  * ----------------------------------------------------------------------------
@@ -886,6 +900,8 @@ table_beginscan(Relation rel, Snapshot snapshot,
 	uint32		flags = SO_TYPE_SEQSCAN |
 	SO_ALLOW_STRAT | SO_ALLOW_SYNC | SO_ALLOW_PAGEMODE;
 
+	table_ensure_storage(rel);
+
 	return rel->rd_tableam->scan_begin(rel, snapshot, nkeys, key, NULL, flags);
 }
 
@@ -915,6 +931,8 @@ table_beginscan_strat(Relation rel, Snapshot snapshot,
 	if (allow_sync)
 		flags |= SO_ALLOW_SYNC;
 
+	table_ensure_storage(rel);
+
 	return rel->rd_tableam->scan_begin(rel, snapshot, nkeys, key, NULL, flags);
 }
 
@@ -930,6 +948,8 @@ table_beginscan_bm(Relation rel, Snapshot snapshot,
 {
 	uint32		flags = SO_TYPE_BITMAPSCAN | SO_ALLOW_PAGEMODE;
 
+	table_ensure_storage(rel);
+
 	return rel->rd_tableam->scan_begin(rel, snapshot, nkeys, key, NULL, flags);
 }
 
@@ -955,6 +975,8 @@ table_beginscan_sampling(Relation rel, Snapshot snapshot,
 	if (allow_pagemode)
 		flags |= SO_ALLOW_PAGEMODE;
 
+	table_ensure_storage(rel);
+
 	return rel->rd_tableam->scan_begin(rel, snapshot, nkeys, key, NULL, flags);
 }
 
@@ -968,6 +990,8 @@ table_beginscan_tid(Relation rel, Snapshot snapshot)
 {
 	uint32		flags = SO_TYPE_TIDSCAN;
 
+	table_ensure_storage(rel);
+
 	return rel->rd_tableam->scan_begin(rel, snapshot, 0, NULL, NULL, flags);
 }
 
@@ -981,6 +1005,8 @@ table_beginscan_analyze(Relation rel)
 {
 	uint32		flags = SO_TYPE_ANALYZE;
 
+	table_ensure_storage(rel);
+
 	return rel->rd_tableam->scan_begin(rel, NULL, 0, NULL, NULL, flags);
 }
 
@@ -1061,6 +1087,8 @@ table_beginscan_tidrange(Relation rel, Snapshot snapshot,
 	TableScanDesc sscan;
 	uint32		flags = SO_TYPE_TIDRANGESCAN | SO_ALLOW_PAGEMODE;
 
+	table_ensure_storage(rel);
+
 	sscan = rel->rd_tableam->scan_begin(rel, snapshot, 0, NULL, NULL, flags);
 
 	/* Set the range of TIDs to scan */
@@ -1160,6 +1188,8 @@ table_parallelscan_reinitialize(Relation rel, ParallelTableScanDesc pscan)
 static inline IndexFetchTableData *
 table_index_fetch_begin(Relation rel)
 {
+	table_ensure_storage(rel);
+
 	return rel->rd_tableam->index_fetch_begin(rel);
 }
 
@@ -1371,6 +1401,8 @@ static inline void
 table_tuple_insert(Relation rel, TupleTableSlot *slot, CommandId cid,
 				   int options, struct BulkInsertStateData *bistate)
 {
+	table_ensure_storage(rel);
+
 	rel->rd_tableam->tuple_insert(rel, slot, cid, options,
 								  bistate);
 }
@@ -1392,6 +1424,8 @@ table_tuple_insert_speculative(Relation rel, TupleTableSlot *slot,
 							   struct BulkInsertStateData *bistate,
 							   uint32 specToken)
 {
+	table_ensure_storage(rel);
+
 	rel->rd_tableam->tuple_insert_speculative(rel, slot, cid, options,
 											  bistate, specToken);
 }
@@ -1426,6 +1460,8 @@ static inline void
 table_multi_insert(Relation rel, TupleTableSlot **slots, int nslots,
 				   CommandId cid, int options, struct BulkInsertStateData *bistate)
 {
+	table_ensure_storage(rel);
+
 	rel->rd_tableam->multi_insert(rel, slots, nslots,
 								  cid, options, bistate);
 }
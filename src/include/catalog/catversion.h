@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	202103093
+#define CATALOG_VERSION_NO	202103103
 
 #endif
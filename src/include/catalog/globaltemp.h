@@ -0,0 +1,49 @@
+/*-------------------------------------------------------------------------
+ *
+ * globaltemp.h
+ *	  prototypes for functions in backend/catalog/globaltemp.c
+ *
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/globaltemp.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef GLOBALTEMP_H
+#define GLOBALTEMP_H
+
+#include "access/htup.h"
+#include "storage/block.h"
+#include "utils/relcache.h"
+
+extern Size GlobalTempShmemSize(void);
+extern void GlobalTempShmemInit(void);
+
+extern void GlobalTempRelationInitPhysicalAddr(Relation rel);
+extern void GlobalTempRelationEnsureStorage(Relation rel);
+extern void GlobalTempRelationSetNewFilenode(Relation rel);
+extern void GlobalTempRelationDropped(Relation rel);
+extern Oid	GlobalTempRelationGetFilenode(Oid relid);
+
+extern void GlobalTempRelationSetStats(Relation rel, BlockNumber relpages,
+									   double reltuples,
+									   BlockNumber relallvisible);
+extern void GlobalTempRelationSetXids(Relation rel, TransactionId frozenxid,
+									  MultiXactId minmulti);
+extern void GlobalTempRelationSetStatistic(Oid relid, AttrNumber attnum,
+										   bool inh, HeapTuple tuple);
+extern bool GlobalTempRelationGetStatistic(Oid relid, AttrNumber attnum,
+										   bool inh, HeapTuple *tuple);
+
+extern void CheckGlobalTempRelationNotInUse(Relation rel, const char *stmt);
+extern void ResetGlobalTempRelations(void);
+extern void GetOldestGlobalTempXids(TransactionId *frozenxid,
+									MultiXactId *minmulti);
+
+extern void AtEOXact_GlobalTemp(bool isCommit);
+extern void AtEOSubXact_GlobalTemp(bool isCommit, SubTransactionId mySubid,
+								   SubTransactionId parentSubid);
+
+#endif							/* GLOBALTEMP_H */
@@ -140,6 +140,7 @@ typedef struct TransitionCaptureState
 #define SESSION_REPLICATION_ROLE_REPLICA	1
 #define SESSION_REPLICATION_ROLE_LOCAL		2
 extern PGDLLIMPORT int SessionReplicationRole;
+extern PGDLLIMPORT int trigger_queue_work_mem;
 
 /*
  * States at which a trigger can be fired. These are the
@@ -258,6 +259,8 @@ extern bool RI_Initial_Check(Trigger *trigger,
 							 Relation fk_rel, Relation pk_rel);
 extern void RI_PartitionRemove_Check(Trigger *trigger, Relation fk_rel,
 									 Relation pk_rel);
+extern void RI_FlushPendingChecks(void);
+extern void RI_DiscardPendingChecks(void);
 
 /* result values for RI_FKey_trigger_type: */
 #define RI_TRIGGER_PK	1		/* is a trigger on the PK relation */
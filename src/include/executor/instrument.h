@@ -28,6 +28,8 @@ typedef struct BufferUsage
 	long		local_blks_written; /* # of local disk blocks written */
 	long		temp_blks_read; /* # of temp blocks read */
 	long		temp_blks_written;	/* # of temp blocks written */
+	uint64		temp_compressed_bytes;	/* compressed temp data written */
+	uint64		temp_uncompressed_bytes;	/* same, before compression */
 	instr_time	blk_read_time;	/* time spent reading */
 	instr_time	blk_write_time; /* time spent writing */
 } BufferUsage;
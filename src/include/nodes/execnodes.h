@@ -2243,6 +2243,17 @@ typedef struct AggState
 typedef struct WindowStatePerFuncData *WindowStatePerFunc;
 typedef struct WindowStatePerAggData *WindowStatePerAgg;
 
+/*
+ * WindowAggStatus -- Used to track the status of WindowAggState
+ */
+typedef enum WindowAggStatus
+{
+	WINDOWAGG_RUN,				/* Normal processing of window funcs */
+	WINDOWAGG_PASSTHROUGH,		/* Don't eval window funcs */
+	WINDOWAGG_PASSTHROUGH_STRICT	/* Pass-through plus don't store new
+									 * tuples during spool */
+} WindowAggStatus;
+
 typedef struct WindowAggState
 {
 	ScanState	ss;				/* its first field is NodeTag */
@@ -2256,6 +2267,16 @@ typedef struct WindowAggState
 	WindowStatePerAgg peragg;	/* per-plain-aggregate information */
 	ExprState  *partEqfunction; /* equality funcs for partition columns */
 	ExprState  *ordEqfunction;	/* equality funcs for ordering columns */
+	ExprState  *runcondition;	/* Condition which must remain true otherwise
+								 * execution of the WindowAgg will finish or
+								 * go into pass-through mode.  NULL when there
+								 * is no such condition. */
+	bool		use_pass_through;	/* When false, stop execution when
+									 * runcondition is no longer true.  Else
+									 * just stop evaluating window funcs. */
+	bool		top_window;		/* true if this is the top-most WindowAgg or
+								 * the only WindowAgg in this query level */
+	WindowAggStatus status;		/* run status of WindowAggState */
 	Tuplestorestate *buffer;	/* stores rows of current partition */
 	int			current_ptr;	/* read pointer # for current row */
 	int			framehead_ptr;	/* read pointer # for frame head, if used */
@@ -2391,6 +2412,27 @@ typedef struct GatherMergeState
 	struct binaryheap *gm_heap; /* binary heap of slot indices */
 } GatherMergeState;
 
+/* ----------------
+ * RepartitionState information
+ *
+ *		Repartition nodes spool their share of a partial subplan's output
+ *		into shared batches chosen by hashing the key columns, then return
+ *		the rows of whichever batches this process manages to claim.
+ * ----------------
+ */
+struct ParallelRepartitionState;	/* private in nodeRepartition.c */
+
+typedef struct RepartitionState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	FmgrInfo   *hashfunctions;	/* hash functions for the key columns */
+	/* shared state, or NULL if we're the only participant */
+	struct ParallelRepartitionState *parallel_state;
+	SharedTuplestoreAccessor **batches; /* accessor for each batch */
+	bool		spooled;		/* done with our share of the input? */
+	int			cur_batch;		/* batch being read, or -1 if none */
+} RepartitionState;
+
 /* ----------------
  *	 Values displayed by EXPLAIN ANALYZE
  * ----------------
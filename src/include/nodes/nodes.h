@@ -82,6 +82,7 @@ typedef enum NodeTag
 	T_Unique,
 	T_Gather,
 	T_GatherMerge,
+	T_Repartition,
 	T_Hash,
 	T_SetOp,
 	T_LockRows,
@@ -140,6 +141,7 @@ typedef enum NodeTag
 	T_UniqueState,
 	T_GatherState,
 	T_GatherMergeState,
+	T_RepartitionState,
 	T_HashState,
 	T_SetOpState,
 	T_LockRowsState,
@@ -245,6 +247,7 @@ typedef enum NodeTag
 	T_UniquePath,
 	T_GatherPath,
 	T_GatherMergePath,
+	T_RepartitionPath,
 	T_ProjectionPath,
 	T_ProjectSetPath,
 	T_SortPath,
@@ -521,7 +524,8 @@ typedef enum NodeTag
 	T_SupportRequestSelectivity,	/* in nodes/supportnodes.h */
 	T_SupportRequestCost,		/* in nodes/supportnodes.h */
 	T_SupportRequestRows,		/* in nodes/supportnodes.h */
-	T_SupportRequestIndexCondition	/* in nodes/supportnodes.h */
+	T_SupportRequestIndexCondition, /* in nodes/supportnodes.h */
+	T_SupportRequestWFuncMonotonic	/* in nodes/supportnodes.h */
 } NodeTag;
 
 /*
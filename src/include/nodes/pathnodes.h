@@ -1528,6 +1528,19 @@ typedef struct GatherMergePath
 	int			num_workers;	/* number of workers sought to help */
 } GatherMergePath;
 
+/*
+ * RepartitionPath represents redistributing the rows of a partial path
+ * among the parallel participants by hashing the given grouping clauses.
+ * The result is still a partial path, but now every participant returns
+ * all the rows for the key values it has been assigned.
+ */
+typedef struct RepartitionPath
+{
+	Path		path;
+	Path	   *subpath;		/* path representing input source */
+	List	   *hashClauses;	/* list of SortGroupClauses to hash on */
+} RepartitionPath;
+
 
 /*
  * All join-type paths share these fields.
@@ -1782,6 +1795,8 @@ typedef struct WindowAggPath
 	Path		path;
 	Path	   *subpath;		/* path representing input source */
 	WindowClause *winclause;	/* WindowClause we'll be using */
+	bool		topwindow;		/* false for all apart from the WindowAgg
+								 * that's closest to the root of the plan */
 } WindowAggPath;
 
 /*
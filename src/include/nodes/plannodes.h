@@ -870,8 +870,33 @@ typedef struct WindowAgg
 	Oid			inRangeColl;	/* collation for in_range tests */
 	bool		inRangeAsc;		/* use ASC sort order for in_range tests? */
 	bool		inRangeNullsFirst;	/* nulls sort first for in_range tests? */
+
+	/*
+	 * runCondition: quals on this node's window functions that, once false,
+	 * stay false for the rest of the partition; see WindowClause.
+	 */
+	List	   *runCondition;
+	bool		topWindow;		/* false for all apart from the WindowAgg
+								 * that's closest to the root of the plan */
 } WindowAgg;
 
+/*
+ * MonotonicFunction
+ *
+ * Allows the planner to track monotonic properties of functions.  A function
+ * is monotonically increasing if a subsequent call cannot yield a lower value
+ * than the previous call.  A monotonically decreasing function cannot yield a
+ * higher value on subsequent calls, and a function which is both must return
+ * the same value on each call.
+ */
+typedef enum MonotonicFunction
+{
+	MONOTONICFUNC_NONE = 0,
+	MONOTONICFUNC_INCREASING = (1 << 0),
+	MONOTONICFUNC_DECREASING = (1 << 1),
+	MONOTONICFUNC_BOTH = MONOTONICFUNC_INCREASING | MONOTONICFUNC_DECREASING
+} MonotonicFunction;
+
 /* ----------------
  *		unique node
  * ----------------
@@ -926,6 +951,26 @@ typedef struct GatherMerge
 								 * at gather merge or one of it's child node */
 } GatherMerge;
 
+/* ------------
+ *		repartition node
+ *
+ * A Repartition node appears below a Gather or Gather Merge.  It reads its
+ * share of a partial subplan's output, and redistributes the rows among the
+ * participating processes by hashing the given columns, so that all rows
+ * with equal key values end up in the same process.  The output of each
+ * process is thus a disjoint set of groups of equal keys, as needed for
+ * example by a WindowAgg partitioned on those keys.
+ * ------------
+ */
+typedef struct Repartition
+{
+	Plan		plan;
+	int			numCols;		/* number of hash key columns */
+	AttrNumber *hashColIdx;		/* their indexes in the target list */
+	Oid		   *hashOperators;	/* equality operators for the hash keys */
+	Oid		   *hashCollations; /* collations for the hash keys */
+} Repartition;
+
 /* ----------------
  *		hash build node
  *
@@ -33,11 +33,13 @@
 #ifndef SUPPORTNODES_H
 #define SUPPORTNODES_H
 
+#include "nodes/plannodes.h"
 #include "nodes/primnodes.h"
 
 struct PlannerInfo;				/* avoid including pathnodes.h here */
 struct IndexOptInfo;
 struct SpecialJoinInfo;
+struct WindowClause;
 
 
 /*
@@ -239,4 +241,31 @@ typedef struct SupportRequestIndexCondition
 								 * equivalent of the function call */
 } SupportRequestIndexCondition;
 
+/*
+ * The WFuncMonotonic request allows the planner to ask a window function's
+ * support function whether the function's result is monotonic within a
+ * window partition, given the window clause it is evaluated over.  For
+ * example, row_number() can only go up as the partition is processed, so
+ * once a condition such as "row_number() <= 10" becomes false it can never
+ * become true again for the rest of the partition.  The planner uses this to
+ * give the WindowAgg node a "run condition" that lets it stop processing the
+ * partition early.
+ *
+ * The support function must set "monotonic" to one of the MonotonicFunction
+ * values.  Leaving it as MONOTONICFUNC_NONE (or not implementing the request)
+ * is always safe.  Note that for aggregate functions used as window
+ * functions, the answer generally depends on the window frame options.
+ */
+typedef struct SupportRequestWFuncMonotonic
+{
+	NodeTag		type;
+
+	/* Input fields: */
+	WindowFunc *window_func;	/* Pointer to the window function data */
+	struct WindowClause *window_clause; /* Pointer to the window clause data */
+
+	/* Output fields: */
+	MonotonicFunction monotonic;
+} SupportRequestWFuncMonotonic;
+
 #endif							/* SUPPORTNODES_H */
@@ -94,6 +94,10 @@ extern GatherMergePath *create_gather_merge_path(PlannerInfo *root,
 												 List *pathkeys,
 												 Relids required_outer,
 												 double *rows);
+extern RepartitionPath *create_repartition_path(PlannerInfo *root,
+												RelOptInfo *rel,
+												Path *subpath,
+												List *hashClauses);
 extern SubqueryScanPath *create_subqueryscan_path(PlannerInfo *root,
 												  RelOptInfo *rel, Path *subpath,
 												  List *pathkeys, Relids required_outer);
@@ -237,7 +241,8 @@ extern WindowAggPath *create_windowagg_path(PlannerInfo *root,
 											Path *subpath,
 											PathTarget *target,
 											List *windowFuncs,
-											WindowClause *winclause);
+											WindowClause *winclause,
+											bool topwindow);
 extern SetOpPath *create_setop_path(PlannerInfo *root,
 									RelOptInfo *rel,
 									Path *subpath,
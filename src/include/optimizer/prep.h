@@ -44,6 +44,7 @@ extern PlanRowMark *get_plan_rowmark(List *rowmarks, Index rtindex);
 extern void get_agg_clause_costs(PlannerInfo *root, AggSplit aggsplit,
 								 AggClauseCosts *agg_costs);
 extern void preprocess_aggrefs(PlannerInfo *root, Node *clause);
+extern void transform_distinct_aggs(PlannerInfo *root);
 
 /*
  * prototypes for prepunion.c
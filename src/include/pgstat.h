@@ -78,6 +78,7 @@ typedef enum StatMsgType
 	PGSTAT_MTYPE_FUNCPURGE,
 	PGSTAT_MTYPE_RECOVERYCONFLICT,
 	PGSTAT_MTYPE_TEMPFILE,
+	PGSTAT_MTYPE_TEMPCOMPRESSION,
 	PGSTAT_MTYPE_DEADLOCK,
 	PGSTAT_MTYPE_CHECKSUMFAILURE,
 	PGSTAT_MTYPE_REPLSLOT,
@@ -542,6 +543,20 @@ typedef struct PgStat_MsgTempFile
 	size_t		m_filesize;
 } PgStat_MsgTempFile;
 
+/* ----------
+ * PgStat_MsgTempCompression	Sent by the backend upon closing a compressed
+ *								temp file
+ * ----------
+ */
+typedef struct PgStat_MsgTempCompression
+{
+	PgStat_MsgHdr m_hdr;
+
+	Oid			m_databaseid;
+	PgStat_Counter m_compressed_bytes;
+	PgStat_Counter m_uncompressed_bytes;
+} PgStat_MsgTempCompression;
+
 /* ----------
  * PgStat_FunctionCounts	The actual per-function counts kept by a backend
  *
@@ -684,6 +699,7 @@ typedef union PgStat_Msg
 	PgStat_MsgRecoveryConflict msg_recoveryconflict;
 	PgStat_MsgDeadlock msg_deadlock;
 	PgStat_MsgTempFile msg_tempfile;
+	PgStat_MsgTempCompression msg_tempcompression;
 	PgStat_MsgChecksumFailure msg_checksumfailure;
 	PgStat_MsgReplSlot msg_replslot;
 	PgStat_MsgConn msg_conn;
@@ -698,7 +714,7 @@ typedef union PgStat_Msg
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BCA1
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BCA2
 
 /* ----------
  * PgStat_StatDBEntry			The collector's data per database
@@ -724,6 +740,8 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter n_conflict_startup_deadlock;
 	PgStat_Counter n_temp_files;
 	PgStat_Counter n_temp_bytes;
+	PgStat_Counter n_temp_compressed_bytes;
+	PgStat_Counter n_temp_uncompressed_bytes;
 	PgStat_Counter n_deadlocks;
 	PgStat_Counter n_checksum_failures;
 	TimestampTz last_checksum_failure;
@@ -1005,6 +1023,7 @@ typedef enum
 	WAIT_EVENT_RECOVERY_CONFLICT_SNAPSHOT,
 	WAIT_EVENT_RECOVERY_CONFLICT_TABLESPACE,
 	WAIT_EVENT_RECOVERY_PAUSE,
+	WAIT_EVENT_REPARTITION_SPOOL,
 	WAIT_EVENT_REPLICATION_ORIGIN_DROP,
 	WAIT_EVENT_REPLICATION_SLOT_DROP,
 	WAIT_EVENT_SAFE_SNAPSHOT,
@@ -1457,6 +1476,8 @@ extern void pgstat_bestart(void);
 
 extern void pgstat_report_activity(BackendState state, const char *cmd_str);
 extern void pgstat_report_tempfile(size_t filesize);
+extern void pgstat_report_tempfile_compression(uint64 compressed_bytes,
+											   uint64 uncompressed_bytes);
 extern void pgstat_report_appname(const char *appname);
 extern void pgstat_report_xact_timestamp(TimestampTz tstamp);
 extern const char *pgstat_get_wait_event(uint32 wait_event_info);
@@ -6,8 +6,9 @@
  * The shared cache invalidation manager is responsible for transmitting
  * invalidation messages between backends.  Any message sent by any backend
  * must be delivered to all already-running backends before it can be
- * forgotten.  (If we run out of space, we instead deliver a "RESET"
- * message to backends that have fallen too far behind.)
+ * forgotten.  (If we run out of space, backends that have fallen too far
+ * behind get a summary of the messages they missed instead, or if that
+ * would be too long, a "RESET" message.)
  *
  * The struct type SharedInvalidationMessage, defining the contents of
  * a single message, is defined in sinval.h.
@@ -25,6 +26,22 @@
 #include "storage/lock.h"
 #include "storage/sinval.h"
 
+/* GUC variable */
+extern PGDLLIMPORT int invalidation_queue_size;
+
+/*
+ * Invalidation statistics of a backend, as reported by SIGetBackendStatus.
+ * The counters are reset when the backend exits.
+ */
+typedef struct SIBackendStatus
+{
+	int			pid;			/* PID of the backend */
+	int			lag;			/* # of unread messages, -1 if reset pending */
+	uint64		resets;			/* # of times it had to reset its caches */
+	uint64		partialResets;	/* # of times it got a summary instead */
+	uint64		catchupSignals; /* # of catchup interrupts sent to it */
+} SIBackendStatus;
+
 /*
  * prototypes for functions in sinvaladt.c
  */
@@ -37,6 +54,7 @@ extern void BackendIdGetTransactionIds(int backendID, TransactionId *xid, Transa
 extern void SIInsertDataEntries(const SharedInvalidationMessage *data, int n);
 extern int	SIGetDataEntries(SharedInvalidationMessage *data, int datasize);
 extern void SICleanupQueue(bool callerHasWriteLock, int minFree);
+extern int	SIGetBackendStatus(SIBackendStatus *status);
 
 extern LocalTransactionId GetNextLocalTransactionId(void);
 
@@ -62,6 +62,13 @@ typedef struct catcache
 	ScanKeyData cc_skey[CATCACHE_MAXKEYS];	/* precomputed key info for heap
 											 * scans */
 
+	/* statistics, shown in pg_backend_catalog_caches */
+	Size		cc_memory;		/* memory used by this cache's entries */
+	uint64		cc_nhits;		/* # of searches satisfied from the cache */
+	uint64		cc_nmisses;		/* # of searches that read the catalog */
+	uint64		cc_nsharedhits; /* # of searches satisfied from shared cache */
+	uint64		cc_nevictions;	/* # of entries pruned to fit the budget */
+
 	/*
 	 * Keep these at the end, so that compiling catcache.c with CATCACHE_STATS
 	 * doesn't break ABI for other modules
@@ -103,6 +110,17 @@ typedef struct catctup
 	 */
 	dlist_node	cache_elem;		/* list member of per-bucket list */
 
+	/*
+	 * Each tuple is also a member of a backend-wide list, kept in order of
+	 * last access, which is used to prune cold entries once the caches grow
+	 * beyond catalog_cache_memory_limit.  lru_epoch records the transaction
+	 * (counted locally, see AtEOXact_CatCache) in which the entry was last
+	 * accessed, so that we never prune entries that the current transaction
+	 * has used.  Neither is maintained for hits while there is no limit.
+	 */
+	dlist_node	lru_elem;		/* list member of global LRU list */
+	uint32		lru_epoch;		/* transaction of last access */
+
 	/*
 	 * A tuple marked "dead" must not be returned by subsequent searches.
 	 * However, it won't be physically deleted from the cache until its
@@ -183,14 +201,23 @@ typedef struct catcacheheader
 {
 	slist_head	ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	Size		ch_memory;		/* memory used by entries of all caches */
+	dlist_head	ch_lru;			/* all tuples, most recently used first */
 } CatCacheHeader;
 
 
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
 
+/* GUC variables */
+extern PGDLLIMPORT int catalog_cache_memory_limit;
+extern PGDLLIMPORT int shared_catalog_cache_size;
+
 extern void CreateCacheMemoryContext(void);
 
+extern Size CatCacheShmemSize(void);
+extern void CatCacheShmemInit(void);
+
 extern CatCache *InitCatCache(int id, Oid reloid, Oid indexoid,
 							  int nkeys, const int *key,
 							  int nbuckets);
@@ -225,6 +252,12 @@ extern void PrepareToInvalidateCacheTuple(Relation relation,
 										  HeapTuple newtuple,
 										  void (*function) (int, uint32, Oid));
 
+extern void AtEOXact_CatCache(void);
+
+extern void SharedCatCacheInvalidate(int cacheId, Oid dbId, uint32 hashValue);
+extern void SharedCatCacheReset(void);
+extern void SharedCatCacheDropDatabase(Oid dbId);
+
 extern void PrintCatCacheLeakWarning(HeapTuple tuple);
 extern void PrintCatCacheListLeakWarning(CatCList *list);
 
@@ -282,6 +282,8 @@ extern int	tcp_user_timeout;
 #ifdef TRACE_SORT
 extern bool trace_sort;
 #endif
+extern bool optimize_specialized_sort;
+extern bool optimize_radix_sort;
 
 /*
  * Functions exported by guc.c
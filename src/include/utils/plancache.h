@@ -36,6 +36,7 @@ typedef enum
 
 /* GUC parameter */
 extern int	plan_cache_mode;
+extern PGDLLIMPORT int shared_plan_cache_size;
 
 #define CACHEDPLANSOURCE_MAGIC		195726186
 #define CACHEDPLAN_MAGIC			953717834
@@ -132,6 +133,8 @@ typedef struct CachedPlanSource
 	double		total_custom_cost;	/* total cost of custom plans so far */
 	int64		num_custom_plans;	/* # of custom plans included in total */
 	int64		num_generic_plans;	/* # of generic plans */
+	int64		num_shared_plans;	/* # of generic plans taken from the
+									 * shared plan cache */
 } CachedPlanSource;
 
 /*
@@ -188,6 +191,13 @@ typedef struct CachedExpression
 extern void InitPlanCache(void);
 extern void ResetPlanCache(void);
 
+extern Size PlanCacheShmemSize(void);
+extern void PlanCacheShmemInit(void);
+extern void SharedPlanCacheInvalidateRelation(Oid relid);
+extern void SharedPlanCacheInvalidateObject(int cacheId, uint32 hashValue);
+extern void SharedPlanCacheReset(void);
+extern void SharedPlanCacheDropDatabase(Oid dbId);
+
 extern CachedPlanSource *CreateCachedPlan(struct RawStmt *raw_parse_tree,
 										  const char *query_string,
 										  CommandTag commandTag);
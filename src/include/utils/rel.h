@@ -571,7 +571,26 @@ typedef struct ViewOptions
  *		True if relation's pages are stored in local buffers.
  */
 #define RelationUsesLocalBuffers(relation) \
-	((relation)->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+	((relation)->rd_rel->relpersistence == RELPERSISTENCE_TEMP || \
+	 (relation)->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+
+/*
+ * RelationIsGlobalTemp
+ *		True if relation is a global temporary relation, whose storage and
+ *		statistics are private to each session (see catalog/globaltemp.c).
+ */
+#define RelationIsGlobalTemp(relation) \
+	((relation)->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+
+/*
+ * RelationLacksSessionStorage
+ *		True if relation is a global temporary relation that this session has
+ *		not created its storage for yet.  Such a relation reads as empty.
+ */
+#define RelationLacksSessionStorage(relation) \
+	(RelationIsGlobalTemp(relation) && \
+	 !OidIsValid((relation)->rd_node.relNode) && \
+	 RELKIND_HAS_STORAGE((relation)->rd_rel->relkind))
 
 /*
  * RELATION_IS_LOCAL
@@ -124,6 +124,7 @@ extern void RelationCacheInvalidateEntry(Oid relationId);
 extern void RelationCacheInvalidate(void);
 
 extern void RelationCloseSmgrByOid(Oid relationId);
+extern void RelationCacheResetStorage(Oid relationId);
 
 #ifdef USE_ASSERT_CHECKING
 extern void AssertPendingSyncs_RelationCache(void);
@@ -134,6 +135,14 @@ extern void AtEOXact_RelationCache(bool isCommit);
 extern void AtEOSubXact_RelationCache(bool isCommit, SubTransactionId mySubid,
 									  SubTransactionId parentSubid);
 
+/*
+ * Routines for keeping the relcache within catalog_cache_memory_limit
+ */
+extern Size RelationCacheMemoryUsed(void);
+extern void RelationCachePrune(Size target);
+extern void RelationCacheGetStats(long *entries, Size *memory, uint64 *hits,
+								  uint64 *misses, uint64 *evictions);
+
 /*
  * Routines to help manage rebuilding of relcache init files
  */
@@ -0,0 +1,42 @@
+# Tests for LISTEN/NOTIFY with a notifying transaction that fails at commit
+#
+# A serializable transaction that fails the serialization check at commit
+# has already added its notifications to the queue by then.  Listeners must
+# skip them, and still receive the committed notifications queued before or
+# after them, without waiting for further NOTIFY traffic.
+
+setup
+{
+  CREATE TABLE notify_abort (i int PRIMARY KEY, t text);
+  INSERT INTO notify_abort VALUES (1, 'apple'), (2, 'pear');
+}
+
+teardown
+{
+  DROP TABLE notify_abort;
+}
+
+session "s1"
+setup		{ BEGIN ISOLATION LEVEL SERIALIZABLE; }
+step "rwx1"	{ UPDATE notify_abort SET t = 'apple' WHERE t = 'pear'; }
+step "c1"	{ COMMIT; }
+
+session "s2"
+setup		{ BEGIN ISOLATION LEVEL SERIALIZABLE; }
+step "rwx2"	{ UPDATE notify_abort SET t = 'pear' WHERE t = 'apple'; NOTIFY c1, 'aborted'; }
+step "c2"	{ COMMIT; }
+
+session "notifier"
+step "notify"	{ NOTIFY c1, 'committed'; }
+
+session "listener"
+step "llisten"	{ LISTEN c1; }
+step "lcheck"	{ SELECT 1 AS x; }
+teardown		{ UNLISTEN *; }
+
+# s2's notification is queued at commit, which then fails; the committed
+# notification is queued behind it.
+permutation "llisten" "rwx1" "rwx2" "c1" "c2" "notify" "lcheck"
+
+# Same, with the committed notification queued ahead of the aborted one.
+permutation "llisten" "rwx1" "rwx2" "notify" "c1" "c2" "lcheck"
@@ -0,0 +1,62 @@
+# Tests for global temporary tables
+#
+# The definition of a global temporary table is shared, but each session
+# sees only its own contents, and only gets storage for them once it reads
+# or writes the table.  DDL that can't cope with other sessions' contents is
+# refused while another session has storage for the table, and a session
+# that wants to start using the table waits for such DDL to finish.
+
+setup
+{
+  CREATE GLOBAL TEMPORARY TABLE gtt (a int PRIMARY KEY, b text);
+}
+
+teardown
+{
+  DROP TABLE IF EXISTS gtt;
+}
+
+session "s1"
+step "s1ins"		{ INSERT INTO gtt VALUES (1, 's1'); }
+step "s1sel"		{ SELECT * FROM gtt ORDER BY a; }
+step "s1begin"		{ BEGIN; }
+step "s1trunc"		{ TRUNCATE gtt; }
+step "s1commit"		{ COMMIT; }
+step "s1rollback"	{ ROLLBACK; }
+step "s1alter"		{ ALTER TABLE gtt ADD COLUMN c int; }
+step "s1discard"	{ DISCARD TEMP; }
+teardown			{ DISCARD TEMP; }
+
+session "s2"
+step "s2ins"		{ INSERT INTO gtt VALUES (1, 's2'), (2, 's2'); }
+step "s2sel"		{ SELECT * FROM gtt ORDER BY a; }
+step "s2size"		{ SELECT pg_relation_filenode('gtt') IS NULL AS no_storage, pg_relation_size('gtt') AS size; }
+step "s2begin"		{ BEGIN; }
+step "s2alter"		{ ALTER TABLE gtt ADD COLUMN c int; }
+step "s2index"		{ CREATE INDEX gtt_b_idx ON gtt (b); }
+step "s2drop"		{ DROP TABLE gtt; }
+step "s2commit"		{ COMMIT; }
+teardown			{ DISCARD TEMP; }
+
+# Each session sees only its own rows.
+permutation "s1ins" "s2ins" "s1sel" "s2sel"
+
+# TRUNCATE of one session's contents takes effect at commit, and leaves the
+# other session's contents alone.
+permutation "s1ins" "s2ins" "s1begin" "s1trunc" "s2sel" "s1rollback" "s1sel" "s1begin" "s1trunc" "s1commit" "s1sel" "s2sel"
+
+# Looking at the table's size doesn't give a session storage, so it doesn't
+# stand in the way of DDL.
+permutation "s1ins" "s2size" "s1alter" "s2sel"
+
+# DDL is refused while another session has contents, until it discards them.
+permutation "s1ins" "s2alter" "s2drop" "s1discard" "s2drop"
+
+# Rolling back a transaction must not let go of contents from before it, but
+# contents that were only created in it are gone.
+permutation "s1ins" "s1begin" "s1trunc" "s1rollback" "s2alter" "s1sel"
+permutation "s1begin" "s1ins" "s1rollback" "s2alter" "s1sel"
+
+# A session that starts using the table waits for DDL in progress, and then
+# gets storage for the new index too.
+permutation "s2begin" "s2index" "s1sel" "s2commit" "s1ins" "s1sel"
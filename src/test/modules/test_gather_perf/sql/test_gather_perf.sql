@@ -0,0 +1,18 @@
+CREATE EXTENSION test_gather_perf;
+
+CREATE TABLE gather_perf_tab AS
+  SELECT i, md5(i::text) AS t FROM generate_series(1, 10000) i;
+ANALYZE gather_perf_tab;
+
+-- Every run has to deliver every row, whatever the number of workers.
+SELECT workers, nrows, rows_per_sec > 0 AS ok
+  FROM test_gather_perf('gather_perf_tab', 2, 1);
+
+-- Tuples too large to be batched are sent on their own.
+CREATE VIEW gather_perf_wide AS
+  SELECT i, repeat(t, 300 + i % 10) AS t FROM gather_perf_tab WHERE i % 10 = 0;
+SELECT workers, nrows, rows_per_sec > 0 AS ok
+  FROM test_gather_perf('gather_perf_wide', 2, 1);
+
+DROP VIEW gather_perf_wide;
+DROP TABLE gather_perf_tab;
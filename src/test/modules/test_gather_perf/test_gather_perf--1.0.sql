@@ -0,0 +1,52 @@
+/* src/test/modules/test_gather_perf/test_gather_perf--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_gather_perf" to load this file. \quit
+
+-- Run "SELECT * FROM rel" under EXPLAIN ANALYZE with 0 to max_workers
+-- workers per Gather, and report how many rows per second arrived at the
+-- top of the plan.  The settings are restored when the function exits.
+CREATE FUNCTION test_gather_perf(rel regclass,
+    max_workers integer,
+    nloops integer DEFAULT 3,
+    OUT workers integer,
+    OUT workers_launched integer,
+    OUT nrows bigint,
+    OUT rows_per_sec float8)
+RETURNS SETOF record STRICT
+LANGUAGE plpgsql
+SET parallel_setup_cost = 0
+SET parallel_tuple_cost = 0
+SET min_parallel_table_scan_size = 0
+SET max_parallel_workers_per_gather = 0
+AS $$
+DECLARE
+    plan json;
+    total_ms float8;
+    i integer;
+BEGIN
+    IF max_workers < 0 OR nloops < 1 THEN
+        RAISE EXCEPTION 'invalid arguments';
+    END IF;
+
+    FOR w IN 0..max_workers LOOP
+        PERFORM set_config('max_parallel_workers_per_gather', w::text, true);
+        workers := w;
+        workers_launched := 0;
+        total_ms := 0;
+
+        FOR i IN 1..nloops LOOP
+            EXECUTE format('EXPLAIN (ANALYZE, TIMING OFF, FORMAT JSON) SELECT * FROM %s',
+                           rel)
+                INTO plan;
+            total_ms := total_ms + (plan->0->>'Execution Time')::float8;
+            nrows := (plan->0->'Plan'->>'Actual Rows')::float8::bigint;
+            workers_launched := greatest(workers_launched,
+                coalesce((plan->0->'Plan'->>'Workers Launched')::integer, 0));
+        END LOOP;
+
+        rows_per_sec := nrows * nloops / (greatest(total_ms, 0.001) / 1000.0);
+        RETURN NEXT;
+    END LOOP;
+END
+$$;
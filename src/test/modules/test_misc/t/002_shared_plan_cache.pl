@@ -0,0 +1,95 @@
+# Verify that generic plans are shared between sessions through the shared
+# plan cache, but only where that's safe
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 9;
+
+# Initialize a test cluster with the shared plan cache enabled
+my $node = get_new_node('primary');
+$node->init();
+$node->append_conf('postgresql.conf', 'shared_plan_cache_size = 1MB');
+$node->start;
+
+# Prepare and execute a statement with a generic plan in a new session.
+# Returns the statement's result, followed by the number of generic plans
+# that the session took from the shared plan cache.
+sub run_prepared
+{
+	my ($setup, $prepare, $execute) = @_;
+
+	return $node->safe_psql(
+		'postgres', qq[
+		$setup
+		SET plan_cache_mode = force_generic_plan;
+		PREPARE q $prepare;
+		EXECUTE q$execute;
+		SELECT shared_plans FROM pg_prepared_statements WHERE name = 'q';
+	]);
+}
+
+$node->safe_psql(
+	'postgres', q[
+	CREATE TABLE spc_tab (a int, b int);
+	INSERT INTO spc_tab SELECT i, i % 10 FROM generate_series(1, 1000) i;
+	CREATE SCHEMA spc_other;
+	CREATE TABLE spc_other.spc_tab (a int, b int);
+	INSERT INTO spc_other.spc_tab SELECT i, 0 FROM generate_series(1, 10) i;
+]);
+
+my $prepare = '(int) AS SELECT count(*) FROM spc_tab WHERE b = $1';
+
+note "test reuse of generic plans";
+
+is(run_prepared('', $prepare, '(1)'),
+	"100\n0", 'first session plans the statement itself');
+is(run_prepared('', $prepare, '(1)'),
+	"100\n1", 'second session adopts the shared plan');
+
+note "test plans that depend on the search path";
+
+is(run_prepared('SET search_path = spc_other, public;', $prepare, '(0)'),
+	"10\n0", 'plan for another search path is not shared');
+is(run_prepared('', $prepare, '(0)'),
+	"100\n1", 'plan for the default search path is still shared');
+
+note "test invalidation by DDL in another session";
+
+$node->safe_psql(
+	'postgres', q[
+	DROP TABLE spc_tab;
+	CREATE TABLE spc_tab (b int, a int);
+	INSERT INTO spc_tab SELECT i % 5, i FROM generate_series(1, 1000) i;
+]);
+
+is(run_prepared('', $prepare, '(1)'),
+	"200\n0", 'plan is not adopted after its table was replaced');
+is(run_prepared('', $prepare, '(1)'),
+	"200\n1", 'replanned statement is shared again');
+
+note "test plans that depend on row level security";
+
+$node->safe_psql(
+	'postgres', q[
+	CREATE ROLE spc_alice;
+	CREATE ROLE spc_bob;
+	CREATE TABLE spc_rls (v int);
+	INSERT INTO spc_rls VALUES (1), (2), (10);
+	ALTER TABLE spc_rls ENABLE ROW LEVEL SECURITY;
+	CREATE POLICY spc_alice_pol ON spc_rls TO spc_alice USING (v < 10);
+	CREATE POLICY spc_bob_pol ON spc_rls TO spc_bob USING (v >= 10);
+	GRANT SELECT ON spc_rls TO spc_alice, spc_bob;
+]);
+
+my $prepare_rls = 'AS SELECT sum(v) FROM spc_rls';
+
+is(run_prepared('SET ROLE spc_alice;', $prepare_rls, ''),
+	"3\n0", 'first session plans the RLS statement itself');
+is(run_prepared('SET ROLE spc_alice;', $prepare_rls, ''),
+	"3\n1", 'session of the same role adopts the RLS plan');
+is(run_prepared('SET ROLE spc_bob;', $prepare_rls, ''),
+	"10\n0", 'session of another role does not adopt the RLS plan');
+
+$node->stop('fast');
@@ -0,0 +1,27 @@
+CREATE EXTENSION test_sort_perf;
+
+-- Each call checks that the sort output is correctly ordered.  10000 values
+-- is enough to use radix sort, when enabled.
+SET optimize_specialized_sort = off;
+SELECT t, test_sort_perf(t, 10000) >= 0 AS ascending,
+       test_sort_perf(t, 10000, 1, true) >= 0 AS descending
+  FROM unnest('{int4,int8,date,timestamp,timestamptz,uuid,text}'::regtype[]) t;
+
+SET optimize_specialized_sort = on;
+SET optimize_radix_sort = off;
+SELECT t, test_sort_perf(t, 10000) >= 0 AS ascending,
+       test_sort_perf(t, 10000, 1, true) >= 0 AS descending
+  FROM unnest('{int4,int8,date,timestamp,timestamptz,uuid,text}'::regtype[]) t;
+
+SET optimize_radix_sort = on;
+SELECT t, test_sort_perf(t, 10000) >= 0 AS ascending,
+       test_sort_perf(t, 10000, 1, true) >= 0 AS descending
+  FROM unnest('{int4,int8,date,timestamp,timestamptz,uuid,text}'::regtype[]) t;
+
+-- Small inputs, below the radix sort threshold
+SELECT t, test_sort_perf(t, 100, 10) >= 0 AS ascending,
+       test_sort_perf(t, 100, 10, true) >= 0 AS descending
+  FROM unnest('{int4,int8,date,timestamp,timestamptz,uuid,text}'::regtype[]) t;
+
+RESET optimize_specialized_sort;
+RESET optimize_radix_sort;
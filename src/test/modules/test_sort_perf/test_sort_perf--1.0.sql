@@ -0,0 +1,11 @@
+/* src/test/modules/test_sort_perf/test_sort_perf--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_sort_perf" to load this file. \quit
+
+CREATE FUNCTION test_sort_perf(datatype regtype,
+    ntuples integer,
+    nloops integer DEFAULT 1,
+    descending boolean DEFAULT false)
+RETURNS pg_catalog.float8 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -0,0 +1,198 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_sort_perf.c
+ *		Test and benchmark in-memory sorting of common datatypes.
+ *
+ * Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_sort_perf/test_sort_perf.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/sortsupport.h"
+#include "utils/timestamp.h"
+#include "utils/tuplesort.h"
+#include "utils/typcache.h"
+#include "utils/uuid.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_sort_perf);
+
+/* One in this many generated values is NULL */
+#define NULL_FREQUENCY		100
+
+static uint64
+random_uint64(void)
+{
+	return ((uint64) random() << 62) ^ ((uint64) random() << 31) ^
+		(uint64) random();
+}
+
+/*
+ * Generate a random value of the given type.  Values are drawn from a range
+ * that produces some duplicates for the narrower types.
+ */
+static Datum
+generate_datum(Oid typid)
+{
+	switch (typid)
+	{
+		case INT4OID:
+			return Int32GetDatum((int32) random_uint64());
+		case INT8OID:
+			return Int64GetDatum((int64) random_uint64());
+		case DATEOID:
+			return DateADTGetDatum((DateADT) (random() % 100000));
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			/* about a century around the epoch, in microseconds */
+			return TimestampGetDatum((Timestamp) (random_uint64() %
+												  (INT64CONST(3155760000) * USECS_PER_SEC)) -
+									 INT64CONST(1577880000) * USECS_PER_SEC);
+		case UUIDOID:
+			{
+				pg_uuid_t  *uuid = palloc(sizeof(pg_uuid_t));
+				uint64		hi = random_uint64();
+				uint64		lo = random_uint64();
+
+				memcpy(uuid->data, &hi, sizeof(hi));
+				memcpy(uuid->data + sizeof(hi), &lo, sizeof(lo));
+				return UUIDPGetDatum(uuid);
+			}
+		case TEXTOID:
+			{
+				char		buf[32];
+
+				snprintf(buf, sizeof(buf), "%016" INT64_MODIFIER "x",
+						 random_uint64());
+				return PointerGetDatum(cstring_to_text(buf));
+			}
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("type %s is not supported", format_type_be(typid))));
+	}
+
+	return (Datum) 0;			/* keep compiler quiet */
+}
+
+/*
+ * SQL-callable entry point.
+ *
+ * Sorts 'ntuples' random values of the given type with a Datum tuplesort,
+ * 'nloops' times, and returns the average time taken in milliseconds.  The
+ * output of every sort is checked against the type's authoritative
+ * comparator.
+ */
+Datum
+test_sort_perf(PG_FUNCTION_ARGS)
+{
+	Oid			typid = PG_GETARG_OID(0);
+	int32		ntuples = PG_GETARG_INT32(1);
+	int32		nloops = PG_GETARG_INT32(2);
+	bool		descending = PG_GETARG_BOOL(3);
+	TypeCacheEntry *typentry;
+	Oid			sortop;
+	Oid			collation = get_typcollation(typid);
+	SortSupportData ssup;
+	Datum	   *values;
+	bool	   *isnull;
+	MemoryContext sortcxt;
+	MemoryContext oldcxt;
+	double		total_ms = 0;
+	int			i;
+	int			loop;
+
+	if (ntuples < 0 || nloops < 1)
+		elog(ERROR, "invalid arguments");
+
+	typentry = lookup_type_cache(typid, TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
+	sortop = descending ? typentry->gt_opr : typentry->lt_opr;
+	if (!OidIsValid(sortop))
+		elog(ERROR, "could not find ordering operator for type %s",
+			 format_type_be(typid));
+
+	/* The authoritative comparator, for checking the results */
+	memset(&ssup, 0, sizeof(ssup));
+	ssup.ssup_cxt = CurrentMemoryContext;
+	ssup.ssup_collation = collation;
+	ssup.ssup_nulls_first = descending;
+	ssup.abbreviate = false;
+	PrepareSortSupportFromOrderingOp(sortop, &ssup);
+
+	values = palloc(sizeof(Datum) * ntuples);
+	isnull = palloc(sizeof(bool) * ntuples);
+	for (i = 0; i < ntuples; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		isnull[i] = (random() % NULL_FREQUENCY == 0);
+		values[i] = isnull[i] ? (Datum) 0 : generate_datum(typid);
+	}
+
+	sortcxt = AllocSetContextCreate(CurrentMemoryContext,
+									"test_sort_perf",
+									ALLOCSET_DEFAULT_SIZES);
+
+	for (loop = 0; loop < nloops; loop++)
+	{
+		Tuplesortstate *state;
+		instr_time	start_time;
+		instr_time	end_time;
+		Datum		prev = (Datum) 0;
+		bool		prevnull = false;
+		Datum		val;
+		bool		valnull;
+		int			nread = 0;
+
+		oldcxt = MemoryContextSwitchTo(sortcxt);
+
+		/* Use plenty of memory, as we only want to measure in-memory sorts */
+		state = tuplesort_begin_datum(typid, sortop, collation, descending,
+									  MAX_KILOBYTES, NULL, false);
+
+		INSTR_TIME_SET_CURRENT(start_time);
+		for (i = 0; i < ntuples; i++)
+			tuplesort_putdatum(state, values[i], isnull[i]);
+		tuplesort_performsort(state);
+		INSTR_TIME_SET_CURRENT(end_time);
+		INSTR_TIME_SUBTRACT(end_time, start_time);
+		total_ms += INSTR_TIME_GET_MILLISEC(end_time);
+
+		while (tuplesort_getdatum(state, true, &val, &valnull, NULL))
+		{
+			if (nread > 0 &&
+				ApplySortComparator(prev, prevnull, val, valnull, &ssup) > 0)
+				elog(ERROR, "sort output is out of order at position %d",
+					 nread);
+			prev = val;
+			prevnull = valnull;
+			nread++;
+		}
+		if (nread != ntuples)
+			elog(ERROR, "sort returned %d values, expected %d",
+				 nread, ntuples);
+
+		tuplesort_end(state);
+
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextReset(sortcxt);
+	}
+
+	MemoryContextDelete(sortcxt);
+
+	PG_RETURN_FLOAT8(total_ms / nloops);
+}
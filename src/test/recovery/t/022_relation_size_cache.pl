@@ -0,0 +1,158 @@
+# Test that the shared relation size cache stays exact when relations are
+# extended, truncated and rewritten, on the primary and during replay on a
+# standby.  The cache is made tiny so that entries are evicted all the time.
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 8;
+
+my $ntables = 20;
+
+my $node_primary = get_new_node('primary');
+$node_primary->init(allows_streaming => 1);
+$node_primary->append_conf(
+	'postgresql.conf', qq{
+relation_size_cache_entries = 8
+autovacuum = off
+});
+$node_primary->start;
+
+$node_primary->backup('primary_backup');
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_primary, 'primary_backup',
+	has_streaming => 1);
+$node_standby->append_conf('postgresql.conf',
+	'relation_size_cache_entries = 8');
+$node_standby->start;
+
+# Returns the row count of every test table, read with sequential scans.  A
+# stale cached size makes a scan miss rows or fail to read a block.
+$node_primary->safe_psql(
+	'postgres', q{
+create function rsc_counts() returns text language plpgsql as $$
+declare
+  r record;
+  n bigint;
+  result text := '';
+begin
+  for r in select relname from pg_class
+    where relname like 'rsc\_%' and relkind = 'r' order by relname
+  loop
+    execute format('select count(*) from %I', r.relname) into n;
+    result := result || r.relname || '=' || n || ' ';
+  end loop;
+  return result;
+end
+$$;
+});
+
+# Expected output of rsc_counts(), given the row count of each table
+sub expected_counts
+{
+	my ($count) = @_;
+
+	return join('',
+		map { "rsc_$_=" . $count->($_) . ' ' }
+		  sort { "rsc_$a" cmp "rsc_$b" } 1 .. $ntables);
+}
+
+# Checks on the primary that ANALYZE, which asks smgr for the number of
+# blocks, agrees with the actual size of the files
+my $relpages_query = q{
+analyze;
+select count(*) from pg_class
+  where relname like 'rsc\_%' and relkind = 'r'
+    and relpages <> pg_relation_size(oid) / current_setting('block_size')::int;
+};
+
+sub standby_caught_up
+{
+	$node_primary->wait_for_catchup($node_standby, 'replay',
+		$node_primary->lsn('insert'));
+}
+
+# More tables than cache entries, so sizes are evicted and looked up again
+for my $i (1 .. $ntables)
+{
+	$node_primary->safe_psql('postgres',
+		    "create table rsc_$i (a int, b char(100));"
+		  . "insert into rsc_$i select g, 'x' from generate_series(1, "
+		  . $i * 20
+		  . ") g;");
+}
+standby_caught_up();
+
+is($node_standby->safe_psql('postgres', 'select rsc_counts()'),
+	expected_counts(sub { $_[0] * 20 }),
+	'standby sees all rows after creation');
+
+note "test extension";
+
+for my $i (1 .. $ntables)
+{
+	$node_primary->safe_psql('postgres',
+		"insert into rsc_$i select g, 'y' from generate_series(1, 500) g;");
+}
+is($node_primary->safe_psql('postgres', 'select rsc_counts()'),
+	expected_counts(sub { $_[0] * 20 + 500 }),
+	'primary sees all rows after extension');
+is($node_primary->safe_psql('postgres', $relpages_query),
+	'0', 'cached sizes match file sizes after extension');
+standby_caught_up();
+is($node_standby->safe_psql('postgres', 'select rsc_counts()'),
+	expected_counts(sub { $_[0] * 20 + 500 }),
+	'standby sees all rows after extension');
+
+note "test truncation";
+
+# Every even-numbered table shrinks by VACUUM truncation, every fifth is
+# truncated outright, and one is rewritten into a new relfilenode.
+for my $i (1 .. $ntables)
+{
+	$node_primary->safe_psql('postgres',
+		"delete from rsc_$i where a > 10; vacuum rsc_$i;")
+	  if $i % 2 == 0;
+	$node_primary->safe_psql('postgres', "truncate rsc_$i;")
+	  if $i % 5 == 0;
+}
+$node_primary->safe_psql('postgres', 'vacuum full rsc_7;');
+
+my $count_after_truncation = sub {
+	my ($i) = @_;
+
+	return 0 if $i % 5 == 0;
+	return 20 if $i % 2 == 0;
+	return $i * 20 + 500;
+};
+
+is($node_primary->safe_psql('postgres', 'select rsc_counts()'),
+	expected_counts($count_after_truncation),
+	'primary sees all rows after truncation');
+is($node_primary->safe_psql('postgres', $relpages_query),
+	'0', 'cached sizes match file sizes after truncation');
+standby_caught_up();
+is($node_standby->safe_psql('postgres', 'select rsc_counts()'),
+	expected_counts($count_after_truncation),
+	'standby sees all rows after truncation');
+
+note "test extension after promotion";
+
+# The promoted standby extends the tables using the sizes it cached during
+# replay; a stale one would fail or overwrite data.
+$node_standby->promote;
+$node_standby->poll_query_until('postgres',
+	'select not pg_is_in_recovery()')
+  or die "Timed out while waiting for promotion";
+for my $i (1 .. $ntables)
+{
+	$node_standby->safe_psql('postgres',
+		"insert into rsc_$i select g, 'z' from generate_series(1, 100) g;");
+}
+is($node_standby->safe_psql('postgres', 'select rsc_counts()'),
+	expected_counts(sub { $count_after_truncation->($_[0]) + 100 }),
+	'promoted standby sees all rows after extension');
+
+$node_standby->stop;
+$node_primary->stop;
@@ -148,6 +148,24 @@ group by ten order by ten;
 select ten, count(four), sum(DISTINCT four) from onek
 group by ten order by ten;
 
+-- if all the aggregates are DISTINCT over the same arguments, duplicates are
+-- eliminated by grouping on the aggregate arguments first
+explain (costs off)
+select ten, count(DISTINCT four), sum(DISTINCT four) from onek
+group by ten;
+select ten, count(DISTINCT four), sum(DISTINCT four) from onek
+group by ten order by ten;
+select count(DISTINCT x), sum(DISTINCT x)
+  from (values (1), (1), (null), (2)) v(x);
+select count(DISTINCT x) from (values (1)) v(x) where false;
+
+-- approximate distinct counts
+select approx_count_distinct(four) from onek;
+select approx_count_distinct(unique1) from tenk1;
+select ten, approx_count_distinct(four) from onek
+group by ten order by ten;
+select approx_count_distinct(x) from (values (null::int)) v(x);
+
 -- user-defined aggregates
 SELECT newavg(four) AS avg_1 FROM onek;
 SELECT newsum(four) AS sum_1500 FROM onek;
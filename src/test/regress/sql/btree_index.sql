@@ -170,5 +170,120 @@ VACUUM delete_test_table;
 -- need to insert some rows to cause the fast root page to split.
 INSERT INTO delete_test_table SELECT i, 1, 2, 3 FROM generate_series(1,1000) i;
 
+--
+-- Test B-tree skip scan, with no qual on the leading index column
+--
+create temp table btree_skip_tbl (a int, b int);
+insert into btree_skip_tbl select i % 4, i from generate_series(1, 40) i;
+insert into btree_skip_tbl values (null, 7), (null, 50);
+create index btree_skip_idx on btree_skip_tbl (a, b);
+vacuum analyze btree_skip_tbl;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+select a, b from btree_skip_tbl where b in (7, 8, 9) order by a, b;
+select a, b from btree_skip_tbl where b between 5 and 9 order by a desc, b desc;
+set enable_bitmapscan = on;
+set enable_indexscan = off;
+select count(*) from btree_skip_tbl where b >= 38;
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset enable_indexscan;
+
+--
+-- Skip scan over an index with many leaf pages.  The index is built before
+-- the rows are inserted, in scattered order, so that page splits put some
+-- prefix boundaries at page boundaries.
+--
+create temp table btree_skip_big (a int, b int);
+create index btree_skip_big_idx on btree_skip_big (a, b);
+insert into btree_skip_big
+  select a, b from generate_series(0, 49) a, generate_series(1, 400) b
+  order by (b * 7919) % 400, (a * 31) % 50;
+insert into btree_skip_big
+  select null, b from generate_series(1, 400) b order by (b * 7919) % 400;
+vacuum analyze btree_skip_big;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+explain (costs off)
+select a from btree_skip_big where b = 200 order by a;
+select count(*), count(a), sum(a) from btree_skip_big where b = 200;
+select array_agg(a) filter (where a % 10 = 0 or a is null)
+  from (select a from btree_skip_big where b = 200 order by a) s;
+explain (costs off)
+select a from btree_skip_big where b = 200 order by a desc;
+select array_agg(a) filter (where a % 10 = 0 or a is null)
+  from (select a from btree_skip_big where b = 200 order by a desc) s;
+select count(*), sum(b) from btree_skip_big where b between 100 and 350;
+select a, b from btree_skip_big where b between 399 and 400
+  order by a desc, b desc limit 6;
+-- Merge join restores the marked skip key values
+set enable_hashjoin = off;
+set enable_nestloop = off;
+set enable_material = off;
+select v.x, count(*) from (values (0), (0), (25), (25), (49)) v(x)
+  join btree_skip_big s on s.a = v.x
+  where s.b between 10 and 12
+  group by v.x order by v.x;
+--
+-- A skip scan whose prefixes are nearly unique gives up skipping, and reads
+-- the rest of the index in order
+--
+create temp table btree_skip_dense (a int, b int, c int);
+create index btree_skip_dense_idx on btree_skip_dense (a, b, c);
+insert into btree_skip_dense select i / 3, i, i % 10 from generate_series(1, 10000) i;
+insert into btree_skip_dense values (null, 0, 7), (null, 1, 7);
+vacuum analyze btree_skip_dense;
+explain (costs off)
+select count(*), sum(b) from btree_skip_dense where c = 7;
+select count(*), sum(b) from btree_skip_dense where c = 7;
+select a, b from btree_skip_dense where c = 7 order by a, b limit 3;
+select a, b from btree_skip_dense where c = 7 order by a desc, b desc limit 4;
+select count(*) from btree_skip_dense where b between 5000 and 5100;
+select count(*) from (values (10), (10), (2000), (2000)) v(x)
+  join btree_skip_dense s on s.a = v.x
+  where s.c = 1;
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset enable_hashjoin;
+reset enable_nestloop;
+reset enable_material;
+
+--
+-- Binary searches in an index whose tuples share long key prefixes, which
+-- only compare the attributes that aren't known to be equal
+--
+create temp table btree_prefix_tbl (org int, project int, path text collate "C");
+create unique index btree_prefix_idx on btree_prefix_tbl (org, project, path);
+insert into btree_prefix_tbl
+  select o, p, 'root/dir' || (i % 7) || '/file' || i
+  from generate_series(1, 3) o, generate_series(1, 4) p,
+       generate_series(1, 500) i
+  order by i, p, o;
+insert into btree_prefix_tbl values (2, 3, 'root/dir3/file3');
+insert into btree_prefix_tbl values (2, 3, 'root/dir3/file3x');
+vacuum analyze btree_prefix_tbl;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+select count(*) from btree_prefix_tbl
+  where org = 2 and project = 3 and path = 'root/dir3/file3';
+select count(*) from btree_prefix_tbl
+  where org = 2 and project = 3 and path >= 'root/dir3/file3';
+select count(*) from btree_prefix_tbl
+  where org = 2 and project = 3 and path > 'root/dir6';
+select count(*) from btree_prefix_tbl
+  where org = 2 and project >= 3 and path < 'root/dir1';
+select path from btree_prefix_tbl
+  where org = 3 and project = 4 and path < 'root/dir2/file2'
+  order by path desc limit 3;
+create index btree_prefix_desc_idx on btree_prefix_tbl (org desc, project, path desc);
+drop index btree_prefix_idx;
+select path from btree_prefix_tbl
+  where org = 1 and project = 2 and path > 'root/dir5/file495'
+  order by path limit 3;
+select count(*) from btree_prefix_tbl
+  where org = 1 and project = 2 and path <= 'root/dir0/file497';
+reset enable_seqscan;
+reset enable_bitmapscan;
+
 -- Test unsupported btree opclass parameters
 create index on btree_tall_tbl (id int4_ops(foo=1));
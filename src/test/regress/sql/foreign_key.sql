@@ -1754,3 +1754,47 @@ UPDATE fkpart10.tbl1 SET f1 = 2 WHERE f1 = 1;
 INSERT INTO fkpart10.tbl1 VALUES (0), (1);
 COMMIT;
 DROP SCHEMA fkpart10 CASCADE;
+
+-- FK checks against plain tables are queued and done in batches.  Test more
+-- keys than fit in one batch, FK columns in a different order than the PK
+-- index's, and FK types that need a cast.
+CREATE TABLE fkbatch_pk (a text, b numeric, PRIMARY KEY (a, b));
+CREATE TABLE fkbatch_fk (x int4, y varchar,
+  FOREIGN KEY (x, y) REFERENCES fkbatch_pk (b, a));
+INSERT INTO fkbatch_pk SELECT 'k' || i, i FROM generate_series(0, 9) i;
+INSERT INTO fkbatch_fk SELECT i % 10, 'k' || i % 10 FROM generate_series(1, 3000) i;
+SELECT count(*) FROM fkbatch_fk;
+INSERT INTO fkbatch_fk
+  SELECT i % 10, 'k' || (i % 10 + (i = 2500)::int) FROM generate_series(1, 3000) i;
+UPDATE fkbatch_fk SET x = 7 WHERE x = 3;
+-- the checks must be done before any other trigger fires
+CREATE FUNCTION fkbatch_notice() RETURNS trigger LANGUAGE plpgsql AS
+$$ BEGIN RAISE NOTICE 'fkbatch_notice: %', NEW.x; RETURN NULL; END $$;
+CREATE TRIGGER fkbatch_notice AFTER INSERT ON fkbatch_fk
+  FOR EACH ROW EXECUTE FUNCTION fkbatch_notice();
+INSERT INTO fkbatch_fk VALUES (1, 'k1'), (5, 'k4'), (2, 'k2');
+DROP TABLE fkbatch_fk, fkbatch_pk;
+DROP FUNCTION fkbatch_notice();
+
+-- Queued trigger events are spilled to disk if there are many of them
+SET trigger_queue_work_mem = '64kB';
+CREATE TABLE fkspill_pk (a int PRIMARY KEY);
+CREATE TABLE fkspill_fk (x int REFERENCES fkspill_pk DEFERRABLE);
+INSERT INTO fkspill_pk SELECT generate_series(1, 1000);
+INSERT INTO fkspill_fk SELECT i % 1000 + 1 FROM generate_series(1, 30000) i;
+UPDATE fkspill_fk SET x = x % 1000 + 1;
+INSERT INTO fkspill_fk
+  SELECT CASE WHEN i = 20000 THEN 0 ELSE i % 1000 + 1 END
+  FROM generate_series(1, 30000) i;
+-- deferred checks, some of them discarded by subtransaction abort
+BEGIN;
+SET CONSTRAINTS ALL DEFERRED;
+INSERT INTO fkspill_fk SELECT i % 1000 + 1 FROM generate_series(1, 30000) i;
+SAVEPOINT s;
+INSERT INTO fkspill_fk SELECT 0 FROM generate_series(1, 30000);
+ROLLBACK TO s;
+INSERT INTO fkspill_fk SELECT i % 1000 + 1 FROM generate_series(1, 30000) i;
+COMMIT;
+SELECT count(*) FROM fkspill_fk;
+DROP TABLE fkspill_fk, fkspill_pk;
+RESET trigger_queue_work_mem;
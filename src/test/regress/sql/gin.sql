@@ -171,3 +171,25 @@ reset enable_seqscan;
 reset enable_bitmapscan;
 
 drop table t_gin_test_tbl;
+
+-- Test parallel index build.  Whether workers actually get launched doesn't
+-- matter, the index must come out the same either way.
+create table gin_par_tbl (i int[]) with (parallel_workers = 2);
+insert into gin_par_tbl select array[g % 10, g % 7, g] from generate_series(1, 20000) g;
+insert into gin_par_tbl values (null), ('{}');
+set max_parallel_maintenance_workers = 2;
+create index gin_par_idx on gin_par_tbl using gin (i);
+reset max_parallel_maintenance_workers;
+
+set enable_seqscan = off;
+set enable_bitmapscan = on;
+
+select count(*) from gin_par_tbl where i @> array[3];
+select count(*) from gin_par_tbl where i @> array[5, 6];
+select count(*) from gin_par_tbl where i @> array[12345];
+select count(*) from gin_par_tbl where i @> '{}'::int[];
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+
+drop table gin_par_tbl;
@@ -148,3 +148,22 @@ reset enable_bitmapscan;
 reset enable_indexonlyscan;
 
 drop table gist_tbl;
+
+-- Test parallel sorted index build
+create table gist_par_tbl (p point) with (parallel_workers = 2);
+insert into gist_par_tbl select point(g % 100, g / 100) from generate_series(1, 20000) g;
+set max_parallel_maintenance_workers = 2;
+create index gist_par_idx on gist_par_tbl using gist (p);
+reset max_parallel_maintenance_workers;
+
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+set enable_indexonlyscan = on;
+
+select count(*) from gist_par_tbl where p <@ box(point(10, 30), point(20, 40));
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset enable_indexonlyscan;
+
+drop table gist_par_tbl;
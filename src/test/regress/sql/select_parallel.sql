@@ -382,11 +382,42 @@ select count(*) from tenk1;
 reset force_parallel_mode;
 reset role;
 
--- Window function calculation can't be pushed to workers.
+-- Window function calculation can't be pushed to workers without a
+-- PARTITION BY clause.
 explain (costs off, verbose)
   select count(*) from tenk1 a where (unique1, two) in
     (select unique1, row_number() over() from tenk1 b);
 
+-- With one, the rows can be redistributed among the workers by the
+-- partitioning key, so that each worker sees complete partitions.
+explain (costs off)
+  select four, ten, count(*) over (partition by four order by ten) from tenk1;
+select sum(c), count(*) from
+  (select count(*) over (partition by four order by ten) c from tenk1) ss;
+
+-- Hashed aggregation can use the same redistribution, so that each worker
+-- aggregates and finalizes its own groups.
+explain (costs off)
+  select fivethous, count(*) from tenk1 group by fivethous;
+select count(*), sum(c) from
+  (select fivethous, count(*) c from tenk1 group by fivethous
+   having count(*) = 2) ss;
+-- Each worker spills its own groups if they don't fit in work_mem.
+set work_mem = '64kB';
+select count(*), sum(c) from
+  (select fivethous, count(*) c from tenk1 group by fivethous
+   having count(*) = 2) ss;
+reset work_mem;
+
+-- DISTINCT aggregates are computed over a grouping subquery, which can be
+-- parallelized too.
+select count(distinct fivethous) from tenk1;
+
+-- Approximate distinct counts can be combined across workers.
+explain (costs off)
+  select approx_count_distinct(fivethous) from tenk1;
+select approx_count_distinct(fivethous) from tenk1;
+
 
 -- LIMIT/OFFSET within sub-selects can't be pushed to workers.
 explain (costs off)
@@ -12,6 +12,56 @@ select count(*) >= 0 as ok from pg_available_extension_versions;
 
 select count(*) >= 0 as ok from pg_available_extensions;
 
+-- The relcache is always there, and pg_class must have been looked up
+select name, cache_id is null as is_relcache, entries > 0 as ok
+  from pg_backend_catalog_caches where name in ('relcache', 'pg_class')
+  order by cache_id nulls first limit 2;
+
+-- temp_buffers can be raised after temporary tables have been used, and a
+-- scan of a temporary table larger than a quarter of the pool then recycles
+-- a ring of at most 1/8th of the pool rather than taking over the pool
+set temp_buffers = 100;
+create temp table localbuf_tbl (a int, b text);
+insert into localbuf_tbl select g, repeat('x', 500) from generate_series(1, 4000) g;
+-- evicting the table's pages while filling it writes them out in runs
+select writes_coalesced > writes / 2 as coalesced
+  from pg_backend_local_buffers;
+select buffers_allocated as allocated_before, ring_reuses as reuses_before
+  from pg_backend_local_buffers \gset
+set temp_buffers = 400;
+select buffers from pg_backend_local_buffers;
+select count(*) from localbuf_tbl;
+select buffers_allocated <= :allocated_before + buffers / 8 as bounded,
+       ring_reuses > :reuses_before as ring_used
+  from pg_backend_local_buffers;
+-- but it can't be lowered again
+set temp_buffers = 200;
+drop table localbuf_tbl;
+
+-- Under a small catalog_cache_memory_limit, entries left over from earlier
+-- transactions get evicted, while those in use must survive
+create temp table catcache_tbl as select g as a from generate_series(1, 6) g;
+set catalog_cache_memory_limit = '64kB';
+select sum(evictions) as evictions_before from pg_backend_catalog_caches \gset
+select count(oid::regprocedure::text) > 0 as ok from pg_proc;
+select count(oid::regclass::text) > 0 as ok from pg_class;
+begin;
+declare catcache_cur cursor for select a from catcache_tbl order by a;
+fetch 2 from catcache_cur;
+select count(oid::regprocedure::text) > 0 as ok from pg_proc;
+fetch 2 from catcache_cur;
+select count(oid::regclass::text) > 0 as ok from pg_class;
+fetch 2 from catcache_cur;
+commit;
+select sum(evictions) > :evictions_before as evicted
+  from pg_backend_catalog_caches;
+reset catalog_cache_memory_limit;
+drop table catcache_tbl;
+
+-- Nothing can be pinned between queries
+select buffers >= buffers_allocated and buffers_pinned = 0 as ok
+  from pg_backend_local_buffers;
+
 -- The entire output of pg_backend_memory_contexts is not stable,
 -- we test only the existance and basic condition of TopMemoryContext.
 select name, ident, parent, level, total_bytes >= free_bytes
@@ -40,6 +90,10 @@ select count(*) >= 0 as ok from pg_prepared_xacts;
 -- There must be only one record
 select count(*) = 1 as ok from pg_stat_wal;
 
+-- Our own backend must be there, and not in reset state
+select count(*) = 1 as ok from pg_stat_invalidation
+  where pid = pg_backend_pid() and queue_lag >= 0;
+
 -- We expect no walreceiver running in this test
 select count(*) = 0 as ok from pg_stat_wal_receiver;
 
@@ -240,6 +240,42 @@ select * from temp_inh_oncommit_test;
 select relname from pg_class where relname ~ '^temp_inh_oncommit_test';
 drop table temp_inh_oncommit_test;
 
+-- Global temporary tables: the definition is permanent, the contents are
+-- private to each session.
+create global temp table gtt_test (a int primary key, b text);
+insert into gtt_test select i, 'x' || i from generate_series(1, 3) i;
+select * from gtt_test order by a;
+select relpersistence, relnamespace = 'public'::regnamespace as in_public
+  from pg_class where relname = 'gtt_test';
+-- Changes of the session's storage are transactional.
+begin;
+truncate gtt_test;
+insert into gtt_test values (10, 'y');
+rollback;
+select * from gtt_test order by a;
+-- Statistics are kept by the session, not in the catalogs.
+insert into gtt_test select i, 'x' || i from generate_series(4, 100) i;
+analyze gtt_test;
+select reltuples from pg_class where relname = 'gtt_test';
+select count(*) from pg_statistic where starelid = 'gtt_test'::regclass;
+-- DISCARD TEMP removes the session's contents, not the table.
+discard temp;
+-- Storage is only created once the table is scanned or inserted into.
+select pg_relation_filenode('gtt_test') is null as no_storage,
+       pg_relation_size('gtt_test') as size;
+vacuum analyze gtt_test;
+select pg_relation_filenode('gtt_test') is null as no_storage;
+select count(*) from gtt_test;
+select pg_relation_filenode('gtt_test') is not null as table_storage,
+       pg_relation_filenode('gtt_test_pkey') is not null as index_storage;
+-- Unsupported cases.
+create global temp table gtt_oncommit (a int) on commit delete rows;
+create table gtt_child () inherits (gtt_test);
+alter table gtt_test set logged;
+cluster gtt_test using gtt_test_pkey;
+create global temp view gtt_view as select 1;
+drop table gtt_test;
+
 -- Tests with two-phase commit
 -- Transactions creating objects in a temporary namespace cannot be used
 -- with two-phase commit.
@@ -296,3 +296,32 @@ EXPLAIN (COSTS OFF) :qry;
 :qry;
 
 COMMIT;
+
+-- test on-disk sorts, hash joins and hash aggregation with compressed
+-- temporary files
+BEGIN;
+
+SET LOCAL enable_nestloop = off;
+SET LOCAL enable_hashjoin = off;
+SET LOCAL enable_material = off;
+SET LOCAL work_mem = '100kB';
+SET LOCAL temp_file_compression = pglz;
+
+:qry;
+
+SELECT count(*) FROM
+  (SELECT h, lag(h) OVER (ORDER BY h) AS prev
+   FROM (SELECT md5(g::text) AS h FROM generate_series(1, 50000) g) s) s
+WHERE prev > h;
+
+SET LOCAL enable_hashjoin = on;
+SET LOCAL enable_mergejoin = off;
+SELECT count(*), sum(a.g) FROM generate_series(1, 50000) a(g)
+  JOIN generate_series(1, 50000) b(g) ON a.g = b.g;
+
+SET LOCAL enable_sort = off;
+SELECT count(*), sum(c) FROM
+  (SELECT g % 20000 AS k, count(*) AS c
+   FROM generate_series(1, 100000) g GROUP BY 1) s;
+
+COMMIT;
@@ -93,6 +93,27 @@ VACUUM (PARALLEL 2) pvactst;
 UPDATE pvactst SET i = i WHERE i < 1000;
 VACUUM (PARALLEL 2) pvactst;
 
+-- VACUUM invokes parallel heap scan and heap vacuuming
+SET min_parallel_table_scan_size to 0;
+UPDATE pvactst SET i = i WHERE i < 1000;
+VACUUM (PARALLEL 2) pvactst;
+-- No rows may be lost, and the indexes must still find all of them
+SELECT count(*), sum(i) FROM pvactst;
+SET enable_seqscan TO off;
+SET enable_bitmapscan TO off;
+SELECT count(*), sum(i) FROM pvactst WHERE i BETWEEN 1 AND 1000;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+-- Tuples inserted by an aborted transaction are dead to everyone, so the
+-- parallel heap passes must remove them and truncate the pages they added
+SELECT pg_relation_size('pvactst') AS pvactst_size \gset
+BEGIN;
+INSERT INTO pvactst SELECT i, array[1,2,3], point(i, i+1) FROM generate_series(1001,5000) i;
+ROLLBACK;
+VACUUM (PARALLEL 2) pvactst;
+SELECT pg_relation_size('pvactst') <= :pvactst_size AS truncated;
+RESET min_parallel_table_scan_size;
+
 UPDATE pvactst SET i = i WHERE i < 1000;
 VACUUM (PARALLEL 0) pvactst; -- disable parallel vacuum
 